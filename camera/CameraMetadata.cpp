@@ -20,6 +20,8 @@
 #include <utils/Log.h>
 #include <utils/Errors.h>
 
+#include <atomic>
+
 #include <binder/Parcel.h>
 #include <camera/CameraMetadata.h>
 #include <camera_metadata_hidden.h>
@@ -32,22 +34,52 @@ namespace android {
 typedef Parcel::WritableBlob WritableBlob;
 typedef Parcel::ReadableBlob ReadableBlob;
 
+static std::atomic<uint64_t> sAllocations(0);
+static std::atomic<uint64_t> sBytesCopied(0);
+static std::atomic<uint64_t> sSharedCopies(0);
+
+struct CameraMetadata::SharedBuffer {
+    explicit SharedBuffer(camera_metadata_t *b) : buffer(b), refCount(1) {}
+
+    camera_metadata_t *buffer;
+    // Number of CameraMetadata objects sharing buffer.
+    std::atomic<int32_t> refCount;
+};
+
+static camera_metadata_t* allocateMetadata(size_t entryCapacity, size_t dataCapacity) {
+    camera_metadata_t *buffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    if (buffer != NULL) {
+        sAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
+static camera_metadata_t* cloneMetadata(const camera_metadata_t *src) {
+    camera_metadata_t *buffer = clone_camera_metadata(src);
+    if (buffer != NULL) {
+        sAllocations.fetch_add(1, std::memory_order_relaxed);
+        sBytesCopied.fetch_add(get_camera_metadata_size(src), std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
 CameraMetadata::CameraMetadata() :
-        mBuffer(NULL), mLocked(false) {
+        mShared(NULL), mLocked(false) {
 }
 
 CameraMetadata::CameraMetadata(size_t entryCapacity, size_t dataCapacity) :
-        mLocked(false)
+        mShared(NULL), mLocked(false)
 {
-    mBuffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    adopt(allocateMetadata(entryCapacity, dataCapacity));
 }
 
 CameraMetadata::CameraMetadata(const CameraMetadata &other) :
-        mLocked(false) {
-    mBuffer = clone_camera_metadata(other.mBuffer);
+        mShared(NULL), mLocked(false) {
+    share(other);
 }
 
-CameraMetadata::CameraMetadata(CameraMetadata &&other) :mBuffer(NULL),  mLocked(false) {
+CameraMetadata::CameraMetadata(CameraMetadata &&other) :
+        mShared(NULL), mLocked(false) {
     acquire(other);
 }
 
@@ -57,12 +89,21 @@ CameraMetadata &CameraMetadata::operator=(CameraMetadata &&other) {
 }
 
 CameraMetadata::CameraMetadata(camera_metadata_t *buffer) :
-        mBuffer(NULL), mLocked(false) {
+        mShared(NULL), mLocked(false) {
     acquire(buffer);
 }
 
 CameraMetadata &CameraMetadata::operator=(const CameraMetadata &other) {
-    return operator=(other.mBuffer);
+    if (mLocked) {
+        ALOGE("%s: Assignment to a locked CameraMetadata!", __FUNCTION__);
+        return *this;
+    }
+
+    if (CC_LIKELY(other.mShared != mShared)) {
+        clear();
+        share(other);
+    }
+    return *this;
 }
 
 CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
@@ -71,10 +112,10 @@ CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
         return *this;
     }
 
-    if (CC_LIKELY(buffer != mBuffer)) {
-        camera_metadata_t *newBuffer = clone_camera_metadata(buffer);
+    if (CC_LIKELY(buffer != rawBuffer())) {
+        camera_metadata_t *newBuffer = cloneMetadata(buffer);
         clear();
-        mBuffer = newBuffer;
+        adopt(newBuffer);
     }
     return *this;
 }
@@ -86,7 +127,19 @@ CameraMetadata::~CameraMetadata() {
 
 const camera_metadata_t* CameraMetadata::getAndLock() const {
     mLocked = true;
-    return mBuffer;
+    return rawBuffer();
+}
+
+camera_metadata_t* CameraMetadata::getAndLockForWrite() {
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return NULL;
+    }
+    if (detach() != OK) {
+        return NULL;
+    }
+    mLocked = true;
+    return rawBuffer();
 }
 
 status_t CameraMetadata::unlock(const camera_metadata_t *buffer) const {
@@ -94,7 +147,7 @@ status_t CameraMetadata::unlock(const camera_metadata_t *buffer) const {
         ALOGE("%s: Can't unlock a non-locked CameraMetadata!", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    if (buffer != mBuffer) {
+    if (buffer != rawBuffer()) {
         ALOGE("%s: Can't unlock CameraMetadata with wrong pointer!",
                 __FUNCTION__);
         return BAD_VALUE;
@@ -108,8 +161,16 @@ camera_metadata_t* CameraMetadata::release() {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return NULL;
     }
-    camera_metadata_t *released = mBuffer;
-    mBuffer = NULL;
+    camera_metadata_t *released;
+    if (mShared != NULL && mShared->refCount.load(std::memory_order_acquire) > 1) {
+        // The caller takes ownership, so it needs a buffer of its own.
+        released = cloneMetadata(mShared->buffer);
+        releaseRef();
+    } else {
+        released = rawBuffer();
+        delete mShared;
+        mShared = NULL;
+    }
     return released;
 }
 
@@ -118,10 +179,7 @@ void CameraMetadata::clear() {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return;
     }
-    if (mBuffer) {
-        free_camera_metadata(mBuffer);
-        mBuffer = NULL;
-    }
+    releaseRef();
 }
 
 void CameraMetadata::acquire(camera_metadata_t *buffer) {
@@ -130,9 +188,9 @@ void CameraMetadata::acquire(camera_metadata_t *buffer) {
         return;
     }
     clear();
-    mBuffer = buffer;
+    adopt(buffer);
 
-    ALOGE_IF(validate_camera_metadata_structure(mBuffer, /*size*/NULL) != OK,
+    ALOGE_IF(validate_camera_metadata_structure(rawBuffer(), /*size*/NULL) != OK,
              "%s: Failed to validate metadata structure %p",
              __FUNCTION__, buffer);
 }
@@ -142,11 +200,68 @@ void CameraMetadata::acquire(CameraMetadata &other) {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return;
     }
-    acquire(other.release());
+    if (&other == this) {
+        return;
+    }
+    if (other.mLocked) {
+        ALOGE("%s: Other CameraMetadata is locked", __FUNCTION__);
+        clear();
+        return;
+    }
+    // Take over other's reference, whether or not the buffer is shared.
+    clear();
+    mShared = other.mShared;
+    other.mShared = NULL;
+}
+
+camera_metadata_t* CameraMetadata::rawBuffer() const {
+    return (mShared != NULL) ? mShared->buffer : NULL;
+}
+
+void CameraMetadata::adopt(camera_metadata_t *buffer) {
+    mShared = (buffer != NULL) ? new SharedBuffer(buffer) : NULL;
+}
+
+void CameraMetadata::share(const CameraMetadata &other) {
+    mShared = other.mShared;
+    if (mShared != NULL) {
+        mShared->refCount.fetch_add(1, std::memory_order_relaxed);
+        sSharedCopies.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CameraMetadata::releaseRef() {
+    if (mShared != NULL && mShared->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        free_camera_metadata(mShared->buffer);
+        delete mShared;
+    }
+    mShared = NULL;
+}
+
+status_t CameraMetadata::detach() {
+    if (mShared == NULL || mShared->refCount.load(std::memory_order_acquire) == 1) {
+        return OK;
+    }
+    camera_metadata_t *copy = cloneMetadata(mShared->buffer);
+    if (copy == NULL) {
+        ALOGE("%s: Failed to clone shared metadata buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    releaseRef();
+    adopt(copy);
+    return OK;
+}
+
+CameraMetadata::AllocationStats CameraMetadata::getAllocationStats() {
+    AllocationStats stats;
+    stats.allocations = sAllocations.load(std::memory_order_relaxed);
+    stats.bytesCopied = sBytesCopied.load(std::memory_order_relaxed);
+    stats.sharedCopies = sSharedCopies.load(std::memory_order_relaxed);
+    return stats;
 }
 
 status_t CameraMetadata::append(const CameraMetadata &other) {
-    return append(other.mBuffer);
+    return append(other.rawBuffer());
 }
 
 status_t CameraMetadata::append(const camera_metadata_t* other) {
@@ -154,16 +269,20 @@ status_t CameraMetadata::append(const camera_metadata_t* other) {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return INVALID_OPERATION;
     }
+    status_t res = detach();
+    if (res != OK) {
+        return res;
+    }
     size_t extraEntries = get_camera_metadata_entry_count(other);
     size_t extraData = get_camera_metadata_data_count(other);
     resizeIfNeeded(extraEntries, extraData);
 
-    return append_camera_metadata(mBuffer, other);
+    return append_camera_metadata(rawBuffer(), other);
 }
 
 size_t CameraMetadata::entryCount() const {
-    return (mBuffer == NULL) ? 0 :
-            get_camera_metadata_entry_count(mBuffer);
+    return (rawBuffer() == NULL) ? 0 :
+            get_camera_metadata_entry_count(rawBuffer());
 }
 
 bool CameraMetadata::isEmpty() const {
@@ -171,8 +290,8 @@ bool CameraMetadata::isEmpty() const {
 }
 
 size_t CameraMetadata::bufferSize() const {
-    return (mBuffer == NULL) ? 0 :
-            get_camera_metadata_size(mBuffer);
+    return (rawBuffer() == NULL) ? 0 :
+            get_camera_metadata_size(rawBuffer());
 }
 
 status_t CameraMetadata::sort() {
@@ -180,11 +299,16 @@ status_t CameraMetadata::sort() {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    return sort_camera_metadata(mBuffer);
+    // Sorting moves entries around, which readers of a shared buffer must not see.
+    status_t res = detach();
+    if (res != OK) {
+        return res;
+    }
+    return sort_camera_metadata(rawBuffer());
 }
 
 status_t CameraMetadata::checkType(uint32_t tag, uint8_t expectedType) {
-    int tagType = get_local_camera_metadata_tag_type(tag, mBuffer);
+    int tagType = get_local_camera_metadata_tag_type(tag, rawBuffer());
     if ( CC_UNLIKELY(tagType == -1)) {
         ALOGE("Update metadata entry: Unknown tag %d", tag);
         return INVALID_OPERATION;
@@ -192,7 +316,7 @@ status_t CameraMetadata::checkType(uint32_t tag, uint8_t expectedType) {
     if ( CC_UNLIKELY(tagType != expectedType) ) {
         ALOGE("Mismatched tag type when updating entry %s (%d) of type %s; "
                 "got type %s data instead ",
-                get_local_camera_metadata_tag_name(tag, mBuffer), tag,
+                get_local_camera_metadata_tag_name(tag, rawBuffer()), tag,
                 camera_metadata_type_names[tagType],
                 camera_metadata_type_names[expectedType]);
         return INVALID_OPERATION;
@@ -311,15 +435,21 @@ status_t CameraMetadata::updateImpl(uint32_t tag, const void *data,
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    int type = get_local_camera_metadata_tag_type(tag, mBuffer);
+    int type = get_local_camera_metadata_tag_type(tag, rawBuffer());
     if (type == -1) {
         ALOGE("%s: Tag %d not found", __FUNCTION__, tag);
         return BAD_VALUE;
     }
+    // If data points into a shared buffer, that buffer stays alive with the
+    // other owners after detaching.
+    res = detach();
+    if (res != OK) {
+        return res;
+    }
     // Safety check - ensure that data isn't pointing to this metadata, since
     // that would get invalidated if a resize is needed
-    size_t bufferSize = get_camera_metadata_size(mBuffer);
-    uintptr_t bufAddr = reinterpret_cast<uintptr_t>(mBuffer);
+    size_t bufferSize = get_camera_metadata_size(rawBuffer());
+    uintptr_t bufAddr = reinterpret_cast<uintptr_t>(rawBuffer());
     uintptr_t dataAddr = reinterpret_cast<uintptr_t>(data);
     if (dataAddr > bufAddr && dataAddr < (bufAddr + bufferSize)) {
         ALOGE("%s: Update attempted with data from the same metadata buffer!",
@@ -334,29 +464,29 @@ status_t CameraMetadata::updateImpl(uint32_t tag, const void *data,
 
     if (res == OK) {
         camera_metadata_entry_t entry;
-        res = find_camera_metadata_entry(mBuffer, tag, &entry);
+        res = find_camera_metadata_entry(rawBuffer(), tag, &entry);
         if (res == NAME_NOT_FOUND) {
-            res = add_camera_metadata_entry(mBuffer,
+            res = add_camera_metadata_entry(rawBuffer(),
                     tag, data, data_count);
         } else if (res == OK) {
-            res = update_camera_metadata_entry(mBuffer,
+            res = update_camera_metadata_entry(rawBuffer(),
                     entry.index, data, data_count, NULL);
         }
     }
 
     if (res != OK) {
         ALOGE("%s: Unable to update metadata entry %s.%s (%x): %s (%d)",
-                __FUNCTION__, get_local_camera_metadata_section_name(tag, mBuffer),
-                get_local_camera_metadata_tag_name(tag, mBuffer), tag,
+                __FUNCTION__, get_local_camera_metadata_section_name(tag, rawBuffer()),
+                get_local_camera_metadata_tag_name(tag, rawBuffer()), tag,
                 strerror(-res), res);
     }
 
     IF_ALOGV() {
-        ALOGE_IF(validate_camera_metadata_structure(mBuffer, /*size*/NULL) !=
+        ALOGE_IF(validate_camera_metadata_structure(rawBuffer(), /*size*/NULL) !=
                  OK,
 
                  "%s: Failed to validate metadata structure after update %p",
-                 __FUNCTION__, mBuffer);
+                 __FUNCTION__, rawBuffer());
     }
 
     return res;
@@ -364,7 +494,7 @@ status_t CameraMetadata::updateImpl(uint32_t tag, const void *data,
 
 bool CameraMetadata::exists(uint32_t tag) const {
     camera_metadata_ro_entry entry;
-    return find_camera_metadata_ro_entry(mBuffer, tag, &entry) == 0;
+    return find_camera_metadata_ro_entry(rawBuffer(), tag, &entry) == 0;
 }
 
 camera_metadata_entry_t CameraMetadata::find(uint32_t tag) {
@@ -375,7 +505,7 @@ camera_metadata_entry_t CameraMetadata::find(uint32_t tag) {
         entry.count = 0;
         return entry;
     }
-    res = find_camera_metadata_entry(mBuffer, tag, &entry);
+    res = find_camera_metadata_entry(rawBuffer(), tag, &entry);
     if (CC_UNLIKELY( res != OK )) {
         entry.count = 0;
         entry.data.u8 = NULL;
@@ -383,10 +513,26 @@ camera_metadata_entry_t CameraMetadata::find(uint32_t tag) {
     return entry;
 }
 
+camera_metadata_entry_t CameraMetadata::findForWrite(uint32_t tag) {
+    camera_metadata_entry entry;
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        entry.count = 0;
+        entry.data.u8 = NULL;
+        return entry;
+    }
+    if (detach() != OK) {
+        entry.count = 0;
+        entry.data.u8 = NULL;
+        return entry;
+    }
+    return find(tag);
+}
+
 camera_metadata_ro_entry_t CameraMetadata::find(uint32_t tag) const {
     status_t res;
     camera_metadata_ro_entry entry;
-    res = find_camera_metadata_ro_entry(mBuffer, tag, &entry);
+    res = find_camera_metadata_ro_entry(rawBuffer(), tag, &entry);
     if (CC_UNLIKELY( res != OK )) {
         entry.count = 0;
         entry.data.u8 = NULL;
@@ -401,23 +547,31 @@ status_t CameraMetadata::erase(uint32_t tag) {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    res = find_camera_metadata_entry(mBuffer, tag, &entry);
+    // Only detach from a shared buffer if there is something to erase.
+    if (!exists(tag)) {
+        return OK;
+    }
+    res = detach();
+    if (res != OK) {
+        return res;
+    }
+    res = find_camera_metadata_entry(rawBuffer(), tag, &entry);
     if (res == NAME_NOT_FOUND) {
         return OK;
     } else if (res != OK) {
         ALOGE("%s: Error looking for entry %s.%s (%x): %s %d",
                 __FUNCTION__,
-                get_local_camera_metadata_section_name(tag, mBuffer),
-                get_local_camera_metadata_tag_name(tag, mBuffer),
+                get_local_camera_metadata_section_name(tag, rawBuffer()),
+                get_local_camera_metadata_tag_name(tag, rawBuffer()),
                 tag, strerror(-res), res);
         return res;
     }
-    res = delete_camera_metadata_entry(mBuffer, entry.index);
+    res = delete_camera_metadata_entry(rawBuffer(), entry.index);
     if (res != OK) {
         ALOGE("%s: Error deleting entry %s.%s (%x): %s %d",
                 __FUNCTION__,
-                get_local_camera_metadata_section_name(tag, mBuffer),
-                get_local_camera_metadata_tag_name(tag, mBuffer),
+                get_local_camera_metadata_section_name(tag, rawBuffer()),
+                get_local_camera_metadata_tag_name(tag, rawBuffer()),
                 tag, strerror(-res), res);
     }
     return res;
@@ -497,26 +651,26 @@ status_t CameraMetadata::removePermissionEntries(metadata_vendor_id_t vendorId,
 }
 
 void CameraMetadata::dump(int fd, int verbosity, int indentation) const {
-    dump_indented_camera_metadata(mBuffer, fd, verbosity, indentation);
+    dump_indented_camera_metadata(rawBuffer(), fd, verbosity, indentation);
 }
 
 status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
-    if (mBuffer == NULL) {
-        mBuffer = allocate_camera_metadata(extraEntries * 2, extraData * 2);
-        if (mBuffer == NULL) {
+    if (rawBuffer() == NULL) {
+        adopt(allocateMetadata(extraEntries * 2, extraData * 2));
+        if (rawBuffer() == NULL) {
             ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
             return NO_MEMORY;
         }
     } else {
-        size_t currentEntryCount = get_camera_metadata_entry_count(mBuffer);
-        size_t currentEntryCap = get_camera_metadata_entry_capacity(mBuffer);
+        size_t currentEntryCount = get_camera_metadata_entry_count(rawBuffer());
+        size_t currentEntryCap = get_camera_metadata_entry_capacity(rawBuffer());
         size_t newEntryCount = currentEntryCount +
                 extraEntries;
         newEntryCount = (newEntryCount > currentEntryCap) ?
                 newEntryCount * 2 : currentEntryCap;
 
-        size_t currentDataCount = get_camera_metadata_data_count(mBuffer);
-        size_t currentDataCap = get_camera_metadata_data_capacity(mBuffer);
+        size_t currentDataCount = get_camera_metadata_data_count(rawBuffer());
+        size_t currentDataCap = get_camera_metadata_data_capacity(rawBuffer());
         size_t newDataCount = currentDataCount +
                 extraData;
         newDataCount = (newDataCount > currentDataCap) ?
@@ -524,16 +678,19 @@ status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
 
         if (newEntryCount > currentEntryCap ||
                 newDataCount > currentDataCap) {
-            camera_metadata_t *oldBuffer = mBuffer;
-            mBuffer = allocate_camera_metadata(newEntryCount,
+            // Callers detach before resizing, so the buffer isn't shared here.
+            camera_metadata_t *oldBuffer = mShared->buffer;
+            camera_metadata_t *newBuffer = allocateMetadata(newEntryCount,
                     newDataCount);
-            if (mBuffer == NULL) {
+            if (newBuffer == NULL) {
                 // Maintain old buffer to avoid potential memory leak.
-                mBuffer = oldBuffer;
                 ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
                 return NO_MEMORY;
             }
-            append_camera_metadata(mBuffer, oldBuffer);
+            append_camera_metadata(newBuffer, oldBuffer);
+            mShared->buffer = newBuffer;
+            sBytesCopied.fetch_add(get_camera_metadata_size(oldBuffer),
+                    std::memory_order_relaxed);
             free_camera_metadata(oldBuffer);
         }
     }
@@ -616,6 +773,9 @@ status_t CameraMetadata::readFromParcel(const Parcel& data,
             // also failed, therefore the readFromParcel was a failure.
             ALOGE("%s: metadata allocation and copy failed", __FUNCTION__);
             err = BAD_VALUE;
+        } else {
+            sAllocations.fetch_add(1, std::memory_order_relaxed);
+            sBytesCopied.fetch_add(metadataSize, std::memory_order_relaxed);
         }
     } while(0);
     blob.release();
@@ -753,7 +913,7 @@ status_t CameraMetadata::readFromParcel(const Parcel *parcel) {
     }
 
     clear();
-    mBuffer = buffer;
+    adopt(buffer);
 
     return OK;
 }
@@ -767,7 +927,7 @@ status_t CameraMetadata::writeToParcel(Parcel *parcel) const {
         return BAD_VALUE;
     }
 
-    return CameraMetadata::writeToParcel(*parcel, mBuffer);
+    return CameraMetadata::writeToParcel(*parcel, rawBuffer());
 }
 
 void CameraMetadata::swap(CameraMetadata& other) {
@@ -779,11 +939,11 @@ void CameraMetadata::swap(CameraMetadata& other) {
         return;
     }
 
-    camera_metadata* thisBuf = mBuffer;
-    camera_metadata* otherBuf = other.mBuffer;
+    SharedBuffer* thisShared = mShared;
+    SharedBuffer* otherShared = other.mShared;
 
-    other.mBuffer = thisBuf;
-    mBuffer = otherBuf;
+    other.mShared = thisShared;
+    mShared = otherShared;
 }
 
 status_t CameraMetadata::getTagFromName(const char *name,
@@ -881,7 +1041,7 @@ status_t CameraMetadata::getTagFromName(const char *name,
 }
 
 metadata_vendor_id_t CameraMetadata::getVendorId() {
-    return get_camera_metadata_vendor_id(mBuffer);
+    return get_camera_metadata_vendor_id(rawBuffer());
 }
 
 }; // namespace android
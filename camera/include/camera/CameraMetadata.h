@@ -30,6 +30,9 @@ class VendorTagDescriptor;
 
 /**
  * A convenience wrapper around the C-based camera_metadata_t library.
+ *
+ * Copies are copy-on-write: copying a CameraMetadata shares the underlying
+ * buffer, which is only cloned once one of the sharing objects is modified.
  */
 class CameraMetadata: public Parcelable {
   public:
@@ -49,11 +52,12 @@ class CameraMetadata: public Parcelable {
 
     /** Takes ownership of passed-in buffer */
     CameraMetadata(camera_metadata_t *buffer);
-    /** Clones the metadata */
+    /** Shares the metadata buffer until either object is modified */
     CameraMetadata(const CameraMetadata &other);
 
     /**
-     * Assignment clones metadata buffer.
+     * Assignment from another CameraMetadata shares its metadata buffer until
+     * either object is modified. Assignment from a raw buffer clones it.
      */
     CameraMetadata &operator=(const CameraMetadata &other);
     CameraMetadata &operator=(const camera_metadata_t *buffer);
@@ -72,6 +76,13 @@ class CameraMetadata: public Parcelable {
      */
     const camera_metadata_t* getAndLock() const;
 
+    /**
+     * Same as getAndLock(), but first makes sure the buffer isn't shared with
+     * any other CameraMetadata object, so that the caller may modify it in
+     * place. Must be unlocked with unlock() as well.
+     */
+    camera_metadata_t* getAndLockForWrite();
+
     /**
      * Unlock the CameraMetadata for use again. After this unlock, the pointer
      * given from getAndLock() may no longer be used. The pointer passed out
@@ -171,10 +182,17 @@ class CameraMetadata: public Parcelable {
     bool exists(uint32_t tag) const;
 
     /**
-     * Get metadata entry by tag id
+     * Get metadata entry by tag id. The buffer may be shared with copies of
+     * this object, so the entry must not be modified; use findForWrite().
      */
     camera_metadata_entry find(uint32_t tag);
 
+    /**
+     * Get metadata entry by tag id, to modify its data in place. The buffer
+     * is first cloned if it's shared with copies of this object.
+     */
+    camera_metadata_entry findForWrite(uint32_t tag);
+
     /**
      * Get metadata entry by tag id, with no editing
      */
@@ -247,10 +265,57 @@ class CameraMetadata: public Parcelable {
      */
     metadata_vendor_id_t getVendorId();
 
+    /**
+     * Process-wide metadata buffer allocation statistics.
+     */
+    struct AllocationStats {
+        // Metadata buffers allocated, including clones and resizes
+        uint64_t allocations;
+        // Bytes copied into newly allocated buffers
+        uint64_t bytesCopied;
+        // Copies that shared a buffer instead of cloning it
+        uint64_t sharedCopies;
+    };
+    static AllocationStats getAllocationStats();
+
   private:
-    camera_metadata_t *mBuffer;
+    struct SharedBuffer;
+
+    // The metadata buffer with its share count, NULL when there's no buffer.
+    // A single pointer, so that the layout of this exported class is the same
+    // as when it held the buffer pointer directly.
+    SharedBuffer      *mShared;
     mutable bool       mLocked;
 
+    /**
+     * The metadata buffer, or NULL
+     */
+    camera_metadata_t* rawBuffer() const;
+
+    /**
+     * Take ownership of a buffer that isn't shared yet. The current buffer
+     * must already have been released.
+     */
+    void adopt(camera_metadata_t *buffer);
+
+    /**
+     * Share the buffer of another CameraMetadata. The current buffer must
+     * already have been released.
+     */
+    void share(const CameraMetadata &other);
+
+    /**
+     * Drop this object's reference to its buffer, freeing the buffer when it
+     * was the last one.
+     */
+    void releaseRef();
+
+    /**
+     * Clone the buffer if it's shared with another CameraMetadata, so that it
+     * can be modified.
+     */
+    status_t detach();
+
     /**
      * Check if tag has a given type
      */
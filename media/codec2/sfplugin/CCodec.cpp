@@ -1913,6 +1913,10 @@ void CCodec::stop(bool pushBlankBuffer) {
     }
     status_t err = comp->stop();
     mChannel->stopUseOutputSurface(pushBlankBuffer);
+    std::string latency = mChannel->dumpPipelineLatency();
+    if (!latency.empty()) {
+        ALOGI("[%s] pipeline latency:\n%s", comp->getName().c_str(), latency.c_str());
+    }
     if (err != C2_OK) {
         // TODO: convert err into status_t
         mCallback->onError(UNKNOWN_ERROR, ACTION_CODE_FATAL);
@@ -190,6 +190,7 @@ CCodecBufferChannel::CCodecBufferChannel(
     std::string value = GetServerConfigurableFlag("media_native", "ccodec_rendering_depth", "3");
     android::base::ParseInt(value, &mRenderingDepth);
     mOutputSurface.lock()->maxDequeueBuffers = kSmoothnessFactor + mRenderingDepth;
+    mPipelineLatencyStats = mPipelineWatcher.lock()->latencyStats();
 }
 
 CCodecBufferChannel::~CCodecBufferChannel() {
@@ -829,6 +830,13 @@ status_t CCodecBufferChannel::renderOutputBuffer(
         }
         return INVALID_OPERATION;
     }
+    {
+        int64_t frameIndex;
+        if (buffer->meta()->findInt64("frameIndex", &frameIndex)) {
+            mPipelineWatcher.lock()->onOutputRendered(
+                    frameIndex, PipelineWatcher::Clock::now());
+        }
+    }
 
 #if 0
     const std::vector<std::shared_ptr<const C2Info>> infoParams = c2Buffer->info();
@@ -1936,8 +1944,19 @@ bool CCodecBufferChannel::handleWork(
             || !work->worklets.front()
             || !(work->worklets.front()->output.flags &
                  C2FrameData::FLAG_INCOMPLETE))) {
-        mPipelineWatcher.lock()->onWorkDone(
-                work->input.ordinal.frameIndex.peeku());
+        if (notifyClient) {
+            // The output buffer reports rendering under its output ordinal.
+            uint64_t outputFrameIndex = work->input.ordinal.frameIndex.peeku();
+            if (work->worklets.size() == 1u && work->worklets.front()) {
+                outputFrameIndex = work->worklets.front()->output.ordinal.frameIndex.peeku();
+            }
+            mPipelineWatcher.lock()->onWorkDone(
+                    work->input.ordinal.frameIndex.peeku(), outputFrameIndex,
+                    PipelineWatcher::Clock::now());
+        } else {
+            mPipelineWatcher.lock()->onWorkDone(
+                    work->input.ordinal.frameIndex.peeku());
+        }
     }
 
     // NOTE: MediaCodec usage supposedly have only one worklet
@@ -2380,6 +2399,25 @@ PipelineWatcher::Clock::duration CCodecBufferChannel::elapsed() {
     return mPipelineWatcher.lock()->elapsed(PipelineWatcher::Clock::now(), n);
 }
 
+void CCodecBufferChannel::getPipelineLatencyMetrics(const sp<AMessage> &metrics) {
+    for (size_t i = 0; i < PipelineLatencyStats::STAGE_COUNT; ++i) {
+        const PipelineLatencyHistogram &hist = mPipelineLatencyStats->histograms[i];
+        if (hist.count() == 0) {
+            continue;
+        }
+        std::string prefix = std::string("pipeline.")
+                + PipelineLatencyStats::AsString(PipelineLatencyStats::Stage(i));
+        metrics->setInt64((prefix + ".p50").c_str(), hist.percentile(50));
+        metrics->setInt64((prefix + ".p95").c_str(), hist.percentile(95));
+        metrics->setInt64((prefix + ".p99").c_str(), hist.percentile(99));
+        metrics->setInt64((prefix + ".n").c_str(), hist.count());
+    }
+}
+
+std::string CCodecBufferChannel::dumpPipelineLatency() {
+    return mPipelineLatencyStats->toString();
+}
+
 void CCodecBufferChannel::setMetaMode(MetaMode mode) {
     mMetaMode = mode;
 }
@@ -200,6 +200,13 @@ public:
 
     PipelineWatcher::Clock::duration elapsed();
 
+    void getPipelineLatencyMetrics(const sp<AMessage> &metrics) override;
+
+    /**
+     * \return  human-readable per-stage pipeline latency percentiles.
+     */
+    std::string dumpPipelineLatency();
+
     enum MetaMode {
         MODE_NONE,
         MODE_ANW,
@@ -363,6 +370,8 @@ private:
     MetaMode mMetaMode;
 
     Mutexed<PipelineWatcher> mPipelineWatcher;
+    // read without holding mPipelineWatcher
+    std::shared_ptr<const PipelineLatencyStats> mPipelineLatencyStats;
 
     std::atomic_bool mInputMetEos;
     std::once_flag mRenderWarningFlag;
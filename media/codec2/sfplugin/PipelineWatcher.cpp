@@ -17,14 +17,104 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "PipelineWatcher"
 
+#include <algorithm>
 #include <numeric>
 
+#include <android-base/stringprintf.h>
 #include <log/log.h>
 
 #include "PipelineWatcher.h"
 
 namespace android {
 
+using ::android::base::StringAppendF;
+
+// static
+size_t PipelineLatencyHistogram::BucketOf(uint64_t us) {
+    if (us < kSubBuckets) {
+        return us;
+    }
+    // index of the most significant bit, and the kSubBucketBits bits below it
+    size_t msb = 63 - __builtin_clzll(us);
+    size_t sub = (us >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+    size_t bucket = (msb - kSubBucketBits + 1) * kSubBuckets + sub;
+    return std::min(bucket, kBuckets - 1);
+}
+
+// static
+uint64_t PipelineLatencyHistogram::UpperBoundOf(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t msb = bucket / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = bucket % kSubBuckets;
+    return ((kSubBuckets + sub + 1) << (msb - kSubBucketBits)) - 1;
+}
+
+void PipelineLatencyHistogram::record(int64_t us) {
+    mBuckets[BucketOf(us < 0 ? 0 : us)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineLatencyHistogram::clear() {
+    for (std::atomic<uint64_t> &bucket : mBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+}
+
+int64_t PipelineLatencyHistogram::percentile(double p) const {
+    // Sum up the buckets instead of trusting mCount, which may be ahead of
+    // the buckets if record() is running concurrently.
+    std::array<uint64_t, kBuckets> snapshot;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        snapshot[i] = mBuckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    p = std::clamp(p, 0.0, 100.0);
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * total / 100.0 + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += snapshot[i];
+        if (seen >= rank) {
+            return UpperBoundOf(i);
+        }
+    }
+    return UpperBoundOf(kBuckets - 1);
+}
+
+// static
+const char *PipelineLatencyStats::AsString(Stage stage) {
+    switch (stage) {
+        case STAGE_INPUT_CONSUMED:  return "input-consumed";
+        case STAGE_OUTPUT_READY:    return "output-ready";
+        case STAGE_RENDER:          return "render";
+        case STAGE_TOTAL:           return "total";
+        default:                    return "unknown";
+    }
+}
+
+std::string PipelineLatencyStats::toString() const {
+    std::string str;
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        const PipelineLatencyHistogram &hist = histograms[i];
+        if (hist.count() == 0) {
+            continue;
+        }
+        StringAppendF(&str, "%s: n=%llu p50=%lldus p95=%lldus p99=%lldus\n",
+                      AsString(Stage(i)),
+                      (unsigned long long)hist.count(),
+                      (long long)hist.percentile(50),
+                      (long long)hist.percentile(95),
+                      (long long)hist.percentile(99));
+    }
+    return str;
+}
+
 PipelineWatcher &PipelineWatcher::inputDelay(uint32_t value) {
     mInputDelay = value;
     return *this;
@@ -80,6 +170,16 @@ std::shared_ptr<C2Buffer> PipelineWatcher::onInputBufferReleased(
     std::shared_ptr<C2Buffer> buffer(std::move(it->second.buffers[arrayIndex]));
     ALOGD_IF(!buffer, "onInputBufferReleased: buffer already released (%llu:%zu)",
              (unsigned long long)frameIndex, arrayIndex);
+    if (buffer && !it->second.inputConsumed) {
+        bool allReleased = std::none_of(
+                it->second.buffers.begin(), it->second.buffers.end(),
+                [](const std::shared_ptr<C2Buffer> &b) { return b != nullptr; });
+        if (allReleased) {
+            it->second.inputConsumed = true;
+            recordLatency(PipelineLatencyStats::STAGE_INPUT_CONSUMED,
+                          it->second.queuedAt, Clock::now());
+        }
+    }
     return buffer;
 }
 
@@ -94,9 +194,58 @@ void PipelineWatcher::onWorkDone(uint64_t frameIndex) {
     (void)mFramesInPipeline.erase(it);
 }
 
+void PipelineWatcher::onWorkDone(
+        uint64_t frameIndex, uint64_t outputFrameIndex, const Clock::time_point &doneAt) {
+    ALOGV("onWorkDone(frameIndex=%llu, outputFrameIndex=%llu, doneAt=%lld)",
+          (unsigned long long)frameIndex, (unsigned long long)outputFrameIndex,
+          (long long)doneAt.time_since_epoch().count());
+    auto it = mFramesInPipeline.find(frameIndex);
+    if (it == mFramesInPipeline.end()) {
+        ALOGD("onWorkDone: frameIndex not found (%llu); ignored",
+              (unsigned long long)frameIndex);
+        return;
+    }
+    const Clock::time_point queuedAt = it->second.queuedAt;
+    if (!it->second.inputConsumed) {
+        // The component did not report input buffers separately.
+        recordLatency(PipelineLatencyStats::STAGE_INPUT_CONSUMED, queuedAt, doneAt);
+    }
+    recordLatency(PipelineLatencyStats::STAGE_OUTPUT_READY, queuedAt, doneAt);
+    (void)mFramesInPipeline.erase(it);
+
+    if (mFramesReady.size() >= kMaxReadyFrames) {
+        (void)mFramesReady.erase(mFramesReady.begin());
+    }
+    mFramesReady[outputFrameIndex] = ReadyFrame{queuedAt, doneAt};
+}
+
+void PipelineWatcher::onOutputRendered(
+        uint64_t frameIndex, const Clock::time_point &renderedAt) {
+    ALOGV("onOutputRendered(frameIndex=%llu, renderedAt=%lld)",
+          (unsigned long long)frameIndex, (long long)renderedAt.time_since_epoch().count());
+    auto it = mFramesReady.find(frameIndex);
+    if (it == mFramesReady.end()) {
+        ALOGV("onOutputRendered: frameIndex not found (%llu); ignored",
+              (unsigned long long)frameIndex);
+        return;
+    }
+    recordLatency(PipelineLatencyStats::STAGE_RENDER, it->second.doneAt, renderedAt);
+    recordLatency(PipelineLatencyStats::STAGE_TOTAL, it->second.queuedAt, renderedAt);
+    (void)mFramesReady.erase(it);
+}
+
 void PipelineWatcher::flush() {
     ALOGV("flush");
     mFramesInPipeline.clear();
+    mFramesReady.clear();
+}
+
+void PipelineWatcher::recordLatency(
+        PipelineLatencyStats::Stage stage,
+        const Clock::time_point &from,
+        const Clock::time_point &to) {
+    mLatencyStats->histograms[stage].record(
+            std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
 }
 
 bool PipelineWatcher::pipelineFull() const {
@@ -17,14 +17,90 @@
 #ifndef PIPELINE_WATCHER_H_
 #define PIPELINE_WATCHER_H_
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <memory>
+#include <string>
 
 #include <C2Work.h>
 
 namespace android {
 
+/**
+ * PipelineLatencyHistogram is a lock-free histogram of latency samples with
+ * logarithmically sized buckets. Each power of two is split into
+ * kSubBuckets linear sub-buckets, which bounds the relative error of the
+ * reported percentiles to 1 / kSubBuckets.
+ *
+ * record() may be called concurrently with the accessors.
+ */
+class PipelineLatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 2;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    // enough buckets to cover 2^40 us (~12 days)
+    static constexpr size_t kBuckets = 40 * kSubBuckets;
+
+    PipelineLatencyHistogram() { clear(); }
+
+    /**
+     * Record a latency sample.
+     *
+     * \param us  latency in microseconds; negative values are counted as 0.
+     */
+    void record(int64_t us);
+
+    /**
+     * Clear all samples.
+     */
+    void clear();
+
+    /**
+     * \return  number of samples recorded so far.
+     */
+    uint64_t count() const { return mCount.load(std::memory_order_relaxed); }
+
+    /**
+     * \param p  percentile in [0, 100]
+     * \return  approximate latency in microseconds at percentile |p|, or 0
+     *          if there are no samples.
+     */
+    int64_t percentile(double p) const;
+
+private:
+    static size_t BucketOf(uint64_t us);
+    static uint64_t UpperBoundOf(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, kBuckets> mBuckets;
+    std::atomic<uint64_t> mCount;
+};
+
+/**
+ * Latency histograms of each stage of the pipeline, as observed by
+ * PipelineWatcher.
+ */
+struct PipelineLatencyStats {
+    enum Stage : size_t {
+        STAGE_INPUT_CONSUMED,   ///< queued -> all input buffers released
+        STAGE_OUTPUT_READY,     ///< queued -> work done
+        STAGE_RENDER,           ///< work done -> output rendered
+        STAGE_TOTAL,            ///< queued -> output rendered
+        STAGE_COUNT,
+    };
+
+    static const char *AsString(Stage stage);
+
+    /**
+     * \return  one line per stage with the sample count and p50/p95/p99
+     *          latencies, or an empty string if no sample was recorded.
+     */
+    std::string toString() const;
+
+    std::array<PipelineLatencyHistogram, STAGE_COUNT> histograms;
+};
+
 /**
  * PipelineWatcher watches the pipeline and infers the status of work items from
  * events.
@@ -37,7 +113,8 @@ public:
         : mInputDelay(0),
           mPipelineDelay(0),
           mOutputDelay(0),
-          mSmoothnessFactor(0) {}
+          mSmoothnessFactor(0),
+          mLatencyStats(std::make_shared<PipelineLatencyStats>()) {}
     ~PipelineWatcher() = default;
 
     /**
@@ -94,6 +171,27 @@ public:
      */
     void onWorkDone(uint64_t frameIndex);
 
+    /**
+     * The component finished processing a work item and the output is
+     * ready to be delivered to the client. Unlike the variant above, this
+     * records the latency of the work item.
+     *
+     * \param frameIndex        input frame index
+     * \param outputFrameIndex  frame index of the output ordinal, which the
+     *                          output buffer carries to onOutputRendered()
+     * \param doneAt            time when the output became ready
+     */
+    void onWorkDone(
+            uint64_t frameIndex, uint64_t outputFrameIndex, const Clock::time_point &doneAt);
+
+    /**
+     * The client rendered the output of a work item.
+     *
+     * \param frameIndex  frame index of the output ordinal
+     * \param renderedAt  time when the client requested rendering
+     */
+    void onOutputRendered(uint64_t frameIndex, const Clock::time_point &renderedAt);
+
     /**
      * Flush the pipeline.
      */
@@ -117,6 +215,14 @@ public:
      */
     Clock::duration elapsed(const Clock::time_point &now, size_t n) const;
 
+    /**
+     * \return  per-stage latency statistics. The returned object may be
+     *          accessed without holding any lock on this object.
+     */
+    std::shared_ptr<const PipelineLatencyStats> latencyStats() const {
+        return mLatencyStats;
+    }
+
 private:
     uint32_t mInputDelay;
     uint32_t mPipelineDelay;
@@ -127,11 +233,30 @@ private:
         Frame(std::vector<std::shared_ptr<C2Buffer>> &&b,
               const Clock::time_point &q)
             : buffers(b),
-              queuedAt(q) {}
+              queuedAt(q),
+              inputConsumed(false) {}
         std::vector<std::shared_ptr<C2Buffer>> buffers;
         const Clock::time_point queuedAt;
+        bool inputConsumed;
     };
     std::map<uint64_t, Frame> mFramesInPipeline;
+
+    struct ReadyFrame {
+        Clock::time_point queuedAt;
+        Clock::time_point doneAt;
+    };
+    // Frames whose output is ready but not yet rendered, keyed by the frame
+    // index of the output ordinal. Bounded by kMaxReadyFrames as outputs that
+    // are never rendered are not reported.
+    static constexpr size_t kMaxReadyFrames = 64;
+    std::map<uint64_t, ReadyFrame> mFramesReady;
+
+    std::shared_ptr<PipelineLatencyStats> mLatencyStats;
+
+    void recordLatency(
+            PipelineLatencyStats::Stage stage,
+            const Clock::time_point &from,
+            const Clock::time_point &to);
 };
 
 }  // namespace android
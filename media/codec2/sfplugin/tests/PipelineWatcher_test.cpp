@@ -0,0 +1,133 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PipelineWatcher.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+using namespace std::chrono_literals;
+
+TEST(PipelineLatencyHistogramTest, Empty) {
+    PipelineLatencyHistogram hist;
+    EXPECT_EQ(0u, hist.count());
+    EXPECT_EQ(0, hist.percentile(50));
+    EXPECT_EQ(0, hist.percentile(99));
+}
+
+TEST(PipelineLatencyHistogramTest, SmallValuesAreExact) {
+    PipelineLatencyHistogram hist;
+    for (int64_t us = 0; us < 4; ++us) {
+        hist.record(us);
+    }
+    EXPECT_EQ(4u, hist.count());
+    EXPECT_EQ(1, hist.percentile(50));
+    EXPECT_EQ(3, hist.percentile(100));
+}
+
+TEST(PipelineLatencyHistogramTest, PercentilesWithinRelativeError) {
+    PipelineLatencyHistogram hist;
+    for (int64_t us = 1; us <= 10000; ++us) {
+        hist.record(us);
+    }
+    EXPECT_EQ(10000u, hist.count());
+    for (double p : {50.0, 95.0, 99.0}) {
+        double expected = p * 100;
+        double actual = hist.percentile(p);
+        EXPECT_GE(actual, expected) << "p" << p;
+        EXPECT_LE(actual, expected * (1 + 1.0 / PipelineLatencyHistogram::kSubBuckets))
+                << "p" << p;
+    }
+    hist.clear();
+    EXPECT_EQ(0u, hist.count());
+    EXPECT_EQ(0, hist.percentile(50));
+}
+
+TEST(PipelineLatencyHistogramTest, ClampsOutOfRangeValues) {
+    PipelineLatencyHistogram hist;
+    hist.record(-5);
+    hist.record(INT64_MAX);
+    EXPECT_EQ(2u, hist.count());
+    EXPECT_EQ(0, hist.percentile(0));
+    EXPECT_GT(hist.percentile(100), 0);
+}
+
+TEST(PipelineWatcherTest, RecordsStageLatencies) {
+    PipelineWatcher watcher;
+    std::shared_ptr<const PipelineLatencyStats> stats = watcher.latencyStats();
+    const PipelineWatcher::Clock::time_point start = PipelineWatcher::Clock::now() - 10ms;
+
+    watcher.onWorkQueued(0, {}, start);
+    watcher.onWorkDone(0, 0, start + 5ms);
+    watcher.onOutputRendered(0, start + 8ms);
+
+    const auto &hists = stats->histograms;
+    ASSERT_EQ(1u, hists[PipelineLatencyStats::STAGE_INPUT_CONSUMED].count());
+    ASSERT_EQ(1u, hists[PipelineLatencyStats::STAGE_OUTPUT_READY].count());
+    ASSERT_EQ(1u, hists[PipelineLatencyStats::STAGE_RENDER].count());
+    ASSERT_EQ(1u, hists[PipelineLatencyStats::STAGE_TOTAL].count());
+
+    int64_t ready = hists[PipelineLatencyStats::STAGE_OUTPUT_READY].percentile(50);
+    EXPECT_GE(ready, 5000);
+    EXPECT_LE(ready, 5000 * 5 / 4);
+    int64_t render = hists[PipelineLatencyStats::STAGE_RENDER].percentile(50);
+    EXPECT_GE(render, 3000);
+    EXPECT_LE(render, 3000 * 5 / 4);
+    EXPECT_FALSE(stats->toString().empty());
+}
+
+TEST(PipelineWatcherTest, RendersUnderOutputFrameIndex) {
+    PipelineWatcher watcher;
+    std::shared_ptr<const PipelineLatencyStats> stats = watcher.latencyStats();
+    const PipelineWatcher::Clock::time_point now = PipelineWatcher::Clock::now();
+
+    // work 4 completes with the output of frame 3, as a reordering decoder does
+    watcher.onWorkQueued(4, {}, now);
+    watcher.onWorkDone(4, 3, now);
+    watcher.onOutputRendered(4, now);
+    EXPECT_EQ(0u, stats->histograms[PipelineLatencyStats::STAGE_RENDER].count());
+    watcher.onOutputRendered(3, now);
+    EXPECT_EQ(1u, stats->histograms[PipelineLatencyStats::STAGE_RENDER].count());
+    EXPECT_EQ(1u, stats->histograms[PipelineLatencyStats::STAGE_TOTAL].count());
+}
+
+TEST(PipelineWatcherTest, UntrackedWorkIsNotRecorded) {
+    PipelineWatcher watcher;
+    std::shared_ptr<const PipelineLatencyStats> stats = watcher.latencyStats();
+    const PipelineWatcher::Clock::time_point now = PipelineWatcher::Clock::now();
+
+    // dropped work does not count towards output latency
+    watcher.onWorkQueued(0, {}, now);
+    watcher.onWorkDone(0);
+    watcher.onOutputRendered(0, now);
+    // unknown frame
+    watcher.onWorkDone(1, 1, now);
+
+    for (const PipelineLatencyHistogram &hist : stats->histograms) {
+        EXPECT_EQ(0u, hist.count());
+    }
+
+    // flush discards frames awaiting render
+    watcher.onWorkQueued(2, {}, now);
+    watcher.onWorkDone(2, 2, now);
+    watcher.flush();
+    watcher.onOutputRendered(2, now);
+    EXPECT_EQ(0u, stats->histograms[PipelineLatencyStats::STAGE_RENDER].count());
+    EXPECT_TRUE(stats->toString().find("render") == std::string::npos);
+}
+
+} // namespace android
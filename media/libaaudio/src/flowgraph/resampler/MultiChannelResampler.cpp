@@ -32,6 +32,7 @@ MultiChannelResampler::MultiChannelResampler(const MultiChannelResampler::Builde
         , mX(static_cast<size_t>(builder.getChannelCount())
                 * static_cast<size_t>(builder.getNumTaps()) * 2)
         , mSingleFrame(builder.getChannelCount())
+        , mKernels(ResamplerKernels::get())
         , mChannelCount(builder.getChannelCount())
         {
     // Reduce sample rates to the smallest ratio.
@@ -84,6 +85,8 @@ MultiChannelResampler *MultiChannelResampler::Builder::build() {
         // Note that this does not do low pass filteringh.
         return new LinearResampler(*this);
     }
+    // The FIR kernels are unrolled by 4 taps.
+    mNumTaps = (mNumTaps + 3) & ~3;
     IntegerRatio ratio(getInputRate(), getOutputRate());
     ratio.reduce();
     bool usePolyphase = (getNumTaps() * ratio.getDenominator()) <= kMaxCoefficients;
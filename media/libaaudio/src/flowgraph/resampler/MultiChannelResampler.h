@@ -35,6 +35,7 @@
 #endif
 
 #include "ResamplerDefinitions.h"
+#include "ResamplerKernels.h"
 
 namespace RESAMPLER_OUTER_NAMESPACE::resampler {
 
@@ -63,7 +64,8 @@ public:
          * More taps gives better quality but uses more CPU time.
          * This typically ranges from 4 to 64. Default is 16.
          *
-         * For polyphase filters, numTaps must be a multiple of four for loop unrolling.
+         * Except for the linear resampler used for 2 taps, the filter kernels are unrolled
+         * by four taps, so build() rounds numTaps up to a multiple of four.
          * @param numTaps number of taps for the filter
          * @return address of this builder for chaining calls
          */
@@ -251,6 +253,7 @@ protected:
     int                  mCursor = 0;
     std::vector<float>   mX;           // delayed input values for the FIR
     std::vector<float>   mSingleFrame; // one frame for temporary use
+    const ResamplerKernels &mKernels;  // inner loops for this CPU
     int32_t              mIntegerPhase = 0;
     int32_t              mNumerator = 0;
     int32_t              mDenominator = 0;
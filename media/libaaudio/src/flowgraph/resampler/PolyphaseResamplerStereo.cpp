@@ -44,36 +44,14 @@ void PolyphaseResamplerStereo::writeFrame(const float *frame) {
 }
 
 void PolyphaseResamplerStereo::readFrame(float *frame) {
-    // Clear accumulators.
-    float left = 0.0;
-    float right = 0.0;
-
     // Multiply input times precomputed windowed sinc function.
     const float *coefficients = &mCoefficients[mCoefficientCursor];
-    float *xFrame = &mX[mCursor * STEREO];
-    const int numLoops = mNumTaps >> 2; // n/4
-    for (int i = 0; i < numLoops; i++) {
-        // Manual loop unrolling, might get converted to SIMD.
-        float coefficient = *coefficients++;
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++; // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++;  // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++;  // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
+    const float *xFrame = &mX[mCursor * STEREO];
+    if (mNumTaps < ResamplerKernels::kMinTapsForKernels) {
+        dotStereoScalar(xFrame, coefficients, mNumTaps, frame);
+    } else {
+        mKernels.dotStereo(xFrame, coefficients, mNumTaps, frame);
     }
 
     mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mCoefficients.size();
-
-    // Copy accumulators to output.
-    frame[0] = left;
-    frame[1] = right;
 }
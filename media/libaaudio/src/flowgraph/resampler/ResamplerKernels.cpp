@@ -0,0 +1,309 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ResamplerKernels.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#define RESAMPLER_USE_NEON 1
+#include <arm_neon.h>
+#else
+#define RESAMPLER_USE_NEON 0
+#endif
+
+#if defined(__SSE2__)
+#define RESAMPLER_USE_SSE 1
+#include <immintrin.h>
+#else
+#define RESAMPLER_USE_SSE 0
+#endif
+
+// AVX2 is not part of any Android ABI so it is compiled separately and picked at run time.
+#if RESAMPLER_USE_SSE && defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#define RESAMPLER_USE_AVX2 1
+#define RESAMPLER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define RESAMPLER_USE_AVX2 0
+#endif
+
+using namespace RESAMPLER_OUTER_NAMESPACE::resampler;
+
+namespace {
+
+constexpr ResamplerKernels kScalarKernels = {
+    "scalar", dotMonoScalar, dotStereoScalar, dotMono2Scalar, dotStereo2Scalar,
+};
+
+#if RESAMPLER_USE_NEON
+
+inline float32x4_t multiplyAdd(float32x4_t sum, float32x4_t a, float32x4_t b) {
+#if defined(__aarch64__)
+    return vfmaq_f32(sum, a, b);
+#else
+    return vmlaq_f32(sum, a, b);
+#endif
+}
+
+inline float horizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+    return vaddvq_f32(v);
+#else
+    const float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+}
+
+float dotMonoNeon(const float *x, const float *coefficients, int32_t numTaps) {
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        sum = multiplyAdd(sum, vld1q_f32(x + i), vld1q_f32(coefficients + i));
+    }
+    return horizontalSum(sum);
+}
+
+void dotStereoNeon(const float *x, const float *coefficients, int32_t numTaps, float *sum) {
+    float32x4_t left = vdupq_n_f32(0.0f);
+    float32x4_t right = vdupq_n_f32(0.0f);
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const float32x4x2_t frames = vld2q_f32(x + 2 * i); // deinterleave 4 frames
+        const float32x4_t coefficient = vld1q_f32(coefficients + i);
+        left = multiplyAdd(left, frames.val[0], coefficient);
+        right = multiplyAdd(right, frames.val[1], coefficient);
+    }
+    sum[0] = horizontalSum(left);
+    sum[1] = horizontalSum(right);
+}
+
+void dotMono2Neon(const float *x, const float *coefficients1, const float *coefficients2,
+                  int32_t numTaps, float *sum1, float *sum2) {
+    float32x4_t low = vdupq_n_f32(0.0f);
+    float32x4_t high = vdupq_n_f32(0.0f);
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const float32x4_t samples = vld1q_f32(x + i);
+        low = multiplyAdd(low, samples, vld1q_f32(coefficients1 + i));
+        high = multiplyAdd(high, samples, vld1q_f32(coefficients2 + i));
+    }
+    *sum1 = horizontalSum(low);
+    *sum2 = horizontalSum(high);
+}
+
+void dotStereo2Neon(const float *x, const float *coefficients1, const float *coefficients2,
+                    int32_t numTaps, float *sum1, float *sum2) {
+    float32x4_t left1 = vdupq_n_f32(0.0f);
+    float32x4_t right1 = vdupq_n_f32(0.0f);
+    float32x4_t left2 = vdupq_n_f32(0.0f);
+    float32x4_t right2 = vdupq_n_f32(0.0f);
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const float32x4x2_t frames = vld2q_f32(x + 2 * i);
+        const float32x4_t coefficient1 = vld1q_f32(coefficients1 + i);
+        const float32x4_t coefficient2 = vld1q_f32(coefficients2 + i);
+        left1 = multiplyAdd(left1, frames.val[0], coefficient1);
+        right1 = multiplyAdd(right1, frames.val[1], coefficient1);
+        left2 = multiplyAdd(left2, frames.val[0], coefficient2);
+        right2 = multiplyAdd(right2, frames.val[1], coefficient2);
+    }
+    sum1[0] = horizontalSum(left1);
+    sum1[1] = horizontalSum(right1);
+    sum2[0] = horizontalSum(left2);
+    sum2[1] = horizontalSum(right2);
+}
+
+constexpr ResamplerKernels kNeonKernels = {
+    "neon", dotMonoNeon, dotStereoNeon, dotMono2Neon, dotStereo2Neon,
+};
+
+#endif // RESAMPLER_USE_NEON
+
+#if RESAMPLER_USE_SSE
+
+inline float horizontalSum(__m128 v) {
+    const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+// Sum the lanes of {L, R, L, R} into sum[0] and sum[1].
+inline void storeStereoSum(__m128 v, float *sum) {
+    const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    sum[0] = _mm_cvtss_f32(pairs);
+    sum[1] = _mm_cvtss_f32(_mm_shuffle_ps(pairs, pairs, 1));
+}
+
+float dotMonoSse(const float *x, const float *coefficients, int32_t numTaps) {
+    __m128 sum = _mm_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(coefficients + i)));
+    }
+    return horizontalSum(sum);
+}
+
+void dotStereoSse(const float *x, const float *coefficients, int32_t numTaps, float *sum) {
+    __m128 stereo = _mm_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const __m128 coefficient = _mm_loadu_ps(coefficients + i);
+        // Duplicate each coefficient to match the interleaved frames.
+        const __m128 low = _mm_unpacklo_ps(coefficient, coefficient);
+        const __m128 high = _mm_unpackhi_ps(coefficient, coefficient);
+        stereo = _mm_add_ps(stereo, _mm_mul_ps(_mm_loadu_ps(x + 2 * i), low));
+        stereo = _mm_add_ps(stereo, _mm_mul_ps(_mm_loadu_ps(x + 2 * i + 4), high));
+    }
+    storeStereoSum(stereo, sum);
+}
+
+void dotMono2Sse(const float *x, const float *coefficients1, const float *coefficients2,
+                 int32_t numTaps, float *sum1, float *sum2) {
+    __m128 low = _mm_setzero_ps();
+    __m128 high = _mm_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const __m128 samples = _mm_loadu_ps(x + i);
+        low = _mm_add_ps(low, _mm_mul_ps(samples, _mm_loadu_ps(coefficients1 + i)));
+        high = _mm_add_ps(high, _mm_mul_ps(samples, _mm_loadu_ps(coefficients2 + i)));
+    }
+    *sum1 = horizontalSum(low);
+    *sum2 = horizontalSum(high);
+}
+
+void dotStereo2Sse(const float *x, const float *coefficients1, const float *coefficients2,
+                   int32_t numTaps, float *sum1, float *sum2) {
+    __m128 stereo1 = _mm_setzero_ps();
+    __m128 stereo2 = _mm_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const __m128 frames01 = _mm_loadu_ps(x + 2 * i);
+        const __m128 frames23 = _mm_loadu_ps(x + 2 * i + 4);
+        const __m128 coefficient1 = _mm_loadu_ps(coefficients1 + i);
+        const __m128 coefficient2 = _mm_loadu_ps(coefficients2 + i);
+        stereo1 = _mm_add_ps(stereo1, _mm_mul_ps(frames01,
+                _mm_unpacklo_ps(coefficient1, coefficient1)));
+        stereo1 = _mm_add_ps(stereo1, _mm_mul_ps(frames23,
+                _mm_unpackhi_ps(coefficient1, coefficient1)));
+        stereo2 = _mm_add_ps(stereo2, _mm_mul_ps(frames01,
+                _mm_unpacklo_ps(coefficient2, coefficient2)));
+        stereo2 = _mm_add_ps(stereo2, _mm_mul_ps(frames23,
+                _mm_unpackhi_ps(coefficient2, coefficient2)));
+    }
+    storeStereoSum(stereo1, sum1);
+    storeStereoSum(stereo2, sum2);
+}
+
+constexpr ResamplerKernels kSseKernels = {
+    "sse", dotMonoSse, dotStereoSse, dotMono2Sse, dotStereo2Sse,
+};
+
+#endif // RESAMPLER_USE_SSE
+
+#if RESAMPLER_USE_AVX2
+
+RESAMPLER_TARGET_AVX2 inline __m128 reduceToSse(__m256 v) {
+    return _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+}
+
+// Load 4 coefficients as {c0, c0, c1, c1, c2, c2, c3, c3} to match 4 stereo frames.
+RESAMPLER_TARGET_AVX2 inline __m256 loadStereoCoefficients(const float *coefficients) {
+    const __m256i duplicate = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    return _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(coefficients)),
+                                    duplicate);
+}
+
+RESAMPLER_TARGET_AVX2
+float dotMonoAvx2(const float *x, const float *coefficients, int32_t numTaps) {
+    __m256 sum = _mm256_setzero_ps();
+    int32_t i = 0;
+    for (; i + 8 <= numTaps; i += 8) {
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(coefficients + i), sum);
+    }
+    __m128 sum4 = reduceToSse(sum);
+    if (i < numTaps) { // 4 taps left over
+        sum4 = _mm_fmadd_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(coefficients + i), sum4);
+    }
+    return horizontalSum(sum4);
+}
+
+RESAMPLER_TARGET_AVX2
+void dotStereoAvx2(const float *x, const float *coefficients, int32_t numTaps, float *sum) {
+    __m256 stereo = _mm256_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        stereo = _mm256_fmadd_ps(_mm256_loadu_ps(x + 2 * i),
+                                 loadStereoCoefficients(coefficients + i), stereo);
+    }
+    storeStereoSum(reduceToSse(stereo), sum);
+}
+
+RESAMPLER_TARGET_AVX2
+void dotMono2Avx2(const float *x, const float *coefficients1, const float *coefficients2,
+                  int32_t numTaps, float *sum1, float *sum2) {
+    __m256 low = _mm256_setzero_ps();
+    __m256 high = _mm256_setzero_ps();
+    int32_t i = 0;
+    for (; i + 8 <= numTaps; i += 8) {
+        const __m256 samples = _mm256_loadu_ps(x + i);
+        low = _mm256_fmadd_ps(samples, _mm256_loadu_ps(coefficients1 + i), low);
+        high = _mm256_fmadd_ps(samples, _mm256_loadu_ps(coefficients2 + i), high);
+    }
+    __m128 low4 = reduceToSse(low);
+    __m128 high4 = reduceToSse(high);
+    if (i < numTaps) { // 4 taps left over
+        const __m128 samples = _mm_loadu_ps(x + i);
+        low4 = _mm_fmadd_ps(samples, _mm_loadu_ps(coefficients1 + i), low4);
+        high4 = _mm_fmadd_ps(samples, _mm_loadu_ps(coefficients2 + i), high4);
+    }
+    *sum1 = horizontalSum(low4);
+    *sum2 = horizontalSum(high4);
+}
+
+RESAMPLER_TARGET_AVX2
+void dotStereo2Avx2(const float *x, const float *coefficients1, const float *coefficients2,
+                    int32_t numTaps, float *sum1, float *sum2) {
+    __m256 stereo1 = _mm256_setzero_ps();
+    __m256 stereo2 = _mm256_setzero_ps();
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        const __m256 frames = _mm256_loadu_ps(x + 2 * i);
+        stereo1 = _mm256_fmadd_ps(frames, loadStereoCoefficients(coefficients1 + i), stereo1);
+        stereo2 = _mm256_fmadd_ps(frames, loadStereoCoefficients(coefficients2 + i), stereo2);
+    }
+    storeStereoSum(reduceToSse(stereo1), sum1);
+    storeStereoSum(reduceToSse(stereo2), sum2);
+}
+
+constexpr ResamplerKernels kAvx2Kernels = {
+    "avx2", dotMonoAvx2, dotStereoAvx2, dotMono2Avx2, dotStereo2Avx2,
+};
+
+#endif // RESAMPLER_USE_AVX2
+
+const ResamplerKernels &selectKernels() {
+#if RESAMPLER_USE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return kAvx2Kernels;
+    }
+#endif
+#if RESAMPLER_USE_NEON
+    return kNeonKernels;
+#elif RESAMPLER_USE_SSE
+    return kSseKernels;
+#else
+    return kScalarKernels;
+#endif
+}
+
+} // namespace
+
+const ResamplerKernels &ResamplerKernels::get() {
+    static const ResamplerKernels &sKernels = selectKernels();
+    return sKernels;
+}
+
+const ResamplerKernels &ResamplerKernels::getScalar() {
+    return kScalarKernels;
+}
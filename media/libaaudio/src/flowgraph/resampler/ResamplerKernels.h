@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RESAMPLER_RESAMPLER_KERNELS_H
+#define RESAMPLER_RESAMPLER_KERNELS_H
+
+#include <sys/types.h>
+
+#include "ResamplerDefinitions.h"
+
+namespace RESAMPLER_OUTER_NAMESPACE::resampler {
+
+/**
+ * Inner loops of the FIR resamplers.
+ *
+ * Each kernel multiplies the delayed input frames by one or two rows of coefficients
+ * and sums the products. The input frames are interleaved and numTaps must be a
+ * multiple of 4.
+ *
+ * The kernels for the instruction set of the CPU are chosen at run time.
+ * They may sum in a different order than the scalar kernels so the results can
+ * differ by a few ULPs.
+ */
+struct ResamplerKernels {
+    /** Name of the instruction set, for logs and benchmarks. */
+    const char *name;
+
+    /** @return the dot product of one channel of input with the coefficients */
+    float (*dotMono)(const float *x, const float *coefficients, int32_t numTaps);
+
+    /** Write the left and right dot products to sum[0] and sum[1]. */
+    void (*dotStereo)(const float *x, const float *coefficients, int32_t numTaps,
+                      float *sum);
+
+    /** Write the dot products with two rows of coefficients to *sum1 and *sum2. */
+    void (*dotMono2)(const float *x, const float *coefficients1, const float *coefficients2,
+                     int32_t numTaps, float *sum1, float *sum2);
+
+    /** Write the stereo dot products with two rows of coefficients to sum1[] and sum2[]. */
+    void (*dotStereo2)(const float *x, const float *coefficients1, const float *coefficients2,
+                       int32_t numTaps, float *sum1, float *sum2);
+
+    /**
+     * Below this many taps the call costs more than the vector instructions save,
+     * so the resamplers use the inline scalar kernels below instead.
+     */
+    static constexpr int32_t kMinTapsForKernels = 16;
+
+    /**
+     * @return the fastest kernels supported by this CPU, chosen on the first call
+     */
+    static const ResamplerKernels &get();
+
+    /**
+     * @return the portable kernels, which are the reference for the others
+     */
+    static const ResamplerKernels &getScalar();
+};
+
+// Scalar kernels, unrolled by 4 taps like the original resampler loops.
+
+inline float dotMonoScalar(const float *x, const float *coefficients, int32_t numTaps) {
+    float sum = 0.0;
+    for (int32_t i = 0; i < numTaps; i += 4) {
+        sum += x[i] * coefficients[i];
+        sum += x[i + 1] * coefficients[i + 1];
+        sum += x[i + 2] * coefficients[i + 2];
+        sum += x[i + 3] * coefficients[i + 3];
+    }
+    return sum;
+}
+
+inline void dotStereoScalar(const float *x, const float *coefficients, int32_t numTaps,
+                            float *sum) {
+    float left = 0.0;
+    float right = 0.0;
+    for (int32_t i = 0; i < numTaps; i++) {
+        const float coefficient = coefficients[i];
+        left += x[2 * i] * coefficient;
+        right += x[2 * i + 1] * coefficient;
+    }
+    sum[0] = left;
+    sum[1] = right;
+}
+
+inline void dotMono2Scalar(const float *x,
+                           const float *coefficients1, const float *coefficients2,
+                           int32_t numTaps, float *sum1, float *sum2) {
+    float low = 0.0;
+    float high = 0.0;
+    for (int32_t i = 0; i < numTaps; i++) {
+        low += x[i] * coefficients1[i];
+        high += x[i] * coefficients2[i];
+    }
+    *sum1 = low;
+    *sum2 = high;
+}
+
+inline void dotStereo2Scalar(const float *x,
+                             const float *coefficients1, const float *coefficients2,
+                             int32_t numTaps, float *sum1, float *sum2) {
+    float left1 = 0.0;
+    float right1 = 0.0;
+    float left2 = 0.0;
+    float right2 = 0.0;
+    for (int32_t i = 0; i < numTaps; i++) {
+        const float left = x[2 * i];
+        const float right = x[2 * i + 1];
+        left1 += left * coefficients1[i];
+        right1 += right * coefficients1[i];
+        left2 += left * coefficients2[i];
+        right2 += right * coefficients2[i];
+    }
+    sum1[0] = left1;
+    sum1[1] = right1;
+    sum2[0] = left2;
+    sum2[1] = right2;
+}
+
+} /* namespace RESAMPLER_OUTER_NAMESPACE::resampler */
+
+#endif //RESAMPLER_RESAMPLER_KERNELS_H
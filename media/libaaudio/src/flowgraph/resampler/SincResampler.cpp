@@ -36,10 +36,6 @@ SincResampler::SincResampler(const MultiChannelResampler::Builder &builder)
 }
 
 void SincResampler::readFrame(float *frame) {
-    // Clear accumulator for mixing.
-    std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
-    std::fill(mSingleFrame2.begin(), mSingleFrame2.end(), 0.0);
-
     // Determine indices into coefficients table.
     const double tablePhase = getIntegerPhase() * mPhaseScaler;
     const int indexLow = static_cast<int>(floor(tablePhase));
@@ -51,13 +47,24 @@ void SincResampler::readFrame(float *frame) {
                                              * static_cast<size_t>(getNumTaps())];
 
     float *xFrame = &mX[static_cast<size_t>(mCursor) * static_cast<size_t>(getChannelCount())];
-    for (int tap = 0; tap < mNumTaps; tap++) {
-        const float coefficientLow = *coefficientsLow++;
-        const float coefficientHigh = *coefficientsHigh++;
-        for (int channel = 0; channel < getChannelCount(); channel++) {
-            const float sample = *xFrame++;
-            mSingleFrame[channel] += sample * coefficientLow;
-            mSingleFrame2[channel] += sample * coefficientHigh;
+    if (getChannelCount() == 1 && mNumTaps < ResamplerKernels::kMinTapsForKernels) {
+        dotMono2Scalar(xFrame, coefficientsLow, coefficientsHigh, mNumTaps,
+                       &mSingleFrame[0], &mSingleFrame2[0]);
+    } else if (getChannelCount() == 1) {
+        mKernels.dotMono2(xFrame, coefficientsLow, coefficientsHigh, mNumTaps,
+                          &mSingleFrame[0], &mSingleFrame2[0]);
+    } else {
+        // Clear accumulator for mixing.
+        std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
+        std::fill(mSingleFrame2.begin(), mSingleFrame2.end(), 0.0);
+        for (int tap = 0; tap < mNumTaps; tap++) {
+            const float coefficientLow = *coefficientsLow++;
+            const float coefficientHigh = *coefficientsHigh++;
+            for (int channel = 0; channel < getChannelCount(); channel++) {
+                const float sample = *xFrame++;
+                mSingleFrame[channel] += sample * coefficientLow;
+                mSingleFrame2[channel] += sample * coefficientHigh;
+            }
         }
     }
 
@@ -47,10 +47,6 @@ void SincResamplerStereo::writeFrame(const float *frame) {
 
 // Multiply input times windowed sinc function.
 void SincResamplerStereo::readFrame(float *frame) {
-    // Clear accumulator for mixing.
-    std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
-    std::fill(mSingleFrame2.begin(), mSingleFrame2.end(), 0.0);
-
     // Determine indices into coefficients table.
     double tablePhase = getIntegerPhase() * mPhaseScaler;
     int index1 = static_cast<int>(floor(tablePhase));
@@ -60,14 +56,12 @@ void SincResamplerStereo::readFrame(float *frame) {
     float *coefficients2 = &mCoefficients[static_cast<size_t>(index2)
             * static_cast<size_t>(getNumTaps())];
     float *xFrame = &mX[static_cast<size_t>(mCursor) * static_cast<size_t>(getChannelCount())];
-    for (int i = 0; i < mNumTaps; i++) {
-        float coefficient1 = *coefficients1++;
-        float coefficient2 = *coefficients2++;
-        for (int channel = 0; channel < getChannelCount(); channel++) {
-            float sample = *xFrame++;
-            mSingleFrame[channel] +=  sample * coefficient1;
-            mSingleFrame2[channel] += sample * coefficient2;
-        }
+    if (mNumTaps < ResamplerKernels::kMinTapsForKernels) {
+        dotStereo2Scalar(xFrame, coefficients1, coefficients2, mNumTaps,
+                         mSingleFrame.data(), mSingleFrame2.data());
+    } else {
+        mKernels.dotStereo2(xFrame, coefficients1, coefficients2, mNumTaps,
+                            mSingleFrame.data(), mSingleFrame2.data());
     }
 
     // Interpolate and copy to output.
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput and quality of the flowgraph resamplers, and of their inner kernels.
+ */
+
+#include <math.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "flowgraph/resampler/MultiChannelResampler.h"
+#include "flowgraph/resampler/ResamplerKernels.h"
+
+using namespace RESAMPLER_OUTER_NAMESPACE::resampler;
+
+namespace {
+
+constexpr int32_t kInputFramesPerIteration = 1024;
+constexpr double kToneFrequency = 1000.0;
+
+// Push the input through the resampler and return the number of output frames.
+int32_t resample(MultiChannelResampler *resampler, const float *input, int32_t numInputFrames,
+                 float *output) {
+    const int32_t channelCount = resampler->getChannelCount();
+    int32_t numOutputFrames = 0;
+    int32_t inputFrame = 0;
+    while (inputFrame < numInputFrames) {
+        if (resampler->isWriteNeeded()) {
+            resampler->writeNextFrame(input + inputFrame * channelCount);
+            inputFrame++;
+        } else {
+            resampler->readNextFrame(output + numOutputFrames * channelCount);
+            numOutputFrames++;
+        }
+    }
+    return numOutputFrames;
+}
+
+/**
+ * Resample a tone and return the ratio, in dB, of the tone to everything else
+ * in the first channel of the output. The tone is found by a least squares fit
+ * so the delay of the filter does not matter.
+ */
+double measureSignalToNoise(int32_t channelCount, int32_t inputRate, int32_t outputRate,
+                            MultiChannelResampler::Quality quality) {
+    constexpr int32_t kNumInputFrames = 8192;
+    constexpr int32_t kSettlingFrames = 64; // skip the filter warming up
+    std::unique_ptr<MultiChannelResampler> resampler(
+            MultiChannelResampler::make(channelCount, inputRate, outputRate, quality));
+    std::vector<float> input(kNumInputFrames * channelCount);
+    for (int32_t i = 0; i < kNumInputFrames; i++) {
+        const float sample = 0.5 * sin(2.0 * M_PI * kToneFrequency * i / inputRate);
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            input[i * channelCount + channel] = sample;
+        }
+    }
+    std::vector<float> output((kNumInputFrames * (int64_t) outputRate / inputRate + 16)
+                              * channelCount);
+    const int32_t numOutputFrames = resample(resampler.get(), input.data(), kNumInputFrames,
+                                             output.data());
+
+    // Solve the normal equations for y = a sin(wt) + b cos(wt).
+    double ss = 0, sc = 0, cc = 0, sy = 0, cy = 0, yy = 0;
+    for (int32_t i = kSettlingFrames; i < numOutputFrames; i++) {
+        const double phase = 2.0 * M_PI * kToneFrequency * i / outputRate;
+        const double s = sin(phase);
+        const double c = cos(phase);
+        const double y = output[i * channelCount];
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        sy += s * y;
+        cy += c * y;
+        yy += y * y;
+    }
+    const double determinant = ss * cc - sc * sc;
+    const double a = (sy * cc - cy * sc) / determinant;
+    const double b = (cy * ss - sy * sc) / determinant;
+    const double signal = a * sy + b * cy; // energy of the fitted tone
+    const double noise = std::max(yy - signal, 1.0e-20);
+    return 10.0 * log10(signal / noise);
+}
+
+// range(0) channel count, range(1) quality, range(2) input rate, range(3) output rate.
+void BM_Resampler(benchmark::State& state) {
+    const int32_t channelCount = state.range(0);
+    const auto quality = static_cast<MultiChannelResampler::Quality>(state.range(1));
+    const int32_t inputRate = state.range(2);
+    const int32_t outputRate = state.range(3);
+    std::unique_ptr<MultiChannelResampler> resampler(
+            MultiChannelResampler::make(channelCount, inputRate, outputRate, quality));
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> input(kInputFramesPerIteration * channelCount);
+    for (float &sample : input) sample = distribution(generator);
+    std::vector<float> output(
+            (kInputFramesPerIteration * (int64_t) outputRate / inputRate + 16) * channelCount);
+
+    int64_t outputFrames = 0;
+    for (auto _ : state) {
+        outputFrames += resample(resampler.get(), input.data(), kInputFramesPerIteration,
+                                 output.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["output_frames_per_second"] =
+            benchmark::Counter(outputFrames, benchmark::Counter::kIsRate);
+    state.counters["snr_db"] =
+            measureSignalToNoise(channelCount, inputRate, outputRate, quality);
+    state.SetLabel(ResamplerKernels::get().name);
+}
+
+void ResamplerArgs(benchmark::internal::Benchmark* b) {
+    const int64_t qualities[] = {
+        static_cast<int64_t>(MultiChannelResampler::Quality::Low),
+        static_cast<int64_t>(MultiChannelResampler::Quality::Medium),
+        static_cast<int64_t>(MultiChannelResampler::Quality::High),
+        static_cast<int64_t>(MultiChannelResampler::Quality::Best),
+    };
+    for (int64_t channelCount : {1, 2}) {
+        for (int64_t quality : qualities) {
+            b->Args({channelCount, quality, 44100, 48000}); // polyphase
+            b->Args({channelCount, quality, 48000, 44100});
+            b->Args({channelCount, quality, 44100, 48001}); // sinc, interpolated phases
+        }
+    }
+}
+
+BENCHMARK(BM_Resampler)->Apply(ResamplerArgs);
+
+// range(0) is 0 for the scalar kernels, 1 for the kernels chosen for this CPU.
+// range(1) is the number of taps.
+template <bool Stereo, bool TwoRows>
+void BM_Kernel(benchmark::State& state) {
+    const ResamplerKernels &kernels = state.range(0) == 0
+            ? ResamplerKernels::getScalar() : ResamplerKernels::get();
+    const int32_t numTaps = state.range(1);
+    std::vector<float> x(2 * numTaps, 0.25f);
+    std::vector<float> coefficients1(numTaps, 0.5f);
+    std::vector<float> coefficients2(numTaps, -0.5f);
+    float sum1[2];
+    float sum2[2];
+    for (auto _ : state) {
+        if constexpr (Stereo && TwoRows) {
+            kernels.dotStereo2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                               sum1, sum2);
+        } else if constexpr (Stereo) {
+            kernels.dotStereo(x.data(), coefficients1.data(), numTaps, sum1);
+        } else if constexpr (TwoRows) {
+            kernels.dotMono2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                             sum1, sum2);
+        } else {
+            sum1[0] = kernels.dotMono(x.data(), coefficients1.data(), numTaps);
+        }
+        benchmark::DoNotOptimize(sum1);
+        benchmark::DoNotOptimize(sum2);
+    }
+    state.SetLabel(kernels.name);
+}
+
+BENCHMARK_TEMPLATE(BM_Kernel, false, false)->ArgsProduct({{0, 1}, {8, 16, 32}});
+BENCHMARK_TEMPLATE(BM_Kernel, true, false)->ArgsProduct({{0, 1}, {8, 16, 32}});
+BENCHMARK_TEMPLATE(BM_Kernel, false, true)->ArgsProduct({{0, 1}, {8, 16, 32}});
+BENCHMARK_TEMPLATE(BM_Kernel, true, true)->ArgsProduct({{0, 1}, {8, 16, 32}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -22,10 +22,13 @@
  */
 
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "flowgraph/resampler/MultiChannelResampler.h"
+#include "flowgraph/resampler/ResamplerKernels.h"
 
 using namespace RESAMPLER_OUTER_NAMESPACE::resampler;
 
@@ -219,3 +222,116 @@ TEST(test_resampler, resampler_48000_44100_best) {
 TEST(test_resampler, resampler_44100_11025_best) {
     checkResampler(44100, 11025, MultiChannelResampler::Quality::Best);
 }
+
+// The kernels chosen for this CPU must match the scalar kernels within rounding error.
+TEST(test_resampler, resampler_kernels_match_scalar) {
+    const ResamplerKernels &kernels = ResamplerKernels::get();
+    const ResamplerKernels &scalar = ResamplerKernels::getScalar();
+    std::cout << "Resampler kernels: " << kernels.name << std::endl;
+
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (int32_t numTaps : {4, 8, 12, 16, 32, 64}) {
+        std::vector<float> x(2 * numTaps);
+        std::vector<float> coefficients1(numTaps);
+        std::vector<float> coefficients2(numTaps);
+        for (float &value : x) value = distribution(generator);
+        for (float &value : coefficients1) value = distribution(generator);
+        for (float &value : coefficients2) value = distribution(generator);
+        const float tolerance = numTaps * 1.0e-6f;
+
+        EXPECT_NEAR(scalar.dotMono(x.data(), coefficients1.data(), numTaps),
+                    kernels.dotMono(x.data(), coefficients1.data(), numTaps), tolerance);
+
+        float expected[2];
+        float actual[2];
+        scalar.dotStereo(x.data(), coefficients1.data(), numTaps, expected);
+        kernels.dotStereo(x.data(), coefficients1.data(), numTaps, actual);
+        EXPECT_NEAR(expected[0], actual[0], tolerance);
+        EXPECT_NEAR(expected[1], actual[1], tolerance);
+
+        float expected2[2];
+        float actual2[2];
+        scalar.dotMono2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                        &expected[0], &expected2[0]);
+        kernels.dotMono2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                         &actual[0], &actual2[0]);
+        EXPECT_NEAR(expected[0], actual[0], tolerance);
+        EXPECT_NEAR(expected2[0], actual2[0], tolerance);
+
+        scalar.dotStereo2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                          expected, expected2);
+        kernels.dotStereo2(x.data(), coefficients1.data(), coefficients2.data(), numTaps,
+                           actual, actual2);
+        for (int channel = 0; channel < 2; channel++) {
+            EXPECT_NEAR(expected[channel], actual[channel], tolerance);
+            EXPECT_NEAR(expected2[channel], actual2[channel], tolerance);
+        }
+    }
+}
+
+/**
+ * Convert the same noise with a mono and a stereo resampler, which use different kernels,
+ * and check that every channel of the stereo output matches the mono output.
+ */
+static void checkStereoMatchesMono(int32_t sourceRate, int32_t sinkRate,
+        MultiChannelResampler::Quality quality) {
+    const int kNumInputFrames = 2000;
+    std::unique_ptr<MultiChannelResampler> mono(
+            MultiChannelResampler::make(1, sourceRate, sinkRate, quality));
+    std::unique_ptr<MultiChannelResampler> stereo(
+            MultiChannelResampler::make(2, sourceRate, sinkRate, quality));
+
+    std::mt19937 generator(sourceRate + sinkRate);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    int numRead = 0;
+    for (int i = 0; i < kNumInputFrames; ) {
+        ASSERT_EQ(mono->isWriteNeeded(), stereo->isWriteNeeded());
+        if (mono->isWriteNeeded()) {
+            const float sample = distribution(generator);
+            const float frame[2] = {sample, -0.5f * sample};
+            mono->writeNextFrame(&sample);
+            stereo->writeNextFrame(frame);
+            i++;
+        } else {
+            float monoFrame;
+            float stereoFrame[2];
+            mono->readNextFrame(&monoFrame);
+            stereo->readNextFrame(stereoFrame);
+            ASSERT_NEAR(monoFrame, stereoFrame[0], 1.0e-4f) << "at frame " << numRead;
+            ASSERT_NEAR(-0.5f * monoFrame, stereoFrame[1], 1.0e-4f) << "at frame " << numRead;
+            numRead++;
+        }
+    }
+    EXPECT_GT(numRead, 0);
+}
+
+TEST(test_resampler, resampler_stereo_matches_mono) {
+    const MultiChannelResampler::Quality qualities[] = {
+        MultiChannelResampler::Quality::Low,
+        MultiChannelResampler::Quality::Medium,
+        MultiChannelResampler::Quality::High,
+        MultiChannelResampler::Quality::Best
+    };
+    for (auto quality : qualities) {
+        checkStereoMatchesMono(44100, 48000, quality); // polyphase
+        checkStereoMatchesMono(48000, 44100, quality);
+        checkStereoMatchesMono(44100, 48001, quality); // sinc, ratio too fine for a table
+    }
+}
+
+TEST(test_resampler, resampler_rounds_up_num_taps) {
+    const int32_t outputRates[] = {
+        48000, // polyphase
+        48001  // sinc
+    };
+    for (int32_t outputRate : outputRates) {
+        MultiChannelResampler::Builder builder;
+        builder.setChannelCount(2)
+                ->setInputRate(44100)
+                ->setOutputRate(outputRate)
+                ->setNumTaps(6);
+        std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+        EXPECT_EQ(8, resampler->getNumTaps());
+    }
+}
@@ -18,11 +18,16 @@
 #define LOG_TAG "FileSource"
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include <cutils/properties.h>
 #include <datasource/FileSource.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/FoundationUtils.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -43,6 +48,9 @@ FileSource::FileSource(const char *filename)
 
     if (mFd >= 0) {
         mLength = lseek64(mFd, 0, SEEK_END);
+        if (property_get_bool("media.datasource.file_mmap", false)) {
+            enableMmap();
+        }
     } else {
         ALOGE("Failed to open file '%s'. (%s)", filename, strerror(errno));
     }
@@ -87,9 +95,16 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
             (long long) mOffset,
             (long long) mLength);
 
+    if (property_get_bool("media.datasource.file_mmap", false)) {
+        enableMmap();
+    }
 }
 
 FileSource::~FileSource() {
+    if (mMapBase != nullptr) {
+        munmap(mMapBase, mMapLength);
+        mMapBase = nullptr;
+    }
     if (mFd >= 0) {
         ::close(mFd);
         mFd = -1;
@@ -100,12 +115,39 @@ status_t FileSource::initCheck() const {
     return mFd >= 0 ? OK : NO_INIT;
 }
 
+bool FileSource::enableMmap() {
+    if (mMapData != nullptr) {
+        return true;
+    }
+    struct stat s;
+    if (mFd < 0 || mLength <= 0 || fstat(mFd, &s) != 0 || !S_ISREG(s.st_mode)
+            || mOffset + mLength > s.st_size) {
+        return false;
+    }
+    const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    const int64_t mapOffset = mOffset - (mOffset % pageSize);
+    const int64_t mapLength = mOffset - mapOffset + mLength;
+    if (mapLength > SIZE_MAX / 2) {
+        return false;  // too big for the address space of a 32-bit process
+    }
+    void *base = mmap(nullptr, mapLength, PROT_READ, MAP_PRIVATE, mFd, mapOffset);
+    if (base == MAP_FAILED) {
+        ALOGW("%s: mmap of %lld bytes failed (%s)",
+                mName.c_str(), (long long) mapLength, strerror(errno));
+        return false;
+    }
+    mMapBase = base;
+    mMapLength = mapLength;
+    mMapData = static_cast<const uint8_t *>(base) + (mOffset - mapOffset);
+    ALOGV("%s: mapped %zu bytes", mName.c_str(), mMapLength);
+    return true;
+}
+
 ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
     if (mFd < 0) {
         return NO_INIT;
     }
 
-    Mutex::Autolock autoLock(mLock);
     if (mLength >= 0) {
         if (offset < 0) {
             return UNKNOWN_ERROR;
@@ -122,18 +164,72 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
 }
 
 ssize_t FileSource::readAt_l(off64_t offset, void *data, size_t size) {
-    off64_t result = lseek64(mFd, offset + mOffset, SEEK_SET);
-    if (result == -1) {
-        ALOGE("seek to %lld failed", (long long)(offset + mOffset));
+    if (mMapData != nullptr) {
+        if (offset < 0) {
+            return UNKNOWN_ERROR;
+        }
+        if (offset >= mLength) {
+            return 0;
+        }
+        size = std::min<uint64_t>(size, mLength - offset);
+        adviseForRead(offset, size);
+        memcpy(data, mMapData + offset, size);
+        return size;
+    }
+
+    ssize_t result = pread64(mFd, data, size, offset + mOffset);
+    if (result < 0) {
+        ALOGE("read of %zu bytes at %lld failed (%s)",
+                size, (long long)(offset + mOffset), strerror(errno));
         return UNKNOWN_ERROR;
     }
+    return result;
+}
+
+void FileSource::adviseForRead(off64_t offset, size_t size) {
+    const int64_t end = offset + size;
+    const int64_t expected = mNextReadOffset.exchange(end, std::memory_order_relaxed);
+    const bool sequential = offset >= expected && offset - expected <= kMaxSequentialGap;
+    if (!sequential) {
+        mSequentialReads.store(0, std::memory_order_relaxed);
+        if (mSequentialAdvised.exchange(false, std::memory_order_relaxed)) {
+            // A seek, go back to the default readahead.
+            advise(0, mLength, MADV_NORMAL);
+            mWillNeedEnd.store(0, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (mSequentialReads.fetch_add(1, std::memory_order_relaxed) + 1
+            == kSequentialReadsToAdvise) {
+        mSequentialAdvised.store(true, std::memory_order_relaxed);
+        advise(0, mLength, MADV_SEQUENTIAL);
+    }
+    if (mSequentialAdvised.load(std::memory_order_relaxed)
+            && end + kWillNeedWindow / 2 > mWillNeedEnd.load(std::memory_order_relaxed)) {
+        // Top up the pages ahead of the reader half a window at a time.
+        const int64_t start = std::max(end, mWillNeedEnd.load(std::memory_order_relaxed));
+        mWillNeedEnd.store(end + kWillNeedWindow, std::memory_order_relaxed);
+        advise(start, end + kWillNeedWindow - start, MADV_WILLNEED);
+    }
+}
 
-    return ::read(mFd, data, size);
+void FileSource::advise(int64_t offset, int64_t length, int advice) {
+    // offset and length are relative to mMapData; madvise wants whole pages.
+    const uint8_t *mapBase = static_cast<const uint8_t *>(mMapBase);
+    const int64_t mapOffset = mMapData - mapBase;
+    const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t start = mapOffset + offset;
+    start -= start % pageSize;
+    const int64_t end = std::min<int64_t>(mapOffset + offset + length, mMapLength);
+    if (end <= start) {
+        return;
+    }
+    if (madvise(const_cast<uint8_t *>(mapBase) + start, end - start, advice) != 0) {
+        ALOGV("%s: madvise(%d) failed (%s)", mName.c_str(), advice, strerror(errno));
+    }
 }
 
 status_t FileSource::getSize(off64_t *size) {
-    Mutex::Autolock autoLock(mLock);
-
     if (mFd < 0) {
         return NO_INIT;
     }
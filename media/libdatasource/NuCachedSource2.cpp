@@ -16,10 +16,14 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 //#define LOG_NDEBUG 0
 #define LOG_TAG "NuCachedSource2"
 #include <utils/Log.h>
 
+#include "PageCache.h"
+
 #include <datasource/NuCachedSource2.h>
 #include <datasource/HTTPBase.h>
 
@@ -30,155 +34,6 @@
 
 namespace android {
 
-struct PageCache {
-    explicit PageCache(size_t pageSize);
-    ~PageCache();
-
-    struct Page {
-        void *mData;
-        size_t mSize;
-    };
-
-    Page *acquirePage();
-    void releasePage(Page *page);
-
-    void appendPage(Page *page);
-    size_t releaseFromStart(size_t maxBytes);
-
-    size_t totalSize() const {
-        return mTotalSize;
-    }
-
-    void copy(size_t from, void *data, size_t size);
-
-private:
-    size_t mPageSize;
-    size_t mTotalSize;
-
-    List<Page *> mActivePages;
-    List<Page *> mFreePages;
-
-    void freePages(List<Page *> *list);
-
-    DISALLOW_EVIL_CONSTRUCTORS(PageCache);
-};
-
-PageCache::PageCache(size_t pageSize)
-    : mPageSize(pageSize),
-      mTotalSize(0) {
-}
-
-PageCache::~PageCache() {
-    freePages(&mActivePages);
-    freePages(&mFreePages);
-}
-
-void PageCache::freePages(List<Page *> *list) {
-    List<Page *>::iterator it = list->begin();
-    while (it != list->end()) {
-        Page *page = *it;
-
-        free(page->mData);
-        delete page;
-        page = NULL;
-
-        ++it;
-    }
-}
-
-PageCache::Page *PageCache::acquirePage() {
-    if (!mFreePages.empty()) {
-        List<Page *>::iterator it = mFreePages.begin();
-        Page *page = *it;
-        mFreePages.erase(it);
-
-        return page;
-    }
-
-    Page *page = new Page;
-    page->mData = malloc(mPageSize);
-    page->mSize = 0;
-
-    return page;
-}
-
-void PageCache::releasePage(Page *page) {
-    page->mSize = 0;
-    mFreePages.push_back(page);
-}
-
-void PageCache::appendPage(Page *page) {
-    mTotalSize += page->mSize;
-    mActivePages.push_back(page);
-}
-
-size_t PageCache::releaseFromStart(size_t maxBytes) {
-    size_t bytesReleased = 0;
-
-    while (maxBytes > 0 && !mActivePages.empty()) {
-        List<Page *>::iterator it = mActivePages.begin();
-
-        Page *page = *it;
-
-        if (maxBytes < page->mSize) {
-            break;
-        }
-
-        mActivePages.erase(it);
-
-        maxBytes -= page->mSize;
-        bytesReleased += page->mSize;
-
-        releasePage(page);
-    }
-
-    mTotalSize -= bytesReleased;
-    return bytesReleased;
-}
-
-void PageCache::copy(size_t from, void *data, size_t size) {
-    ALOGV("copy from %zu size %zu", from, size);
-
-    if (size == 0) {
-        return;
-    }
-
-    CHECK_LE(from + size, mTotalSize);
-
-    size_t offset = 0;
-    List<Page *>::iterator it = mActivePages.begin();
-    while (from >= offset + (*it)->mSize) {
-        offset += (*it)->mSize;
-        ++it;
-    }
-
-    size_t delta = from - offset;
-    size_t avail = (*it)->mSize - delta;
-
-    if (avail >= size) {
-        memcpy(data, (const uint8_t *)(*it)->mData + delta, size);
-        return;
-    }
-
-    memcpy(data, (const uint8_t *)(*it)->mData + delta, avail);
-    ++it;
-    data = (uint8_t *)data + avail;
-    size -= avail;
-
-    while (size > 0) {
-        size_t copy = (*it)->mSize;
-        if (copy > size) {
-            copy = size;
-        }
-        memcpy(data, (*it)->mData, copy);
-        data = (uint8_t *)data + copy;
-        size -= copy;
-        ++it;
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
 NuCachedSource2::NuCachedSource2(
         const sp<DataSource> &source,
         const char *cacheConfig,
@@ -196,6 +51,18 @@ NuCachedSource2::NuCachedSource2(
       mNumRetriesLeft(kMaxNumRetries),
       mHighwaterThresholdBytes(kDefaultHighWaterThreshold),
       mLowwaterThresholdBytes(kDefaultLowWaterThreshold),
+      mAdaptiveReadAhead(true),
+      mReadAheadHighBytes(kDefaultHighWaterThreshold),
+      mReadAheadLowBytes(kDefaultLowWaterThreshold),
+      mLargestReadSize(0),
+      mThroughputBytesPerSec(0),
+      mConsumptionBytesPerSec(0),
+      mConsumeWindowStartUs(-1),
+      mConsumeWindowStartPos(0),
+      mConsumePos(0),
+      mNumCacheHits(0),
+      mNumCacheMisses(0),
+      mStallTimeUs(0),
       mKeepAliveIntervalUs(kDefaultKeepAliveIntervalUs),
       mDisconnectAtHighwatermark(disconnectAtHighwatermark) {
     // We are NOT going to support disconnect-at-highwatermark indefinitely
@@ -214,6 +81,9 @@ NuCachedSource2::NuCachedSource2(
         mKeepAliveIntervalUs = 0;
     }
 
+    mReadAheadHighBytes = mHighwaterThresholdBytes;
+    mReadAheadLowBytes = mLowwaterThresholdBytes;
+
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
 
@@ -289,6 +159,19 @@ status_t NuCachedSource2::setCacheStatCollectFreq(int32_t freqMs) {
     return ERROR_UNSUPPORTED;
 }
 
+sp<AMessage> NuCachedSource2::getCacheStats() {
+    Mutex::Autolock autoLock(mLock);
+    sp<AMessage> stats = new AMessage;
+    stats->setInt64("hits", mNumCacheHits);
+    stats->setInt64("misses", mNumCacheMisses);
+    stats->setInt64("stall-us", mStallTimeUs);
+    stats->setInt64("read-ahead-bytes", mReadAheadHighBytes);
+    stats->setInt64("retained-bytes", mCache->retainedSize());
+    stats->setInt64("throughput-bytes-per-sec", mThroughputBytesPerSec);
+    stats->setInt64("consumption-bytes-per-sec", mConsumptionBytesPerSec);
+    return stats;
+}
+
 status_t NuCachedSource2::initCheck() const {
     return mSource->initCheck();
 }
@@ -361,10 +244,16 @@ void NuCachedSource2::fetchInternal() {
         }
     }
 
-    PageCache::Page *page = mCache->acquirePage();
+    PageCache::Page *page;
+    {
+        Mutex::Autolock autoLock(mLock);
+        page = mCache->acquirePage();
+    }
 
+    const int64_t startUs = ALooper::GetNowUs();
     ssize_t n = mSource->readAt(
             mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+    const int64_t elapsedUs = ALooper::GetNowUs() - startUs;
 
     Mutex::Autolock autoLock(mLock);
 
@@ -394,6 +283,12 @@ void NuCachedSource2::fetchInternal() {
 
         page->mSize = n;
         mCache->appendPage(page);
+
+        if (elapsedUs > 0) {
+            const int64_t rate = n * 1000000LL / elapsedUs;
+            mThroughputBytesPerSec = mThroughputBytesPerSec > 0
+                    ? (7 * mThroughputBytesPerSec + rate) / 8 : rate;
+        }
     }
 }
 
@@ -420,7 +315,13 @@ void NuCachedSource2::onFetch() {
 
         mLastFetchTimeUs = ALooper::GetNowUs();
 
-        if (mFetching && mCache->totalSize() >= mHighwaterThresholdBytes) {
+        size_t readAheadBytes;
+        {
+            Mutex::Autolock autoLock(mLock);
+            readAheadBytes = mReadAheadHighBytes;
+        }
+
+        if (mFetching && mCache->totalSize() >= readAheadBytes) {
             ALOGI("Cache full, done prefetching for now");
             mFetching = false;
 
@@ -486,15 +387,13 @@ void NuCachedSource2::onRead(const sp<AMessage> &msg) {
 
 void NuCachedSource2::restartPrefetcherIfNecessary_l(
         bool ignoreLowWaterThreshold, bool force) {
-    static const size_t kGrayArea = 1024 * 1024;
-
     if (mFetching || (mFinalStatus != OK && mNumRetriesLeft == 0)) {
         return;
     }
 
     if (!ignoreLowWaterThreshold && !force
             && mCacheOffset + mCache->totalSize() - mLastAccessPos
-                >= mLowwaterThresholdBytes) {
+                >= mReadAheadLowBytes) {
         return;
     }
 
@@ -533,10 +432,18 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         mCache->copy(delta, data, size);
 
         mLastAccessPos = offset + size;
+        ++mNumCacheHits;
+        recordConsumption_l(offset, size);
 
         return size;
     }
 
+    // Reads from ranges kept after a seek do not move the playback window.
+    if (mCache->copyRetained(offset, data, size, ALooper::GetNowUs())) {
+        ++mNumCacheHits;
+        return size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector);
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -545,9 +452,12 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
     CHECK(mAsyncResult == NULL);
     msg->post();
 
+    const int64_t stallStartUs = ALooper::GetNowUs();
     while (mAsyncResult == NULL && !mDisconnecting) {
         mCondition.wait(mLock);
     }
+    ++mNumCacheMisses;
+    mStallTimeUs += ALooper::GetNowUs() - stallStartUs;
 
     if (mDisconnecting) {
         mAsyncResult.clear();
@@ -561,11 +471,84 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
 
     if (result > 0) {
         mLastAccessPos = offset + result;
+        recordConsumption_l(offset, result);
     }
 
     return (ssize_t)result;
 }
 
+void NuCachedSource2::recordConsumption_l(off64_t offset, size_t size) {
+    const int64_t nowUs = ALooper::GetNowUs();
+    const off64_t end = offset + size;
+
+    if (size > mLargestReadSize) {
+        mLargestReadSize = size;
+        updateReadAhead_l();
+    }
+
+    // Several tracks read at nearby offsets; a jump further than that
+    // is a seek and starts a new measurement.
+    if (mConsumeWindowStartUs < 0
+            || end < mConsumeWindowStartPos
+            || offset > mConsumePos + kGrayArea) {
+        mConsumeWindowStartUs = nowUs;
+        mConsumeWindowStartPos = offset;
+        mConsumePos = end;
+        return;
+    }
+
+    mConsumePos = std::max(mConsumePos, end);
+
+    const int64_t elapsedUs = nowUs - mConsumeWindowStartUs;
+    if (elapsedUs < kRateWindowUs) {
+        return;
+    }
+
+    // A much longer window spans a pause, which says nothing of the rate.
+    const off64_t consumed = mConsumePos - mConsumeWindowStartPos;
+    if (consumed > 0 && elapsedUs < 4 * kRateWindowUs) {
+        const int64_t rate = consumed * 1000000LL / elapsedUs;
+        mConsumptionBytesPerSec = mConsumptionBytesPerSec > 0
+                ? (3 * mConsumptionBytesPerSec + rate) / 4 : rate;
+        updateReadAhead_l();
+    }
+
+    mConsumeWindowStartUs = nowUs;
+    mConsumeWindowStartPos = mConsumePos;
+}
+
+void NuCachedSource2::updateReadAhead_l() {
+    size_t high = mHighwaterThresholdBytes;
+    size_t low = mLowwaterThresholdBytes;
+
+    if (mAdaptiveReadAhead && mThroughputBytesPerSec > 0 && mConsumptionBytesPerSec > 0) {
+        if (mThroughputBytesPerSec < 2 * mConsumptionBytesPerSec) {
+            // The network barely keeps up, buffer as much as allowed and
+            // refill early.
+            low = high / 2;
+        } else {
+            high = std::clamp<int64_t>(
+                    mConsumptionBytesPerSec * kReadAheadDurationUs / 1000000LL,
+                    kMinReadAheadBytes, mHighwaterThresholdBytes);
+            low = std::clamp<int64_t>(
+                    mConsumptionBytesPerSec * kLowWaterDurationUs / 1000000LL,
+                    kMinReadAheadBytes / 4, high / 2);
+        }
+    }
+
+    // Fetching must not stop short of the largest read.
+    high = std::min(std::max(high, 2 * mLargestReadSize), mHighwaterThresholdBytes);
+    low = std::min(low, high / 2);
+
+    if (high != mReadAheadHighBytes || low != mReadAheadLowBytes) {
+        ALOGV("read-ahead %zu/%zu bytes (throughput %lld, consumption %lld bytes/s)",
+              low, high, (long long)mThroughputBytesPerSec,
+              (long long)mConsumptionBytesPerSec);
+        mReadAheadHighBytes = high;
+        mReadAheadLowBytes = low;
+    }
+}
+
 size_t NuCachedSource2::cachedSize() {
     Mutex::Autolock autoLock(mLock);
     return mCacheOffset + mCache->totalSize();
@@ -613,13 +596,6 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         return ERROR_END_OF_STREAM;
     }
 
-    if (!mFetching) {
-        mLastAccessPos = offset;
-        restartPrefetcherIfNecessary_l(
-                false, // ignoreLowWaterThreshold
-                true); // force
-    }
-
     if (offset < mCacheOffset
             || offset >= (off64_t)(mCacheOffset + mCache->totalSize())) {
         static const off64_t kPadding = 256 * 1024;
@@ -630,7 +606,14 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         // does not trigger another seek.
         off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
 
-        seekInternal_l(seekOffset);
+        seekInternal_l(seekOffset, offset);
+    }
+
+    if (!mFetching) {
+        mLastAccessPos = offset;
+        restartPrefetcherIfNecessary_l(
+                false, // ignoreLowWaterThreshold
+                true); // force
     }
 
     size_t delta = offset - mCacheOffset;
@@ -662,7 +645,7 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
     return -EAGAIN;
 }
 
-status_t NuCachedSource2::seekInternal_l(off64_t offset) {
+status_t NuCachedSource2::seekInternal_l(off64_t offset, off64_t readOffset) {
     mLastAccessPos = offset;
 
     if (offset >= mCacheOffset
@@ -672,10 +655,21 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
 
     ALOGI("new range: offset= %lld", (long long)offset);
 
-    mCacheOffset = offset;
-
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+    // Keep the current window in case the reader comes back to it.
+    mCache->retainActivePages(mCacheOffset, ALooper::GetNowUs());
+    mCache->trimRetained(
+            std::min<size_t>(kMaxRetainedBytes, mHighwaterThresholdBytes / 2),
+            kMaxRetainedRanges);
+
+    off64_t rangeOffset;
+    // Look up the read position itself: the padding may reach into another
+    // range, or before the start of the one holding the read.
+    if (mCache->restoreRetained(readOffset, &rangeOffset)) {
+        ALOGV("resuming retained range at %lld", (long long)rangeOffset);
+        mCacheOffset = rangeOffset;
+    } else {
+        mCacheOffset = offset;
+    }
 
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
@@ -741,6 +735,9 @@ void NuCachedSource2::updateCacheParamsFromString(const char *s) {
         mKeepAliveIntervalUs = kDefaultKeepAliveIntervalUs;
     }
 
+    // Stick to the thresholds the client asked for.
+    mAdaptiveReadAhead = false;
+
     ALOGV("lowwater = %zu bytes, highwater = %zu bytes, keepalive = %lld us",
          mLowwaterThresholdBytes,
          mHighwaterThresholdBytes,
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PageCache"
+#include <utils/Log.h>
+
+#include "PageCache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+
+namespace android {
+
+PageCache::PageCache(size_t pageSize)
+    : mPageSize(pageSize),
+      mTotalSize(0),
+      mRetainedSize(0) {
+}
+
+PageCache::~PageCache() {
+    freePages(&mActivePages);
+    freePages(&mFreePages);
+
+    for (Range *range : mRetainedRanges) {
+        freePages(&range->mPages);
+        delete range;
+    }
+}
+
+void PageCache::freePages(List<Page *> *list) {
+    List<Page *>::iterator it = list->begin();
+    while (it != list->end()) {
+        Page *page = *it;
+
+        free(page->mData);
+        delete page;
+        page = NULL;
+
+        ++it;
+    }
+}
+
+PageCache::Page *PageCache::acquirePage() {
+    if (!mFreePages.empty()) {
+        List<Page *>::iterator it = mFreePages.begin();
+        Page *page = *it;
+        mFreePages.erase(it);
+
+        return page;
+    }
+
+    Page *page = new Page;
+    page->mData = malloc(mPageSize);
+    page->mSize = 0;
+
+    return page;
+}
+
+void PageCache::releasePage(Page *page) {
+    page->mSize = 0;
+    mFreePages.push_back(page);
+}
+
+void PageCache::appendPage(Page *page) {
+    mTotalSize += page->mSize;
+    mActivePages.push_back(page);
+}
+
+size_t PageCache::releaseFromStart(size_t maxBytes) {
+    size_t bytesReleased = 0;
+
+    while (maxBytes > 0 && !mActivePages.empty()) {
+        List<Page *>::iterator it = mActivePages.begin();
+
+        Page *page = *it;
+
+        if (maxBytes < page->mSize) {
+            break;
+        }
+
+        mActivePages.erase(it);
+
+        maxBytes -= page->mSize;
+        bytesReleased += page->mSize;
+
+        releasePage(page);
+    }
+
+    mTotalSize -= bytesReleased;
+    return bytesReleased;
+}
+
+void PageCache::copy(size_t from, void *data, size_t size) {
+    ALOGV("copy from %zu size %zu", from, size);
+
+    if (size == 0) {
+        return;
+    }
+
+    CHECK_LE(from + size, mTotalSize);
+
+    copyPages(mActivePages, from, data, size);
+}
+
+// static
+void PageCache::copyPages(
+        const List<Page *> &pages, size_t from, void *data, size_t size) {
+    size_t offset = 0;
+    List<Page *>::const_iterator it = pages.begin();
+    while (from >= offset + (*it)->mSize) {
+        offset += (*it)->mSize;
+        ++it;
+    }
+
+    size_t delta = from - offset;
+    size_t avail = (*it)->mSize - delta;
+
+    if (avail >= size) {
+        memcpy(data, (const uint8_t *)(*it)->mData + delta, size);
+        return;
+    }
+
+    memcpy(data, (const uint8_t *)(*it)->mData + delta, avail);
+    ++it;
+    data = (uint8_t *)data + avail;
+    size -= avail;
+
+    while (size > 0) {
+        size_t copy = (*it)->mSize;
+        if (copy > size) {
+            copy = size;
+        }
+        memcpy(data, (*it)->mData, copy);
+        data = (uint8_t *)data + copy;
+        size -= copy;
+        ++it;
+    }
+}
+
+void PageCache::retainActivePages(off64_t offset, int64_t nowUs) {
+    if (mActivePages.empty()) {
+        return;
+    }
+
+    Range *range = new Range;
+    range->mOffset = offset;
+    range->mSize = mTotalSize;
+    range->mLastUseUs = nowUs;
+
+    List<Page *>::iterator it = mActivePages.begin();
+    while (it != mActivePages.end()) {
+        range->mPages.push_back(*it);
+        it = mActivePages.erase(it);
+    }
+    mTotalSize = 0;
+
+    ALOGV("retaining range at %lld, size %zu", (long long)range->mOffset, range->mSize);
+    mRetainedSize += range->mSize;
+    mRetainedRanges.push_back(range);
+}
+
+bool PageCache::copyRetained(off64_t offset, void *data, size_t size, int64_t nowUs) {
+    for (Range *range : mRetainedRanges) {
+        if (offset >= range->mOffset
+                && offset + (off64_t)size <= range->mOffset + (off64_t)range->mSize) {
+            if (size > 0) {
+                copyPages(range->mPages, offset - range->mOffset, data, size);
+            }
+            range->mLastUseUs = nowUs;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PageCache::restoreRetained(off64_t offset, off64_t *rangeOffset) {
+    CHECK(mActivePages.empty());
+
+    for (List<Range *>::iterator it = mRetainedRanges.begin();
+            it != mRetainedRanges.end(); ++it) {
+        Range *range = *it;
+        if (offset < range->mOffset
+                || offset > range->mOffset + (off64_t)range->mSize) {
+            continue;
+        }
+
+        ALOGV("restoring range at %lld, size %zu", (long long)range->mOffset, range->mSize);
+        for (Page *page : range->mPages) {
+            appendPage(page);
+        }
+        *rangeOffset = range->mOffset;
+
+        mRetainedSize -= range->mSize;
+        mRetainedRanges.erase(it);
+        delete range;
+        return true;
+    }
+    return false;
+}
+
+void PageCache::trimRetained(size_t maxBytes, size_t maxRanges) {
+    while (mRetainedSize > maxBytes || mRetainedRanges.size() > maxRanges) {
+        List<Range *>::iterator lru = mRetainedRanges.begin();
+        for (List<Range *>::iterator it = lru; it != mRetainedRanges.end(); ++it) {
+            if ((*it)->mLastUseUs < (*lru)->mLastUseUs) {
+                lru = it;
+            }
+        }
+        Range *range = *lru;
+
+        // Drop whole ranges while over the count, otherwise keep the
+        // start of the range, where the reader came in, e.g. a moov atom.
+        const bool tooManyRanges = mRetainedRanges.size() > maxRanges;
+        while (!range->mPages.empty()
+                && (tooManyRanges || mRetainedSize > maxBytes)) {
+            List<Page *>::iterator last = --range->mPages.end();
+            Page *page = *last;
+            range->mSize -= page->mSize;
+            mRetainedSize -= page->mSize;
+            range->mPages.erase(last);
+            releasePage(page);
+        }
+
+        if (range->mPages.empty()) {
+            mRetainedRanges.erase(lru);
+            delete range;
+        }
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PAGE_CACHE_H_
+
+#define PAGE_CACHE_H_
+
+#include <sys/types.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/List.h>
+
+namespace android {
+
+// The pages of NuCachedSource2: the active window being fetched and read,
+// and the retained ranges of windows the reader seeked away from.
+struct PageCache {
+    explicit PageCache(size_t pageSize);
+    ~PageCache();
+
+    struct Page {
+        void *mData;
+        size_t mSize;
+    };
+
+    Page *acquirePage();
+    void releasePage(Page *page);
+
+    void appendPage(Page *page);
+    size_t releaseFromStart(size_t maxBytes);
+
+    size_t totalSize() const {
+        return mTotalSize;
+    }
+
+    void copy(size_t from, void *data, size_t size);
+
+    // Retained ranges keep the data of windows the reader seeked away from,
+    // e.g. the moov atom at the end of a file while playing from its start.
+
+    // Moves the active pages, the first of which is at |offset|, to a new
+    // retained range.
+    void retainActivePages(off64_t offset, int64_t nowUs);
+
+    // Copies [offset, offset + size) if a retained range holds all of it.
+    bool copyRetained(off64_t offset, void *data, size_t size, int64_t nowUs);
+
+    // If a retained range holds |offset|, makes its pages the active pages,
+    // which must be empty, and returns the offset of its first page.
+    bool restoreRetained(off64_t offset, off64_t *rangeOffset);
+
+    // Releases the pages of the least recently used retained ranges until
+    // at most |maxBytes| in |maxRanges| ranges are left.
+    void trimRetained(size_t maxBytes, size_t maxRanges);
+
+    size_t retainedSize() const {
+        return mRetainedSize;
+    }
+
+private:
+    struct Range {
+        off64_t mOffset;
+        size_t mSize;
+        int64_t mLastUseUs;
+        List<Page *> mPages;
+    };
+
+    size_t mPageSize;
+    size_t mTotalSize;
+    size_t mRetainedSize;
+
+    List<Page *> mActivePages;
+    List<Page *> mFreePages;
+    List<Range *> mRetainedRanges;
+
+    void freePages(List<Page *> *list);
+
+    static void copyPages(
+            const List<Page *> &pages, size_t from, void *data, size_t size);
+
+    DISALLOW_EVIL_CONSTRUCTORS(PageCache);
+};
+
+}  // namespace android
+
+#endif  // PAGE_CACHE_H_
@@ -20,6 +20,8 @@
 
 #include <stdio.h>
 
+#include <atomic>
+
 #include <media/DataSource.h>
 #include <media/stagefright/MediaErrors.h>
 #include <utils/threads.h>
@@ -34,6 +36,7 @@ public:
 
     virtual status_t initCheck() const;
 
+    // Safe to call from several threads at once, reads do not take mLock.
     virtual ssize_t readAt(off64_t offset, void *data, size_t size);
 
     virtual status_t getSize(off64_t *size);
@@ -46,8 +49,21 @@ public:
         return mName;
     }
 
+    // Serve reads from a read-only mapping of the file rather than pread().
+    // Only regular files can be mapped. Must be called before the first read.
+    // This is off unless the media.datasource.file_mmap property is set, as
+    // reading a mapped file that another process truncates raises SIGBUS.
+    // Returns true if reads now come from the mapping.
+    bool enableMmap();
+
+    bool isMmapEnabled() const {
+        return mMapData != nullptr;
+    }
+
 protected:
     virtual ~FileSource();
+    // Reads within [0, mLength). Does not need mLock, which only guards the
+    // state of subclasses.
     virtual ssize_t readAt_l(off64_t offset, void *data, size_t size);
 
     int mFd;
@@ -56,8 +72,30 @@ protected:
     Mutex mLock;
 
 private:
+    // Forward reads at most this far past the previous one still count as sequential,
+    // so that interleaved tracks read in presentation order do.
+    static constexpr int64_t kMaxSequentialGap = 256 * 1024;
+    // Sequential reads in a row before the mapping is advised MADV_SEQUENTIAL.
+    static constexpr int32_t kSequentialReadsToAdvise = 8;
+    // How far ahead of a sequential reader pages are requested with MADV_WILLNEED.
+    static constexpr int64_t kWillNeedWindow = 2 * 1024 * 1024;
+
+    void adviseForRead(off64_t offset, size_t size);
+    void advise(int64_t offset, int64_t length, int advice);
+
     String8 mName;
 
+    // The mapping starts at the page holding mOffset; mMapData points at mOffset.
+    void *mMapBase = nullptr;
+    size_t mMapLength = 0;
+    const uint8_t *mMapData = nullptr;
+
+    // Read pattern, updated without a lock; a lost update only delays a hint.
+    std::atomic<int64_t> mNextReadOffset{-1};
+    std::atomic<int32_t> mSequentialReads{0};
+    std::atomic<bool> mSequentialAdvised{false};
+    std::atomic<int64_t> mWillNeedEnd{0};
+
     FileSource(const FileSource &);
     FileSource &operator=(const FileSource &);
 };
@@ -25,6 +25,7 @@
 namespace android {
 
 struct ALooper;
+struct AMessage;
 struct PageCache;
 
 struct NuCachedSource2 : public DataSource {
@@ -67,6 +68,13 @@ struct NuCachedSource2 : public DataSource {
     status_t getEstimatedBandwidthKbps(int32_t *kbps);
     status_t setCacheStatCollectFreq(int32_t freqMs);
 
+    // Returns the cache hit and miss counts ("hits", "misses"), the time
+    // readers spent waiting for the network ("stall-us"), the current
+    // read-ahead ("read-ahead-bytes"), the bytes kept in retained ranges
+    // ("retained-bytes") and the measured rates ("throughput-bytes-per-sec",
+    // "consumption-bytes-per-sec", 0 until measured).
+    sp<AMessage> getCacheStats();
+
     static void RemoveCacheSpecificHeaders(
             KeyedVector<String8, String8> *headers,
             String8 *cacheConfig,
@@ -91,6 +99,23 @@ private:
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
+
+        // Data before the last access kept when the cache is trimmed.
+        kGrayArea                       = 1024 * 1024,
+
+        // Up to this many windows that the reader seeked away from are
+        // kept, within at most half of the high water threshold.
+        kMaxRetainedBytes               = 8 * 1024 * 1024,
+        kMaxRetainedRanges              = 4,
+
+        // Unless the cache parameters were configured, the read-ahead is
+        // sized to hold this much playback once the rates are measured.
+        kReadAheadDurationUs            = 60000000,
+        kLowWaterDurationUs             = 15000000,
+        kMinReadAheadBytes              = 2 * 1024 * 1024,
+
+        // Period over which the consumption rate is measured.
+        kRateWindowUs                   = 2000000,
     };
 
     enum {
@@ -122,9 +147,30 @@ private:
 
     int32_t mNumRetriesLeft;
 
+    // Configured limits of the cache.
     size_t mHighwaterThresholdBytes;
     size_t mLowwaterThresholdBytes;
 
+    // Thresholds in use, adapted to the measured rates within the limits
+    // above unless the cache parameters were configured.
+    bool mAdaptiveReadAhead;
+    size_t mReadAheadHighBytes;
+    size_t mReadAheadLowBytes;
+    size_t mLargestReadSize;
+
+    // Exponential moving averages, 0 until measured.
+    int64_t mThroughputBytesPerSec;
+    int64_t mConsumptionBytesPerSec;
+
+    // Current consumption measurement window.
+    int64_t mConsumeWindowStartUs;
+    off64_t mConsumeWindowStartPos;
+    off64_t mConsumePos;
+
+    int64_t mNumCacheHits;
+    int64_t mNumCacheMisses;
+    int64_t mStallTimeUs;
+
     // If the keep-alive interval is 0, keep-alives are disabled.
     int64_t mKeepAliveIntervalUs;
 
@@ -136,13 +182,18 @@ private:
 
     void fetchInternal();
     ssize_t readInternal(off64_t offset, void *data, size_t size);
-    status_t seekInternal_l(off64_t offset);
+    // Fetches from |offset| unless a retained range holds |readOffset|, the
+    // position being read, in which case that range becomes the window.
+    status_t seekInternal_l(off64_t offset, off64_t readOffset);
 
     size_t approxDataRemaining_l(off64_t offset, status_t *finalStatus) const;
 
     void restartPrefetcherIfNecessary_l(
             bool ignoreLowWaterThreshold = false, bool force = false);
 
+    void recordConsumption_l(off64_t offset, size_t size);
+    void updateReadAhead_l();
+
     void updateCacheParamsFromSystemProperty();
     void updateCacheParamsFromString(const char *s);
 
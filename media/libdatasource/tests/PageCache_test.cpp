@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PageCache_test"
+
+#include "../PageCache.h"
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kPageSize = 16;
+
+// Appends |numPages| full pages holding the low bytes of their file offsets,
+// starting at |offset|.
+void appendPages(PageCache *cache, off64_t offset, size_t numPages) {
+    for (size_t i = 0; i < numPages; ++i) {
+        PageCache::Page *page = cache->acquirePage();
+        uint8_t *data = static_cast<uint8_t *>(page->mData);
+        for (size_t j = 0; j < kPageSize; ++j) {
+            data[j] = static_cast<uint8_t>(offset + i * kPageSize + j);
+        }
+        page->mSize = kPageSize;
+        cache->appendPage(page);
+    }
+}
+
+void expectData(const uint8_t *data, off64_t offset, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        EXPECT_EQ(static_cast<uint8_t>(offset + i), data[i]) << "at offset " << offset + i;
+    }
+}
+
+TEST(PageCacheTest, RetainsActivePages) {
+    PageCache cache(kPageSize);
+    appendPages(&cache, 1000, 2);
+    cache.retainActivePages(1000, 1);
+    EXPECT_EQ(0u, cache.totalSize());
+    EXPECT_EQ(2 * kPageSize, cache.retainedSize());
+
+    // Spans both pages.
+    uint8_t data[kPageSize];
+    ASSERT_TRUE(cache.copyRetained(1010, data, sizeof(data), 2));
+    expectData(data, 1010, sizeof(data));
+
+    // Only reads held entirely by a range are served.
+    EXPECT_FALSE(cache.copyRetained(990, data, sizeof(data), 2));
+    EXPECT_FALSE(cache.copyRetained(1020, data, sizeof(data), 2));
+}
+
+TEST(PageCacheTest, RestoresRangeHoldingOffset) {
+    PageCache cache(kPageSize);
+    appendPages(&cache, 1000, 2);
+    cache.retainActivePages(1000, 1);
+
+    off64_t rangeOffset = -1;
+    EXPECT_FALSE(cache.restoreRetained(999, &rangeOffset));
+    EXPECT_FALSE(cache.restoreRetained(1033, &rangeOffset));
+
+    // The end of the range restores it, so that fetching resumes there.
+    ASSERT_TRUE(cache.restoreRetained(1032, &rangeOffset));
+    EXPECT_EQ(1000, rangeOffset);
+    EXPECT_EQ(2 * kPageSize, cache.totalSize());
+    EXPECT_EQ(0u, cache.retainedSize());
+
+    uint8_t data[8];
+    cache.copy(12, data, sizeof(data));
+    expectData(data, 1012, sizeof(data));
+}
+
+TEST(PageCacheTest, EvictsLeastRecentlyUsedRange) {
+    PageCache cache(kPageSize);
+    appendPages(&cache, 0, 1);
+    cache.retainActivePages(0, 1);
+    appendPages(&cache, 1000, 1);
+    cache.retainActivePages(1000, 2);
+
+    // Reading the older range makes the other one the least recently used.
+    uint8_t data[4];
+    ASSERT_TRUE(cache.copyRetained(0, data, sizeof(data), 3));
+
+    cache.trimRetained(SIZE_MAX, 1);
+    EXPECT_EQ(kPageSize, cache.retainedSize());
+    EXPECT_TRUE(cache.copyRetained(0, data, sizeof(data), 4));
+    EXPECT_FALSE(cache.copyRetained(1000, data, sizeof(data), 4));
+}
+
+TEST(PageCacheTest, TrimKeepsStartOfRange) {
+    PageCache cache(kPageSize);
+    appendPages(&cache, 1000, 3);
+    cache.retainActivePages(1000, 1);
+
+    cache.trimRetained(kPageSize + kPageSize / 2, 4);
+    EXPECT_EQ(kPageSize, cache.retainedSize());
+
+    uint8_t data[kPageSize];
+    ASSERT_TRUE(cache.copyRetained(1000, data, sizeof(data), 2));
+    expectData(data, 1000, sizeof(data));
+    EXPECT_FALSE(cache.copyRetained(1000 + kPageSize, data, 1, 2));
+
+    cache.trimRetained(0, 4);
+    EXPECT_EQ(0u, cache.retainedSize());
+    EXPECT_FALSE(cache.copyRetained(1000, data, 1, 3));
+}
+
+}  // namespace
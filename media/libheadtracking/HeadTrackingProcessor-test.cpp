@@ -141,6 +141,57 @@ TEST(HeadTrackingProcessor, SmoothModeSwitch) {
     EXPECT_EQ(processor->getHeadToStagePose(), Pose3f());
 }
 
+TEST(HeadTrackingProcessor, BatchedHeadPoses) {
+    for (auto type : {PosePredictorType::LAST, PosePredictorType::TWIST,
+                      PosePredictorType::LEAST_SQUARES}) {
+        std::unique_ptr<HeadTrackingProcessor> processor = createHeadTrackingProcessor(
+                Options{.predictionDuration = 2.f}, HeadTrackingMode::WORLD_RELATIVE);
+        std::unique_ptr<HeadTrackingProcessor> batchedProcessor = createHeadTrackingProcessor(
+                Options{.predictionDuration = 2.f}, HeadTrackingMode::WORLD_RELATIVE);
+        processor->setPosePredictorType(type);
+        batchedProcessor->setPosePredictorType(type);
+
+        // The head turns, with batches of 1 to 4 samples.
+        int64_t timestamp = 0;
+        for (size_t batchSize = 1; batchSize <= 4; ++batchSize) {
+            PoseBatch batch;
+            for (size_t i = 0; i < batchSize; ++i, ++timestamp) {
+                const Pose3f worldToHead{{0, 0, 0}, rotateY(timestamp * 0.1f)};
+                const Twist3f headTwist{{0, 0, 0}, {0, 0.1f, 0}};
+                processor->setWorldToHeadPose(timestamp, worldToHead, headTwist);
+                batch.push_back(timestamp, worldToHead, headTwist);
+            }
+            batchedProcessor->setWorldToHeadPoses(batch);
+
+            processor->calculate(timestamp);
+            batchedProcessor->calculate(timestamp);
+            EXPECT_EQ(batchedProcessor->getHeadToStagePose(), processor->getHeadToStagePose())
+                    << toString(type) << " batch size " << batchSize;
+        }
+    }
+}
+
+TEST(PoseBatch, Components) {
+    const Pose3f pose{{1, 2, 3}, Quaternionf::UnitRandom()};
+    const Twist3f twist{{4, 5, 6}, {7, 8, 9}};
+
+    PoseBatch batch;
+    batch.push_back(10, Pose3f(), Twist3f());
+    batch.push_back(20, pose, twist);
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_EQ(batch.timestamp(1), 20);
+    EXPECT_EQ(batch.pose(1), pose);
+    EXPECT_EQ(batch.twist(1), twist);
+    EXPECT_EQ(batch.component(PoseBatch::TRANSLATION_Y), (std::vector<float>{0, 2}));
+
+    batch.scaleTwists(0.5f);
+    EXPECT_EQ(batch.pose(1), pose);
+    EXPECT_EQ(batch.twist(1), twist * 0.5f);
+
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+}
+
 }  // namespace
 }  // namespace media
 }  // namespace android
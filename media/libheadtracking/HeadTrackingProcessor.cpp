@@ -67,6 +67,17 @@ class HeadTrackingProcessorImpl : public HeadTrackingProcessor {
         mWorldToHeadTimestamp = timestamp;
     }
 
+    void setWorldToHeadPoses(const PoseBatch& samples) override {
+        if (samples.empty()) return;
+        mPosePredictor.predict(samples, mOptions.predictionDuration, &mPredictedWorldToHead);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            mHeadStillnessDetector.setInput(samples.timestamp(i), mPredictedWorldToHead[i]);
+        }
+        // The bias only retains the last input.
+        mHeadPoseBias.setInput(mPredictedWorldToHead.back());
+        mWorldToHeadTimestamp = samples.timestamp(samples.size() - 1);
+    }
+
     void setWorldToScreenPose(int64_t timestamp, const Pose3f& worldToScreen) override {
         if (mPhysicalToLogicalAngle != mPendingPhysicalToLogicalAngle) {
             // We're introducing an artificial discontinuity. Enable the rate limiter.
@@ -214,6 +225,8 @@ class HeadTrackingProcessorImpl : public HeadTrackingProcessor {
     ModeSelector mModeSelector;
     PoseRateLimiter mRateLimiter;
     PosePredictor mPosePredictor;
+    // Scratch space for setWorldToHeadPoses(), kept to avoid reallocating for each batch.
+    std::vector<Pose3f> mPredictedWorldToHead;
     static constexpr std::size_t mMaxLocalLogLine = 10;
     SimpleLog mLocalLog{mMaxLocalLogLine};
 };
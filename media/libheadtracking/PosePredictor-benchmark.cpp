@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "media/HeadTrackingProcessor.h"
+#include "media/QuaternionUtil.h"
+#include "PosePredictor.h"
+
+namespace android {
+namespace media {
+namespace {
+
+using Eigen::Vector3f;
+
+// Head tracker sensors report at 50 to 100 Hz.
+constexpr int64_t kSamplePeriodNs = 10'000'000;
+constexpr float kPredictionDurationNs = 120'000'000;
+constexpr size_t kNumSamples = 1024;
+
+constexpr PosePredictorType kPredictorTypes[] = {
+        PosePredictorType::LAST,
+        PosePredictorType::TWIST,
+        PosePredictorType::LEAST_SQUARES,
+};
+
+// A head turning back and forth, with its rotational velocity per nanosecond.
+PoseBatch makeHeadPoses() {
+    PoseBatch poses;
+    poses.reserve(kNumSamples);
+    for (size_t i = 0; i < kNumSamples; ++i) {
+        const float t = i * 0.01f;
+        const float yaw = std::sin(t);
+        const float yawRate = std::cos(t) * 1e-9f;
+        poses.push_back(i * kSamplePeriodNs, Pose3f(rotateZ(yaw)),
+                        Twist3f(Vector3f::Zero(), Vector3f(0, 0, yawRate)));
+    }
+    return poses;
+}
+
+// Time per pose for each predictor, range(0) indexes kPredictorTypes.
+void BM_PosePredictor(benchmark::State& state) {
+    const PosePredictorType type = kPredictorTypes[state.range(0)];
+    const PoseBatch poses = makeHeadPoses();
+    PosePredictor predictor;
+    predictor.setPosePredictorType(type);
+
+    int64_t timestampOffsetNs = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < poses.size(); ++i) {
+            benchmark::DoNotOptimize(predictor.predict(
+                    timestampOffsetNs + poses.timestamp(i), poses.pose(i), poses.twist(i),
+                    kPredictionDurationNs));
+        }
+        timestampOffsetNs += kNumSamples * kSamplePeriodNs;
+    }
+    state.SetItemsProcessed(state.iterations() * poses.size());
+    state.SetLabel(toString(type));
+}
+
+BENCHMARK(BM_PosePredictor)->DenseRange(0, std::size(kPredictorTypes) - 1);
+
+// Time per pose through the HeadTrackingProcessor, calculating once every range(1) poses.
+// range(2) is 1 to hand the poses over in batches, 0 to set them one by one.
+void BM_HeadTrackingProcessor(benchmark::State& state) {
+    const PosePredictorType type = kPredictorTypes[state.range(0)];
+    const size_t batchSize = state.range(1);
+    const bool batched = state.range(2) != 0;
+    const PoseBatch poses = makeHeadPoses();
+
+    // Batches of consecutive poses, as they are read from the sensor queue.
+    std::vector<PoseBatch> batches;
+    for (size_t i = 0; i < poses.size(); i += batchSize) {
+        PoseBatch& batch = batches.emplace_back();
+        for (size_t j = i; j < std::min(i + batchSize, poses.size()); ++j) {
+            batch.push_back(poses.timestamp(j), poses.pose(j), poses.twist(j));
+        }
+    }
+
+    for (auto _ : state) {
+        // The timestamps restart on each iteration, start over with a new processor.
+        state.PauseTiming();
+        std::unique_ptr<HeadTrackingProcessor> processor = createHeadTrackingProcessor(
+                HeadTrackingProcessor::Options{.predictionDuration = kPredictionDurationNs},
+                HeadTrackingMode::WORLD_RELATIVE);
+        processor->setPosePredictorType(type);
+        state.ResumeTiming();
+
+        for (const PoseBatch& batch : batches) {
+            if (batched) {
+                processor->setWorldToHeadPoses(batch);
+            } else {
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    processor->setWorldToHeadPose(batch.timestamp(i), batch.pose(i),
+                                                  batch.twist(i));
+                }
+            }
+            processor->calculate(batch.timestamp(batch.size() - 1));
+            benchmark::DoNotOptimize(processor->getHeadToStagePose());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * poses.size());
+    state.SetLabel(toString(type) + (batched ? " batched" : ""));
+}
+
+BENCHMARK(BM_HeadTrackingProcessor)
+        ->ArgsProduct({benchmark::CreateDenseRange(0, std::size(kPredictorTypes) - 1, 1),
+                       {1, 4, 16},
+                       {0, 1}})
+        ->ArgNames({"predictor", "batch", "batched"});
+
+}  // namespace
+}  // namespace media
+}  // namespace android
+
+BENCHMARK_MAIN();
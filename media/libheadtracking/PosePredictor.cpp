@@ -123,6 +123,32 @@ PosePredictor::PosePredictor()
 
 Pose3f PosePredictor::predict(
         int64_t timestampNs, const Pose3f& pose, const Twist3f& twist, float predictionDurationNs)
+{
+    auto selectedPredictor = getCurrentPredictor();
+    add(timestampNs, pose, twist, selectedPredictor.get());
+
+    // Deliver prediction
+    const int64_t predictionTimeNs = timestampNs + (int64_t)predictionDurationNs;
+    return selectedPredictor->predict(predictionTimeNs);
+}
+
+void PosePredictor::predict(const PoseBatch& samples, float predictionDurationNs,
+        std::vector<Pose3f>* predictions)
+{
+    // The predictor type cannot change within the batch, look it up once.
+    auto selectedPredictor = getCurrentPredictor();
+    predictions->resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const int64_t timestampNs = samples.timestamp(i);
+        add(timestampNs, samples.pose(i), samples.twist(i), selectedPredictor.get());
+
+        const int64_t predictionTimeNs = timestampNs + (int64_t)predictionDurationNs;
+        (*predictions)[i] = selectedPredictor->predict(predictionTimeNs);
+    }
+}
+
+void PosePredictor::add(int64_t timestampNs, const Pose3f& pose, const Twist3f& twist,
+        PredictorBase* selectedPredictor)
 {
     if (timestampNs - mLastTimestampNs > kMaximumSampleIntervalBeforeResetNs) {
         for (const auto& predictor : mPredictors) {
@@ -132,7 +158,6 @@ Pose3f PosePredictor::predict(
     }
     mLastTimestampNs = timestampNs;
 
-    auto selectedPredictor = getCurrentPredictor();
     if constexpr (kEnableVerification) {
         // Update all Predictors
         for (const auto& predictor : mPredictors) {
@@ -159,10 +184,6 @@ Pose3f PosePredictor::predict(
     } else /* constexpr */ {
         selectedPredictor->add(timestampNs, pose, twist);
     }
-
-    // Deliver prediction
-    const int64_t predictionTimeNs = timestampNs + (int64_t)predictionDurationNs;
-    return selectedPredictor->predict(predictionTimeNs);
 }
 
 void PosePredictor::setPosePredictorType(PosePredictorType type) {
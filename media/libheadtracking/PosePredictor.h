@@ -19,6 +19,7 @@
 #include "PosePredictorVerifier.h"
 #include <memory>
 #include <audio_utils/Statistics.h>
+#include <media/PoseBatch.h>
 #include <media/PosePredictorType.h>
 #include <media/Twist.h>
 #include <media/VectorRecorder.h>
@@ -168,6 +169,11 @@ public:
     Pose3f predict(int64_t timestampNs, const Pose3f& pose, const Twist3f& twist,
             float predictionDurationNs);
 
+    // Same as predict() for each sample of the batch in order, the predictions are stored in
+    // predictions.
+    void predict(const PoseBatch& samples, float predictionDurationNs,
+            std::vector<Pose3f>* predictions);
+
     void setPosePredictorType(PosePredictorType type);
 
     // convert predictions to a printable string
@@ -210,6 +216,10 @@ private:
 
     // Returns current predictor
     std::shared_ptr<PredictorBase> getCurrentPredictor() const;
+
+    // Adds a sample to the predictors, resetting them first after a gap in the samples.
+    void add(int64_t timestampNs, const Pose3f& pose, const Twist3f& twist,
+            PredictorBase* selectedPredictor);
 };
 
 }  // namespace android::media
@@ -45,6 +45,9 @@ using android::base::StringAppendF;
 // Note: Instead of a fixed number, the SensorEventQueue's fd could be used instead.
 constexpr int kIdent = 19;
 
+// Maximum number of events read from the queue, and delivered to the listener, per wakeup.
+constexpr ssize_t kMaxEventsPerRead = 16;
+
 static inline Looper* ALooper_to_Looper(ALooper* alooper) {
     return reinterpret_cast<Looper*>(alooper);
 }
@@ -228,6 +231,11 @@ class SensorPoseProviderImpl : public SensorPoseProvider {
     std::map<int32_t, SensorEnableGuard> mEnabledSensors;
     std::map<int32_t, SensorExtra> mEnabledSensorsExtra GUARDED_BY(mMutex);
 
+    // Events being delivered, only accessed from the worker thread.
+    PoseBatch mBatch;
+    int32_t mBatchSensor = INVALID_HANDLE;
+    bool mBatchHasTwist = false;
+
     // We must do some of the initialization operations on the worker thread, because the API relies
     // on the thread-local looper. In addition, as a matter of convenience, we store some of the
     // state on the stack.
@@ -269,6 +277,7 @@ class SensorPoseProviderImpl : public SensorPoseProvider {
 
         initFinished(true);
 
+        mBatch.reserve(kMaxEventsPerRead);
         while (!mQuit) {
             const int ret = mLooper->pollOnce(-1 /* no timeout */, nullptr /* outFd */,
                     nullptr /* outEvents */, nullptr /* outData */);
@@ -293,15 +302,15 @@ class SensorPoseProviderImpl : public SensorPoseProvider {
                     continue;
             }
 
-            // Process an event.
-            ASensorEvent event;
-            ssize_t actual = mQueue->read(&event, 1);
+            // Process the pending events, up to kMaxEventsPerRead at a time.
+            ASensorEvent events[kMaxEventsPerRead];
+            ssize_t actual = mQueue->read(events, kMaxEventsPerRead);
             if (actual > 0) {
-                mQueue->sendAck(&event, actual);
+                mQueue->sendAck(events, actual);
             }
-            ssize_t size = mQueue->filterEvents(&event, actual);
+            ssize_t size = mQueue->filterEvents(events, actual);
 
-            if (size < 0 || size > 1) {
+            if (size < 0 || size > kMaxEventsPerRead) {
                 ALOGE("%s: Unexpected return value from SensorEventQueue::filterEvents: %zd",
                         __func__, size);
                 break;
@@ -311,25 +320,44 @@ class SensorPoseProviderImpl : public SensorPoseProvider {
                 continue;
             }
 
-            handleEvent(event);
+            handleEvents(events, size);
         }
         ALOGD("%s: Exiting sensor event loop", __func__);
     }
 
-    void handleEvent(const ASensorEvent& event) {
-        PoseEvent value;
-        {
-            std::lock_guard lock(mMutex);
-            auto iter = mEnabledSensorsExtra.find(event.sensor);
-            if (iter == mEnabledSensorsExtra.end()) {
-                // This can happen if we have any pending events shortly after stopping.
-                return;
+    void handleEvents(const ASensorEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const ASensorEvent& event = events[i];
+            if (event.sensor != mBatchSensor) {
+                deliverBatch(false /* isNewReference */);
+            }
+
+            PoseEvent value;
+            {
+                std::lock_guard lock(mMutex);
+                auto iter = mEnabledSensorsExtra.find(event.sensor);
+                if (iter == mEnabledSensorsExtra.end()) {
+                    // This can happen if we have any pending events shortly after stopping.
+                    continue;
+                }
+                value = parseEvent(event, iter->second.format, &iter->second.discontinuityCount);
+                updateEventTimestamp(event, iter->second);
+            }
+            mBatchSensor = event.sensor;
+            mBatchHasTwist = value.twist.has_value();
+            mBatch.push_back(event.timestamp, value.pose, value.twist.value_or(Twist3f()));
+            if (value.isNewReference) {
+                // The listener must see the new reference before the poses that follow it.
+                deliverBatch(true /* isNewReference */);
             }
-            value = parseEvent(event, iter->second.format, &iter->second.discontinuityCount);
-            updateEventTimestamp(event, iter->second);
         }
-        mListener->onPose(event.timestamp, event.sensor, value.pose, value.twist,
-                          value.isNewReference);
+        deliverBatch(false /* isNewReference */);
+    }
+
+    void deliverBatch(bool isNewReference) {
+        if (mBatch.empty()) return;
+        mListener->onPoses(mBatchSensor, mBatch, mBatchHasTwist, isNewReference);
+        mBatch.clear();
     }
 
     DataFormat getSensorFormat(int32_t handle) {
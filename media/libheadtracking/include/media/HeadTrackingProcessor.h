@@ -19,6 +19,7 @@
 
 #include "HeadTrackingMode.h"
 #include "Pose.h"
+#include "PoseBatch.h"
 #include "PosePredictorType.h"
 #include "Twist.h"
 
@@ -59,6 +60,13 @@ class HeadTrackingProcessor {
     virtual void setWorldToHeadPose(int64_t timestamp, const Pose3f& worldToHead,
                                     const Twist3f& headTwist) = 0;
 
+    /**
+     * Sets a batch of world-to-head poses and head twists, in timestamp order.
+     * Equivalent to calling setWorldToHeadPose() for each sample of the batch, at a lower cost per
+     * sample.
+     */
+    virtual void setWorldToHeadPoses(const PoseBatch& samples) = 0;
+
     /**
      * Sets the world-to-screen pose.
      */
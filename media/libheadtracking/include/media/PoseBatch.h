@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Pose.h"
+#include "Twist.h"
+
+namespace android {
+namespace media {
+
+/**
+ * A sequence of timestamped pose samples, each with its twist, stored as one array per component
+ * (structure-of-arrays).
+ *
+ * Samples are expected in increasing timestamp order. Operations applied to the whole batch, such
+ * as scaleTwists(), run over contiguous arrays of floats and vectorize.
+ *
+ * This class is thread-compatible, but not thread-safe.
+ */
+class PoseBatch {
+  public:
+    enum Component {
+        TRANSLATION_X,
+        TRANSLATION_Y,
+        TRANSLATION_Z,
+        ROTATION_W,
+        ROTATION_X,
+        ROTATION_Y,
+        ROTATION_Z,
+        TRANSLATIONAL_VELOCITY_X,
+        TRANSLATIONAL_VELOCITY_Y,
+        TRANSLATIONAL_VELOCITY_Z,
+        ROTATIONAL_VELOCITY_X,
+        ROTATIONAL_VELOCITY_Y,
+        ROTATIONAL_VELOCITY_Z,
+        NUM_COMPONENTS,
+    };
+
+    size_t size() const { return mTimestamps.size(); }
+
+    bool empty() const { return mTimestamps.empty(); }
+
+    void reserve(size_t capacity) {
+        mTimestamps.reserve(capacity);
+        for (auto& component : mComponents) {
+            component.reserve(capacity);
+        }
+    }
+
+    /** Removes all samples, keeping the capacity. */
+    void clear() {
+        mTimestamps.clear();
+        for (auto& component : mComponents) {
+            component.clear();
+        }
+    }
+
+    void push_back(int64_t timestamp, const Pose3f& pose, const Twist3f& twist = Twist3f()) {
+        const Eigen::Vector3f translation = pose.translation();
+        const Eigen::Quaternionf rotation = pose.rotation();
+        const Eigen::Vector3f translationalVelocity = twist.translationalVelocity();
+        const Eigen::Vector3f rotationalVelocity = twist.rotationalVelocity();
+
+        mTimestamps.push_back(timestamp);
+        mComponents[TRANSLATION_X].push_back(translation.x());
+        mComponents[TRANSLATION_Y].push_back(translation.y());
+        mComponents[TRANSLATION_Z].push_back(translation.z());
+        mComponents[ROTATION_W].push_back(rotation.w());
+        mComponents[ROTATION_X].push_back(rotation.x());
+        mComponents[ROTATION_Y].push_back(rotation.y());
+        mComponents[ROTATION_Z].push_back(rotation.z());
+        mComponents[TRANSLATIONAL_VELOCITY_X].push_back(translationalVelocity.x());
+        mComponents[TRANSLATIONAL_VELOCITY_Y].push_back(translationalVelocity.y());
+        mComponents[TRANSLATIONAL_VELOCITY_Z].push_back(translationalVelocity.z());
+        mComponents[ROTATIONAL_VELOCITY_X].push_back(rotationalVelocity.x());
+        mComponents[ROTATIONAL_VELOCITY_Y].push_back(rotationalVelocity.y());
+        mComponents[ROTATIONAL_VELOCITY_Z].push_back(rotationalVelocity.z());
+    }
+
+    int64_t timestamp(size_t index) const { return mTimestamps[index]; }
+
+    Pose3f pose(size_t index) const {
+        return Pose3f(
+                Eigen::Vector3f(mComponents[TRANSLATION_X][index],
+                                mComponents[TRANSLATION_Y][index],
+                                mComponents[TRANSLATION_Z][index]),
+                Eigen::Quaternionf(mComponents[ROTATION_W][index],
+                                   mComponents[ROTATION_X][index],
+                                   mComponents[ROTATION_Y][index],
+                                   mComponents[ROTATION_Z][index]));
+    }
+
+    Twist3f twist(size_t index) const {
+        return Twist3f(
+                Eigen::Vector3f(mComponents[TRANSLATIONAL_VELOCITY_X][index],
+                                mComponents[TRANSLATIONAL_VELOCITY_Y][index],
+                                mComponents[TRANSLATIONAL_VELOCITY_Z][index]),
+                Eigen::Vector3f(mComponents[ROTATIONAL_VELOCITY_X][index],
+                                mComponents[ROTATIONAL_VELOCITY_Y][index],
+                                mComponents[ROTATIONAL_VELOCITY_Z][index]));
+    }
+
+    const std::vector<int64_t>& timestamps() const { return mTimestamps; }
+
+    /** The value of one component for all samples, in sample order. */
+    const std::vector<float>& component(Component component) const {
+        return mComponents[component];
+    }
+
+    /** Multiplies all twists by s, e.g. to change their time unit. */
+    void scaleTwists(float s) {
+        for (size_t c = TRANSLATIONAL_VELOCITY_X; c <= ROTATIONAL_VELOCITY_Z; ++c) {
+            for (float& value : mComponents[c]) {
+                value *= s;
+            }
+        }
+    }
+
+  private:
+    std::vector<int64_t> mTimestamps;
+    std::array<std::vector<float>, NUM_COMPONENTS> mComponents;
+};
+
+}  // namespace media
+}  // namespace android
@@ -23,6 +23,7 @@
 #include <sensor/Sensor.h>
 
 #include "Pose.h"
+#include "PoseBatch.h"
 #include "Twist.h"
 
 namespace android {
@@ -66,6 +67,22 @@ class SensorPoseProvider {
 
         virtual void onPose(int64_t timestamp, int32_t handle, const Pose3f& pose,
                             const std::optional<Twist3f>& twist, bool isNewReference) = 0;
+
+        /**
+         * Consecutive events of a single sensor, read from the queue at once. isNewReference
+         * applies to the last pose of the batch: a batch ends with the event of a new reference.
+         * hasTwist tells whether the sensor provides twists, otherwise they are zero.
+         *
+         * The default implementation calls onPose() for each event.
+         */
+        virtual void onPoses(int32_t handle, const PoseBatch& poses, bool hasTwist,
+                             bool isNewReference) {
+            for (size_t i = 0; i < poses.size(); ++i) {
+                onPose(poses.timestamp(i), handle, poses.pose(i),
+                       hasTwist ? std::optional<Twist3f>(poses.twist(i)) : std::nullopt,
+                       isNewReference && i == poses.size() - 1);
+            }
+        }
     };
 
     /**
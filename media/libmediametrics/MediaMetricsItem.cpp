@@ -17,13 +17,20 @@
 #define LOG_TAG "mediametrics::Item"
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <binder/Parcel.h>
 #include <cutils/multiuser.h>
@@ -309,12 +316,11 @@ std::string mediametrics::Item::toString() const {
 bool mediametrics::Item::selfrecord() {
     ALOGD_IF(DEBUG_API, "%s: delivering %s", __func__, this->toString().c_str());
 
-    char *str;
-    size_t size;
-    status_t status = writeToByteString(&str, &size);
+    // Reused across items from the same thread to avoid an allocation per item.
+    thread_local std::vector<char> buffer;
+    status_t status = writeToByteString(&buffer);
     if (status == NO_ERROR) {
-        status = submitBuffer(str, size);
-        free(str);
+        status = submitBuffer(buffer.data(), buffer.size());
     }
     if (status != NO_ERROR) {
         ALOGW("%s: failed to record: %s", __func__, this->toString().c_str());
@@ -382,15 +388,45 @@ void BaseItem::dropInstance() {
     sMediaMetricsService = nullptr;
 }
 
-// static
-status_t BaseItem::submitBuffer(const char *buffer, size_t size) {
-    ALOGD_IF(DEBUG_API, "%s: delivering %zu bytes", __func__, size);
+// Batching state. The batch capacity is reserved once; batches are swapped out
+// to be delivered so that steady state batching does not allocate.
+static std::atomic<bool>& batchingEnabled() {
+    static std::atomic<bool> enabled{
+            property_get_bool(BaseItem::BatchingProperty, false /* default_value */)};
+    return enabled;
+}
+struct BatchState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<char> batch;    // under mutex
+    nsecs_t deadlineNs = 0;     // under mutex
+    pid_t threadPid = 0;        // under mutex, the thread does not survive fork.
+};
 
-    // Validate size
-    if (size > std::numeric_limits<int32_t>::max()) return BAD_VALUE;
+// Leaked on purpose: the detached batch thread may still use it while static
+// destructors run at exit.
+static std::atomic<BatchState*> sBatchState{nullptr};
+
+// The batch thread is gone in the child, which may have forked while it, or any
+// other thread, held the lock. Start over, the parent delivers the pending items.
+// The old state is leaked, it may be inconsistent.
+static void batchStateForkChild() {
+    sBatchState.store(new BatchState);
+}
 
+static BatchState& batchState() {
+    [[maybe_unused]] static const bool initialized = [] {
+        sBatchState.store(new BatchState);
+        pthread_atfork(nullptr /* prepare */, nullptr /* parent */, batchStateForkChild);
+        return true;
+    }();
+    return *sBatchState.load();
+}
+
+// Delivers buffer to the service, which may contain one or several items.
+static status_t deliverBuffer(const char *buffer, size_t size) {
     // Do we have the service available?
-    sp<media::IMediaMetricsService> svc = getService();
+    sp<media::IMediaMetricsService> svc = BaseItem::getService();
     if (svc == nullptr)  return NO_INIT;
 
     ::android::status_t status = NO_ERROR;
@@ -442,6 +478,96 @@ status_t BaseItem::submitBuffer(const char *buffer, size_t size) {
     return status;
 }
 
+// Delivers the batch once its deadline has passed, in case no further
+// submission fills it up.
+static void batchThreadLoop() {
+    BatchState& state = batchState();
+    std::vector<char> pending;
+    std::unique_lock l(state.mutex);
+    while (true) {
+        if (state.batch.empty()) {
+            state.cv.wait(l);
+            continue;
+        }
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < state.deadlineNs) {
+            state.cv.wait_for(l, std::chrono::nanoseconds(state.deadlineNs - now));
+            continue;
+        }
+        pending.swap(state.batch);
+        l.unlock();
+        (void)deliverBuffer(pending.data(), pending.size());
+        pending.clear();
+        l.lock();
+    }
+}
+
+static status_t appendToBatch(const char *buffer, size_t size) {
+    // Receives a full batch from this thread, to deliver it outside of the lock.
+    thread_local std::vector<char> full;
+    BatchState& state = batchState();
+    {
+        std::lock_guard l(state.mutex);
+        if (state.batch.size() + size > BaseItem::kBatchMaxBytes) {
+            full.swap(state.batch);
+        }
+        if (state.batch.empty()) {
+            state.batch.reserve(BaseItem::kBatchMaxBytes);
+            state.deadlineNs = systemTime(SYSTEM_TIME_MONOTONIC) + BaseItem::kBatchDelayNs;
+            state.cv.notify_one();
+        }
+        state.batch.insert(state.batch.end(), buffer, buffer + size);
+        if (state.threadPid != getpid()) {
+            state.threadPid = getpid();
+            std::thread(batchThreadLoop).detach();
+        }
+    }
+    if (full.empty()) return NO_ERROR;
+    const status_t status = deliverBuffer(full.data(), full.size());
+    full.clear();
+    return status;
+}
+
+// static
+status_t BaseItem::submitBuffer(const char *buffer, size_t size) {
+    ALOGD_IF(DEBUG_API, "%s: delivering %zu bytes", __func__, size);
+
+    // Validate size
+    if (size > std::numeric_limits<int32_t>::max()) return BAD_VALUE;
+
+    if (size <= kBatchMaxBytes && isBatchingEnabled()) {
+        // Items would be dropped on delivery anyhow.
+        if (getService() == nullptr) return NO_INIT;
+        return appendToBatch(buffer, size);
+    }
+    return deliverBuffer(buffer, size);
+}
+
+// static
+void BaseItem::setBatchingEnabled(bool enabled) {
+    if (!batchingEnabled().exchange(enabled) || enabled) return;
+    (void)flush(); // do not hold on to items submitted before disabling.
+}
+
+// static
+bool BaseItem::isBatchingEnabled() {
+    return batchingEnabled().load(std::memory_order_relaxed);
+}
+
+// static
+status_t BaseItem::flush() {
+    thread_local std::vector<char> pending;
+    BatchState& state = batchState();
+    {
+        std::lock_guard l(state.mutex);
+        pending.swap(state.batch);
+    }
+    if (pending.empty()) return NO_ERROR;
+    const status_t status = deliverBuffer(pending.data(), pending.size());
+    pending.clear();
+    return status;
+}
+
 //static
 sp<media::IMediaMetricsService> BaseItem::getService() {
     static const char *servicename = "media.metrics";
@@ -482,12 +608,8 @@ sp<media::IMediaMetricsService> BaseItem::getService() {
 }
 
 
-status_t mediametrics::Item::writeToByteString(char **pbuffer, size_t *plength) const
+status_t mediametrics::Item::getByteStringSize(uint32_t *psize, uint32_t *pheaderSize) const
 {
-    if (pbuffer == nullptr || plength == nullptr)
-        return BAD_VALUE;
-
-    // get size
     const size_t keySizeZeroTerminated = strlen(mKey.c_str()) + 1;
     if (keySizeZeroTerminated > UINT16_MAX) {
         ALOGW("%s: key size %zu too large", __func__, keySizeZeroTerminated);
@@ -519,12 +641,16 @@ status_t mediametrics::Item::writeToByteString(char **pbuffer, size_t *plength)
             return INVALID_OPERATION;
         }
     }
+    *psize = size;
+    *pheaderSize = header_size;
+    return NO_ERROR;
+}
 
-    // since we fill every byte in the buffer (there is no padding),
-    // malloc is used here instead of calloc.
-    char * const build = (char *)malloc(size);
-    if (build == nullptr) return NO_MEMORY;
-
+status_t mediametrics::Item::writeToByteString(
+        char *build, uint32_t size, uint32_t header_size) const
+{
+    const uint16_t version = 0;
+    const size_t keySizeZeroTerminated = strlen(mKey.c_str()) + 1;
     char *filling = build;
     char *buildmax = build + size;
     if (insert((uint32_t)size, &filling, buildmax) != NO_ERROR
@@ -537,12 +663,10 @@ status_t mediametrics::Item::writeToByteString(char **pbuffer, size_t *plength)
             || insert((int64_t)mTimestamp, &filling, buildmax) != NO_ERROR
             || insert((uint32_t)mProps.size(), &filling, buildmax) != NO_ERROR) {
         ALOGE("%s:could not write header", __func__);  // shouldn't happen
-        free(build);
         return INVALID_OPERATION;
     }
     for (auto &prop : *this) {
         if (prop.writeToByteString(&filling, buildmax) != NO_ERROR) {
-            free(build);
             // shouldn't happen
             ALOGE("%s:could not write prop %s", __func__, prop.getName());
             return INVALID_OPERATION;
@@ -552,14 +676,51 @@ status_t mediametrics::Item::writeToByteString(char **pbuffer, size_t *plength)
     if (filling != buildmax) {
         ALOGE("%s: problems populating; wrote=%d planned=%d",
                 __func__, (int)(filling - build), (int)size);
-        free(build);
         return INVALID_OPERATION;
     }
+    return NO_ERROR;
+}
+
+status_t mediametrics::Item::writeToByteString(char **pbuffer, size_t *plength) const
+{
+    if (pbuffer == nullptr || plength == nullptr)
+        return BAD_VALUE;
+
+    uint32_t size;
+    uint32_t header_size;
+    status_t status = getByteStringSize(&size, &header_size);
+    if (status != NO_ERROR) return status;
+
+    // since we fill every byte in the buffer (there is no padding),
+    // malloc is used here instead of calloc.
+    char * const build = (char *)malloc(size);
+    if (build == nullptr) return NO_MEMORY;
+
+    status = writeToByteString(build, size, header_size);
+    if (status != NO_ERROR) {
+        free(build);
+        return status;
+    }
     *pbuffer = build;
     *plength = size;
     return NO_ERROR;
 }
 
+status_t mediametrics::Item::writeToByteString(std::vector<char> *buffer) const
+{
+    if (buffer == nullptr) return BAD_VALUE;
+
+    uint32_t size;
+    uint32_t header_size;
+    status_t status = getByteStringSize(&size, &header_size);
+    if (status != NO_ERROR) return status;
+
+    buffer->resize(size); // no allocation once the capacity has grown to fit.
+    status = writeToByteString(buffer->data(), size, header_size);
+    if (status != NO_ERROR) buffer->clear();
+    return status;
+}
+
 status_t mediametrics::Item::readFromByteString(const char *bufferptr, size_t length)
 {
     if (bufferptr == nullptr) return BAD_VALUE;
@@ -25,6 +25,7 @@
 #include <string>
 #include <sys/types.h>
 #include <variant>
+#include <vector>
 
 #include <binder/Parcel.h>
 #include <log/log.h>
@@ -276,6 +277,25 @@ public:
     // submits a raw buffer directly to the MediaMetrics service - this is highly optimized.
     static status_t submitBuffer(const char *buffer, size_t len);
 
+    /**
+     * Batching coalesces the buffers passed to submitBuffer() in process, and
+     * delivers them to the service together in a single one-way transaction.
+     *
+     * A batch is delivered when adding a buffer would exceed kBatchMaxBytes,
+     * or kBatchDelayNs after its first buffer, whichever comes first.
+     * Buffers larger than kBatchMaxBytes are delivered immediately.
+     *
+     * Batching is off by default, unless the BatchingProperty is set.
+     */
+    static void setBatchingEnabled(bool enabled);
+    static bool isBatchingEnabled();
+    // delivers the pending batch now, if any. Items still batched at exit are dropped.
+    static status_t flush();
+
+    static inline constexpr size_t kBatchMaxBytes = 16 * 1024;
+    static inline constexpr nsecs_t kBatchDelayNs = 100'000'000; // 100 ms
+    static constexpr const char * const BatchingProperty = "media.metrics.batching";
+
 protected:
     static constexpr const char * const EnabledProperty = "media.metrics.enabled";
     static constexpr const char * const EnabledPropertyPersist = "persist.media.metrics.enabled";
@@ -1103,6 +1123,8 @@ public:
     status_t readFromParcel(const Parcel&);
 
     status_t writeToByteString(char **bufferptr, size_t *length) const;
+    // as above, into buffer which is resized to fit, reusing its capacity.
+    status_t writeToByteString(std::vector<char> *buffer) const;
     status_t readFromByteString(const char *bufferptr, size_t length);
 
 
@@ -1184,6 +1206,10 @@ private:
                 : RECURSIVE_WILDCARD_CHECK_NO_MATCH_NO_WILDCARD;
     }
 
+    // byte string encoding, sizing then filling a caller provided buffer.
+    status_t getByteStringSize(uint32_t *size, uint32_t *headerSize) const;
+    status_t writeToByteString(char *buffer, uint32_t size, uint32_t headerSize) const;
+
     // handle Parcel version 0
     int32_t writeToParcel0(Parcel *) const;
     int32_t readFromParcel0(const Parcel&);
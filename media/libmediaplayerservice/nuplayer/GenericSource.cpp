@@ -164,6 +164,15 @@ sp<MetaData> NuPlayer::GenericSource::getFileFormatMeta() const {
     return mFileMeta;
 }
 
+sp<AMessage> NuPlayer::GenericSource::getCacheStats() {
+    sp<NuCachedSource2> cachedSource;
+    {
+        Mutex::Autolock _l_d(mDisconnectLock);
+        cachedSource = mCachedSource;
+    }
+    return cachedSource != NULL ? cachedSource->getCacheStats() : NULL;
+}
+
 status_t NuPlayer::GenericSource::initFromDataSource() {
     sp<IMediaExtractor> extractor;
     sp<DataSource> dataSource;
@@ -520,10 +529,9 @@ void NuPlayer::GenericSource::notifyPreparedAndCleanup(status_t err) {
             Mutex::Autolock _l_d(mDisconnectLock);
             mDataSource.clear();
             mHttpSource.clear();
+            mCachedSource.clear();
         }
 
-        mCachedSource.clear();
-
         mBitrate = -1;
         mPrevBufferPercentage = -1;
         ++mPollBufferingGeneration;
@@ -2293,6 +2293,15 @@ void NuPlayer::getStats(Vector<sp<AMessage> > *trackStats) {
     }
 }
 
+sp<AMessage> NuPlayer::getCacheStats() {
+    sp<Source> source;
+    {
+        Mutex::Autolock autoLock(mSourceLock);
+        source = mSource;
+    }
+    return source != NULL ? source->getCacheStats() : NULL;
+}
+
 sp<MetaData> NuPlayer::getFileMeta() {
     return mSource->getFileFormatMeta();
 }
@@ -68,6 +68,9 @@ static const char *kPlayerDataSourceType = "android.media.mediaplayer.dataSource
 static const char *kPlayerRebuffering = "android.media.mediaplayer.rebufferingMs";
 static const char *kPlayerRebufferingCount = "android.media.mediaplayer.rebuffers";
 static const char *kPlayerRebufferingAtExit = "android.media.mediaplayer.rebufferExit";
+//
+static const char *kPlayerCacheHitRatio = "android.media.mediaplayer.cacheHitRatio";
+static const char *kPlayerCacheStall = "android.media.mediaplayer.cacheStallMs";
 
 
 NuPlayerDriver::NuPlayerDriver(pid_t pid)
@@ -573,6 +576,8 @@ void NuPlayerDriver::updateMetrics(const char *where) {
     Vector<sp<AMessage>> trackStats;
     mPlayer->getStats(&trackStats);
 
+    sp<AMessage> cacheStats = mPlayer->getCacheStats();
+
     // getDuration() uses mLock
     int duration_ms = -1;
     getDuration(&duration_ms);
@@ -611,6 +616,17 @@ void NuPlayerDriver::updateMetrics(const char *where) {
 
     mMetricsItem->setCString(kPlayerDataSourceType, mPlayer->getDataSourceType());
 
+    int64_t cacheHits, cacheMisses, cacheStallUs;
+    if (cacheStats != NULL
+            && cacheStats->findInt64("hits", &cacheHits)
+            && cacheStats->findInt64("misses", &cacheMisses)
+            && cacheStats->findInt64("stall-us", &cacheStallUs)
+            && cacheHits + cacheMisses > 0) {
+        mMetricsItem->setDouble(kPlayerCacheHitRatio,
+                (double)cacheHits / (cacheHits + cacheMisses));
+        mMetricsItem->setInt64(kPlayerCacheStall, (cacheStallUs+500)/1000);
+    }
+
     if (trackStats.size() > 0) {
         for (size_t i = 0; i < trackStats.size(); ++i) {
             const sp<AMessage> &stats = trackStats.itemAt(i);
@@ -956,6 +972,8 @@ status_t NuPlayerDriver::dump(
     Vector<sp<AMessage> > trackStats;
     mPlayer->getStats(&trackStats);
 
+    sp<AMessage> cacheStats = mPlayer->getCacheStats();
+
     AString logString(" NuPlayer\n");
     char buf[256] = {0};
 
@@ -1018,6 +1036,21 @@ status_t NuPlayerDriver::dump(
         }
     }
 
+    int64_t cacheHits, cacheMisses, cacheStallUs, readAheadBytes, retainedBytes;
+    if (cacheStats != NULL
+            && cacheStats->findInt64("hits", &cacheHits)
+            && cacheStats->findInt64("misses", &cacheMisses)
+            && cacheStats->findInt64("stall-us", &cacheStallUs)
+            && cacheStats->findInt64("read-ahead-bytes", &readAheadBytes)
+            && cacheStats->findInt64("retained-bytes", &retainedBytes)) {
+        snprintf(buf, sizeof(buf), "  cache: hits(%lld), misses(%lld), stallMs(%lld), "
+                 "readAheadKB(%lld), retainedKB(%lld)\n",
+                 (long long)cacheHits, (long long)cacheMisses,
+                 (long long)(cacheStallUs / 1000),
+                 (long long)(readAheadBytes / 1024), (long long)(retainedBytes / 1024));
+        logString.append(buf);
+    }
+
     ALOGI("%s", logString.c_str());
 
     if (fd >= 0) {
@@ -72,6 +72,8 @@ struct NuPlayer::GenericSource : public NuPlayer::Source,
 
     virtual sp<MetaData> getFileFormatMeta() const;
 
+    virtual sp<AMessage> getCacheStats();
+
     virtual status_t dequeueAccessUnit(bool audio, sp<ABuffer> *accessUnit);
 
     virtual status_t getDuration(int64_t *durationUs);
@@ -93,6 +93,9 @@ struct NuPlayer::Source : public AHandler {
     virtual sp<MetaData> getFormatMeta(bool /* audio */) { return NULL; }
     virtual sp<MetaData> getFileFormatMeta() const { return NULL; }
 
+    // Statistics of the read cache of progressive streams, NULL if there is none.
+    virtual sp<AMessage> getCacheStats() { return NULL; }
+
     virtual status_t dequeueAccessUnit(
             bool audio, sp<ABuffer> *accessUnit) = 0;
 
@@ -17,6 +17,9 @@
 #define LOG_TAG "Pipe"
 //#define LOG_NDEBUG 0
 
+#include <algorithm>
+#include <stdio.h>
+
 #include <cutils/atomic.h>
 #include <cutils/compiler.h>
 #include <utils/Log.h>
@@ -60,4 +63,64 @@ ssize_t Pipe::write(const void *buffer, size_t count)
     return actual;
 }
 
+Pipe::ReaderStatsSlot* Pipe::attachReader()
+{
+    for (ReaderStatsSlot& slot : mReaderStats) {
+        bool inUse = false;
+        if (slot.mInUse.compare_exchange_strong(inUse, true)) {
+            slot.mFramesRead.store(0, std::memory_order_relaxed);
+            slot.mFramesOverrun.store(0, std::memory_order_relaxed);
+            slot.mOverruns.store(0, std::memory_order_relaxed);
+            slot.mLag.store(0, std::memory_order_relaxed);
+            slot.mMaxLag.store(0, std::memory_order_relaxed);
+            slot.mId.store(mNextReaderId++, std::memory_order_release);
+            return &slot;
+        }
+    }
+    ALOGV("%s: %zu readers already tracked", __func__, kMaxTrackedReaders);
+    return nullptr;
+}
+
+void Pipe::detachReader(ReaderStatsSlot* slot)
+{
+    slot->mInUse.store(false);
+}
+
+std::vector<Pipe::ReaderStats> Pipe::getReaderStats() const
+{
+    std::vector<ReaderStats> stats;
+    for (const ReaderStatsSlot& slot : mReaderStats) {
+        if (!slot.mInUse.load()) {
+            continue;
+        }
+        stats.push_back({
+                .id = slot.mId.load(std::memory_order_acquire),
+                .framesRead = slot.mFramesRead.load(std::memory_order_relaxed),
+                .framesOverrun = slot.mFramesOverrun.load(std::memory_order_relaxed),
+                .overruns = slot.mOverruns.load(std::memory_order_relaxed),
+                .lag = slot.mLag.load(std::memory_order_relaxed),
+                .maxLag = slot.mMaxLag.load(std::memory_order_relaxed),
+        });
+    }
+    std::sort(stats.begin(), stats.end(),
+            [](const ReaderStats& a, const ReaderStats& b) { return a.id < b.id; });
+    return stats;
+}
+
+std::string Pipe::dumpReaderStats() const
+{
+    const double msPerFrame = 1000. / Format_sampleRate(mFormat);
+    std::string result;
+    for (const ReaderStats& stats : getReaderStats()) {
+        char line[160];
+        (void)snprintf(line, sizeof(line),
+                "reader %d: read %lld overrun %lld frames in %lld overruns,"
+                " lag %.2f ms max %.2f ms\n",
+                stats.id, (long long)stats.framesRead, (long long)stats.framesOverrun,
+                (long long)stats.overruns, stats.lag * msPerFrame, stats.maxLag * msPerFrame);
+        result.append(line);
+    }
+    return result;
+}
+
 }   // namespace android
@@ -17,6 +17,8 @@
 #define LOG_TAG "PipeReader"
 //#define LOG_NDEBUG 0
 
+#include <algorithm>
+
 #include <cutils/compiler.h>
 #include <cutils/atomic.h>
 #include <utils/Log.h>
@@ -28,13 +30,19 @@ PipeReader::PipeReader(Pipe& pipe) :
         NBAIO_Source(pipe.mFormat),
         mPipe(pipe), mFifoReader(mPipe.mFifo, false /*throttlesWriter*/, false /*flush*/),
         mFramesOverrun(0),
-        mOverruns(0)
+        mOverruns(0),
+        mLag(0),
+        mMaxLag(0),
+        mStats(pipe.attachReader())
 {
     android_atomic_inc(&pipe.mReaders);
 }
 
 PipeReader::~PipeReader()
 {
+    if (mStats != nullptr) {
+        mPipe.detachReader(mStats);
+    }
 #if !LOG_NDEBUG
     int32_t readers =
 #else
@@ -54,6 +62,7 @@ ssize_t PipeReader::availableToRead()
     if (avail == -EOVERFLOW || lost > 0) {
         mFramesOverrun += lost;
         ++mOverruns;
+        updateStats();
         avail = OVERRUN;
     }
     return avail;
@@ -62,17 +71,24 @@ ssize_t PipeReader::availableToRead()
 ssize_t PipeReader::read(void *buffer, size_t count)
 {
     size_t lost;
-    ssize_t actual = mFifoReader.read(buffer, count, NULL /*timeout*/, &lost);
+    // The frames available before reading are how far this reader is behind the writer.
+    // An overrun found here has already moved the reader forward, so report it as read() would.
+    ssize_t actual = mFifoReader.available(&lost);
+    if (actual >= 0 && lost == 0) {
+        mLag = actual;
+        mMaxLag = std::max(mMaxLag, mLag);
+        actual = mFifoReader.read(buffer, count, NULL /*timeout*/, &lost);
+    }
     ALOG_ASSERT(actual <= count);
     if (actual == -EOVERFLOW || lost > 0) {
         mFramesOverrun += lost;
         ++mOverruns;
         actual = OVERRUN;
     }
-    if (actual <= 0) {
-        return actual;
+    if (actual > 0) {
+        mFramesRead += (size_t) actual;
     }
-    mFramesRead += (size_t) actual;
+    updateStats();
     return actual;
 }
 
@@ -88,11 +104,23 @@ ssize_t PipeReader::flush()
         ++mOverruns;
         flushed = OVERRUN;
     }
-    if (flushed <= 0) {
-        return flushed;
+    if (flushed > 0) {
+        mFramesRead += (size_t) flushed;  // we consider flushed frames as read, but not lost frames
     }
-    mFramesRead += (size_t) flushed;  // we consider flushed frames as read, but not lost frames
+    updateStats();
     return flushed;
 }
 
+void PipeReader::updateStats()
+{
+    if (mStats == nullptr) {
+        return;
+    }
+    mStats->mFramesRead.store(mFramesRead, std::memory_order_relaxed);
+    mStats->mFramesOverrun.store(mFramesOverrun, std::memory_order_relaxed);
+    mStats->mOverruns.store(mOverruns, std::memory_order_relaxed);
+    mStats->mLag.store(mLag, std::memory_order_relaxed);
+    mStats->mMaxLag.store(mMaxLag, std::memory_order_relaxed);
+}
+
 }   // namespace android
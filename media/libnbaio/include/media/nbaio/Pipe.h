@@ -17,6 +17,10 @@
 #ifndef ANDROID_AUDIO_PIPE_H
 #define ANDROID_AUDIO_PIPE_H
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include <audio_utils/fifo.h>
 #include <media/nbaio/NBAIO.h>
 
@@ -25,11 +29,26 @@ namespace android {
 // Pipe is multi-thread safe for readers (see PipeReader), but safe for only a single writer thread.
 // It cannot UNDERRUN on write, unless we allow designation of a primary reader that provides the
 // time-base. Readers can be added and removed dynamically, and it's OK to have no readers.
+// Each reader keeps its own position, so a slow reader overruns without affecting the others.
 class Pipe : public NBAIO_Sink {
 
     friend class PipeReader;
 
 public:
+    // Statistics of one attached PipeReader, see getReaderStats().
+    struct ReaderStats {
+        int32_t id;             // assigned in attach order, unique for the lifetime of the Pipe
+        int64_t framesRead;
+        int64_t framesOverrun;  // frames overwritten before being read
+        int64_t overruns;
+        int64_t lag;            // frames available to read at the last read()
+        int64_t maxLag;         // maximum of lag since attached
+    };
+
+    // Statistics are kept for up to this many readers attached at the same time,
+    // readers attached beyond this are not tracked.
+    static constexpr size_t kMaxTrackedReaders = 8;
+
     // maxFrames will be rounded up to a power of 2, and all slots are available. Must be >= 2.
     // buffer is an optional parameter specifying the virtual address of the pipe buffer,
     // which must be of size roundup(maxFrames) * Format_frameSize(format) bytes.
@@ -57,13 +76,38 @@ public:
     virtual ssize_t write(const void *buffer, size_t count);
     //virtual ssize_t writeVia(writeVia_t via, size_t total, void *user, size_t block);
 
+    // Returns the statistics of the readers currently attached, in attach order.
+    // Lock-free, may be called from any thread; the values of a reader are updated
+    // after each of its reads, and are not a consistent snapshot.
+    std::vector<ReaderStats> getReaderStats() const;
+
+    // Returns one line per attached reader, with lag in milliseconds, for dumpsys.
+    std::string dumpReaderStats() const;
+
 private:
+    // Statistics of a reader, written by the reader thread only.
+    struct ReaderStatsSlot {
+        std::atomic<bool>    mInUse{false};
+        std::atomic<int32_t> mId{0};
+        std::atomic<int64_t> mFramesRead{0};
+        std::atomic<int64_t> mFramesOverrun{0};
+        std::atomic<int64_t> mOverruns{0};
+        std::atomic<int64_t> mLag{0};
+        std::atomic<int64_t> mMaxLag{0};
+    };
+
+    // Called by PipeReader, returns nullptr if kMaxTrackedReaders are attached.
+    ReaderStatsSlot* attachReader();
+    void detachReader(ReaderStatsSlot* slot);
+
     const size_t    mMaxFrames;     // always a power of 2
     void * const    mBuffer;
     audio_utils_fifo        mFifo;
     audio_utils_fifo_writer mFifoWriter;
     volatile int32_t mReaders;      // number of PipeReader clients currently attached to this Pipe
     const bool      mFreeBufferInDestructor;
+    std::atomic<int32_t> mNextReaderId{0};
+    ReaderStatsSlot mReaderStats[kMaxTrackedReaders];
 };
 
 }   // namespace android
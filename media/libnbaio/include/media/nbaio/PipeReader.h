@@ -43,6 +43,11 @@ public:
     virtual int64_t framesOverrun() { return mFramesOverrun; }
     virtual int64_t overruns()  { return mOverruns; }
 
+    // Frames available to read at the last read(), that is how far this reader was behind
+    // the writer, and the maximum since attached. See also Pipe::getReaderStats().
+    int64_t lag() const { return mLag; }
+    int64_t maxLag() const { return mMaxLag; }
+
     virtual ssize_t availableToRead();
 
     virtual ssize_t read(void *buffer, size_t count);
@@ -56,10 +61,16 @@ public:
 #endif
 
 private:
+    // Publishes the statistics to the Pipe, if tracked there.
+    void updateStats();
+
     Pipe&       mPipe;
     audio_utils_fifo_reader mFifoReader;
     int64_t     mFramesOverrun;
     int64_t     mOverruns;
+    int64_t     mLag;
+    int64_t     mMaxLag;
+    Pipe::ReaderStatsSlot* const mStats;    // nullptr if not tracked
 };
 
 }   // namespace android
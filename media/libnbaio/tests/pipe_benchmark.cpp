@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/nbaio/Pipe.h>
+#include <media/nbaio/PipeReader.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kPipeFrames = 8192;
+constexpr size_t kPeriodFrames = 256; // typical fast capture period
+constexpr uint32_t kChannelCount = 2;
+
+const NBAIO_Format kFormat = Format_from_SR_C(48000, kChannelCount, AUDIO_FORMAT_PCM_16_BIT);
+
+template <typename Port>
+void negotiate(Port* port) {
+    const NBAIO_Format offers[1] = {kFormat};
+    size_t numCounterOffers = 0;
+    [[maybe_unused]] const ssize_t index =
+            port->negotiate(offers, 1, nullptr /* counterOffers */, numCounterOffers);
+}
+
+std::vector<sp<PipeReader>> attachReaders(Pipe& pipe, size_t count) {
+    std::vector<sp<PipeReader>> readers;
+    for (size_t i = 0; i < count; ++i) {
+        readers.push_back(new PipeReader(pipe));
+        negotiate(readers.back().get());
+    }
+    return readers;
+}
+
+// One period written, then read by each of range(0) readers, on the same thread.
+// This is the cost of the pipe itself, readers never lag by more than one period.
+void BM_PipeWriteRead(benchmark::State& state) {
+    const size_t readerCount = state.range(0);
+    sp<Pipe> pipe = new Pipe(kPipeFrames, kFormat);
+    negotiate(pipe.get());
+    std::vector<sp<PipeReader>> readers = attachReaders(*pipe, readerCount);
+    std::vector<int16_t> input(kPeriodFrames * kChannelCount);
+    std::vector<int16_t> output(kPeriodFrames * kChannelCount);
+
+    for (auto _ : state) {
+        pipe->write(input.data(), kPeriodFrames);
+        for (const auto& reader : readers) {
+            benchmark::DoNotOptimize(reader->read(output.data(), kPeriodFrames));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kPeriodFrames * (1 + readerCount));
+    readers.clear(); // detach before the pipe is destroyed
+}
+
+BENCHMARK(BM_PipeWriteRead)->DenseRange(1, Pipe::kMaxTrackedReaders);
+
+// One writer and range(0) readers, each on its own thread, reading as fast as they can.
+// Readers that cannot keep up overrun; the counters report the overruns and the maximum
+// lag over all readers, from Pipe::getReaderStats().
+void BM_PipeConcurrentReaders(benchmark::State& state) {
+    const size_t readerCount = state.range(0);
+    sp<Pipe> pipe = new Pipe(kPipeFrames, kFormat);
+    negotiate(pipe.get());
+    std::vector<sp<PipeReader>> readers = attachReaders(*pipe, readerCount);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (const auto& reader : readers) {
+        threads.emplace_back([&stop, reader = reader.get()] {
+            std::vector<int16_t> output(kPeriodFrames * kChannelCount);
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (reader->read(output.data(), kPeriodFrames) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int16_t> input(kPeriodFrames * kChannelCount);
+    for (auto _ : state) {
+        pipe->write(input.data(), kPeriodFrames);
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int64_t overruns = 0;
+    int64_t framesRead = 0;
+    int64_t maxLag = 0;
+    for (const Pipe::ReaderStats& stats : pipe->getReaderStats()) {
+        overruns += stats.overruns;
+        framesRead += stats.framesRead;
+        maxLag = std::max(maxLag, stats.maxLag);
+    }
+    state.SetItemsProcessed(state.iterations() * kPeriodFrames);
+    state.counters["overruns"] = overruns;
+    state.counters["framesRead"] = benchmark::Counter(framesRead, benchmark::Counter::kIsRate);
+    state.counters["maxLag"] = maxLag;
+    readers.clear();
+}
+
+BENCHMARK(BM_PipeConcurrentReaders)->DenseRange(1, Pipe::kMaxTrackedReaders)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
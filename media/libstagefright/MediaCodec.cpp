@@ -158,6 +158,9 @@ static const char *kCodecLatencyAvg = "android.media.mediacodec.latency.avg";
 static const char *kCodecLatencyCount = "android.media.mediacodec.latency.n";
 static const char *kCodecLatencyHist = "android.media.mediacodec.latency.hist"; /* in us */
 static const char *kCodecLatencyUnknown = "android.media.mediacodec.latency.unknown";
+// per-stage pipeline latencies reported by the buffer channel, e.g.
+// "android.media.mediacodec.pipeline.render.p95" (in us)
+static const char *kCodecPipelineLatencyPrefix = "android.media.mediacodec.";
 static const char *kCodecQueueSecureInputBufferError = "android.media.mediacodec.queueSecureInputBufferError";
 static const char *kCodecQueueInputBufferError = "android.media.mediacodec.queueInputBufferError";
 static const char *kCodecComponentColorFormat = "android.media.mediacodec.component-color-format";
@@ -1234,6 +1237,19 @@ void MediaCodec::updateMediametrics() {
     if (mLatencyUnknown > 0) {
         mediametrics_setInt64(mMetricsHandle, kCodecLatencyUnknown, mLatencyUnknown);
     }
+    if (mBufferChannel != nullptr) {
+        sp<AMessage> pipelineLatency = new AMessage;
+        mBufferChannel->getPipelineLatencyMetrics(pipelineLatency);
+        for (size_t i = 0; i < pipelineLatency->countEntries(); ++i) {
+            AMessage::Type type;
+            const char *name = pipelineLatency->getEntryNameAt(i, &type);
+            int64_t value;
+            if (type == AMessage::kTypeInt64 && pipelineLatency->findInt64(name, &value)) {
+                std::string key = std::string(kCodecPipelineLatencyPrefix) + name;
+                mediametrics_setInt64(mMetricsHandle, key.c_str(), value);
+            }
+        }
+    }
     int64_t playbackDurationSec = mPlaybackDurationAccumulator.getDurationInSeconds();
     if (playbackDurationSec > 0) {
         mediametrics_setInt64(mMetricsHandle, kCodecPlaybackDurationSec, playbackDurationSec);
@@ -66,9 +66,11 @@ struct HTTPDownloader : public RefBase {
             sp<ABuffer> *out,
             String8 *actualUrl = NULL);
 
-    // fetch a playlist file
+    // fetch a playlist file, reusing the segments of "previous" if it is
+    // an earlier version of the same media playlist
     sp<M3UParser> fetchPlaylist(
-            const char *url, uint8_t *curPlaylistHash, bool *unchanged);
+            const char *url, uint8_t *curPlaylistHash, bool *unchanged,
+            const sp<M3UParser> &previous = NULL);
 
 private:
     sp<HTTPBase> mHTTPDataSource;
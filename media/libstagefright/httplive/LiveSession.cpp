@@ -22,6 +22,7 @@
 #include "HTTPDownloader.h"
 #include "M3UParser.h"
 #include "PlaylistFetcher.h"
+#include "SegmentPrefetcher.h"
 
 #include <mpeg2ts/AnotherPacketSource.h>
 
@@ -54,6 +55,10 @@ const int64_t LiveSession::kResumeThresholdUs = 100000LL;
 // default buffer underflow mark
 static const int kUnderflowMarkMs = 1000;  // 1 second
 
+// segments downloaded ahead by each fetcher, media.httplive.prefetch-segments
+// overrides it and 0 turns prefetching off
+static const int kDefaultPrefetchSegments = 2;
+
 struct LiveSession::BandwidthEstimator : public RefBase {
     BandwidthEstimator();
 
@@ -495,6 +500,23 @@ sp<HTTPDownloader> LiveSession::getHTTPDownloader() {
     return new HTTPDownloader(mHTTPService, mExtraHeaders);
 }
 
+sp<SegmentPrefetcher> LiveSession::getSegmentPrefetcher() {
+    long numSegments = kDefaultPrefetchSegments;
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.httplive.prefetch-segments", value, NULL)) {
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (end > value && *end == '\0' && n >= 0) {
+            numSegments = n;
+        }
+    }
+
+    if (numSegments == 0) {
+        return NULL;
+    }
+    return new SegmentPrefetcher(mHTTPService, mExtraHeaders, numSegments);
+}
+
 void LiveSession::setBufferingSettings(
         const BufferingSettings &buffering) {
     sp<AMessage> msg = new AMessage(kWhatSetBufferingSettings, this);
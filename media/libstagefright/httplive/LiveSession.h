@@ -39,6 +39,7 @@ struct M3UParser;
 struct PlaylistFetcher;
 struct HLSTime;
 struct HTTPDownloader;
+struct SegmentPrefetcher;
 
 struct LiveSession : public AHandler {
     enum Flags {
@@ -82,6 +83,9 @@ struct LiveSession : public AHandler {
 
     sp<HTTPDownloader> getHTTPDownloader();
 
+    // Returns NULL if segments are not to be prefetched.
+    sp<SegmentPrefetcher> getSegmentPrefetcher();
+
     void connectAsync(
             const char *url,
             const KeyedVector<String8, String8> *headers = NULL);
@@ -251,6 +251,12 @@ bool M3UParser::MediaGroup::getActiveURI(AString *uri, const char *baseURL) cons
 
 M3UParser::M3UParser(
         const char *baseURI, const void *data, size_t size)
+    : M3UParser(baseURI, data, size, NULL /* previous */) {
+}
+
+M3UParser::M3UParser(
+        const char *baseURI, const void *data, size_t size,
+        const sp<M3UParser> &previous)
     : mInitCheck(NO_INIT),
       mBaseURI(baseURI),
       mIsExtM3U(false),
@@ -263,7 +269,13 @@ M3UParser::M3UParser(
       mDiscontinuitySeq(0),
       mDiscontinuityCount(0),
       mSelectedIndex(-1) {
-    mInitCheck = parse(data, size);
+    mInitCheck = parse(data, size, previous);
+    if (mInitCheck == -EAGAIN) {
+        ALOGW("segments changed under the same sequence numbers, "
+              "parsing the whole playlist");
+        reset();
+        mInitCheck = parse(data, size, NULL /* previous */);
+    }
 }
 
 M3UParser::~M3UParser() {
@@ -328,16 +340,41 @@ bool M3UParser::itemAt(size_t index, AString *uri, sp<AMessage> *meta) {
     }
 
     if (uri) {
-        *uri = mItems.itemAt(index).makeURL(mBaseURI.c_str());
+        *uri = mItems.itemAt(index)->makeURL(mBaseURI.c_str());
     }
 
     if (meta) {
-        *meta = mItems.itemAt(index).mMeta;
+        *meta = mItems.itemAt(index)->mMeta;
     }
 
     return true;
 }
 
+int64_t M3UParser::getItemStartTimeUs(size_t index) const {
+    CHECK(!mIsVariantPlaylist);
+    CHECK_LE(index, mItems.size());
+
+    return mItemStartTimesUs.itemAt(index);
+}
+
+size_t M3UParser::getItemIndexForTime(int64_t timeUs) const {
+    CHECK(!mIsVariantPlaylist);
+
+    // first item ending after timeUs
+    size_t lo = 0;
+    size_t hi = mItems.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (timeUs < mItemStartTimesUs.itemAt(mid + 1)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
 void M3UParser::pickRandomMediaItems() {
     for (size_t i = 0; i < mMediaGroups.size(); ++i) {
         mMediaGroups.valueAt(i)->pickRandomMediaItems();
@@ -429,12 +466,12 @@ bool M3UParser::getTypeURI(size_t index, const char *key, AString *uri) const {
 
     CHECK_LT(index, mItems.size());
 
-    sp<AMessage> meta = mItems.itemAt(index).mMeta;
+    sp<AMessage> meta = mItems.itemAt(index)->mMeta;
 
     AString groupID;
     if (!meta->findString(key, &groupID)) {
         if (uri != NULL) {
-            *uri = mItems.itemAt(index).makeURL(mBaseURI.c_str());
+            *uri = mItems.itemAt(index)->makeURL(mBaseURI.c_str());
         }
 
         AString codecs;
@@ -470,7 +507,7 @@ bool M3UParser::getTypeURI(size_t index, const char *key, AString *uri) const {
         }
 
         if ((*uri).empty()) {
-            *uri = mItems.itemAt(index).makeURL(mBaseURI.c_str());
+            *uri = mItems.itemAt(index)->makeURL(mBaseURI.c_str());
         }
     }
 
@@ -566,34 +603,142 @@ AString M3UParser::MediaGroup::Media::makeURL(const char *baseURL) const {
     return out;
 }
 
-status_t M3UParser::parse(const void *_data, size_t size) {
+void M3UParser::reset() {
+    mIsExtM3U = false;
+    mIsVariantPlaylist = false;
+    mIsComplete = false;
+    mIsEvent = false;
+    mFirstSeqNumber = -1;
+    mLastSeqNumber = -1;
+    mTargetDurationUs = -1LL;
+    mDiscontinuitySeq = 0;
+    mDiscontinuityCount = 0;
+    mMeta.clear();
+    mItems.clear();
+    mItemStartTimesUs.clear();
+    mMediaGroups.clear();
+}
+
+static bool LineStartsWith(const char *line, size_t length, const char *prefix) {
+    size_t prefixLength = strlen(prefix);
+    return length >= prefixLength && !memcmp(line, prefix, prefixLength);
+}
+
+status_t M3UParser::parse(
+        const void *_data, size_t size, const sp<M3UParser> &previous) {
     int32_t lineNo = 0;
 
     sp<AMessage> itemMeta;
 
+    // Segments of a live playlist are listed again on each reload until they
+    // slide out of the window, the ones "previous" has are not parsed again.
+    bool reuseItems = previous != NULL
+            && previous->initCheck() == OK
+            && !previous->isVariantPlaylist()
+            && previous->mBaseURI == mBaseURI;
+    size_t numReusedItems = 0;
+
     const char *data = (const char *)_data;
     size_t offset = 0;
     uint64_t segmentRangeOffset = 0;
+    int64_t durationUs = 0;
     while (offset < size) {
         size_t offsetLF = offset;
         while (offsetLF < size && data[offsetLF] != '\n') {
             ++offsetLF;
         }
 
-        AString line;
-        if (offsetLF > offset && data[offsetLF - 1] == '\r') {
-            line.setTo(&data[offset], offsetLF - offset - 1);
-        } else {
-            line.setTo(&data[offset], offsetLF - offset);
+        size_t lineLength = offsetLF - offset;
+        if (lineLength > 0 && data[offsetLF - 1] == '\r') {
+            --lineLength;
         }
 
-        // ALOGI("#%s#", line.c_str());
-
-        if (line.empty()) {
+        if (lineLength == 0) {
             offset = offsetLF + 1;
             continue;
         }
 
+        // Index in "previous" of the next segment.
+        ssize_t previousIndex = -1;
+        if (reuseItems && mIsExtM3U && !mIsVariantPlaylist) {
+            int32_t firstSeqNumber = 0;
+            if (mMeta != NULL) {
+                mMeta->findInt32("media-sequence", &firstSeqNumber);
+            }
+            int64_t index = (int64_t)firstSeqNumber + (int64_t)mItems.size()
+                    - previous->mFirstSeqNumber;
+            if (index >= 0 && index < (int64_t)previous->mItems.size()) {
+                previousIndex = index;
+            }
+        }
+
+        if (previousIndex >= 0) {
+            const char *line = &data[offset];
+            bool skip = false;
+            if (line[0] != '#') {
+                const sp<Item> &item = previous->mItems.itemAt(previousIndex);
+                int32_t discontinuitySeq;
+                CHECK(item->mMeta->findInt32("discontinuity-sequence", &discontinuitySeq));
+                if (item->mURI.size() != lineLength
+                        || memcmp(item->mURI.c_str(), line, lineLength)
+                        || discontinuitySeq != (int32_t)(mDiscontinuitySeq + mDiscontinuityCount)) {
+                    return -EAGAIN;
+                }
+
+                if (itemMeta != NULL) {
+                    // The key was listed again, as it is for the first
+                    // segment of a window.
+                    sp<Item> keyedItem = new Item;
+                    keyedItem->mURI = item->mURI;
+                    keyedItem->mMeta = item->mMeta->dup();
+                    const char *keys[] = {"cipher-method", "cipher-uri", "cipher-iv"};
+                    for (size_t i = 0; i < sizeof(keys) / sizeof(const char *); ++i) {
+                        AString value;
+                        if (itemMeta->findString(keys[i], &value)) {
+                            keyedItem->mMeta->setString(keys[i], value.c_str(), value.size());
+                        }
+                    }
+                    mItems.push(keyedItem);
+                } else {
+                    mItems.push(item);
+                }
+
+                int64_t rangeOffset, rangeLength;
+                if (item->mMeta->findInt64("range-offset", &rangeOffset)
+                        && item->mMeta->findInt64("range-length", &rangeLength)) {
+                    segmentRangeOffset = rangeOffset + rangeLength;
+                }
+
+                mItemStartTimesUs.push(durationUs);
+                durationUs += previous->mItemStartTimesUs.itemAt(previousIndex + 1)
+                        - previous->mItemStartTimesUs.itemAt(previousIndex);
+                ++numReusedItems;
+
+                itemMeta.clear();
+                skip = true;
+            } else if (LineStartsWith(line, lineLength, "#EXT-X-DISCONTINUITY-SEQUENCE")) {
+                // parsed below
+            } else if (LineStartsWith(line, lineLength, "#EXT-X-DISCONTINUITY")) {
+                ++mDiscontinuityCount;
+                skip = true;
+            } else if (LineStartsWith(line, lineLength, "#EXTINF")
+                    || LineStartsWith(line, lineLength, "#EXT-X-BYTERANGE")) {
+                // already in the meta data of the item
+                skip = true;
+            }
+
+            if (skip) {
+                offset = offsetLF + 1;
+                ++lineNo;
+                continue;
+            }
+        }
+
+        AString line;
+        line.setTo(&data[offset], lineLength);
+
+        // ALOGI("#%s#", line.c_str());
+
         if (lineNo == 0 && line == "#EXTM3U") {
             mIsExtM3U = true;
         }
@@ -610,6 +755,10 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
                 }
+                if (numReusedItems > 0) {
+                    // segments were matched against the wrong sequence numbers
+                    return -EAGAIN;
+                }
                 err = parseMetaData(line, &mMeta, "media-sequence");
             } else if (line.startsWith("#EXT-X-KEY")) {
                 if (mIsVariantPlaylist) {
@@ -685,20 +834,21 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 return ERROR_MALFORMED;
             }
             if (!mIsVariantPlaylist) {
-                int64_t durationUs;
-                if (!itemMeta->findInt64("durationUs", &durationUs)) {
+                int64_t itemDurationUs;
+                if (!itemMeta->findInt64("durationUs", &itemDurationUs)) {
                     return ERROR_MALFORMED;
                 }
                 itemMeta->setInt32("discontinuity-sequence",
                         mDiscontinuitySeq + mDiscontinuityCount);
-            }
 
-            mItems.push();
-            Item *item = &mItems.editItemAt(mItems.size() - 1);
+                mItemStartTimesUs.push(durationUs);
+                durationUs += itemDurationUs;
+            }
 
+            sp<Item> item = new Item;
             item->mURI = line;
-
             item->mMeta = itemMeta;
+            mItems.push(item);
 
             itemMeta.clear();
         }
@@ -730,10 +880,18 @@ status_t M3UParser::parse(const void *_data, size_t size) {
             mMeta->findInt32("media-sequence", &mFirstSeqNumber);
         }
         mLastSeqNumber = mFirstSeqNumber + mItems.size() - 1;
+
+        mItemStartTimesUs.push(durationUs);
+
+        ALOGV("%zu of %zu segments taken from the previous playlist",
+                numReusedItems, mItems.size());
+
+        // only variant playlists reference media groups
+        return OK;
     }
 
     for (size_t i = 0; i < mItems.size(); ++i) {
-        sp<AMessage> meta = mItems.itemAt(i).mMeta;
+        sp<AMessage> meta = mItems.itemAt(i)->mMeta;
         const char *keys[] = {"audio", "video", "subtitles"};
         for (size_t j = 0; j < sizeof(keys) / sizeof(const char *); ++j) {
             AString groupID;
@@ -29,6 +29,12 @@ namespace android {
 struct M3UParser : public RefBase {
     M3UParser(const char *baseURI, const void *data, size_t size);
 
+    // Parses a reload of the media playlist "previous" was parsed from. The
+    // segments both versions have, by media sequence number, are taken from
+    // "previous" and their tags are not parsed again.
+    M3UParser(const char *baseURI, const void *data, size_t size,
+              const sp<M3UParser> &previous);
+
     status_t initCheck() const;
 
     bool isExtM3U() const;
@@ -45,6 +51,13 @@ struct M3UParser : public RefBase {
     size_t size();
     bool itemAt(size_t index, AString *uri, sp<AMessage> *meta = NULL);
 
+    // Media playlists only. Time from the start of the first item to the
+    // start of the item at "index", the duration of the playlist for
+    // index == size().
+    int64_t getItemStartTimeUs(size_t index) const;
+    // Index of the item playing at "timeUs", size() if it is past the end.
+    size_t getItemIndexForTime(int64_t timeUs) const;
+
     void pickRandomMediaItems();
     status_t selectTrack(size_t index, bool select);
     size_t getTrackCount() const;
@@ -63,7 +76,8 @@ protected:
 private:
     struct MediaGroup;
 
-    struct Item {
+    // Not modified once parsed, successive versions of a playlist share them.
+    struct Item : public RefBase {
         AString mURI;
         sp<AMessage> mMeta;
         AString makeURL(const char *baseURL) const;
@@ -83,13 +97,16 @@ private:
     int32_t mDiscontinuityCount;
 
     sp<AMessage> mMeta;
-    Vector<Item> mItems;
+    Vector<sp<Item> > mItems;
+    // mItemStartTimesUs[i] for getItemStartTimeUs(i), size() + 1 entries.
+    Vector<int64_t> mItemStartTimesUs;
     ssize_t mSelectedIndex;
 
     // Media groups keyed by group ID.
     KeyedVector<AString, sp<MediaGroup> > mMediaGroups;
 
-    status_t parse(const void *data, size_t size);
+    status_t parse(const void *data, size_t size, const sp<M3UParser> &previous);
+    void reset();
 
     static status_t parseMetaData(
             const AString &line, sp<AMessage> *meta, const char *key);
@@ -24,6 +24,7 @@
 #include "HTTPDownloader.h"
 #include "LiveSession.h"
 #include "M3UParser.h"
+#include "SegmentPrefetcher.h"
 #include <ID3.h>
 #include <mpeg2ts/AnotherPacketSource.h>
 #include <mpeg2ts/HlsSampleDecryptor.h>
@@ -180,6 +181,7 @@ PlaylistFetcher::PlaylistFetcher(
       mHasMetadata(false) {
     memset(mPlaylistHash, 0, sizeof(mPlaylistHash));
     mHTTPDownloader = mSession->getHTTPDownloader();
+    mPrefetcher = mSession->getSegmentPrefetcher();
 
     memset(mKeyData, 0, sizeof(mKeyData));
     memset(mAESInitVec, 0, sizeof(mAESInitVec));
@@ -202,20 +204,7 @@ int64_t PlaylistFetcher::getSegmentStartTimeUs(int32_t seqNumber) const {
     CHECK_GE(seqNumber, firstSeqNumberInPlaylist);
     CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
 
-    int64_t segmentStartUs = 0LL;
-    for (int32_t index = 0;
-            index < seqNumber - firstSeqNumberInPlaylist; ++index) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt(
-                    index, NULL /* uri */, &itemMeta));
-
-        int64_t itemDurationUs;
-        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
-
-        segmentStartUs += itemDurationUs;
-    }
-
-    return segmentStartUs;
+    return mPlaylist->getItemStartTimeUs(seqNumber - firstSeqNumberInPlaylist);
 }
 
 int64_t PlaylistFetcher::getSegmentDurationUs(int32_t seqNumber) const {
@@ -308,8 +297,7 @@ status_t PlaylistFetcher::decryptBuffer(
     AString method;
 
     for (ssize_t i = playlistIndex; i >= 0; --i) {
-        AString uri;
-        CHECK(mPlaylist->itemAt(i, &uri, &itemMeta));
+        CHECK(mPlaylist->itemAt(i, NULL /* uri */, &itemMeta));
 
         if (itemMeta->findString("cipher-method", &method)) {
             found = true;
@@ -525,6 +513,9 @@ void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->disconnect();
+        }
     }
 }
 
@@ -535,9 +526,15 @@ void PlaylistFetcher::resetStoppingThreshold(bool disconnect) {
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->disconnect();
+        }
     } else {
         // allow reconnect
         mHTTPDownloader->reconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->reconnect();
+        }
     }
 }
 
@@ -779,6 +776,9 @@ status_t PlaylistFetcher::onStart(const sp<AMessage> &msg) {
         mSeqNumber = -1;
         mTimeChangeSignaled = false;
         mDownloadState->resetState();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->clear();
+        }
     }
 
     postMonitorQueue();
@@ -806,6 +806,9 @@ void PlaylistFetcher::onStop(const sp<AMessage> &msg) {
     }
 
     mDownloadState->resetState();
+    if (mPrefetcher != NULL) {
+        mPrefetcher->clear();
+    }
     mPacketSources.clear();
     mStreamTypeMask = 0;
 
@@ -937,7 +940,7 @@ status_t PlaylistFetcher::refreshPlaylist() {
     if (delayUsToRefreshPlaylist() <= 0) {
         bool unchanged;
         sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                mURI.c_str(), mPlaylistHash, &unchanged);
+                mURI.c_str(), mPlaylistHash, &unchanged, mPlaylist);
 
         if (playlist == NULL) {
             if (unchanged) {
@@ -1364,15 +1367,51 @@ void PlaylistFetcher::onDownloadNext() {
         range_length = -1;
     }
 
+    ssize_t prefetchedBytes = 0;
+    int64_t prefetchedDelayUs = 0;
+    if (connectHTTP && mPrefetcher != NULL) {
+        prefetchedBytes = mPrefetcher->take(mSeqNumber, uri, &buffer, &prefetchedDelayUs);
+        if (prefetchedBytes == ERROR_NOT_CONNECTED) {
+            return;
+        }
+        if (prefetchedBytes >= 0) {
+            FLOGV("segment %d was prefetched", mSeqNumber);
+            buffer->meta()->setInt32("prefetched", 1);
+        } else {
+            if (prefetchedBytes != NAME_NOT_FOUND) {
+                ALOGW("failed to prefetch segment %d (%zd), fetching it again",
+                        mSeqNumber, prefetchedBytes);
+            }
+            buffer.clear();
+            prefetchedBytes = 0;
+        }
+
+        if (!mStartup && mStopParams == NULL) {
+            prefetchSegments(firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+        }
+    }
+
     // block-wise download
     bool shouldPause = false;
     ssize_t bytesRead;
     do {
-        int64_t startUs = ALooper::GetNowUs();
-        bytesRead = mHTTPDownloader->fetchBlock(
-                uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
-                NULL /* actualURL */, connectHTTP);
-        int64_t delayUs = ALooper::GetNowUs() - startUs;
+        int32_t prefetched;
+        int64_t delayUs;
+        if (prefetchedBytes > 0) {
+            // hand the whole segment over as a single block
+            bytesRead = prefetchedBytes;
+            delayUs = prefetchedDelayUs;
+            prefetchedBytes = 0;
+        } else if (buffer != NULL && buffer->meta()->findInt32("prefetched", &prefetched)) {
+            bytesRead = 0;
+            delayUs = 0;
+        } else {
+            int64_t startUs = ALooper::GetNowUs();
+            bytesRead = mHTTPDownloader->fetchBlock(
+                    uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
+                    NULL /* actualURL */, connectHTTP);
+            delayUs = ALooper::GetNowUs() - startUs;
+        }
 
         if (bytesRead == ERROR_NOT_CONNECTED) {
             return;
@@ -1555,6 +1594,29 @@ void PlaylistFetcher::onDownloadNext() {
     }
 }
 
+void PlaylistFetcher::prefetchSegments(
+        int32_t firstSeqNumberInPlaylist, int32_t lastSeqNumberInPlaylist) {
+    mPrefetcher->discardBefore(mSeqNumber + 1);
+
+    for (int32_t seqNumber = mSeqNumber + 1;
+            seqNumber <= lastSeqNumberInPlaylist; ++seqNumber) {
+        AString uri;
+        sp<AMessage> itemMeta;
+        CHECK(mPlaylist->itemAt(seqNumber - firstSeqNumberInPlaylist, &uri, &itemMeta));
+
+        int64_t rangeOffset, rangeLength;
+        if (!itemMeta->findInt64("range-offset", &rangeOffset)
+                || !itemMeta->findInt64("range-length", &rangeLength)) {
+            rangeOffset = 0;
+            rangeLength = -1;
+        }
+
+        if (!mPrefetcher->prefetch(seqNumber, uri, rangeOffset, rangeLength)) {
+            break;
+        }
+    }
+}
+
 /*
  * returns true if we need to adjust mSeqNumber
  */
@@ -1643,23 +1705,7 @@ int32_t PlaylistFetcher::getSeqNumberForDiscontinuity(size_t discontinuitySeq) c
 }
 
 int32_t PlaylistFetcher::getSeqNumberForTime(int64_t timeUs) const {
-    size_t index = 0;
-    int64_t segmentStartUs = 0;
-    while (index < mPlaylist->size()) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt(
-                    index, NULL /* uri */, &itemMeta));
-
-        int64_t itemDurationUs;
-        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
-
-        if (timeUs < segmentStartUs + itemDurationUs) {
-            break;
-        }
-
-        segmentStartUs += itemDurationUs;
-        ++index;
-    }
+    size_t index = mPlaylist->getItemIndexForTime(timeUs);
 
     if (index >= mPlaylist->size()) {
         index = mPlaylist->size() - 1;
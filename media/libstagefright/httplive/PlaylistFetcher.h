@@ -33,6 +33,7 @@ struct HTTPBase;
 struct LiveDataSource;
 struct M3UParser;
 class String8;
+struct SegmentPrefetcher;
 
 struct PlaylistFetcher : public AHandler {
     static const int64_t kMinBufferedDurationUs;
@@ -118,6 +119,7 @@ private:
     sp<AMessage> mStartTimeUsNotify;
 
     sp<HTTPDownloader> mHTTPDownloader;
+    sp<SegmentPrefetcher> mPrefetcher;
     sp<LiveSession> mSession;
     AString mURI;
 
@@ -223,6 +225,10 @@ private:
     void onStop(const sp<AMessage> &msg);
     void onMonitorQueue();
     void onDownloadNext();
+    // Starts downloading the segments after mSeqNumber in the background.
+    void prefetchSegments(
+            int32_t firstSeqNumberInPlaylist,
+            int32_t lastSeqNumberInPlaylist);
     void initSeqNumberForLiveStream(
             int32_t &firstSeqNumberInPlaylist,
             int32_t &lastSeqNumberInPlaylist);
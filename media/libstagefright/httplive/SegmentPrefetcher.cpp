@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher"
+#include <utils/Log.h>
+
+#include "SegmentPrefetcher.h"
+#include "HTTPDownloader.h"
+
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+
+namespace android {
+
+struct SegmentPrefetcher::Segment : public RefBase {
+    Segment(int32_t seqNumber, const AString &uri,
+            int64_t rangeOffset, int64_t rangeLength)
+        : mSeqNumber(seqNumber),
+          mUri(uri),
+          mRangeOffset(rangeOffset),
+          mRangeLength(rangeLength),
+          mDone(false),
+          mResult(OK),
+          mDelayUs(0) {
+    }
+
+    const int32_t mSeqNumber;
+    const AString mUri;
+    const int64_t mRangeOffset;
+    const int64_t mRangeLength;
+
+    // Guarded by the lock of the prefetcher.
+    bool mDone;
+    ssize_t mResult;
+    sp<ABuffer> mBuffer;
+    int64_t mDelayUs;
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(Segment);
+};
+
+struct SegmentPrefetcher::Worker : public AHandler {
+    Worker(SegmentPrefetcher *prefetcher, const sp<HTTPDownloader> &downloader)
+        : mPrefetcher(prefetcher),
+          mDownloader(downloader),
+          mBusy(false) {
+    }
+
+    void downloadAsync(const sp<Segment> &segment) {
+        sp<AMessage> msg = new AMessage(kWhatDownload, this);
+        msg->setObject("segment", segment);
+        msg->post();
+    }
+
+    // The prefetcher stops the looper before going away.
+    SegmentPrefetcher *const mPrefetcher;
+    const sp<HTTPDownloader> mDownloader;
+    // Guarded by the lock of the prefetcher.
+    bool mBusy;
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        CHECK_EQ(msg->what(), (uint32_t)kWhatDownload);
+
+        sp<RefBase> obj;
+        CHECK(msg->findObject("segment", &obj));
+        sp<Segment> segment = static_cast<Segment *>(obj.get());
+
+        sp<ABuffer> buffer;
+        ssize_t result = mDownloader->fetchBlock(
+                segment->mUri.c_str(), &buffer,
+                segment->mRangeOffset, segment->mRangeLength,
+                0 /* block_size */, NULL /* actualUrl */, true /* reconnect */);
+
+        mPrefetcher->onSegmentDownloaded(this, segment, result, buffer);
+    }
+
+private:
+    enum {
+        kWhatDownload = 'down',
+    };
+
+    DISALLOW_EVIL_CONSTRUCTORS(Worker);
+};
+
+SegmentPrefetcher::SegmentPrefetcher(
+        const sp<MediaHTTPService> &httpService,
+        const KeyedVector<String8, String8> &headers,
+        size_t maxSegments)
+    : mHTTPService(httpService),
+      mExtraHeaders(headers),
+      mMaxSegments(maxSegments),
+      mNumDownloads(0),
+      mBusySinceUs(-1LL),
+      mDisconnecting(false) {
+}
+
+SegmentPrefetcher::~SegmentPrefetcher() {
+    disconnect();
+
+    for (size_t i = 0; i < mLoopers.size(); ++i) {
+        mLoopers[i]->unregisterHandler(mWorkers[i]->id());
+        mLoopers[i]->stop();
+    }
+}
+
+bool SegmentPrefetcher::prefetch(
+        int32_t seqNumber,
+        const AString &uri,
+        int64_t rangeOffset,
+        int64_t rangeLength) {
+    AutoMutex _l(mLock);
+
+    if (mDisconnecting) {
+        return false;
+    }
+
+    ssize_t index = mSegments.indexOfKey(seqNumber);
+    if (index >= 0) {
+        return mSegments.valueAt(index)->mUri == uri;
+    }
+
+    if (mSegments.size() >= mMaxSegments) {
+        return false;
+    }
+
+    if (mWorkers.isEmpty()) {
+        for (size_t i = 0; i < mMaxSegments; ++i) {
+            sp<ALooper> looper = new ALooper;
+            looper->setName("SegmentPrefetcher");
+            looper->start(false /* runOnCallingThread */, true /* canCallJava */);
+
+            sp<Worker> worker = new Worker(
+                    this, new HTTPDownloader(mHTTPService, mExtraHeaders));
+            looper->registerHandler(worker);
+
+            mLoopers.push(looper);
+            mWorkers.push(worker);
+        }
+    }
+
+    sp<Worker> worker;
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        if (!mWorkers[i]->mBusy) {
+            worker = mWorkers[i];
+            break;
+        }
+    }
+    if (worker == NULL) {
+        // Still downloading segments that were discarded.
+        return false;
+    }
+
+    ALOGV("prefetching segment %d", seqNumber);
+
+    sp<Segment> segment = new Segment(seqNumber, uri, rangeOffset, rangeLength);
+    mSegments.add(seqNumber, segment);
+
+    if (mNumDownloads++ == 0) {
+        mBusySinceUs = ALooper::GetNowUs();
+    }
+    worker->mBusy = true;
+    worker->downloadAsync(segment);
+
+    return true;
+}
+
+ssize_t SegmentPrefetcher::take(
+        int32_t seqNumber,
+        const AString &uri,
+        sp<ABuffer> *out,
+        int64_t *delayUs) {
+    AutoMutex _l(mLock);
+
+    ssize_t index = mSegments.indexOfKey(seqNumber);
+    if (index < 0) {
+        return NAME_NOT_FOUND;
+    }
+
+    sp<Segment> segment = mSegments.valueAt(index);
+    mSegments.removeItemsAt(index);
+
+    if (segment->mUri != uri) {
+        // The playlist was reloaded with other segments.
+        return NAME_NOT_FOUND;
+    }
+
+    while (!segment->mDone) {
+        mCondition.wait(mLock);
+    }
+
+    *out = segment->mBuffer;
+    *delayUs = segment->mDelayUs;
+
+    return segment->mResult;
+}
+
+void SegmentPrefetcher::discardBefore(int32_t seqNumber) {
+    AutoMutex _l(mLock);
+
+    while (!mSegments.isEmpty() && mSegments.keyAt(0) < seqNumber) {
+        ALOGV("discarding segment %d", mSegments.keyAt(0));
+        mSegments.removeItemsAt(0);
+    }
+}
+
+void SegmentPrefetcher::clear() {
+    AutoMutex _l(mLock);
+
+    mSegments.clear();
+}
+
+void SegmentPrefetcher::disconnect() {
+    Vector<sp<Worker> > workers;
+    {
+        AutoMutex _l(mLock);
+        mDisconnecting = true;
+        workers = mWorkers;
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->mDownloader->disconnect();
+    }
+}
+
+void SegmentPrefetcher::reconnect() {
+    AutoMutex _l(mLock);
+
+    mDisconnecting = false;
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i]->mDownloader->reconnect();
+    }
+}
+
+void SegmentPrefetcher::onSegmentDownloaded(
+        const sp<Worker> &worker, const sp<Segment> &segment,
+        ssize_t result, const sp<ABuffer> &buffer) {
+    AutoMutex _l(mLock);
+
+    int64_t nowUs = ALooper::GetNowUs();
+
+    worker->mBusy = false;
+    --mNumDownloads;
+
+    segment->mDone = true;
+    segment->mResult = result;
+    segment->mBuffer = buffer;
+    segment->mDelayUs = nowUs - mBusySinceUs;
+    mBusySinceUs = nowUs;
+
+    ALOGV("segment %d: %zd bytes, charged %lld us",
+            segment->mSeqNumber, result, (long long)segment->mDelayUs);
+
+    mCondition.broadcast();
+}
+
+}  // namespace android
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENT_PREFETCHER_H_
+
+#define SEGMENT_PREFETCHER_H_
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+struct ALooper;
+struct HTTPDownloader;
+struct MediaHTTPService;
+
+// Downloads the segments following the one a PlaylistFetcher is working on,
+// up to "maxSegments" of them at a time. Each download runs on a worker with
+// its own looper and HTTPDownloader; the workers live as long as the
+// prefetcher, so every segment reuses a connection that is already open.
+//
+// Downloads overlap, so the time of each one doesn't tell the bandwidth. A
+// segment is instead charged with the time the pool was busy since the
+// previous segment completed: the times then add up to the wall-clock time
+// spent downloading and the estimate is the aggregate throughput.
+struct SegmentPrefetcher : public RefBase {
+    SegmentPrefetcher(
+            const sp<MediaHTTPService> &httpService,
+            const KeyedVector<String8, String8> &headers,
+            size_t maxSegments);
+
+    // Starts downloading segment "seqNumber" from "uri", returns false if
+    // all workers are busy or "maxSegments" segments are held already.
+    // Returns true if the segment is, or will be, available to take().
+    bool prefetch(
+            int32_t seqNumber,
+            const AString &uri,
+            int64_t rangeOffset,  /* see HTTPDownloader::fetchBlock */
+            int64_t rangeLength);
+
+    // If segment "seqNumber" was prefetched from "uri", waits for its
+    // download and returns the result of HTTPDownloader::fetchBlock, along
+    // with the time charged to the segment. NAME_NOT_FOUND otherwise.
+    ssize_t take(
+            int32_t seqNumber,
+            const AString &uri,
+            sp<ABuffer> *out,
+            int64_t *delayUs);
+
+    // Drops the segments before "seqNumber", or all of them. Downloads in
+    // progress complete but their data is discarded.
+    void discardBefore(int32_t seqNumber);
+    void clear();
+
+    // Like HTTPDownloader, disconnect() interrupts the downloads and any
+    // take() waiting for them; nothing is prefetched until reconnect().
+    void disconnect();
+    void reconnect();
+
+protected:
+    virtual ~SegmentPrefetcher();
+
+private:
+    struct Segment;
+    struct Worker;
+
+    sp<MediaHTTPService> mHTTPService;
+    KeyedVector<String8, String8> mExtraHeaders;
+    const size_t mMaxSegments;
+
+    Mutex mLock;
+    Condition mCondition;
+    // Created on the first prefetch.
+    Vector<sp<ALooper> > mLoopers;
+    Vector<sp<Worker> > mWorkers;
+    KeyedVector<int32_t, sp<Segment> > mSegments;
+    size_t mNumDownloads;
+    // Start of the time not yet charged to a segment.
+    int64_t mBusySinceUs;
+    bool mDisconnecting;
+
+    void onSegmentDownloaded(
+            const sp<Worker> &worker, const sp<Segment> &segment,
+            ssize_t result, const sp<ABuffer> &buffer);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentPrefetcher);
+};
+
+}  // namespace android
+
+#endif  // SEGMENT_PREFETCHER_H_
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times the parsing of a reloaded live media playlist with a long window, in
+// full or reusing the segments of the previous version.
+//
+// usage: M3UParserBenchmark [benchmark options]
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <M3UParser.h>
+
+using namespace android;
+
+namespace {
+
+const char kBaseUri[] = "https://example.com/live/1080p/playlist.m3u8";
+
+// Window of "numSegments" 6 second segments, a key every 100 segments and a
+// discontinuity every 1000, as for a DVR window of a live event.
+std::string makePlaylist(int32_t firstSeqNumber, int32_t numSegments) {
+    std::string playlist =
+            "#EXTM3U\n"
+            "#EXT-X-VERSION:3\n"
+            "#EXT-X-TARGETDURATION:6\n"
+            "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(firstSeqNumber) + "\n"
+            "#EXT-X-DISCONTINUITY-SEQUENCE:" + std::to_string((firstSeqNumber - 1) / 1000) + "\n";
+    for (int32_t i = 0; i < numSegments; ++i) {
+        int32_t seqNumber = firstSeqNumber + i;
+        if (seqNumber % 1000 == 0) {
+            playlist += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (i == 0 || seqNumber % 100 == 0) {
+            playlist += "#EXT-X-KEY:METHOD=AES-128,URI=\"https://keys.example.com/key?id=" +
+                    std::to_string(seqNumber / 100) + "\",IV=0x" +
+                    std::to_string(1000000000 + seqNumber) + "\n";
+        }
+        playlist += "#EXTINF:6.006,\n";
+        playlist += "segment_1080p_" + std::to_string(seqNumber) + ".ts\n";
+    }
+    return playlist;
+}
+
+// range(0) is the number of segments in the window, range(1) is 1 to reuse the
+// segments of the previous version of the playlist, 0 to parse all of them.
+void BM_ParseReload(benchmark::State &state) {
+    const int32_t numSegments = state.range(0);
+    const bool incremental = state.range(1) != 0;
+
+    // The window slides by one segment on each reload.
+    const std::string text = makePlaylist(1, numSegments);
+    const std::string reloadedText = makePlaylist(2, numSegments);
+    sp<M3UParser> previous = new M3UParser(kBaseUri, text.data(), text.size());
+    if (previous->initCheck() != OK) {
+        state.SkipWithError("Cannot parse the playlist");
+        return;
+    }
+
+    for (auto _ : state) {
+        sp<M3UParser> playlist = incremental
+                ? new M3UParser(kBaseUri, reloadedText.data(), reloadedText.size(), previous)
+                : new M3UParser(kBaseUri, reloadedText.data(), reloadedText.size());
+        if (playlist->initCheck() != OK) {
+            state.SkipWithError("Cannot parse the reloaded playlist");
+            return;
+        }
+        benchmark::DoNotOptimize(playlist.get());
+    }
+    state.SetBytesProcessed(state.iterations() * reloadedText.size());
+    state.SetItemsProcessed(state.iterations() * numSegments);
+    state.SetLabel(incremental ? "incremental" : "full");
+}
+
+BENCHMARK(BM_ParseReload)
+        ->ArgsProduct({{100, 1000, 5000, 20000}, {0, 1}})
+        ->ArgNames({"segments", "incremental"})
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
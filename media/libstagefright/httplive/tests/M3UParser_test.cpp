@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "M3UParser_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <M3UParser.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+#include <string>
+
+namespace android {
+
+static const char kBaseUri[] = "http://127.0.0.1/live/playlist.m3u8";
+static const int32_t kDiscontinuityInterval = 7;
+static const int32_t kKeyInterval = 10;
+static const int32_t kRangeLength = 1000;
+
+// Live window of "numSegments" segments from "firstSeqNumber", as a server
+// would list it: a discontinuity before every kDiscontinuityInterval-th
+// segment and a new key every kKeyInterval segments, listed again for the
+// first segment. With "byteRanges", the segments are consecutive ranges of
+// one file.
+static std::string makePlaylist(int32_t firstSeqNumber, int32_t numSegments,
+                                bool byteRanges = false, const char *uriPrefix = "seg") {
+    std::string playlist =
+            "#EXTM3U\n"
+            "#EXT-X-VERSION:4\n"
+            "#EXT-X-TARGETDURATION:2\n"
+            "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(firstSeqNumber) + "\n"
+            "#EXT-X-DISCONTINUITY-SEQUENCE:" +
+            std::to_string((firstSeqNumber - 1) / kDiscontinuityInterval) + "\n";
+    for (int32_t i = 0; i < numSegments; ++i) {
+        int32_t seqNumber = firstSeqNumber + i;
+        if (seqNumber > 0 && seqNumber % kDiscontinuityInterval == 0) {
+            playlist += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (i == 0 || seqNumber % kKeyInterval == 0) {
+            playlist += "#EXT-X-KEY:METHOD=AES-128,URI=\"key" +
+                    std::to_string(seqNumber / kKeyInterval) + ".bin\"\n";
+        }
+        playlist += seqNumber % 2 ? "#EXTINF:2.0,\n" : "#EXTINF:1.5,\n";
+        if (byteRanges) {
+            playlist += "#EXT-X-BYTERANGE:" + std::to_string(kRangeLength);
+            if (i == 0) {
+                playlist += "@" + std::to_string((int64_t)seqNumber * kRangeLength);
+            }
+            playlist += "\nmedia.ts\n";
+        } else {
+            playlist += uriPrefix + std::to_string(seqNumber) + ".ts\n";
+        }
+    }
+    return playlist;
+}
+
+static sp<M3UParser> parse(const std::string &playlist,
+                           const sp<M3UParser> &previous = NULL) {
+    sp<M3UParser> parser = previous == NULL
+            ? new M3UParser(kBaseUri, playlist.data(), playlist.size())
+            : new M3UParser(kBaseUri, playlist.data(), playlist.size(), previous);
+    EXPECT_EQ(parser->initCheck(), OK);
+    return parser;
+}
+
+// The key of an item is the last one listed before it.
+static std::string keyUri(const sp<M3UParser> &parser, size_t index) {
+    for (ssize_t i = index; i >= 0; --i) {
+        sp<AMessage> meta;
+        AString uri;
+        if (parser->itemAt(i, NULL /* uri */, &meta) && meta->findString("cipher-uri", &uri)) {
+            return uri.c_str();
+        }
+    }
+    return "";
+}
+
+static void expectSameItems(const sp<M3UParser> &parser, const sp<M3UParser> &expected) {
+    int32_t firstSeq, lastSeq, expectedFirstSeq, expectedLastSeq;
+    parser->getSeqNumberRange(&firstSeq, &lastSeq);
+    expected->getSeqNumberRange(&expectedFirstSeq, &expectedLastSeq);
+    ASSERT_EQ(firstSeq, expectedFirstSeq);
+    ASSERT_EQ(lastSeq, expectedLastSeq);
+    ASSERT_EQ(parser->size(), expected->size());
+    EXPECT_EQ(parser->getDiscontinuitySeq(), expected->getDiscontinuitySeq());
+
+    for (size_t i = 0; i < parser->size(); ++i) {
+        AString uri, expectedUri;
+        sp<AMessage> meta, expectedMeta;
+        ASSERT_TRUE(parser->itemAt(i, &uri, &meta));
+        ASSERT_TRUE(expected->itemAt(i, &expectedUri, &expectedMeta));
+        EXPECT_EQ(std::string(uri.c_str()), expectedUri.c_str()) << "item " << i;
+
+        int64_t durationUs, expectedDurationUs;
+        ASSERT_TRUE(meta->findInt64("durationUs", &durationUs));
+        ASSERT_TRUE(expectedMeta->findInt64("durationUs", &expectedDurationUs));
+        EXPECT_EQ(durationUs, expectedDurationUs) << "item " << i;
+
+        const char *int32Keys[] = {"discontinuity", "discontinuity-sequence"};
+        for (const char *key : int32Keys) {
+            int32_t value = -1, expectedValue = -1;
+            EXPECT_EQ(meta->findInt32(key, &value), expectedMeta->findInt32(key, &expectedValue))
+                    << key << " of item " << i;
+            EXPECT_EQ(value, expectedValue) << key << " of item " << i;
+        }
+
+        const char *int64Keys[] = {"range-offset", "range-length"};
+        for (const char *key : int64Keys) {
+            int64_t value = -1, expectedValue = -1;
+            EXPECT_EQ(meta->findInt64(key, &value), expectedMeta->findInt64(key, &expectedValue))
+                    << key << " of item " << i;
+            EXPECT_EQ(value, expectedValue) << key << " of item " << i;
+        }
+
+        EXPECT_EQ(keyUri(parser, i), keyUri(expected, i)) << "item " << i;
+
+        EXPECT_EQ(parser->getItemStartTimeUs(i), expected->getItemStartTimeUs(i)) << "item " << i;
+    }
+    EXPECT_EQ(parser->getItemStartTimeUs(parser->size()),
+              expected->getItemStartTimeUs(expected->size()));
+}
+
+class M3UParserTest : public ::testing::TestWithParam<bool /* byteRanges */> {};
+
+TEST_P(M3UParserTest, ReloadMatchesFullParse) {
+    const bool byteRanges = GetParam();
+    const int32_t kWindowSize = 30;
+    sp<M3UParser> playlist = parse(makePlaylist(1, kWindowSize, byteRanges));
+
+    // Slide the window by 0 to 3 segments on each reload.
+    int32_t firstSeqNumber = 1;
+    for (int32_t reload = 0; reload < 40; ++reload) {
+        firstSeqNumber += reload % 4;
+        const std::string text = makePlaylist(firstSeqNumber, kWindowSize, byteRanges);
+        sp<M3UParser> reloaded = parse(text, playlist);
+        ASSERT_NO_FATAL_FAILURE(expectSameItems(reloaded, parse(text)))
+                << "reload " << reload;
+        playlist = reloaded;
+    }
+}
+
+TEST_P(M3UParserTest, GrowingEventPlaylist) {
+    const bool byteRanges = GetParam();
+    sp<M3UParser> playlist = parse(makePlaylist(0, 1, byteRanges));
+    for (int32_t numSegments = 2; numSegments < 50; numSegments += 3) {
+        const std::string text = makePlaylist(0, numSegments, byteRanges);
+        sp<M3UParser> reloaded = parse(text, playlist);
+        ASSERT_NO_FATAL_FAILURE(expectSameItems(reloaded, parse(text)))
+                << numSegments << " segments";
+        playlist = reloaded;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(M3UParserTestAll, M3UParserTest, ::testing::Values(false, true));
+
+TEST(M3UParserReloadTest, SegmentsChangedUnderSameSequenceNumbers) {
+    sp<M3UParser> playlist = parse(makePlaylist(100, 20));
+    // The server restarted and reuses the sequence numbers for new segments.
+    const std::string text = makePlaylist(105, 20, false /* byteRanges */, "restarted");
+    sp<M3UParser> reloaded = parse(text, playlist);
+    expectSameItems(reloaded, parse(text));
+}
+
+TEST(M3UParserReloadTest, NoCommonSegments) {
+    sp<M3UParser> playlist = parse(makePlaylist(100, 20));
+    const std::string text = makePlaylist(500, 20);
+    sp<M3UParser> reloaded = parse(text, playlist);
+    expectSameItems(reloaded, parse(text));
+}
+
+TEST(M3UParserReloadTest, ItemIndexForTime) {
+    // Durations alternate between 1.5s (even sequence numbers) and 2s.
+    sp<M3UParser> playlist = parse(makePlaylist(0, 10));
+    EXPECT_EQ(playlist->getItemStartTimeUs(0), 0);
+    EXPECT_EQ(playlist->getItemStartTimeUs(1), 1500000);
+    EXPECT_EQ(playlist->getItemStartTimeUs(2), 3500000);
+    EXPECT_EQ(playlist->getItemStartTimeUs(10), 17500000);
+
+    EXPECT_EQ(playlist->getItemIndexForTime(-1), 0u);
+    EXPECT_EQ(playlist->getItemIndexForTime(0), 0u);
+    EXPECT_EQ(playlist->getItemIndexForTime(1499999), 0u);
+    EXPECT_EQ(playlist->getItemIndexForTime(1500000), 1u);
+    EXPECT_EQ(playlist->getItemIndexForTime(17499999), 9u);
+    EXPECT_EQ(playlist->getItemIndexForTime(17500000), 10u);
+}
+
+}  // namespace android
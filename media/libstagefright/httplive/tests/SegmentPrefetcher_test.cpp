@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <HTTPDownloader.h>
+#include <M3UParser.h>
+#include <SegmentPrefetcher.h>
+
+#include <media/MediaHTTPConnection.h>
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace android {
+
+static const char kPlaylistUrl[] = "http://127.0.0.1/live/playlist.m3u8";
+static const int32_t kFirstSeqNumber = 100;
+static const int32_t kNumSegments = 8;
+static const size_t kSegmentSize = 188 * 100;
+static const int64_t kReadDelayUs = 100000ll;  // 100ms
+
+// Stand-in for an HTTP server: serves canned files, each read taking
+// kReadDelayUs, and records which connection each file was opened through.
+struct TestHTTPServer : public RefBase {
+    TestHTTPServer() : mNumConnections(0), mNumReads(0), mMaxConcurrentReads(0) {
+        std::string playlist =
+                "#EXTM3U\n"
+                "#EXT-X-VERSION:3\n"
+                "#EXT-X-TARGETDURATION:2\n"
+                "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(kFirstSeqNumber) + "\n";
+        for (int32_t i = 0; i < kNumSegments; ++i) {
+            int32_t seqNumber = kFirstSeqNumber + i;
+            playlist += "#EXTINF:2.0,\nseg" + std::to_string(seqNumber) + ".ts\n";
+            mFiles[segmentUrl(seqNumber)] = segmentData(seqNumber);
+        }
+        mFiles[kPlaylistUrl] = playlist;
+    }
+
+    static std::string segmentUrl(int32_t seqNumber) {
+        return "http://127.0.0.1/live/seg" + std::to_string(seqNumber) + ".ts";
+    }
+
+    static std::string segmentData(int32_t seqNumber) {
+        std::string data(kSegmentSize, '\0');
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = (char)(seqNumber + i);
+        }
+        return data;
+    }
+
+    bool find(const std::string &url, std::string *data) {
+        auto it = mFiles.find(url);
+        if (it == mFiles.end()) {
+            return false;
+        }
+        *data = it->second;
+        return true;
+    }
+
+    void onConnect(int32_t connectionId, const std::string &url) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mUrlsByConnection[connectionId].insert(url);
+    }
+
+    void onReadStart() {
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mNumReads;
+        mMaxConcurrentReads = std::max(mMaxConcurrentReads, mNumReads);
+    }
+
+    void onReadEnd() {
+        std::lock_guard<std::mutex> lock(mLock);
+        --mNumReads;
+    }
+
+    std::map<std::string, std::string> mFiles;
+    std::mutex mLock;
+    int32_t mNumConnections;
+    // Ids of connections are their creation order, addresses may be reused.
+    std::map<int32_t, std::set<std::string>> mUrlsByConnection;
+    int32_t mNumReads;
+    int32_t mMaxConcurrentReads;
+};
+
+struct TestHTTPConnection : public MediaHTTPConnection {
+    TestHTTPConnection(const sp<TestHTTPServer> &server, int32_t id)
+        : mServer(server), mId(id) {}
+
+    virtual bool connect(const char *uri, const KeyedVector<String8, String8> * /* headers */) {
+        mUri = uri;
+        if (!mServer->find(mUri, &mData)) {
+            return false;
+        }
+        mServer->onConnect(mId, mUri);
+        return true;
+    }
+
+    virtual void disconnect() {}
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        mServer->onReadStart();
+        usleep(kReadDelayUs);
+        mServer->onReadEnd();
+
+        if (offset >= (off64_t)mData.size()) {
+            return 0;
+        }
+        size = std::min(size, mData.size() - (size_t)offset);
+        memcpy(data, mData.data() + offset, size);
+        return size;
+    }
+
+    virtual off64_t getSize() { return mData.size(); }
+
+    virtual status_t getMIMEType(String8 *mimeType) {
+        *mimeType = "application/octet-stream";
+        return OK;
+    }
+
+    virtual status_t getUri(String8 *uri) {
+        *uri = mUri.c_str();
+        return OK;
+    }
+
+private:
+    sp<TestHTTPServer> mServer;
+    const int32_t mId;
+    std::string mUri;
+    std::string mData;
+};
+
+struct TestHTTPService : public MediaHTTPService {
+    explicit TestHTTPService(const sp<TestHTTPServer> &server) : mServer(server) {}
+
+    virtual sp<MediaHTTPConnection> makeHTTPConnection() {
+        std::lock_guard<std::mutex> lock(mServer->mLock);
+        return new TestHTTPConnection(mServer, ++mServer->mNumConnections);
+    }
+
+private:
+    sp<TestHTTPServer> mServer;
+};
+
+class SegmentPrefetcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mServer = new TestHTTPServer;
+        mHTTPService = new TestHTTPService(mServer);
+
+        sp<HTTPDownloader> downloader = new HTTPDownloader(mHTTPService, mHeaders);
+        bool unchanged;
+        mPlaylist = downloader->fetchPlaylist(kPlaylistUrl, NULL /* curPlaylistHash */,
+                                              &unchanged);
+        ASSERT_NE(mPlaylist, nullptr);
+        mServer->mUrlsByConnection.clear();
+    }
+
+    sp<SegmentPrefetcher> createPrefetcher(size_t maxSegments) {
+        return new SegmentPrefetcher(mHTTPService, mHeaders, maxSegments);
+    }
+
+    AString segmentUri(int32_t seqNumber) {
+        AString uri;
+        EXPECT_TRUE(mPlaylist->itemAt(seqNumber - kFirstSeqNumber, &uri));
+        return uri;
+    }
+
+    bool prefetch(const sp<SegmentPrefetcher> &prefetcher, int32_t seqNumber) {
+        return prefetcher->prefetch(seqNumber, segmentUri(seqNumber), 0 /* rangeOffset */,
+                                    -1 /* rangeLength */);
+    }
+
+    void expectSegment(const sp<SegmentPrefetcher> &prefetcher, int32_t seqNumber,
+                       int64_t *delayUs = nullptr) {
+        sp<ABuffer> buffer;
+        int64_t segmentDelayUs;
+        ssize_t n = prefetcher->take(seqNumber, segmentUri(seqNumber), &buffer, &segmentDelayUs);
+        ASSERT_EQ(n, (ssize_t)kSegmentSize);
+        ASSERT_NE(buffer, nullptr);
+        ASSERT_EQ(buffer->size(), kSegmentSize);
+        EXPECT_EQ(TestHTTPServer::segmentData(seqNumber),
+                  std::string((const char *)buffer->data(), buffer->size()));
+        if (delayUs != nullptr) {
+            *delayUs = segmentDelayUs;
+        }
+    }
+
+    sp<TestHTTPServer> mServer;
+    sp<MediaHTTPService> mHTTPService;
+    KeyedVector<String8, String8> mHeaders;
+    sp<M3UParser> mPlaylist;
+};
+
+TEST_F(SegmentPrefetcherTest, PrefetchesPlaylistSegments) {
+    int32_t firstSeqNumber, lastSeqNumber;
+    mPlaylist->getSeqNumberRange(&firstSeqNumber, &lastSeqNumber);
+    ASSERT_EQ(firstSeqNumber, kFirstSeqNumber);
+    ASSERT_EQ(lastSeqNumber, kFirstSeqNumber + kNumSegments - 1);
+    ASSERT_EQ(std::string(segmentUri(kFirstSeqNumber).c_str()),
+              TestHTTPServer::segmentUrl(kFirstSeqNumber));
+
+    sp<SegmentPrefetcher> prefetcher = createPrefetcher(3);
+    EXPECT_TRUE(prefetch(prefetcher, kFirstSeqNumber));
+    EXPECT_TRUE(prefetch(prefetcher, kFirstSeqNumber + 1));
+    EXPECT_TRUE(prefetch(prefetcher, kFirstSeqNumber + 2));
+    // Already prefetched.
+    EXPECT_TRUE(prefetch(prefetcher, kFirstSeqNumber + 1));
+    // At most 3 segments are held.
+    EXPECT_FALSE(prefetch(prefetcher, kFirstSeqNumber + 3));
+
+    for (int32_t i = 0; i < 3; ++i) {
+        expectSegment(prefetcher, kFirstSeqNumber + i);
+    }
+    EXPECT_GT(mServer->mMaxConcurrentReads, 1);
+}
+
+TEST_F(SegmentPrefetcherTest, ReusesConnections) {
+    sp<SegmentPrefetcher> prefetcher = createPrefetcher(2);
+    for (int32_t seqNumber = kFirstSeqNumber; seqNumber < kFirstSeqNumber + kNumSegments;
+         ++seqNumber) {
+        for (int32_t i = seqNumber; i < kFirstSeqNumber + kNumSegments; ++i) {
+            if (!prefetch(prefetcher, i)) {
+                break;
+            }
+        }
+        expectSegment(prefetcher, seqNumber);
+    }
+    // Every segment went through the connection of one of the two workers, so
+    // at least one connection object carried half of them.
+    std::lock_guard<std::mutex> lock(mServer->mLock);
+    EXPECT_LE(mServer->mUrlsByConnection.size(), 2u);
+    size_t numUrls = 0;
+    size_t maxUrlsPerConnection = 0;
+    for (const auto &[connectionId, urls] : mServer->mUrlsByConnection) {
+        numUrls += urls.size();
+        maxUrlsPerConnection = std::max(maxUrlsPerConnection, urls.size());
+    }
+    EXPECT_EQ(numUrls, (size_t)kNumSegments);
+    EXPECT_GE(maxUrlsPerConnection, (size_t)kNumSegments / 2);
+}
+
+TEST_F(SegmentPrefetcherTest, ChargesWallClockTime) {
+    sp<SegmentPrefetcher> prefetcher = createPrefetcher(4);
+    int64_t startUs = ALooper::GetNowUs();
+    for (int32_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(prefetch(prefetcher, kFirstSeqNumber + i));
+    }
+    int64_t totalDelayUs = 0;
+    for (int32_t i = 0; i < 4; ++i) {
+        int64_t delayUs;
+        expectSegment(prefetcher, kFirstSeqNumber + i, &delayUs);
+        EXPECT_GE(delayUs, 0);
+        totalDelayUs += delayUs;
+    }
+    int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+
+    // The downloads overlap, the time charged to the segments is the time
+    // they took together, not the sum of their durations.
+    EXPECT_GE(totalDelayUs, kReadDelayUs);
+    EXPECT_LE(totalDelayUs, elapsedUs);
+    EXPECT_LT(totalDelayUs, 4 * kReadDelayUs);
+}
+
+TEST_F(SegmentPrefetcherTest, IgnoresSegmentsNotPrefetched) {
+    sp<SegmentPrefetcher> prefetcher = createPrefetcher(2);
+    sp<ABuffer> buffer;
+    int64_t delayUs;
+    EXPECT_EQ(prefetcher->take(kFirstSeqNumber, segmentUri(kFirstSeqNumber), &buffer, &delayUs),
+              NAME_NOT_FOUND);
+
+    // Another URI under the same sequence number, after a playlist reload.
+    ASSERT_TRUE(prefetch(prefetcher, kFirstSeqNumber));
+    EXPECT_EQ(prefetcher->take(kFirstSeqNumber, segmentUri(kFirstSeqNumber + 1), &buffer,
+                               &delayUs),
+              NAME_NOT_FOUND);
+
+    ASSERT_TRUE(prefetch(prefetcher, kFirstSeqNumber + 1));
+    prefetcher->discardBefore(kFirstSeqNumber + 2);
+    EXPECT_EQ(prefetcher->take(kFirstSeqNumber + 1, segmentUri(kFirstSeqNumber + 1), &buffer,
+                               &delayUs),
+              NAME_NOT_FOUND);
+}
+
+TEST_F(SegmentPrefetcherTest, DisconnectInterruptsDownloads) {
+    sp<SegmentPrefetcher> prefetcher = createPrefetcher(2);
+    ASSERT_TRUE(prefetch(prefetcher, kFirstSeqNumber));
+    prefetcher->disconnect();
+
+    sp<ABuffer> buffer;
+    int64_t delayUs;
+    EXPECT_EQ(prefetcher->take(kFirstSeqNumber, segmentUri(kFirstSeqNumber), &buffer, &delayUs),
+              ERROR_NOT_CONNECTED);
+    EXPECT_FALSE(prefetch(prefetcher, kFirstSeqNumber + 1));
+
+    prefetcher->reconnect();
+    ASSERT_TRUE(prefetch(prefetcher, kFirstSeqNumber + 1));
+    expectSegment(prefetcher, kFirstSeqNumber + 1);
+}
+
+}  // namespace android
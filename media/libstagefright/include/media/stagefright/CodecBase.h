@@ -436,6 +436,12 @@ public:
      */
     virtual void getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *array) = 0;
 
+    /**
+     * Fill |metrics| with per-stage pipeline latency percentiles, in
+     * microseconds, if the implementation tracks them.
+     */
+    virtual void getPipelineLatencyMetrics(const sp<AMessage> &metrics) { (void)metrics; }
+
     /**
      * Convert binder IMemory to drm SharedBuffer
      *
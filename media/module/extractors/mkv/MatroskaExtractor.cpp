@@ -123,6 +123,7 @@ private:
 
     unsigned long mTrackType;
     void seekwithoutcue_l(int64_t seekTimeUs, int64_t *actualFrameTimeUs);
+    bool seekToKeyFrame_l(const mkvparser::Cluster *cluster, int64_t seekTimeUs);
 
     void advance_l();
 
@@ -371,6 +372,10 @@ void BlockIterator::advance_l() {
         } else if (res == 0) {
             // We're done with this cluster
 
+            if (mExtractor->mIndexClusters) {
+                mExtractor->indexCluster_l(mCluster);
+            }
+
             const mkvparser::Cluster *nextCluster;
             res = mExtractor->mSegment->ParseNext(
                     mCluster, nextCluster, pos, len);
@@ -584,7 +589,18 @@ int64_t BlockIterator::blockTimeUs() const {
 }
 
 void BlockIterator::seekwithoutcue_l(int64_t seekTimeUs, int64_t *actualFrameTimeUs) {
-    mCluster = mExtractor->mSegment->FindCluster(seekTimeUs * 1000ll);
+    const mkvparser::Cluster *cluster = mExtractor->mSegment->FindCluster(seekTimeUs * 1000ll);
+
+    // video track will seek to the next key frame, which may be many clusters away.
+    if (mTrackType == 1 && mExtractor->mIndexClusters
+            && seekToKeyFrame_l(cluster, seekTimeUs)) {
+        *actualFrameTimeUs = blockTimeUs();
+        ALOGV("seekTimeUs:%lld, actualFrameTimeUs:%lld, tracknum:%lld (indexed)",
+              (long long)seekTimeUs, (long long)*actualFrameTimeUs, (long long)mTrackNum);
+        return;
+    }
+
+    mCluster = cluster;
     const long status = mCluster->GetFirst(mBlockEntry);
     if (status < 0) {  // error
         ALOGE("get last blockenry failed!");
@@ -608,6 +624,43 @@ void BlockIterator::seekwithoutcue_l(int64_t seekTimeUs, int64_t *actualFrameTim
               (long long)seekTimeUs, (long long)*actualFrameTimeUs, (long long)mTrackNum);
 }
 
+// Positions the iterator on the first key frame of the track at or after seekTimeUs,
+// starting from cluster. Clusters in the index are not read again. Returns false
+// if a cluster cannot be parsed or the key frame is not where the index says.
+bool BlockIterator::seekToKeyFrame_l(
+        const mkvparser::Cluster *cluster, int64_t seekTimeUs) {
+    while (cluster != NULL && !cluster->EOS()) {
+        const std::vector<MatroskaExtractor::KeyFrame> *keyFrames =
+                mExtractor->indexCluster_l(cluster);
+        if (keyFrames == NULL) {
+            return false;
+        }
+
+        for (const MatroskaExtractor::KeyFrame &keyFrame : *keyFrames) {
+            if (keyFrame.mTrackNum == mTrackNum
+                    && (keyFrame.mTimeNs + 500ll) / 1000ll >= seekTimeUs) {
+                mCluster = cluster;
+                mBlockEntryIndex = keyFrame.mBlockIndex;
+                advance_l();
+                return !eos() && block()->GetTrackNumber() == mTrackNum && block()->IsKey();
+            }
+        }
+
+        const mkvparser::Cluster *nextCluster;
+        long long pos;
+        long len;
+        if (mExtractor->mSegment->ParseNext(cluster, nextCluster, pos, len) != 0) {
+            break;
+        }
+        cluster = nextCluster;
+    }
+
+    // No key frame after the seek time.
+    mCluster = NULL;
+    mBlockEntry = NULL;
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static unsigned U24_AT(const uint8_t *ptr) {
@@ -1336,7 +1389,8 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
       mSegment(NULL),
       mExtractedThumbnails(false),
       mIsWebm(false),
-      mSeekPreRollNs(0) {
+      mSeekPreRollNs(0),
+      mIndexClusters(false) {
     off64_t size;
     mIsLiveStreaming =
         (mDataSource->flags()
@@ -1434,6 +1488,18 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
 #endif
 
     addTracks();
+
+    // Without Cues a seek parses every block up to the next video key frame.
+    const mkvparser::Tracks *tracks = mSegment->GetTracks();
+    if (!mIsLiveStreaming && mSegment->GetCues() == NULL && tracks != NULL) {
+        for (unsigned long index = 0; index < tracks->GetTracksCount(); ++index) {
+            const mkvparser::Track *track = tracks->GetTrackByIndex(index);
+            if (track != NULL && track->GetType() == 1) { // video
+                mIndexClusters = true;
+                break;
+            }
+        }
+    }
 }
 
 MatroskaExtractor::~MatroskaExtractor() {
@@ -1481,6 +1547,46 @@ media_status_t MatroskaExtractor::getTrackMetaData(
     return AMediaFormat_copy(meta, mTracks.itemAt(index).mMeta);
 }
 
+const std::vector<MatroskaExtractor::KeyFrame> *MatroskaExtractor::indexCluster_l(
+        const mkvparser::Cluster *cluster) {
+    const long long clusterPos = cluster->GetPosition();
+    auto it = mClusterIndex.find(clusterPos);
+    if (it != mClusterIndex.end()) {
+        return &it->second;
+    }
+
+    std::vector<KeyFrame> keyFrames;
+    const mkvparser::Tracks *tracks = mSegment->GetTracks();
+    for (long index = 0;;) {
+        const mkvparser::BlockEntry *entry;
+        long res = cluster->GetEntry(index, entry);
+        if (res < 0) {
+            // Need to parse this cluster some more
+            long long pos;
+            long len;
+            if (res != mkvparser::E_BUFFER_NOT_FULL || cluster->Parse(pos, len) < 0) {
+                ALOGE("cannot index cluster at %lld", clusterPos);
+                return NULL;
+            }
+            continue;
+        } else if (res == 0) {
+            break;
+        }
+
+        const mkvparser::Block *block = entry->GetBlock();
+        if (block != NULL && block->IsKey()) {
+            const mkvparser::Track *track = tracks->GetTrackByNumber(block->GetTrackNumber());
+            if (track != NULL && track->GetType() == 1) { // video
+                keyFrames.push_back({block->GetTrackNumber(), index, block->GetTime(cluster)});
+            }
+        }
+        ++index;
+    }
+
+    ALOGV("indexed cluster at %lld, %zu key frames", clusterPos, keyFrames.size());
+    return &mClusterIndex.emplace(clusterPos, std::move(keyFrames)).first->second;
+}
+
 bool MatroskaExtractor::isLiveStreaming() const {
     return mIsLiveStreaming;
 }
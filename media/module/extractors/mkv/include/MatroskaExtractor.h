@@ -26,6 +26,9 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <map>
+#include <vector>
+
 namespace android {
 
 struct AMessage;
@@ -81,6 +84,13 @@ private:
         const mkvparser::CuePoint::TrackPosition *find(long long timeNs) const;
     };
 
+    // A keyframe of a video track: the index of its block in the cluster.
+    struct KeyFrame {
+        long long mTrackNum;
+        long mBlockIndex;
+        long long mTimeNs;
+    };
+
     Mutex mLock;
     Vector<TrackInfo> mTracks;
 
@@ -92,6 +102,12 @@ private:
     bool mIsWebm;
     int64_t mSeekPreRollNs;
 
+    // Without Cues, the keyframes of every cluster parsed so far, by cluster
+    // position, so that later seeks step over these clusters without reading
+    // them again. Guarded by mLock.
+    bool mIndexClusters;
+    std::map<long long, std::vector<KeyFrame>> mClusterIndex;
+
     status_t synthesizeAVCC(TrackInfo *trackInfo, size_t index);
     status_t synthesizeMPEG2(TrackInfo *trackInfo, size_t index);
     status_t synthesizeMPEG4(TrackInfo *trackInfo, size_t index);
@@ -105,6 +121,7 @@ private:
             const mkvparser::VideoTrack *vtrack,
             AMediaFormat *meta);
     bool isLiveStreaming() const;
+    const std::vector<KeyFrame> *indexCluster_l(const mkvparser::Cluster *cluster);
 
     MatroskaExtractor(const MatroskaExtractor &);
     MatroskaExtractor &operator=(const MatroskaExtractor &);
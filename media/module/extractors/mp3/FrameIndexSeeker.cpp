@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameIndexSeeker"
+#include <utils/Log.h>
+
+#include "FrameIndexSeeker.h"
+
+#include <media/stagefright/foundation/avc_utils.h>
+#include <media/stagefright/foundation/ByteUtils.h>
+#include <media/stagefright/DataSourceBase.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <media/MediaExtractorPluginApi.h>
+#include <media/MediaExtractorPluginHelper.h>
+
+namespace android {
+
+const off64_t FrameIndexSeeker::kMaxScanBytesPerSeek = 64 * 1024 * 1024;
+
+// static
+FrameIndexSeeker *FrameIndexSeeker::CreateFromSource(
+        DataSourceHelper *source, off64_t firstFramePos,
+        uint32_t fixedHeader, uint32_t headerMask) {
+    uint8_t header[4];
+    if (source->readAt(firstFramePos, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return NULL;
+    }
+
+    size_t frameSize;
+    int sampleRate;
+    int samplesPerFrame;
+    if (!GetMPEGAudioFrameSize(
+                U32_AT(header), &frameSize, &sampleRate, NULL, NULL, &samplesPerFrame)
+            || sampleRate <= 0 || samplesPerFrame <= 0) {
+        return NULL;
+    }
+
+    FrameIndexSeeker *seeker = new (std::nothrow) FrameIndexSeeker;
+    if (seeker == NULL) {
+        ALOGW("Couldn't allocate FrameIndexSeeker");
+        return NULL;
+    }
+
+    seeker->mDataSource = source;
+    seeker->mFixedHeader = fixedHeader;
+    seeker->mHeaderMask = headerMask;
+    seeker->mSampleRate = sampleRate;
+    seeker->mSamplesPerFrame = samplesPerFrame;
+    seeker->mNextPos = firstFramePos;
+    // Scanning reads ahead of playback, which blocks on a network until the data
+    // arrives. Remote streams are only indexed as they are played.
+    seeker->mScanAhead = (source->flags()
+            & (DataSourceBase::kIsCachingDataSource | DataSourceBase::kIsHTTPBasedSource)) == 0;
+
+    return seeker;
+}
+
+FrameIndexSeeker::FrameIndexSeeker()
+    : mDataSource(NULL),
+      mFixedHeader(0),
+      mHeaderMask(0),
+      mSampleRate(0),
+      mSamplesPerFrame(0),
+      mStride(1),
+      mNumFrames(0),
+      mNextPos(0),
+      mReachedEnd(false),
+      mScanDone(false),
+      mScanAhead(false) {
+}
+
+bool FrameIndexSeeker::getDuration(int64_t *durationUs) {
+    Mutex::Autolock autoLock(mLock);
+    if (!mReachedEnd) {
+        return false;
+    }
+
+    *durationUs = frameTimeUs(mNumFrames);
+
+    return true;
+}
+
+bool FrameIndexSeeker::getOffsetForTime(int64_t *timeUs, off64_t *pos) {
+    int64_t frameNumber;
+    return getFrameForTime(timeUs, pos, &frameNumber);
+}
+
+bool FrameIndexSeeker::getFrameForTime(
+        int64_t *timeUs, off64_t *pos, int64_t *frameNumber) {
+    int64_t target;
+    if (__builtin_mul_overflow(*timeUs < 0 ? 0 : *timeUs, (int64_t)mSampleRate, &target)) {
+        return false;
+    }
+    target /= mSamplesPerFrame * 1000000LL;
+
+    Mutex::Autolock autoLock(mLock);
+    if (target >= mNumFrames && mScanAhead) {
+        scan_l(target);
+    }
+    if (target >= mNumFrames) {
+        // The caller falls back to the bitrate estimate.
+        if (!mReachedEnd) {
+            return false;
+        }
+        // Past the end, the reader will get end of stream.
+        target = mNumFrames;
+    }
+
+    if (!findFrame_l(target, pos)) {
+        return false;
+    }
+
+    ALOGV("getFrameForTime %lld us => frame %lld at 0x%016llx",
+          (long long)*timeUs, (long long)target, (long long)*pos);
+
+    *frameNumber = target;
+    *timeUs = frameTimeUs(target);
+
+    return true;
+}
+
+void FrameIndexSeeker::onFrameRead(int64_t frameNumber, off64_t pos, size_t frameSize) {
+    Mutex::Autolock autoLock(mLock);
+    // Frames after a loss of sync are not indexed, the offsets of the frames
+    // between two entries are found again from the frame sizes.
+    if (frameNumber == mNumFrames && pos == mNextPos) {
+        addFrame_l(pos, frameSize);
+    }
+}
+
+int64_t FrameIndexSeeker::frameTimeUs(int64_t frameNumber) const {
+    return frameNumber * mSamplesPerFrame * 1000000LL / mSampleRate;
+}
+
+void FrameIndexSeeker::addFrame_l(off64_t pos, size_t frameSize) {
+    if (mNumFrames % mStride == 0) {
+        if (mOffsets.size() == kMaxEntries) {
+            // Keep every other offset.
+            for (size_t i = 0; i < kMaxEntries / 2; ++i) {
+                mOffsets[i] = mOffsets[2 * i];
+            }
+            mOffsets.resize(kMaxEntries / 2);
+            mStride *= 2;
+        }
+        if (mNumFrames % mStride == 0) {
+            mOffsets.push_back(pos);
+        }
+    }
+
+    ++mNumFrames;
+    mNextPos = pos + frameSize;
+}
+
+void FrameIndexSeeker::scan_l(int64_t frameNumber) {
+    if (mScanDone) {
+        return;
+    }
+
+    std::vector<uint8_t> chunk(kScanChunkSize);
+    off64_t chunkPos = 0;
+    ssize_t chunkSize = 0;
+    const off64_t startPos = mNextPos;
+    while (mNumFrames <= frameNumber) {
+        if (mNextPos - startPos >= kMaxScanBytesPerSeek) {
+            ALOGV("scanned %lld bytes, frame %lld not reached yet",
+                  (long long)(mNextPos - startPos), (long long)frameNumber);
+            return;
+        }
+
+        // Only the frame headers are needed, read them by chunks.
+        if (mNextPos + 4 > chunkPos + chunkSize) {
+            chunkPos = mNextPos;
+            chunkSize = mDataSource->readAt(chunkPos, chunk.data(), chunk.size());
+            if (chunkSize < 0 && chunkSize != ERROR_END_OF_STREAM) {
+                // Maybe a network error, scan again on the next seek.
+                ALOGW("read error %zd at %lld", chunkSize, (long long)chunkPos);
+                return;
+            }
+            if (chunkSize < 4) {
+                mReachedEnd = true;
+                mScanDone = true;
+                ALOGV("indexed %lld frames", (long long)mNumFrames);
+                return;
+            }
+        }
+
+        const uint32_t header = U32_AT(&chunk[mNextPos - chunkPos]);
+        size_t frameSize;
+        if ((header & mHeaderMask) != (mFixedHeader & mHeaderMask)
+                || !GetMPEGAudioFrameSize(header, &frameSize)) {
+            // An ID3v1 tag ends the stream, anything else is a loss of sync and
+            // the index stays exact up to this point.
+            mReachedEnd = (header >> 8) == ('T' << 16 | 'A' << 8 | 'G');
+            mScanDone = true;
+            ALOGV("%s at %lld after %lld frames", mReachedEnd ? "tag" : "lost sync",
+                  (long long)mNextPos, (long long)mNumFrames);
+            return;
+        }
+
+        addFrame_l(mNextPos, frameSize);
+    }
+}
+
+bool FrameIndexSeeker::findFrame_l(int64_t frameNumber, off64_t *pos) {
+    if (frameNumber == mNumFrames) {
+        *pos = mNextPos;
+        return true;
+    }
+
+    const size_t entry = frameNumber / mStride;
+    off64_t framePos = mOffsets[entry];
+    // At most mStride - 1 frames from the entry.
+    for (int64_t n = entry * mStride; n < frameNumber; ++n) {
+        uint8_t header[4];
+        if (mDataSource->readAt(framePos, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+            return false;
+        }
+
+        size_t frameSize;
+        if (!GetMPEGAudioFrameSize(U32_AT(header), &frameSize)) {
+            ALOGE("no frame at %lld", (long long)framePos);
+            return false;
+        }
+        framePos += frameSize;
+    }
+
+    *pos = framePos;
+
+    return true;
+}
+
+}  // namespace android
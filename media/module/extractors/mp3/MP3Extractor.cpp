@@ -20,6 +20,7 @@
 
 #include "MP3Extractor.h"
 
+#include "FrameIndexSeeker.h"
 #include "ID3.h"
 #include "VBRISeeker.h"
 #include "XINGSeeker.h"
@@ -212,7 +213,7 @@ public:
     MP3Source(
             AMediaFormat *meta, DataSourceHelper *source,
             off64_t first_frame_pos, uint32_t fixed_header,
-            MP3Seeker *seeker);
+            MP3Seeker *seeker, FrameIndexSeeker *frameIndex);
 
     virtual media_status_t start();
     virtual media_status_t stop();
@@ -235,6 +236,9 @@ private:
     int64_t mCurrentTimeUs = 0;
     bool mStarted = false;
     MP3Seeker *mSeeker = NULL;
+    FrameIndexSeeker *mFrameIndex = NULL;
+    // Number of the frame at mCurrentPos, -1 if unknown.
+    int64_t mFrameNumber = -1;
 
     int64_t mBasisTimeUs = 0;
     int64_t mSamplesRead = 0;
@@ -310,6 +314,11 @@ MP3Extractor::MP3Extractor(
         }
         mFirstFramePos = pos;
         mFixedHeader = header;
+    } else {
+        // Without a table of contents, index the frames as they are read.
+        mFrameIndex = FrameIndexSeeker::CreateFromSource(
+                mDataSource, mFirstFramePos, mFixedHeader, kMask);
+        mSeeker = mFrameIndex;
     }
 
     size_t frame_size;
@@ -416,7 +425,7 @@ MediaTrackHelper *MP3Extractor::getTrack(size_t index) {
 
     return new MP3Source(
             mMeta, mDataSource, mFirstFramePos, mFixedHeader,
-            mSeeker);
+            mSeeker, mFrameIndex);
 }
 
 media_status_t MP3Extractor::getTrackMetaData(
@@ -441,12 +450,13 @@ const size_t MP3Source::kMaxFrameSize = (1 << 12); /* 4096 bytes */
 MP3Source::MP3Source(
         AMediaFormat *meta, DataSourceHelper *source,
         off64_t first_frame_pos, uint32_t fixed_header,
-        MP3Seeker *seeker)
+        MP3Seeker *seeker, FrameIndexSeeker *frameIndex)
     : mMeta(meta),
       mDataSource(source),
       mFirstFramePos(first_frame_pos),
       mFixedHeader(fixed_header),
-      mSeeker(seeker) {
+      mSeeker(seeker),
+      mFrameIndex(frameIndex) {
 }
 
 MP3Source::~MP3Source() {
@@ -462,6 +472,7 @@ media_status_t MP3Source::start() {
 
     mCurrentPos = mFirstFramePos;
     mCurrentTimeUs = 0;
+    mFrameNumber = 0;
 
     mBasisTimeUs = mCurrentTimeUs;
     mSamplesRead = 0;
@@ -493,8 +504,16 @@ media_status_t MP3Source::read(
 
     if (options != NULL && options->getSeekTo(&seekTimeUs, &mode)) {
         int64_t actualSeekTimeUs = seekTimeUs;
-        if (mSeeker == NULL
-                || !mSeeker->getOffsetForTime(&actualSeekTimeUs, &mCurrentPos)) {
+        bool found;
+        mFrameNumber = -1;
+        if (mFrameIndex != NULL) {
+            found = mFrameIndex->getFrameForTime(
+                    &actualSeekTimeUs, &mCurrentPos, &mFrameNumber);
+        } else {
+            found = mSeeker != NULL
+                    && mSeeker->getOffsetForTime(&actualSeekTimeUs, &mCurrentPos);
+        }
+        if (!found) {
             int32_t bitrate;
             if (!AMediaFormat_getInt32(mMeta, AMEDIAFORMAT_KEY_BIT_RATE, &bitrate)) {
                 // bitrate is in bits/sec.
@@ -592,6 +611,9 @@ media_status_t MP3Source::read(
     AMediaFormat_setInt64(meta, AMEDIAFORMAT_KEY_TIME_US, mCurrentTimeUs);
     AMediaFormat_setInt32(meta, AMEDIAFORMAT_KEY_IS_SYNC_FRAME, 1);
 
+    if (mFrameIndex != NULL && mFrameNumber >= 0) {
+        mFrameIndex->onFrameRead(mFrameNumber++, mCurrentPos, frame_size);
+    }
     mCurrentPos += frame_size;
 
     mSamplesRead += num_samples;
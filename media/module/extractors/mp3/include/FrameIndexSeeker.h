@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_INDEX_SEEKER_H_
+
+#define FRAME_INDEX_SEEKER_H_
+
+#include "MP3Seeker.h"
+
+#include <utils/Mutex.h>
+
+#include <vector>
+
+namespace android {
+
+class DataSourceHelper;
+
+// Seeker for streams without a XING or VBRI header. It learns the offsets of
+// the frames from the start of the stream, as they are played or, for local
+// sources, by scanning frame headers ahead when a seek goes past what is known.
+// Seeks past the indexed frames of a network source use the bitrate estimate.
+// It keeps the offset of one frame in every "stride" frames. The stride doubles
+// whenever the table is full, so the memory used is bounded whatever the length
+// of the stream.
+//
+// All frames of a stream have the same number of samples, so the time of a
+// frame follows from its number and seeks land on the frame containing the
+// requested time rather than on an offset estimated from the bitrate.
+struct FrameIndexSeeker : public MP3Seeker {
+    // "headerMask" selects the bits of "fixedHeader" that every frame must match.
+    static FrameIndexSeeker *CreateFromSource(
+            DataSourceHelper *source, off64_t firstFramePos,
+            uint32_t fixedHeader, uint32_t headerMask);
+
+    // Only known once the whole stream has been indexed.
+    virtual bool getDuration(int64_t *durationUs);
+    virtual bool getOffsetForTime(int64_t *timeUs, off64_t *pos);
+
+    // Like getOffsetForTime(), also returns the number of the frame at "*pos",
+    // counting from 0 for the first frame of the stream.
+    bool getFrameForTime(int64_t *timeUs, off64_t *pos, int64_t *frameNumber);
+
+    // Tells the seeker that frame number "frameNumber" was read at "pos".
+    // Extends the index when this is the frame right after the indexed ones.
+    void onFrameRead(int64_t frameNumber, off64_t pos, size_t frameSize);
+
+private:
+    enum {
+        // Offsets kept, 32 KiB at most.
+        kMaxEntries = 4096,
+        // Header bytes read at once when scanning.
+        kScanChunkSize = 64 * 1024,
+    };
+    // Bytes scanned by one seek at most, the index is kept for the next seek.
+    static const off64_t kMaxScanBytesPerSeek;
+
+    Mutex mLock;
+    DataSourceHelper *mDataSource;
+    uint32_t mFixedHeader;
+    uint32_t mHeaderMask;
+    int mSampleRate;
+    int mSamplesPerFrame;
+
+    // mOffsets[i] is the offset of frame number i * mStride.
+    std::vector<off64_t> mOffsets;
+    int64_t mStride;
+    // Frames [0, mNumFrames) are indexed, the next one is at mNextPos.
+    int64_t mNumFrames;
+    off64_t mNextPos;
+    // The scan found the end of the stream, or any end to what it can index.
+    bool mReachedEnd;
+    bool mScanDone;
+    // Not for caching or HTTP sources, whose reads can block for a long time.
+    bool mScanAhead;
+
+    FrameIndexSeeker();
+
+    int64_t frameTimeUs(int64_t frameNumber) const;
+    void addFrame_l(off64_t pos, size_t frameSize);
+    void scan_l(int64_t frameNumber);
+    bool findFrame_l(int64_t frameNumber, off64_t *pos);
+
+    DISALLOW_EVIL_CONSTRUCTORS(FrameIndexSeeker);
+};
+
+}  // namespace android
+
+#endif  // FRAME_INDEX_SEEKER_H_
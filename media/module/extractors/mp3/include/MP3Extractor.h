@@ -28,6 +28,7 @@ namespace android {
 class DataSourceHelper;
 
 struct AMessage;
+struct FrameIndexSeeker;
 struct MP3Seeker;
 class String8;
 struct Mp3Meta;
@@ -52,6 +53,8 @@ private:
     AMediaFormat *mMeta = NULL;
     uint32_t mFixedHeader = 0;
     MP3Seeker *mSeeker = NULL;
+    // mSeeker when the stream has neither a XING nor a VBRI header.
+    FrameIndexSeeker *mFrameIndex = NULL;
 
     MP3Extractor(const MP3Extractor &);
     MP3Extractor &operator=(const MP3Extractor &);
@@ -113,6 +113,14 @@ protected:
         int64_t mTimeUs;
     };
 
+    // Limit the maximum amount of RAM we spend on the table of contents.
+    static const size_t kMaxTOCSize = 8192;
+    static const size_t kMaxNumTOCEntries = kMaxTOCSize / sizeof(TOCEntry);
+
+    // Below this many bytes between the bounds of a seek search, read the
+    // pages in between rather than bisect further.
+    static const off64_t kMaxLinearSeekBytes = 16384;
+
     MediaBufferGroupHelper *mBufferGroup;
     DataSourceHelper *mSource;
     off64_t mOffset;
@@ -129,6 +137,8 @@ protected:
     int64_t mSeekPreRollUs;
 
     off64_t mFirstDataOffset;
+    // Size of the source when seeks search for the page, -1 to seek by bitrate.
+    off64_t mFileSize;
 
     vorbis_info mVi;
     vorbis_comment mVc;
@@ -136,12 +146,13 @@ protected:
     AMediaFormat *mMeta;
     AMediaFormat *mFileMeta;
 
+    // Pages found by earlier seeks, by increasing time and offset.
     Vector<TOCEntry> mTableOfContents;
 
     int32_t mHapticChannelCount;
 
     ssize_t readPage(off64_t offset, Page *page);
-    status_t findNextPage(off64_t startOffset, off64_t *pageOffset);
+    status_t findNextPage(off64_t startOffset, off64_t *pageOffset, bool quiet = false);
 
     virtual int64_t getTimeUsOfGranule(uint64_t granulePos) const = 0;
 
@@ -168,7 +179,10 @@ protected:
 
     status_t findPrevGranulePosition(off64_t pageOffset, uint64_t *granulePos);
 
-    void buildTableOfContents();
+    status_t findPageForTime(int64_t timeUs, off64_t *pageOffset);
+    status_t findTimedPage(
+            off64_t startOffset, off64_t endOffset, off64_t *pageOffset, int64_t *timeUs);
+    void addTOCEntry(off64_t pageOffset, int64_t timeUs);
 
     void setChannelMask(int channelCount);
 
@@ -324,6 +338,7 @@ MyOggExtractor::MyOggExtractor(
       mNumHeaders(numHeaders),
       mSeekPreRollUs(seekPreRollUs),
       mFirstDataOffset(-1),
+      mFileSize(-1),
       mHapticChannelCount(0) {
     mCurrentPage.mNumSegments = 0;
     mCurrentPage.mFlags = 0;
@@ -346,7 +361,7 @@ media_status_t MyOggExtractor::getFormat(AMediaFormat *meta) const {
 }
 
 status_t MyOggExtractor::findNextPage(
-        off64_t startOffset, off64_t *pageOffset) {
+        off64_t startOffset, off64_t *pageOffset, bool quiet) {
     *pageOffset = startOffset;
 
     // balance between larger reads and reducing how much we over-read.
@@ -374,7 +389,7 @@ status_t MyOggExtractor::findNextPage(
             i += jump;
             if (memcmp("OggS", &signatureBuffer[i], lenOggS) == 0) {
                 *pageOffset += i;
-                if (*pageOffset > startOffset) {
+                if (*pageOffset > startOffset && !quiet) {
                     ALOGD("skipped %" PRIu64 " bytes of junk to reach next frame",
                          (*pageOffset - startOffset));
                 }
@@ -493,7 +508,7 @@ status_t MyOggExtractor::seekToTime(int64_t timeUs) {
         timeUs = 0;
     }
 
-    if (mTableOfContents.isEmpty()) {
+    if (mFileSize < 0) {
         // Perform approximate seeking based on avg. bitrate.
         uint64_t bps = approxBitrate();
         if (bps <= 0) {
@@ -506,33 +521,166 @@ status_t MyOggExtractor::seekToTime(int64_t timeUs) {
         return seekToOffset(pos);
     }
 
-    size_t left = 0;
-    size_t right_plus_one = mTableOfContents.size();
-    while (left < right_plus_one) {
-        size_t center = left + (right_plus_one - left) / 2;
+    off64_t pageOffset;
+    status_t err = findPageForTime(timeUs, &pageOffset);
+    if (err != OK) {
+        return err;
+    }
+
+    ALOGV("seeking to page at offset %lld", (long long)pageOffset);
 
-        const TOCEntry &entry = mTableOfContents.itemAt(center);
+    return seekToOffset(pageOffset);
+}
+
+// Finds the first page whose granule position is at or after timeUs, or the last
+// page if there is none, by bisecting the file between the pages found so far.
+status_t MyOggExtractor::findPageForTime(int64_t timeUs, off64_t *pageOffset) {
+    // The page is at or after "low" and at or before "best". Until the
+    // search narrows down to a few pages, probe in the middle of [low, high).
+    off64_t low = mFirstDataOffset;
+    off64_t high = mFileSize;
+    off64_t best = mFileSize;
+    // The last page known to end before timeUs, in case no page ends after it.
+    off64_t lastBefore = mFirstDataOffset;
 
-        if (timeUs < entry.mTimeUs) {
-            right_plus_one = center;
-        } else if (timeUs > entry.mTimeUs) {
+    size_t left = 0;
+    size_t right = mTableOfContents.size();
+    while (left < right) {
+        size_t center = left + (right - left) / 2;
+        if (mTableOfContents.itemAt(center).mTimeUs < timeUs) {
             left = center + 1;
         } else {
-            left = center;
+            right = center;
+        }
+    }
+    if (left < mTableOfContents.size()) {
+        best = high = mTableOfContents.itemAt(left).mPageOffset;
+    }
+    if (left > 0) {
+        lastBefore = mTableOfContents.itemAt(left - 1).mPageOffset;
+        low = lastBefore + 1;
+    }
+
+    size_t probes = 0;
+    while (high - low > kMaxLinearSeekBytes) {
+        off64_t mid = low + (high - low) / 2;
+        off64_t offset;
+        int64_t pageTimeUs;
+        status_t err = findTimedPage(mid, high, &offset, &pageTimeUs);
+        ++probes;
+        if (err == ERROR_END_OF_STREAM) {
+            // No page ends between mid and high.
+            high = mid;
+            continue;
+        } else if (err != OK) {
+            return err;
+        }
+
+        if (pageTimeUs >= timeUs) {
+            // Pages starting between mid and this one end in none of them.
+            best = offset;
+            high = mid;
+        } else {
+            lastBefore = offset;
+            low = offset + 1;
+        }
+    }
+
+    // Read the few pages left in order.
+    while (low < best) {
+        off64_t offset;
+        int64_t pageTimeUs;
+        status_t err = findTimedPage(low, best, &offset, &pageTimeUs);
+        ++probes;
+        if (err == ERROR_END_OF_STREAM) {
+            break;
+        } else if (err != OK) {
+            return err;
+        }
+
+        if (pageTimeUs >= timeUs) {
+            best = offset;
             break;
         }
+        lastBefore = offset;
+        low = offset + 1;
     }
 
-    if (left == mTableOfContents.size()) {
-        --left;
+    *pageOffset = best < mFileSize ? best : lastBefore;
+
+    ALOGV("page for %lld us at %lld, %zu probes, %zu pages cached", (long long)timeUs,
+          (long long)*pageOffset, probes, mTableOfContents.size());
+
+    return OK;
+}
+
+// Finds the first page starting at or after startOffset and before endOffset
+// which ends a packet, and so has a granule position. Returns ERROR_END_OF_STREAM
+// if there is none.
+status_t MyOggExtractor::findTimedPage(
+        off64_t startOffset, off64_t endOffset, off64_t *pageOffset, int64_t *timeUs) {
+    off64_t offset = startOffset;
+    while (offset < endOffset) {
+        status_t err = findNextPage(offset, &offset, /* quiet = */ true);
+        if (err != OK) {
+            return err;
+        }
+        if (offset >= endOffset) {
+            break;
+        }
+
+        Page page;
+        ssize_t n = readPage(offset, &page);
+        if (n == AMEDIA_ERROR_END_OF_STREAM) {
+            break;
+        } else if (n <= 0) {
+            // "OggS" within the data of a packet, keep looking.
+            ++offset;
+            continue;
+        }
+
+        if (page.mGranulePosition != (uint64_t)-1) {
+            *pageOffset = offset;
+            *timeUs = getTimeUsOfGranule(page.mGranulePosition);
+            addTOCEntry(offset, *timeUs);
+            return OK;
+        }
+        offset += n;
     }
 
-    const TOCEntry &entry = mTableOfContents.itemAt(left);
+    return ERROR_END_OF_STREAM;
+}
+
+void MyOggExtractor::addTOCEntry(off64_t pageOffset, int64_t timeUs) {
+    size_t left = 0;
+    size_t right = mTableOfContents.size();
+    while (left < right) {
+        size_t center = left + (right - left) / 2;
+        if (mTableOfContents.itemAt(center).mPageOffset < pageOffset) {
+            left = center + 1;
+        } else {
+            right = center;
+        }
+    }
+    if (left < mTableOfContents.size()
+            && mTableOfContents.itemAt(left).mPageOffset == pageOffset) {
+        return;
+    }
 
-    ALOGV("seeking to entry %zu / %zu at offset %lld",
-         left, mTableOfContents.size(), (long long)entry.mPageOffset);
+    TOCEntry entry;
+    entry.mPageOffset = pageOffset;
+    entry.mTimeUs = timeUs;
+    mTableOfContents.insertAt(entry, left);
 
-    return seekToOffset(entry.mPageOffset);
+    if (mTableOfContents.size() > kMaxNumTOCEntries) {
+        // Thin out the table evenly, the entries left still bound later searches.
+        Vector<TOCEntry> maxTOC;
+        maxTOC.setCapacity(kMaxNumTOCEntries);
+        for (size_t i = 0; i < mTableOfContents.size(); i += 2) {
+            maxTOC.push(mTableOfContents.itemAt(i));
+        }
+        mTableOfContents = maxTOC;
+    }
 }
 
 status_t MyOggExtractor::seekToOffset(off64_t offset) {
@@ -1003,69 +1151,30 @@ status_t MyOggExtractor::init() {
 
     off64_t size;
     uint64_t lastGranulePosition;
-    if (!(mSource->flags() & DataSourceBase::kIsCachingDataSource)
-            && mSource->getSize(&size) == OK
-            && findPrevGranulePosition(size, &lastGranulePosition) == OK) {
-        // Let's assume it's cheap to seek to the end.
-        // The granule position of the final page in the stream will
-        // give us the exact duration of the content, something that
-        // we can only approximate using avg. bitrate if seeking to
-        // the end is too expensive or impossible (live streaming).
-
-        int64_t durationUs = getTimeUsOfGranule(lastGranulePosition);
-
-        AMediaFormat_setInt64(mMeta, AMEDIAFORMAT_KEY_DURATION, durationUs);
+    const bool isCaching = mSource->flags() & DataSourceBase::kIsCachingDataSource;
+    if (mSource->getSize(&size) == OK) {
+        if (!isCaching && findPrevGranulePosition(size, &lastGranulePosition) == OK) {
+            // Let's assume it's cheap to seek to the end.
+            // The granule position of the final page in the stream will
+            // give us the exact duration of the content, something that
+            // we can only approximate using avg. bitrate if seeking to
+            // the end is too expensive or impossible (live streaming).
+
+            int64_t durationUs = getTimeUsOfGranule(lastGranulePosition);
+
+            AMediaFormat_setInt64(mMeta, AMEDIAFORMAT_KEY_DURATION, durationUs);
+        }
 
-        buildTableOfContents();
+        // A seek reads a few pages to find its target. Over a caching source
+        // that is only worth it when there is no bitrate to seek by.
+        if (!isCaching || approxBitrate() == 0) {
+            mFileSize = size;
+        }
     }
 
     return AMEDIA_OK;
 }
 
-void MyOggExtractor::buildTableOfContents() {
-    off64_t offset = mFirstDataOffset;
-    Page page;
-    ssize_t pageSize;
-    while ((pageSize = readPage(offset, &page)) > 0) {
-        mTableOfContents.push();
-
-        TOCEntry &entry =
-            mTableOfContents.editItemAt(mTableOfContents.size() - 1);
-
-        entry.mPageOffset = offset;
-        entry.mTimeUs = getTimeUsOfGranule(page.mGranulePosition);
-
-        offset += (size_t)pageSize;
-    }
-
-    // Limit the maximum amount of RAM we spend on the table of contents,
-    // if necessary thin out the table evenly to trim it down to maximum
-    // size.
-
-    static const size_t kMaxTOCSize = 8192;
-    static const size_t kMaxNumTOCEntries = kMaxTOCSize / sizeof(TOCEntry);
-
-    size_t numerator = mTableOfContents.size();
-
-    if (numerator > kMaxNumTOCEntries) {
-        Vector<TOCEntry> maxTOC;
-        maxTOC.setCapacity(kMaxNumTOCEntries);
-
-        size_t denom = numerator - kMaxNumTOCEntries;
-        size_t accum = 0;
-        for (ssize_t i = 0; i < mTableOfContents.size(); i++) {
-            accum += denom;
-            if (accum >= numerator) {
-                accum -= numerator;
-            } else {
-                maxTOC.push(mTableOfContents.itemAt(i));
-            }
-        }
-
-        mTableOfContents = maxTOC;
-    }
-}
-
 int32_t MyOggExtractor::getPacketBlockSize(MediaBufferHelper *buffer) {
     const uint8_t *data =
         (const uint8_t *)buffer->data() + buffer->range_offset();
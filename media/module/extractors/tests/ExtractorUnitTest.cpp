@@ -20,6 +20,8 @@
 
 #include <inttypes.h>
 
+#include <chrono>
+
 #include <datasource/FileSource.h>
 #include <media/stagefright/MediaBufferGroup.h>
 #include <media/stagefright/MediaCodecConstants.h>
@@ -1257,6 +1259,282 @@ INSTANTIATE_TEST_SUITE_P(
                         "video_480x360_mp4_h264_1350kbps_30fps_aac_stereo_128kbps_44100hz_dash.mp4",
                         2, true)));
 
+// A long screen recording without Cues: one cluster per second of 30 fps VP9 video
+// and a key frame every kCuelessKeyFrameIntervalSec.
+#define CUELESS_RECORDING_FILE "/data/local/tmp/extractorCuelessRecording.webm"
+
+constexpr int32_t kCuelessDurationSec = 1800;
+constexpr int32_t kCuelessKeyFrameIntervalSec = 300;
+constexpr int32_t kCuelessFrameRate = 30;
+
+// Appends an EBML element with an 8 byte size, the size is patched by endElement().
+static size_t startElement(vector<uint8_t> &out, uint32_t id) {
+    for (int32_t shift = 24; shift >= 0; shift -= 8) {
+        if ((id >> shift) != 0) out.push_back((id >> shift) & 0xff);
+    }
+    out.push_back(0x01);
+    out.insert(out.end(), 7, 0);
+    return out.size();
+}
+
+static void endElement(vector<uint8_t> &out, size_t start) {
+    uint64_t size = out.size() - start;
+    for (int32_t i = 1; i <= 7; i++, size >>= 8) out[start - i] = size & 0xff;
+}
+
+static void writeUInt(vector<uint8_t> &out, uint32_t id, uint64_t value) {
+    size_t start = startElement(out, id);
+    for (int32_t shift = 56; shift >= 0; shift -= 8) out.push_back((value >> shift) & 0xff);
+    endElement(out, start);
+}
+
+static void writeString(vector<uint8_t> &out, uint32_t id, const char *value) {
+    size_t start = startElement(out, id);
+    out.insert(out.end(), value, value + strlen(value));
+    endElement(out, start);
+}
+
+static bool writeCuelessRecording(const char *fileName) {
+    vector<uint8_t> out;
+    size_t element = startElement(out, 0x1A45DFA3);  // EBML
+    writeUInt(out, 0x4286, 1);
+    writeUInt(out, 0x42F7, 1);
+    writeUInt(out, 0x42F2, 4);
+    writeUInt(out, 0x42F3, 8);
+    writeString(out, 0x4282, "webm");
+    writeUInt(out, 0x4287, 2);
+    writeUInt(out, 0x4285, 2);
+    endElement(out, element);
+
+    size_t segment = startElement(out, 0x18538067);
+    element = startElement(out, 0x1549A966);  // Info
+    writeUInt(out, 0x2AD7B1, 1000000);       // TimecodeScale, 1 ms
+    endElement(out, element);
+
+    size_t tracks = startElement(out, 0x1654AE6B);
+    size_t trackEntry = startElement(out, 0xAE);
+    writeUInt(out, 0xD7, 1);     // TrackNumber
+    writeUInt(out, 0x73C5, 1);   // TrackUID
+    writeUInt(out, 0x83, 1);     // TrackType, video
+    writeString(out, 0x86, "V_VP9");
+    element = startElement(out, 0xE0);  // Video
+    writeUInt(out, 0xB0, 64);
+    writeUInt(out, 0xBA, 64);
+    endElement(out, element);
+    endElement(out, trackEntry);
+    endElement(out, tracks);
+
+    for (int32_t sec = 0; sec < kCuelessDurationSec; sec++) {
+        size_t cluster = startElement(out, 0x1F43B675);
+        writeUInt(out, 0xE7, sec * 1000ll);  // Timecode
+        for (int32_t frame = 0; frame < kCuelessFrameRate; frame++) {
+            bool isKey = frame == 0 && sec % kCuelessKeyFrameIntervalSec == 0;
+            int16_t timecode = frame * 1000 / kCuelessFrameRate;
+            element = startElement(out, 0xA3);  // SimpleBlock
+            out.push_back(0x81);                // track 1
+            out.push_back((timecode >> 8) & 0xff);
+            out.push_back(timecode & 0xff);
+            out.push_back(isKey ? 0x80 : 0x00);
+            out.insert(out.end(), 16, isKey ? 0xAA : 0x55);
+            endElement(out, element);
+        }
+        endElement(out, cluster);
+    }
+    endElement(out, segment);
+
+    FILE *fp = fopen(fileName, "wb");
+    if (!fp) return false;
+    bool written = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    fclose(fp);
+    return written;
+}
+
+// An hour of Opus in one second pages of fifty 20 ms packets, without codec delay.
+#define LONG_OPUS_FILE "/data/local/tmp/extractorLongOpus.opus"
+
+constexpr int32_t kLongOpusDurationSec = 3600;
+constexpr int32_t kLongOpusPacketsPerPage = 50;
+constexpr int64_t kOpusSeekPreRollUs = 80000;
+
+static void writeOggPage(FILE *fp, uint8_t flags, uint64_t granulePosition, uint32_t pageNo,
+                         const vector<vector<uint8_t>> &packets) {
+    vector<uint8_t> lacing;
+    for (const vector<uint8_t> &packet : packets) {
+        size_t size = packet.size();
+        for (; size >= 255; size -= 255) lacing.push_back(255);
+        lacing.push_back(size);
+    }
+    uint8_t header[27] = {'O', 'g', 'g', 'S', 0 /* version */, flags};
+    for (int32_t i = 0; i < 8; i++) header[6 + i] = (granulePosition >> (8 * i)) & 0xff;
+    header[14] = 1;  // serial number
+    for (int32_t i = 0; i < 4; i++) header[18 + i] = (pageNo >> (8 * i)) & 0xff;
+    header[26] = lacing.size();
+    fwrite(header, 1, sizeof(header), fp);
+    fwrite(lacing.data(), 1, lacing.size(), fp);
+    for (const vector<uint8_t> &packet : packets) fwrite(packet.data(), 1, packet.size(), fp);
+}
+
+static bool writeLongOpusStream(const char *fileName) {
+    FILE *fp = fopen(fileName, "wb");
+    if (!fp) return false;
+    // OpusHead: version 1, mono, no pre-skip, 48 kHz
+    writeOggPage(fp, 0x02, 0, 0,
+                 {{'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1, 0, 0, 0x80, 0xbb, 0, 0, 0, 0, 0}});
+    writeOggPage(fp, 0, 0, 1,
+                 {{'O', 'p', 'u', 's', 'T', 'a', 'g', 's', 0, 0, 0, 0, 0, 0, 0, 0}});
+    srand(kRandomSeed);
+    for (int32_t sec = 0; sec < kLongOpusDurationSec; sec++) {
+        vector<vector<uint8_t>> packets;
+        for (int32_t i = 0; i < kLongOpusPacketsPerPage; i++) {
+            // TOC byte of a 20 ms CELT frame followed by noise.
+            vector<uint8_t> packet(2 + rand() % 80);
+            packet[0] = 0xf8;
+            for (size_t j = 1; j < packet.size(); j++) packet[j] = rand();
+            packets.push_back(packet);
+        }
+        writeOggPage(fp, sec == kLongOpusDurationSec - 1 ? 0x04 : 0, (sec + 1) * 48000ll,
+                     sec + 2, packets);
+    }
+    bool written = !ferror(fp);
+    fclose(fp);
+    return written;
+}
+
+// A generated file without a seek index, and where seeks into it are expected to land.
+struct SeekWithoutIndexParams {
+    const char *name;
+    const char *container;
+    const char *fileName;
+    bool (*writeFile)(const char *fileName);
+    int64_t durationUs;  // 0 if not checked
+    // Picks a random seek time and the time of the sample the seek is expected to return.
+    void (*pickSeek)(int64_t *seekToTimeUs, int64_t *expectedTimeUs);
+};
+
+class SeekWithoutIndexTest : public ExtractorUnitTest,
+                             public ::testing::TestWithParam<SeekWithoutIndexParams> {
+  public:
+    virtual void SetUp() override { setupExtractor(GetParam().container); }
+
+    virtual void TearDown() override { remove(GetParam().fileName); }
+};
+
+// Opening must not scan the whole file, and seeks must land on the expected sync sample.
+// The seeks are repeated: a region already parsed is expected to be faster the second time.
+TEST_P(SeekWithoutIndexTest, SeekLatencyTest) {
+    if (mDisableTest) return;
+
+    const SeekWithoutIndexParams &params = GetParam();
+    ASSERT_TRUE(params.writeFile(params.fileName)) << "Failed to write " << params.fileName;
+
+    int32_t status = setDataSource(params.fileName);
+    ASSERT_EQ(status, 0) << "SetDataSource failed for " << params.container << " extractor";
+
+    auto start = std::chrono::steady_clock::now();
+    status = createExtractor();
+    int64_t openDurationUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(status, 0) << "Extractor creation failed for " << params.container << " extractor";
+    ASSERT_EQ(mExtractor->countTracks(), 1) << "Extractor reported wrong number of tracks";
+
+    MediaTrackHelper *track = mExtractor->getTrack(0);
+    ASSERT_NE(track, nullptr) << "Failed to get track";
+    CMediaTrack *cTrack = wrap(track);
+    ASSERT_NE(cTrack, nullptr) << "Failed to get track wrapper";
+
+    if (params.durationUs > 0) {
+        AMediaFormat *trackFormat = AMediaFormat_new();
+        ASSERT_NE(trackFormat, nullptr) << "AMediaFormat_new returned null format";
+        ASSERT_EQ(OK, (media_status_t)track->getFormat(trackFormat))
+                << "Failed to get track format";
+        int64_t durationUs = 0;
+        AMediaFormat_getInt64(trackFormat, AMEDIAFORMAT_KEY_DURATION, &durationUs);
+        AMediaFormat_delete(trackFormat);
+        ASSERT_EQ(durationUs, params.durationUs) << "Wrong duration";
+    }
+
+    MediaBufferGroup *bufferGroup = new MediaBufferGroup();
+    status = cTrack->start(track, bufferGroup->wrap());
+    ASSERT_EQ(OK, (media_status_t)status) << "Failed to start the track";
+
+    vector<pair<int64_t, int64_t>> seeks;
+    srand(kRandomSeed);
+    for (int32_t i = 0; i < kMaxCount; i++) {
+        int64_t seekToTimeStamp, expectedTimeStamp;
+        params.pickSeek(&seekToTimeStamp, &expectedTimeStamp);
+        seeks.push_back(make_pair(seekToTimeStamp, expectedTimeStamp));
+    }
+
+    int64_t seekDurationUs[2] = {0, 0};
+    for (int32_t pass = 0; pass < 2; pass++) {
+        for (const auto &[seekToTimeStamp, expectedTimeStamp] : seeks) {
+            MediaTrackHelper::ReadOptions options(
+                    CMediaTrackReadOptions::SEEK_CLOSEST_SYNC | CMediaTrackReadOptions::SEEK,
+                    seekToTimeStamp);
+            MediaBufferHelper *buffer = nullptr;
+            start = std::chrono::steady_clock::now();
+            status = track->read(&buffer, &options);
+            seekDurationUs[pass] += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            ASSERT_EQ(OK, (media_status_t)status) << "Seek to " << seekToTimeStamp << " failed";
+            ASSERT_NE(buffer, nullptr) << "No sample after seeking to " << seekToTimeStamp;
+
+            int64_t timeStamp = 0;
+            int32_t isSync = 0;
+            AMediaFormat *metaData = buffer->meta_data();
+            AMediaFormat_getInt64(metaData, AMEDIAFORMAT_KEY_TIME_US, &timeStamp);
+            AMediaFormat_getInt32(metaData, AMEDIAFORMAT_KEY_IS_SYNC_FRAME, &isSync);
+            buffer->release();
+            EXPECT_EQ(timeStamp, expectedTimeStamp)
+                    << "Seek to " << seekToTimeStamp << " didn't land on the expected sample";
+            EXPECT_TRUE(isSync) << "Seek to " << seekToTimeStamp << " returned a non sync frame";
+        }
+    }
+    cout << "[   INFO   ] " << params.name << ": opened in " << openDurationUs / 1000 << " ms, "
+         << kMaxCount << " seeks, first pass " << seekDurationUs[0] / 1000
+         << " ms, second pass " << seekDurationUs[1] / 1000 << " ms\n";
+
+    status = cTrack->stop(track);
+    ASSERT_EQ(OK, status) << "Failed to stop the track";
+    delete bufferGroup;
+    delete track;
+    free(cTrack);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        SeekWithoutIndexTestAll, SeekWithoutIndexTest,
+        ::testing::Values(
+                // Matroska without Cues: seeks between the key frames, away from the cluster
+                // holding the next one, land on that key frame.
+                SeekWithoutIndexParams{
+                        "MatroskaWithoutCues", "webm", CUELESS_RECORDING_FILE,
+                        writeCuelessRecording, 0 /* durationUs */,
+                        [](int64_t *seekToTimeUs, int64_t *expectedTimeUs) {
+                            constexpr int64_t kIntervalUs =
+                                    kCuelessKeyFrameIntervalSec * 1000000ll;
+                            int64_t keyFrame =
+                                    rand() % (kCuelessDurationSec / kCuelessKeyFrameIntervalSec - 1);
+                            int64_t offsetSec = 1 + rand() % (kCuelessKeyFrameIntervalSec - 2);
+                            *seekToTimeUs = keyFrame * kIntervalUs + offsetSec * 1000000ll
+                                    + rand() % 1000000;
+                            *expectedTimeUs = (*seekToTimeUs / kIntervalUs + 1) * kIntervalUs;
+                        }},
+                // Ogg without a full scan: seeks land on the page holding the requested time
+                // less the Opus pre-roll. Seek times keep clear of page boundaries, where
+                // rounding could pick either page.
+                SeekWithoutIndexParams{
+                        "OggOpus", "ogg", LONG_OPUS_FILE, writeLongOpusStream,
+                        kLongOpusDurationSec * 1000000ll,
+                        [](int64_t *seekToTimeUs, int64_t *expectedTimeUs) {
+                            *seekToTimeUs = (1 + rand() % (kLongOpusDurationSec - 2)) * 1000000ll
+                                    + kOpusSeekPreRollUs + 1000 + rand() % 998000;
+                            *expectedTimeUs =
+                                    (*seekToTimeUs - kOpusSeekPreRollUs) / 1000000 * 1000000;
+                        }}),
+        [](const ::testing::TestParamInfo<SeekWithoutIndexParams> &info) {
+            return string(info.param.name);
+        });
+
 int main(int argc, char **argv) {
     gEnv = new ExtractorUnitTestEnvironment();
     ::testing::AddGlobalTestEnvironment(gEnv);
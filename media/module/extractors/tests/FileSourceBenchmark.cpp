@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times full-file sample scans by the MPEG4 and Matroska extractors over a
+// FileSource reading with pread() or through a mapping of the file.
+//
+// usage: FileSourceBenchmark [benchmark options] [file.mp4|file.mkv|file.webm ...]
+// Without files, the clips of ExtractorUnitTest in /data/local/tmp are used.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FileSourceBenchmark"
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <datasource/FileSource.h>
+#include <media/stagefright/MediaBufferGroup.h>
+
+#include <MatroskaExtractor.h>
+#include <MPEG4Extractor.h>
+
+using namespace android;
+
+namespace {
+
+const char *const kDefaultFiles[] = {
+    "/data/local/tmp/ExtractorUnitTestRes/crowd_508x240_25fps_hevc.mp4",
+    "/data/local/tmp/ExtractorUnitTestRes/video_1280x720_av1_hdr_static_3mbps.mp4",
+    "/data/local/tmp/ExtractorUnitTestRes/bbb_cif_768kbps_30fps_mpeg4.mkv",
+    "/data/local/tmp/ExtractorUnitTestRes/video_1280x720_av1_hdr_static_3mbps.webm",
+};
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size()
+            && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+MediaExtractorPluginHelper *createExtractor(const std::string &path,
+                                            const sp<DataSource> &source) {
+    if (endsWith(path, ".mkv") || endsWith(path, ".webm")) {
+        return new MatroskaExtractor(new DataSourceHelper(source->wrap()));
+    }
+    return new MPEG4Extractor(new DataSourceHelper(source->wrap()));
+}
+
+// Reads every sample of the track, returns the number of bytes read or -1 on error.
+int64_t scanTrack(MediaExtractorPluginHelper *extractor, size_t index) {
+    MediaTrackHelper *track = extractor->getTrack(index);
+    if (track == nullptr) {
+        return -1;
+    }
+    CMediaTrack *cTrack = wrap(track);
+    MediaBufferGroup *bufferGroup = new MediaBufferGroup();
+    int64_t bytes = 0;
+    if (cTrack->start(track, bufferGroup->wrap()) == AMEDIA_OK) {
+        media_status_t status = AMEDIA_OK;
+        while (status != AMEDIA_ERROR_END_OF_STREAM) {
+            MediaBufferHelper *buffer = nullptr;
+            status = track->read(&buffer);
+            if (buffer != nullptr) {
+                bytes += buffer->range_length();
+                buffer->release();
+            } else if (status != AMEDIA_OK && status != AMEDIA_ERROR_END_OF_STREAM) {
+                bytes = -1;
+                break;
+            }
+        }
+        cTrack->stop(track);
+    } else {
+        bytes = -1;
+    }
+    delete bufferGroup;
+    delete track;
+    free(cTrack);
+    return bytes;
+}
+
+// range(0) is 1 to read through a mapping, 0 for pread().
+// range(1) is 1 to scan the tracks concurrently as a player does, 0 for one after the other.
+void BM_ScanFile(benchmark::State &state, const std::string &path) {
+    const bool useMmap = state.range(0) != 0;
+    const bool parallel = state.range(1) != 0;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        state.SkipWithError(("Cannot stat " + path).c_str());
+        return;
+    }
+
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        sp<FileSource> source = new FileSource(open(path.c_str(), O_RDONLY), 0, st.st_size);
+        if (source->initCheck() != OK || (useMmap && !source->enableMmap())) {
+            state.SkipWithError("Cannot open the file");
+            return;
+        }
+        MediaExtractorPluginHelper *extractor = createExtractor(path, source);
+        const size_t numTracks = extractor->countTracks();
+        std::vector<int64_t> trackBytes(numTracks);
+        if (parallel) {
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < numTracks; ++i) {
+                threads.emplace_back([&, i] { trackBytes[i] = scanTrack(extractor, i); });
+            }
+            for (auto &thread : threads) thread.join();
+        } else {
+            for (size_t i = 0; i < numTracks; ++i) {
+                trackBytes[i] = scanTrack(extractor, i);
+            }
+        }
+        delete extractor;
+        for (int64_t b : trackBytes) {
+            if (b < 0) {
+                state.SkipWithError("Track scan failed");
+                return;
+            }
+            bytes += b;
+        }
+    }
+    state.SetBytesProcessed(bytes);
+    state.SetLabel(useMmap ? "mmap" : "pread");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    std::vector<std::string> files(argv + 1, argv + argc);
+    if (files.empty()) {
+        files.assign(std::begin(kDefaultFiles), std::end(kDefaultFiles));
+    }
+    for (const std::string &path : files) {
+        const std::string name = "BM_ScanFile/" + path.substr(path.find_last_of('/') + 1);
+        benchmark::RegisterBenchmark(name.c_str(), BM_ScanFile, path)
+                ->ArgsProduct({{0, 1}, {0, 1}})
+                ->ArgNames({"mmap", "parallel"})
+                ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times seeks by the MP3 extractor in long VBR streams without a XING or VBRI
+// header, and measures how far the sample it returns is from the requested time.
+//
+// usage: MP3SeekBenchmark [benchmark options]
+// The streams are generated in /data/local/tmp and removed at exit. Each frame
+// carries its number, which gives the true time of the sample returned by a seek.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MP3SeekBenchmark"
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <datasource/FileSource.h>
+#include <media/stagefright/MediaBufferGroup.h>
+
+#include <MP3Extractor.h>
+
+using namespace android;
+
+namespace {
+
+constexpr int32_t kSampleRate = 44100;
+constexpr int32_t kSamplesPerFrame = 1152;  // MPEG-1 layer III
+constexpr int32_t kSeeksPerIteration = 20;
+const int64_t kStreamMinutes[] = {10, 60};
+
+int64_t frameTimeUs(int64_t frameNumber) {
+    return frameNumber * kSamplesPerFrame * 1000000LL / kSampleRate;
+}
+
+// Writes "minutes" of MPEG-1 layer III frames at 44.1 kHz with a random bitrate
+// each, the payload starts with the frame number.
+std::string writeVbrStream(int64_t minutes) {
+    const std::string path =
+            "/data/local/tmp/MP3SeekBenchmark_" + std::to_string(minutes) + "min.mp3";
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        return "";
+    }
+    static const int32_t kBitrates[] = {32, 40, 48, 56, 64, 80, 96, 112, 128, 160};
+    std::mt19937 generator(minutes);
+    const int64_t numFrames = minutes * 60 * kSampleRate / kSamplesPerFrame;
+    std::vector<uint8_t> frame;
+    for (int64_t i = 0; i < numFrames; ++i) {
+        const uint32_t bitrateIndex = 1 + generator() % 10;
+        const uint32_t padding = generator() % 2;
+        frame.assign(144000 * kBitrates[bitrateIndex - 1] / kSampleRate + padding, 0);
+        frame[0] = 0xff;
+        frame[1] = 0xfb;
+        frame[2] = bitrateIndex << 4 | padding << 1;
+        frame[3] = 0xc0;  // mono
+        memcpy(&frame[4], &i, sizeof(i));
+        if (fwrite(frame.data(), 1, frame.size(), fp) != frame.size()) {
+            fclose(fp);
+            return "";
+        }
+    }
+    fclose(fp);
+    return path;
+}
+
+// range(0) is 1 to keep the extractor between iterations, 0 to seek in a new one.
+void BM_SeekVbr(benchmark::State &state, const std::string &path, int64_t minutes) {
+    const bool warm = state.range(0) != 0;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        state.SkipWithError(("Cannot stat " + path).c_str());
+        return;
+    }
+    const int64_t durationUs = minutes * 60 * 1000000LL;
+
+    std::mt19937 generator(42);
+    int64_t seeks = 0;
+    int64_t maxErrorUs = 0;
+    int64_t totalErrorUs = 0;
+    sp<DataSource> source;
+    MP3Extractor *extractor = nullptr;
+    MediaTrackHelper *track = nullptr;
+    CMediaTrack *cTrack = nullptr;
+    MediaBufferGroup *bufferGroup = nullptr;
+    for (auto _ : state) {
+        if (track == nullptr) {
+            source = new FileSource(open(path.c_str(), O_RDONLY), 0, st.st_size);
+            extractor = new MP3Extractor(new DataSourceHelper(source->wrap()), nullptr);
+            track = extractor->getTrack(0);
+            if (track == nullptr) {
+                state.SkipWithError("Cannot open the stream");
+                break;
+            }
+            cTrack = wrap(track);
+            bufferGroup = new MediaBufferGroup();
+            cTrack->start(track, bufferGroup->wrap());
+        }
+
+        for (int32_t i = 0; i < kSeeksPerIteration; ++i) {
+            const int64_t seekTimeUs = generator() % durationUs;
+            MediaTrackHelper::ReadOptions options(
+                    CMediaTrackReadOptions::SEEK_CLOSEST_SYNC | CMediaTrackReadOptions::SEEK,
+                    seekTimeUs);
+            MediaBufferHelper *buffer = nullptr;
+            if (track->read(&buffer, &options) != AMEDIA_OK || buffer == nullptr) {
+                state.SkipWithError("Seek failed");
+                break;
+            }
+            int64_t frameNumber;
+            memcpy(&frameNumber, (const uint8_t *)buffer->data() + 4, sizeof(frameNumber));
+            buffer->release();
+
+            // The returned frame should hold the sample at seekTimeUs.
+            const int64_t errorUs = std::max(frameTimeUs(frameNumber) - seekTimeUs,
+                                             seekTimeUs - frameTimeUs(frameNumber + 1));
+            maxErrorUs = std::max(maxErrorUs, std::max(errorUs, (int64_t)0));
+            totalErrorUs += std::max(errorUs, (int64_t)0);
+            ++seeks;
+        }
+
+        if (!warm) {
+            cTrack->stop(track);
+            delete bufferGroup;
+            delete track;
+            free(cTrack);
+            delete extractor;
+            track = nullptr;
+        }
+    }
+    if (track != nullptr) {
+        cTrack->stop(track);
+        delete bufferGroup;
+        delete track;
+        free(cTrack);
+        delete extractor;
+    }
+
+    state.counters["seeks_per_second"] = benchmark::Counter(seeks, benchmark::Counter::kIsRate);
+    state.counters["mean_error_ms"] = seeks > 0 ? totalErrorUs / 1000.0 / seeks : 0;
+    state.counters["max_error_ms"] = maxErrorUs / 1000.0;
+    state.SetLabel(warm ? "warm" : "cold");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    std::vector<std::string> paths;
+    for (int64_t minutes : kStreamMinutes) {
+        const std::string path = writeVbrStream(minutes);
+        if (path.empty()) {
+            fprintf(stderr, "Cannot write a %" PRId64 " minute stream\n", minutes);
+            continue;
+        }
+        paths.push_back(path);
+        const std::string name = "BM_SeekVbr/" + std::to_string(minutes) + "min";
+        benchmark::RegisterBenchmark(name.c_str(), BM_SeekVbr, path, minutes)
+                ->Arg(0)
+                ->Arg(1)
+                ->ArgNames({"warm"})
+                ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    for (const std::string &path : paths) {
+        remove(path.c_str());
+    }
+    return 0;
+}
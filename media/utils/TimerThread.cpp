@@ -16,6 +16,7 @@
 
 #define LOG_TAG "TimerThread"
 
+#include <algorithm>
 #include <optional>
 #include <sstream>
 #include <unistd.h>
@@ -38,24 +39,24 @@ TimerThread::Handle TimerThread::scheduleTask(
         std::string_view tag, TimerCallback&& func,
         Duration timeoutDuration, Duration secondChanceDuration) {
     const auto now = std::chrono::system_clock::now();
-    auto request = std::make_shared<const Request>(now, now +
+    const Request request(now, now +
             std::chrono::duration_cast<std::chrono::system_clock::duration>(timeoutDuration),
             secondChanceDuration, getThreadIdWrapper(), tag);
-    return mMonitorThread.add(std::move(request), std::move(func), timeoutDuration);
+    return mMonitorThread.add(request, std::move(func), timeoutDuration, HANDLE_TYPE::TIMEOUT);
 }
 
 TimerThread::Handle TimerThread::trackTask(std::string_view tag) {
     const auto now = std::chrono::system_clock::now();
-    auto request = std::make_shared<const Request>(now, now,
+    const Request request(now, now,
             Duration{} /* secondChanceDuration */, getThreadIdWrapper(), tag);
-    return mNoTimeoutMap.add(std::move(request));
+    return mMonitorThread.add(request, {} /* func */, Duration{} /* timeout */,
+            HANDLE_TYPE::NO_TIMEOUT);
 }
 
 bool TimerThread::cancelTask(Handle handle) {
-    std::shared_ptr<const Request> request = isNoTimeoutHandle(handle) ?
-             mNoTimeoutMap.remove(handle) : mMonitorThread.remove(handle);
+    std::optional<Request> request = mMonitorThread.remove(handle);
     if (!request) return false;
-    mRetiredQueue.add(std::move(request));
+    mRetiredQueue.add(*request);
     return true;
 }
 
@@ -183,9 +184,8 @@ std::vector<std::shared_ptr<const TimerThread::Request>> TimerThread::getPending
     std::vector<std::shared_ptr<const Request>> pendingRequests;
     pendingRequests.reserve(kEstimatedPendingRequests); // preallocate vector out of lock.
 
-    // following are internally locked calls, which add to our local pendingRequests.
+    // following is an internally locked call, which adds to our local pendingRequests.
     mMonitorThread.copyRequests(pendingRequests);
-    mNoTimeoutMap.copyRequests(pendingRequests);
 
     // Sort in order of scheduled time.
     std::sort(pendingRequests.begin(), pendingRequests.end(),
@@ -225,48 +225,39 @@ std::string TimerThread::Request::toString() const {
         .append(" tid ").append(std::to_string(tid));
 }
 
-void TimerThread::RequestQueue::add(std::shared_ptr<const Request> request) {
-    std::lock_guard lg(mRQMutex);
-    mRequestQueue.emplace_back(std::chrono::system_clock::now(), std::move(request));
-    if (mRequestQueue.size() > mRequestQueueMax) {
-        mRequestQueue.pop_front();
+void TimerThread::RequestQueue::add(const Request& request) {
+    const uint64_t position = mPosition.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t written = 2 * (position + 1);
+    Slot& slot = mSlots[position % mRequestQueueMax];
+    uint64_t sequence = slot.mSequence.load(std::memory_order_relaxed);
+    // Skip if a newer request is in the slot, or if the slot is being written,
+    // which happens only when adders lap a preempted adder.
+    if (sequence >= written || (sequence & 1) != 0
+            || !slot.mSequence.compare_exchange_strong(sequence, sequence | 1,
+                    std::memory_order_acquire)) {
+        return;
     }
+    slot.mRequest.emplace(request);
+    slot.mSequence.store(written, std::memory_order_release);
 }
 
 void TimerThread::RequestQueue::copyRequests(
         std::vector<std::shared_ptr<const Request>>& requests, size_t n) const {
-    std::lock_guard lg(mRQMutex);
-    const size_t size = mRequestQueue.size();
-    size_t i = n >=  size ? 0 : size - n;
-    for (; i < size; ++i) {
-        const auto &[time, request] = mRequestQueue[i];
-        requests.emplace_back(request);
-    }
-}
-
-TimerThread::Handle TimerThread::NoTimeoutMap::add(std::shared_ptr<const Request> request) {
-    std::lock_guard lg(mNTMutex);
-    // A unique handle is obtained by mNoTimeoutRequests.fetch_add(1),
-    // This need not be under a lock, but we do so anyhow.
-    const Handle handle = getUniqueHandle_l();
-    mMap[handle] = request;
-    return handle;
-}
-
-std::shared_ptr<const TimerThread::Request> TimerThread::NoTimeoutMap::remove(Handle handle) {
-    std::lock_guard lg(mNTMutex);
-    auto it = mMap.find(handle);
-    if (it == mMap.end()) return {};
-    auto request = it->second;
-    mMap.erase(it);
-    return request;
-}
-
-void TimerThread::NoTimeoutMap::copyRequests(
-        std::vector<std::shared_ptr<const Request>>& requests) const {
-    std::lock_guard lg(mNTMutex);
-    for (const auto &[handle, request] : mMap) {
-        requests.emplace_back(request);
+    constexpr int kMaxRetries = 4;
+    const uint64_t end = mPosition.load(std::memory_order_acquire);
+    const uint64_t size = std::min<uint64_t>({end, mRequestQueueMax, n});
+    for (uint64_t position = end - size; position < end; ++position) {
+        const Slot& slot = mSlots[position % mRequestQueueMax];
+        const uint64_t written = 2 * (position + 1);
+        for (int retry = 0; retry < kMaxRetries; ++retry) {
+            if (slot.mSequence.load(std::memory_order_acquire) != written) break;
+            std::optional<Request> request = slot.mRequest;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.mSequence.load(std::memory_order_relaxed) == written) {
+                requests.emplace_back(std::make_shared<const Request>(*request));
+                break;
+            }
+        }
     }
 }
 
@@ -284,140 +275,287 @@ TimerThread::MonitorThread::~MonitorThread() {
         mCond.notify_all();
     }
     mThread.join();
+    for (auto& chunk : mChunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+TimerThread::Record* TimerThread::MonitorThread::getRecord(size_t index) const {
+    Record* const chunk = mChunks[index / kRecordsPerChunk].load(std::memory_order_acquire);
+    return chunk == nullptr ? nullptr : chunk + index % kRecordsPerChunk;
+}
+
+TimerThread::Record* TimerThread::MonitorThread::allocateRecord_l() {
+    if (mFreeRecords == nullptr) {
+        reclaimCancelled_l();
+    }
+    if (mFreeRecords == nullptr && mChunkCount < kMaxChunks) {
+        Record* const chunk = new Record[kRecordsPerChunk];
+        for (size_t i = kRecordsPerChunk; i > 0; --i) {
+            Record* const record = &chunk[i - 1];
+            record->mIndex = mChunkCount * kRecordsPerChunk + i - 1;
+            record->mNextFree = mFreeRecords;
+            mFreeRecords = record;
+        }
+        mChunks[mChunkCount++].store(chunk, std::memory_order_release);
+    }
+    Record* const record = mFreeRecords;
+    if (record != nullptr) mFreeRecords = record->mNextFree;
+    return record;
+}
+
+void TimerThread::MonitorThread::freeRecord_l(Record* record) {
+    if (record->mLevel >= 0) unlink_l(record);
+    record->mRequest.reset();
+    record->mNextFree = mFreeRecords;
+    mFreeRecords = record;
+}
+
+void TimerThread::MonitorThread::reclaimCancelled_l() {
+    Record* record = mCancelledRecords.exchange(nullptr, std::memory_order_acquire);
+    while (record != nullptr) {
+        Record* const next = record->mNextCancelled;
+        freeRecord_l(record);
+        record = next;
+    }
+}
+
+/* static */
+int64_t TimerThread::MonitorThread::toTick(Handle time) {
+    // Round up, so that a tick is processed no earlier than its deadlines.
+    return (time.time_since_epoch() + kTick - Duration(1)) / kTick;
+}
+
+/* static */
+TimerThread::Handle TimerThread::MonitorThread::fromTick(int64_t tick) {
+    return Handle(tick * kTick);
+}
+
+void TimerThread::MonitorThread::link_l(Record* record) {
+    const int64_t tick = std::max(record->mTick, mCurrentTick);
+    record->mTick = tick;
+    int level = 0;
+    int64_t position = tick;
+    // Find the lowest level where the tick falls within the next kSlots slots.
+    while ((position - (mCurrentTick >> (kSlotBits * level))) >= kSlots) {
+        if (level == kLevels - 1) {
+            // Beyond the wheel, park in the farthest slot and cascade again from there.
+            position = (mCurrentTick >> (kSlotBits * level)) + kSlots - 1;
+            break;
+        }
+        ++level;
+        position = tick >> (kSlotBits * level);
+    }
+    const int slot = position & (kSlots - 1);
+    Record*& head = mWheel[level][slot];
+    record->mLevel = level;
+    record->mSlot = slot;
+    record->mPrev = nullptr;
+    record->mNext = head;
+    if (head != nullptr) head->mPrev = record;
+    head = record;
+    mOccupied[level] |= uint64_t(1) << slot;
+}
+
+void TimerThread::MonitorThread::unlink_l(Record* record) {
+    if (record->mPrev != nullptr) {
+        record->mPrev->mNext = record->mNext;
+    } else {
+        mWheel[record->mLevel][record->mSlot] = record->mNext;
+        if (record->mNext == nullptr) {
+            mOccupied[record->mLevel] &= ~(uint64_t(1) << record->mSlot);
+        }
+    }
+    if (record->mNext != nullptr) record->mNext->mPrev = record->mPrev;
+    record->mPrev = record->mNext = nullptr;
+    record->mLevel = -1;
+}
+
+TimerThread::Record* TimerThread::MonitorThread::detachSlot_l(int level, int slot) {
+    Record* const list = mWheel[level][slot];
+    mWheel[level][slot] = nullptr;
+    mOccupied[level] &= ~(uint64_t(1) << slot);
+    for (Record* record = list; record != nullptr; record = record->mNext) {
+        record->mLevel = -1;
+    }
+    return list;
+}
+
+int64_t TimerThread::MonitorThread::getNextTick_l() const {
+    int64_t nextTick = INT64_MAX;
+    for (int level = 0; level < kLevels; ++level) {
+        const uint64_t occupied = mOccupied[level];
+        if (occupied == 0) continue;
+        const int shift = kSlotBits * level;
+        const int64_t position = mCurrentTick >> shift;
+        // The current slot of an upper level is already cascaded, unless on its boundary.
+        const int first = level == 0 || (mCurrentTick & ((int64_t(1) << shift) - 1)) == 0
+                ? 0 : 1;
+        const int rotation = (position + first) & (kSlots - 1);
+        const uint64_t rotated = rotation == 0 ? occupied
+                : occupied >> rotation | occupied << (kSlots - rotation);
+        const int64_t tick = (position + first + __builtin_ctzll(rotated)) << shift;
+        nextTick = std::min(nextTick, tick);
+    }
+    return nextTick;
+}
+
+TimerThread::Record* TimerThread::MonitorThread::processTicks_l(int64_t nowTick, Handle now) {
+    Record* expired = nullptr;
+    Record** expiredTail = &expired;
+    while (true) {
+        const int64_t tick = getNextTick_l();
+        if (tick > nowTick) break;
+        mCurrentTick = tick;
+
+        // Cascade the upper level slots reached, from the top as they cascade
+        // into each other.
+        for (int level = kLevels - 1; level > 0; --level) {
+            const int shift = kSlotBits * level;
+            if ((tick & ((int64_t(1) << shift) - 1)) != 0) continue;
+            Record* record = detachSlot_l(level, (tick >> shift) & (kSlots - 1));
+            while (record != nullptr) {
+                Record* const next = record->mNext;
+                // Cancelled records are left unlinked for reclaimCancelled_l().
+                if (record->mActive.load(std::memory_order_relaxed) != 0) link_l(record);
+                record = next;
+            }
+        }
+
+        Record* record = detachSlot_l(0, tick & (kSlots - 1));
+        while (record != nullptr) {
+            Record* const next = record->mNext;
+            Handle::rep handle = record->mActive.load(std::memory_order_relaxed);
+            if (handle == 0) {
+                // cancelled, left for reclaimCancelled_l().
+            } else if (!record->mSecondChance
+                    && record->mRequest->secondChanceDuration.count() != 0) {
+                // We now apply the second chance duration to find the clock
+                // monotonic second deadline.
+                //
+                // The second chance prevents a false timeout should there be
+                // any clock monotonic advancement during suspend.
+                record->mSecondChance = true;
+                record->mTick = toTick(now + record->mRequest->secondChanceDuration);
+                ALOGD("%s: TimeCheck second chance applied for %s",
+                        __func__, record->mRequest->tag.c_str()); // should be rare event.
+                link_l(record);
+                // increment second chance counter.
+                mSecondChanceCount.fetch_add(1 /* arg */, std::memory_order_relaxed);
+            } else if (record->mActive.compare_exchange_strong(handle, 0,
+                    std::memory_order_acq_rel)) {
+                // Deadline has expired, the request is ours.
+                record->mNextFree = nullptr;
+                *expiredTail = record;
+                expiredTail = &record->mNextFree;
+            }
+            record = next;
+        }
+        mCurrentTick = tick + 1;
+    }
+    mCurrentTick = std::max(mCurrentTick, nowTick + 1);
+    return expired;
 }
 
 void TimerThread::MonitorThread::threadFunc() {
     std::unique_lock _l(mMutex);
     ::android::base::ScopedLockAssertion lock_assertion(mMutex);
     while (!mShouldExit) {
-        Handle nextDeadline = INVALID_HANDLE;
-        Handle now = INVALID_HANDLE;
-        if (!mMonitorRequests.empty()) {
-            nextDeadline = mMonitorRequests.begin()->first;
-            now = std::chrono::steady_clock::now();
-            if (nextDeadline < now) {
-                auto node = mMonitorRequests.extract(mMonitorRequests.begin());
-                // Deadline has expired, handle the request.
-                auto secondChanceDuration = node.mapped().first->secondChanceDuration;
-                if (secondChanceDuration.count() != 0) {
-                    // We now apply the second chance duration to find the clock
-                    // monotonic second deadline.  The unique key is then the
-                    // pair<second_deadline, first_deadline>.
-                    //
-                    // The second chance prevents a false timeout should there be
-                    // any clock monotonic advancement during suspend.
-                    auto newHandle = now + secondChanceDuration;
-                    ALOGD("%s: TimeCheck second chance applied for %s",
-                            __func__, node.mapped().first->tag.c_str()); // should be rare event.
-                    mSecondChanceRequests.emplace_hint(mSecondChanceRequests.end(),
-                            std::make_pair(newHandle, nextDeadline),
-                            std::move(node.mapped()));
-                    // increment second chance counter.
-                    mSecondChanceCount.fetch_add(1 /* arg */, std::memory_order_relaxed);
-                } else {
-                    {
-                        _l.unlock();
-                        // We add Request to retired queue early so that it can be dumped out.
-                        mTimeoutQueue.add(std::move(node.mapped().first));
-                        node.mapped().second(nextDeadline);
-                        // Caution: we don't hold lock when we call TimerCallback,
-                        // but this is the timeout case!  We will crash soon,
-                        // maybe before returning.
-                        // anything left over is released here outside lock.
-                    }
-                    // reacquire the lock - if something was added, we loop immediately to check.
-                    _l.lock();
-                }
-                // always process expiring monitor requests first.
-                continue;
+        reclaimCancelled_l();
+        const Handle now = std::chrono::steady_clock::now();
+        Record* expired = processTicks_l(now.time_since_epoch() / kTick, now);
+        if (expired != nullptr) {
+            _l.unlock();
+            for (Record* record = expired; record != nullptr; record = record->mNextFree) {
+                // We add Request to timeout queue early so that it can be dumped out.
+                mTimeoutQueue.add(*record->mRequest);
+                // The original handle is passed to the callback.
+                record->mFunc(record->mHandle);
+                // Caution: we don't hold lock when we call TimerCallback,
+                // but this is the timeout case!  We will crash soon,
+                // maybe before returning.
+                record->mFunc = nullptr;
             }
-        }
-        // now process any second chance requests.
-        if (!mSecondChanceRequests.empty()) {
-            Handle secondDeadline = mSecondChanceRequests.begin()->first.first;
-            if (now == INVALID_HANDLE) now = std::chrono::steady_clock::now();
-            if (secondDeadline < now) {
-                auto node = mSecondChanceRequests.extract(mSecondChanceRequests.begin());
-                {
-                    _l.unlock();
-                    // We add Request to retired queue early so that it can be dumped out.
-                    mTimeoutQueue.add(std::move(node.mapped().first));
-                    const Handle originalHandle = node.key().second;
-                    node.mapped().second(originalHandle);
-                    // Caution: we don't hold lock when we call TimerCallback.
-                    // This is benign issue - we permit concurrent operations
-                    // while in the callback to the MonitorQueue.
-                    //
-                    // Anything left over is released here outside lock.
-                }
-                // reacquire the lock - if something was added, we loop immediately to check.
-                _l.lock();
-                continue;
-            }
-            // update the deadline.
-            if (nextDeadline == INVALID_HANDLE) {
-                nextDeadline = secondDeadline;
-            } else {
-                nextDeadline = std::min(nextDeadline, secondDeadline);
+            // reacquire the lock - if something was added, we loop immediately to check.
+            _l.lock();
+            while (expired != nullptr) {
+                Record* const next = expired->mNextFree;
+                freeRecord_l(expired);
+                expired = next;
             }
+            continue;
         }
-        if (nextDeadline != INVALID_HANDLE) {
-            mCond.wait_until(_l, nextDeadline);
+        const int64_t nextTick = getNextTick_l();
+        if (nextTick != INT64_MAX) {
+            mWakeTick = nextTick;
+            mCond.wait_until(_l, fromTick(nextTick));
         } else {
+            mWakeTick = INT64_MAX;
             mCond.wait(_l);
         }
+        mWakeTick = INT64_MIN;
     }
 }
 
 TimerThread::Handle TimerThread::MonitorThread::add(
-        std::shared_ptr<const Request> request, TimerCallback&& func, Duration timeout) {
+        const Request& request, TimerCallback&& func, Duration timeout, HANDLE_TYPE type) {
+    const Handle deadline = std::chrono::steady_clock::now() + timeout;
     std::lock_guard _l(mMutex);
-    const Handle handle = getUniqueHandle_l(timeout);
-    mMonitorRequests.emplace_hint(mMonitorRequests.end(),
-            handle, std::make_pair(std::move(request), std::move(func)));
-    mCond.notify_all();
-    return handle;
-}
+    Record* const record = allocateRecord_l();
+    if (record == nullptr) {
+        ALOGW("%s: too many pending requests, not monitoring %s",
+                __func__, request.tag.c_str());
+        return INVALID_HANDLE;
+    }
 
-std::shared_ptr<const TimerThread::Request> TimerThread::MonitorThread::remove(Handle handle) {
-    std::pair<std::shared_ptr<const Request>, TimerCallback> data;
-    std::unique_lock ul(mMutex);
-    ::android::base::ScopedLockAssertion lock_assertion(mMutex);
-    if (const auto it = mMonitorRequests.find(handle);
-        it != mMonitorRequests.end()) {
-        data = std::move(it->second);
-        mMonitorRequests.erase(it);
-        ul.unlock();  // manually release lock here so func (data.second)
-                      // is released outside of lock.
-        return data.first;  // request
+    // The handle is the deadline with the type and the record index in the lsbs,
+    // advanced if needed to differ from the last handle of the record.
+    Handle::rep handle = (deadline.time_since_epoch().count() & ~Handle::rep(HANDLE_LOW_MASK))
+            | Handle::rep(record->mIndex) << HANDLE_INDEX_SHIFT
+            | Handle::rep(enum_as_value(type));
+    if (Handle(Duration(handle)) == record->mHandle) {
+        handle += HANDLE_LOW_MASK + 1;
     }
+    record->mHandle = Handle(Duration(handle));
+    record->mRequest.emplace(request);
+    record->mFunc = std::move(func);
+    record->mSecondChance = false;
+    if (type == HANDLE_TYPE::TIMEOUT) {
+        record->mTick = toTick(deadline);
+        link_l(record);
+        // Only wake the monitor thread if it would sleep past the deadline.
+        if (record->mTick < mWakeTick) mCond.notify_one();
+    }
+    record->mActive.store(handle, std::memory_order_release);
+    return record->mHandle;
+}
 
-    // this check is O(N), but since the second chance requests are ordered
-    // in terms of earliest expiration time, we would expect better than average results.
-    for (auto it = mSecondChanceRequests.begin(); it != mSecondChanceRequests.end(); ++it) {
-        if (it->first.second == handle) {
-            data = std::move(it->second);
-            mSecondChanceRequests.erase(it);
-            ul.unlock();  // manually release lock here so func (data.second)
-                          // is released outside of lock.
-            return data.first; // request
-        }
+std::optional<TimerThread::Request> TimerThread::MonitorThread::remove(Handle handle) {
+    if (handle == INVALID_HANDLE) return {};
+    Record* const record = getRecord(getHandleIndex(handle));
+    if (record == nullptr) return {};
+    Handle::rep expected = handle.time_since_epoch().count();
+    if (!record->mActive.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return {}; // already executed, cancelled, or stale.
     }
-    return {};
+    // The request is ours, the record is reclaimed later under the lock.
+    // Copy, as the request stays readable until the record is reclaimed.
+    std::optional<Request> request = record->mRequest;
+    record->mFunc = nullptr;  // func is released outside of lock.
+    record->mNextCancelled = mCancelledRecords.load(std::memory_order_relaxed);
+    while (!mCancelledRecords.compare_exchange_weak(record->mNextCancelled, record,
+            std::memory_order_release, std::memory_order_relaxed)) {}
+    return request;
 }
 
 void TimerThread::MonitorThread::copyRequests(
         std::vector<std::shared_ptr<const Request>>& requests) const {
     std::lock_guard lg(mMutex);
-    for (const auto &[deadline, monitorpair] : mMonitorRequests) {
-        requests.emplace_back(monitorpair.first);
-    }
-    // we combine the second map with the first map - this is
-    // everything that is pending on the monitor thread.
-    // The second map will be older than the first map so this
-    // is in order.
-    for (const auto &[deadline, monitorpair] : mSecondChanceRequests) {
-        requests.emplace_back(monitorpair.first);
+    for (size_t i = 0; i < mChunkCount * kRecordsPerChunk; ++i) {
+        const Record* const record = getRecord(i);
+        if (record->mActive.load(std::memory_order_acquire) != 0) {
+            requests.emplace_back(std::make_shared<const Request>(*record->mRequest));
+        }
     }
 }
 
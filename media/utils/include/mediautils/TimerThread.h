@@ -18,11 +18,10 @@
 
 #include <atomic>
 #include <condition_variable>
-#include <deque>
 #include <functional>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -56,6 +55,10 @@ class TimerThread {
     // The lsb of the Handle time_point is adjusted to indicate whether there is
     // a timeout action (1) or not (0).
     //
+    // The next HANDLE_INDEX_BITS bits hold the index of the pooled record of the
+    // request, so that the request is found from the Handle without a lookup.
+    // The Handle is thus within 64us before the expiration time.
+    //
 
     template <size_t COUNT>
     static constexpr bool is_power_of_2_v = COUNT > 0 && (COUNT & (COUNT - 1)) == 0;
@@ -75,6 +78,13 @@ class TimerThread {
 
     static constexpr size_t HANDLE_TYPE_MASK = mask_from_count_v<HANDLE_TYPES>;
 
+    static constexpr size_t HANDLE_INDEX_BITS = 15;
+    static constexpr size_t HANDLE_INDEX_SHIFT = 1;  // log2(HANDLE_TYPES)
+    static constexpr size_t HANDLE_INDEX_MASK = mask_from_count_v<1 << HANDLE_INDEX_BITS>;
+    // Bits of the Handle replaced by the type and the index.
+    static constexpr size_t HANDLE_LOW_MASK =
+            mask_from_count_v<HANDLE_TYPES << HANDLE_INDEX_BITS>;
+
     template <typename T>
     static constexpr auto enum_as_value(T x) {
         return static_cast<std::underlying_type_t<T>>(x);
@@ -90,29 +100,8 @@ class TimerThread {
                 enum_as_value(HANDLE_TYPE::TIMEOUT);
     }
 
-    // Returns a unique Handle that doesn't exist in the container.
-    template <size_t MAX_TYPED_HANDLES, size_t HANDLE_TYPE_AS_VALUE, typename C, typename T>
-    static Handle getUniqueHandleForHandleType_l(C container, T timeout) {
-        static_assert(MAX_TYPED_HANDLES > 0 && HANDLE_TYPE_AS_VALUE < MAX_TYPED_HANDLES
-                && is_power_of_2_v<MAX_TYPED_HANDLES>,
-                " handles must be power of two");
-
-        // Our initial handle is the deadline as computed from steady_clock.
-        auto deadline = std::chrono::steady_clock::now() + timeout;
-
-        // We adjust the lsbs by the minimum increment to have the correct
-        // HANDLE_TYPE in the least significant bits.
-        auto remainder = deadline.time_since_epoch().count() & HANDLE_TYPE_MASK;
-        size_t offset = HANDLE_TYPE_AS_VALUE > remainder ? HANDLE_TYPE_AS_VALUE - remainder :
-                     MAX_TYPED_HANDLES + HANDLE_TYPE_AS_VALUE - remainder;
-        deadline += std::chrono::steady_clock::duration(offset);
-
-        // To avoid key collisions, advance the handle by MAX_TYPED_HANDLES (the modulus factor)
-        // until the key is unique.
-        while (container.find(deadline) != container.end()) {
-            deadline += std::chrono::steady_clock::duration(MAX_TYPED_HANDLES);
-        }
-        return deadline;
+    static inline size_t getHandleIndex(Handle handle) {
+        return (handle.time_since_epoch().count() >> HANDLE_INDEX_SHIFT) & HANDLE_INDEX_MASK;
     }
 
     // TimerCallback invoked on timeout or cancel.
@@ -212,8 +201,9 @@ class TimerThread {
         return s;
     }
 
-    // To minimize movement of data, we pass around shared_ptrs to Requests.
-    // These are allocated and deallocated outside of the lock.
+    // Requests are held by value in pooled records while pending and in the
+    // retired and timeout queues, so scheduling does not allocate.
+    // Shared_ptrs to copies are made only for reporting.
     // TODO(b/243839867) consider options to merge Request with the
     // TimeCheck::TimeCheckHandler struct.
     struct Request {
@@ -275,72 +265,91 @@ class TimerThread {
     };
 
   private:
-    // Deque of requests, in order of add().
-    // This class is thread-safe.
+    // Ring of the last requests added, in order of add().
+    // This class is thread-safe, add() is lock-free.
     class RequestQueue {
       public:
         explicit RequestQueue(size_t maxSize)
-            : mRequestQueueMax(maxSize) {}
+            : mRequestQueueMax(maxSize)
+            , mSlots(new Slot[maxSize]) {}
 
-        void add(std::shared_ptr<const Request>);
+        void add(const Request& request);
 
         // return up to the last "n" requests retired.
         void copyRequests(std::vector<std::shared_ptr<const Request>>& requests,
             size_t n = SIZE_MAX) const;
 
       private:
+        // A Slot is written under a sequence lock, so readers retry rather
+        // than block writers.  Request is trivially copied (see FixedString).
+        struct Slot {
+            std::atomic<uint64_t> mSequence{};  // 2 * (position + 1), odd while written.
+            std::optional<Request> mRequest;
+        };
         const size_t mRequestQueueMax;
-        mutable std::mutex mRQMutex;
-        std::deque<std::pair<std::chrono::system_clock::time_point,
-                             std::shared_ptr<const Request>>>
-                mRequestQueue GUARDED_BY(mRQMutex);
+        const std::unique_ptr<Slot[]> mSlots;
+        std::atomic<uint64_t> mPosition{};  // count of requests added.
     };
 
-    // A storage map of tasks without timeouts.  There is no TimerCallback
-    // required, it just tracks the tasks with the tag, scheduled time and the tid.
-    // These tasks show up on a pendingToString() until manually cancelled.
-    class NoTimeoutMap {
-        mutable std::mutex mNTMutex;
-        std::map<Handle, std::shared_ptr<const Request>> mMap GUARDED_BY(mNTMutex);
-        Handle getUniqueHandle_l() REQUIRES(mNTMutex) {
-            return getUniqueHandleForHandleType_l<
-                    HANDLE_TYPES, enum_as_value(HANDLE_TYPE::NO_TIMEOUT)>(
-                mMap, Duration{} /* timeout */);
-        }
-
-      public:
-        bool isValidHandle(Handle handle) const; // lock free
-        Handle add(std::shared_ptr<const Request> request);
-        std::shared_ptr<const Request> remove(Handle handle);
-        void copyRequests(std::vector<std::shared_ptr<const Request>>& requests) const;
+    // A pooled record of a pending request.
+    struct Record {
+        // The Handle while the request is pending, 0 otherwise.
+        // Cancel and timeout race to clear it, the winner retires the request.
+        std::atomic<Handle::rep> mActive{};
+
+        // The following are set before mActive, and read after winning mActive.
+        std::optional<Request> mRequest;
+        TimerCallback mFunc;
+
+        // The following are accessed under the MonitorThread mutex.
+        Handle mHandle = INVALID_HANDLE;  // last handle, kept to not repeat it on reuse.
+        int64_t mTick = 0;                // wheel expiration tick.
+        bool mSecondChance = false;       // second chance applied.
+        Record* mPrev = nullptr;          // wheel slot list links.
+        Record* mNext = nullptr;
+        int8_t mLevel = -1;               // wheel level, -1 if not linked.
+        uint8_t mSlot = 0;
+        uint32_t mIndex = 0;
+        Record* mNextFree = nullptr;      // free list, or expired list.
+
+        // Lock-free stack of records cancelled, reclaimed under the mutex.
+        Record* mNextCancelled = nullptr;
     };
 
     // Monitor thread.
-    // This thread manages shared pointers to Requests and a function to
-    // call on timeout.
-    // This class is thread-safe.
+    // This thread manages the pooled records of the pending Requests,
+    // both with a function to call on timeout and without (tracked tasks).
+    // Records with a timeout are kept in a hierarchical timer wheel.
+    // This class is thread-safe, remove() is lock-free.
     class MonitorThread {
+        static constexpr size_t kRecordsPerChunk = 256;
+        static constexpr size_t kMaxChunks = (HANDLE_INDEX_MASK + 1) / kRecordsPerChunk;
+
+        // Timer wheel of kLevels, each of kSlots.  Level 0 slots are one tick,
+        // level n slots are kSlots^n ticks, which are cascaded down to the
+        // lower levels when reached.
+        static constexpr Duration kTick = std::chrono::milliseconds(1);
+        static constexpr int kLevels = 4;    // up to 64^4 ticks (4.6 hours), then cascaded.
+        static constexpr int kSlotBits = 6;
+        static constexpr int kSlots = 1 << kSlotBits;
+
         std::atomic<size_t> mSecondChanceCount{};
         mutable std::mutex mMutex;
         mutable std::condition_variable mCond GUARDED_BY(mMutex);
 
-        // Ordered map of requests based on time of deadline.
-        //
-        std::map<Handle, std::pair<std::shared_ptr<const Request>, TimerCallback>>
-                mMonitorRequests GUARDED_BY(mMutex);
+        // The record chunks, allocated on demand and never released.
+        std::atomic<Record*> mChunks[kMaxChunks]{};
+        size_t mChunkCount GUARDED_BY(mMutex) = 0;
+        Record* mFreeRecords GUARDED_BY(mMutex) = nullptr;
+        std::atomic<Record*> mCancelledRecords{};
 
-        // Due to monotonic/steady clock inaccuracies during suspend,
-        // we allow an additional second chance waiting time to prevent
-        // false removal.
+        Record* mWheel[kLevels][kSlots] GUARDED_BY(mMutex) = {};
+        uint64_t mOccupied[kLevels] GUARDED_BY(mMutex) = {};  // bitmap of non-empty slots.
+        // The ticks before mCurrentTick are processed.
+        int64_t mCurrentTick GUARDED_BY(mMutex) = toTick(std::chrono::steady_clock::now());
+        int64_t mWakeTick GUARDED_BY(mMutex) = INT64_MIN;  // INT64_MIN if not waiting.
 
-        // This mSecondChanceRequests queue is almost always empty.
-        // Using a pair with the original handle allows lookup and keeps
-        // the Key unique.
-        std::map<std::pair<Handle /* new */, Handle /* original */>,
-                std::pair<std::shared_ptr<const Request>, TimerCallback>>
-                        mSecondChanceRequests GUARDED_BY(mMutex);
-
-        RequestQueue& mTimeoutQueue GUARDED_BY(mMutex); // added to when request times out.
+        RequestQueue& mTimeoutQueue; // added to when request times out.
 
         // Worker thread variables
         bool mShouldExit GUARDED_BY(mMutex) = false;
@@ -350,19 +359,29 @@ class TimerThread {
         std::thread mThread;
 
         void threadFunc();
-        Handle getUniqueHandle_l(Duration timeout) REQUIRES(mMutex) {
-            return getUniqueHandleForHandleType_l<
-                    HANDLE_TYPES, enum_as_value(HANDLE_TYPE::TIMEOUT)>(
-                mMonitorRequests, timeout);
-        }
+
+        Record* getRecord(size_t index) const;  // lock free
+        Record* allocateRecord_l() REQUIRES(mMutex);
+        void freeRecord_l(Record* record) REQUIRES(mMutex);
+        void reclaimCancelled_l() REQUIRES(mMutex);
+
+        static int64_t toTick(Handle time);
+        static Handle fromTick(int64_t tick);
+        void link_l(Record* record) REQUIRES(mMutex);
+        void unlink_l(Record* record) REQUIRES(mMutex);
+        Record* detachSlot_l(int level, int slot) REQUIRES(mMutex);
+        int64_t getNextTick_l() const REQUIRES(mMutex);
+        // Returns the list of records expired up to nowTick, which are retired.
+        Record* processTicks_l(int64_t nowTick, Handle now) REQUIRES(mMutex);
 
       public:
         MonitorThread(RequestQueue &timeoutQueue);
         ~MonitorThread();
 
-        Handle add(std::shared_ptr<const Request> request, TimerCallback&& func,
-                Duration timeout);
-        std::shared_ptr<const Request> remove(Handle handle);
+        // Returns INVALID_HANDLE if too many requests are pending.
+        Handle add(const Request& request, TimerCallback&& func,
+                Duration timeout, HANDLE_TYPE type);
+        std::optional<Request> remove(Handle handle);
         void copyRequests(std::vector<std::shared_ptr<const Request>>& requests) const;
         size_t getSecondChanceCount() const {
             return mSecondChanceCount.load(std::memory_order_relaxed);
@@ -382,8 +401,6 @@ class TimerThread {
     static constexpr size_t kTimeoutQueueMax = 16;
     RequestQueue mTimeoutQueue{kTimeoutQueueMax};  // locked internally
 
-    NoTimeoutMap mNoTimeoutMap;  // locked internally
-
     MonitorThread mMonitorThread{mTimeoutQueue};  // This should be initialized last because
                                                   // the thread is launched immediately.
                                                   // Locked internally.
@@ -16,6 +16,7 @@
 
 #include <chrono>
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <mediautils/TimerThread.h>
 
@@ -274,4 +275,33 @@ TEST(TimerThread, TrackedTasks) {
     ASSERT_EQ(4ul, countChars(thread.retiredToString(), REQUEST_START));
 }
 
+TEST(TimerThread, ConcurrentScheduleCancel) {
+    constexpr size_t kThreads = 8;
+    constexpr size_t kIterations = 10000;
+    TimerThread thread;
+    std::atomic<size_t> taskRan{};
+    std::atomic<size_t> cancelled{};
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j < kIterations; ++j) {
+                auto handle = thread.scheduleTask("Concurrent", [&taskRan](TimerThread::Handle) {
+                        ++taskRan; }, 10s, 1s);
+                auto tracked = thread.trackTask("Tracked");
+                if (thread.cancelTask(handle)) ++cancelled;
+                if (thread.cancelTask(tracked)) ++cancelled;
+                ASSERT_FALSE(thread.cancelTask(handle));  // handles are not reused.
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    ASSERT_EQ(2 * kThreads * kIterations, cancelled);
+    ASSERT_EQ(0ul, taskRan);
+    ASSERT_EQ(0ul, countChars(thread.pendingToString(), REQUEST_START));
+    ASSERT_EQ(16ul, countChars(thread.retiredToString(), REQUEST_START));
+    ASSERT_EQ(3ul, countChars(thread.retiredToString(3), REQUEST_START));
+}
+
 }  // namespace
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+
+#include <benchmark/benchmark.h>
+#include <mediautils/TimerThread.h>
+
+using namespace std::chrono_literals;
+using android::mediautils::TimerThread;
+
+// Shared by all the threads of a run, as TimeCheck shares one TimerThread.
+static TimerThread& getTimerThread() {
+    static TimerThread timerThread;
+    return timerThread;
+}
+
+// Schedule and cancel pairs, as done by a TimeCheck for each binder call that
+// completes in time.
+static void BM_ScheduleCancel(benchmark::State& state) {
+    TimerThread& timerThread = getTimerThread();
+    for (auto _ : state) {
+        const auto handle = timerThread.scheduleTask("IAudioFlinger::createTrack",
+                [](TimerThread::Handle) {}, 10s /* timeoutDuration */,
+                2s /* secondChanceDuration */);
+        if (!timerThread.cancelTask(handle)) {
+            state.SkipWithError("cancel failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScheduleCancel)->ThreadRange(1, 16)->UseRealTime();
+
+// Track and cancel pairs, as done by a TimeCheck without a timeout.
+static void BM_TrackCancel(benchmark::State& state) {
+    TimerThread& timerThread = getTimerThread();
+    for (auto _ : state) {
+        const auto handle = timerThread.trackTask("IAudioFlinger::getParameters");
+        if (!timerThread.cancelTask(handle)) {
+            state.SkipWithError("cancel failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TrackCancel)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
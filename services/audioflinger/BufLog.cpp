@@ -117,6 +117,7 @@ BufLogStream::BufLogStream(unsigned int id,
                 mSamplingRate(samplingRate), mMaxBytes(maxBytes) {
     mByteCount = 0;
     mPaused = false;
+    mClosed = false;
     if (tag != NULL) {
         (void)audio_utils_strlcpy(mTag, tag);
     } else {
@@ -134,52 +135,72 @@ BufLogStream::BufLogStream(unsigned int id,
     localtime_r(&tv.tv_sec, &tm);
     strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &tm);
     char logPath[BUFLOG_MAX_PATH_SIZE];
-    snprintf(logPath, BUFLOG_MAX_PATH_SIZE, "%s/%s_%d_%s_%d_%d_%d.raw", BUFLOG_BASE_PATH, timeStr,
-            mId, mTag, mFormat, mChannels, mSamplingRate);
+    snprintf(logPath, BUFLOG_MAX_PATH_SIZE, "%s/%s_%d_%s_%d_%d_%d.afcap", BUFLOG_BASE_PATH,
+            timeStr, mId, mTag, mFormat, mChannels, mSamplingRate);
     ALOGV("data output: %s", logPath);
 
-    mFile = fopen(logPath, "wb");
-    if (mFile != NULL) {
-        ALOGV("Success creating file at: %p", mFile);
+    mCapture = std::make_unique<android::audioflinger::AudioCaptureWriter>(
+            mSamplingRate, mChannels, (audio_format_t)mFormat);
+    const android::status_t status = mCapture->start(logPath);
+    if (status == android::NO_ERROR) {
+        ALOGV("Success creating file at: %s", logPath);
     } else {
-        ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
+        ALOGE("Error: could not create file BufLogStream %s", strerror(-status));
+        mCapture.reset();
+        mClosed = true;
     }
 }
 
-void BufLogStream::closeStream_l() {
+void BufLogStream::closeStream() {
     ALOGV("Closing BufLogStream id:%d tag:%s", mId, mTag);
-    if (mFile != NULL) {
-        fclose(mFile);
-        mFile = NULL;
+    std::unique_ptr<android::audioflinger::AudioCaptureWriter> capture;
+    {
+        android::Mutex::Autolock autoLock(mLock);
+        mClosed = true;
+        capture = std::move(mCapture);
+    }
+    // stop() flushes the capture and joins the writer thread, so it is called without mLock
+    // to not block an audio thread in write().
+    if (capture != nullptr) {
+        ALOGW_IF(capture->droppedFrames() > 0, "BufLogStream id:%d tag:%s dropped %llu frames",
+                mId, mTag, (unsigned long long)capture->droppedFrames());
+        (void)capture->stop();
     }
 }
 
 BufLogStream::~BufLogStream() {
     ALOGV("Destroying BufLogStream id:%d tag:%s", mId, mTag);
-    android::Mutex::Autolock autoLock(mLock);
-    closeStream_l();
+    closeStream();
 }
 
 size_t BufLogStream::write(const void *buf, size_t size) {
 
     size_t bytes = 0;
-    if (!mPaused && mFile != NULL) {
+    if (!mPaused) {
         if (size > 0 && buf != NULL) {
             android::Mutex::Autolock autoLock(mLock);
+            if (mClosed) { // full, or closed by finalize()
+                return 0;
+            }
+            const size_t frameSize = mCapture->frameSize();
             if (mMaxBytes > 0) {
                 size = MIN(size, mMaxBytes - mByteCount);
             }
-            bytes = fwrite(buf, 1, size, mFile);
+            const size_t frames = size / frameSize;
+            if (mCapture->write(buf, frames)) {
+                bytes = frames * frameSize;
+            }
             mByteCount += bytes;
-            if (mMaxBytes > 0 && mMaxBytes == mByteCount) {
-                closeStream_l();
+            if (mMaxBytes > 0 && mMaxBytes - mByteCount < frameSize) {
+                // The writer thread keeps writing out the capture; the writer is stopped by
+                // finalize() or the destructor, not on the audio thread.
+                mClosed = true;
             }
         }
         ALOGV("wrote %zu/%zu bytes to BufLogStream %d tag:%s. Total Bytes: %zu", bytes, size, mId,
                 mTag, mByteCount);
     } else {
-        ALOGV("Warning: trying to write to %s BufLogStream id:%d tag:%s",
-                mPaused ? "paused" : "closed", mId, mTag);
+        ALOGV("Warning: trying to write to paused BufLogStream id:%d tag:%s", mId, mTag);
     }
     return bytes;
 }
@@ -191,6 +212,5 @@ bool BufLogStream::setPause(bool pause) {
 }
 
 void BufLogStream::finalize() {
-    android::Mutex::Autolock autoLock(mLock);
-    closeStream_l();
+    closeStream();
 }
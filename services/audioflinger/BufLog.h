@@ -21,7 +21,13 @@
  * BUFLOG creates up to BUFLOG_MAXSTREAMS simultaneous streams [0:15] of audio buffer data
  * and saves them to disk. The files are stored in the path specified in BUFLOG_BASE_PATH and
  * are named following this format:
- *   YYYYMMDDHHMMSS_id_format_channels_samplingrate.raw
+ *   YYYYMMDDHHMMSS_id_tag_format_channels_samplingrate.afcap
+ *
+ * The files are audio captures, see capture/AudioCaptureFormat.h: each buffer is stored with
+ * its timestamp and the id of the thread writing it. Buffers are copied into a ring and written
+ * to disk by a background thread, so BUFLOG does not block the audio thread on file I/O; if the
+ * ring overflows, the dropped frames are recorded in the file.
+ * They can be mixed back with the audiocapture_replay tool.
  *
  * Normally we strip BUFLOG dumps from release builds.
  * You can modify this (for example with "#define BUFLOG_NDEBUG 0"
@@ -100,9 +106,11 @@
 #endif
 
 
+#include <memory>
 #include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include <capture/AudioCaptureWriter.h>
 #include <utils/Mutex.h>
 
 //BufLog configuration
@@ -122,7 +130,8 @@ public:
 
     // write buffer to stream
     //  buf:  pointer to buffer
-    //  size: number of bytes to write
+    //  size: number of bytes to write, rounded down to whole frames
+    //  return value: number of bytes written, 0 if dropped as the capture ring is full.
     size_t          write(const void *buf, size_t size);
 
     // pause/resume stream
@@ -132,10 +141,13 @@ public:
 
     // will stop the stream and close any open file
     // the stream can't be reopen. Instead, a new stream (and file) should be created.
+    // A stream that reached maxBytes stops accepting writes, but its file is only completed
+    // here or when the stream is destroyed. Not to be called from an audio thread.
     void            finalize();
 
 private:
     bool                mPaused;
+    bool                mClosed;    // guarded by mLock
     const unsigned int  mId;
     char                mTag[BUFLOGSTREAM_MAX_TAGSIZE + 1];
     const unsigned int  mFormat;
@@ -143,10 +155,10 @@ private:
     const unsigned int  mSamplingRate;
     const size_t        mMaxBytes;
     size_t              mByteCount;
-    FILE                *mFile;
+    std::unique_ptr<android::audioflinger::AudioCaptureWriter> mCapture;
     mutable android::Mutex mLock;
 
-    void            closeStream_l();
+    void            closeStream();
 };
 
 
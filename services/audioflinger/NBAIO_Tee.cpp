@@ -50,6 +50,8 @@ namespace android {
 
  where Reason = [ DTOR | DUMP | REMOVE ]
 
+ Streamed tees (af.tee.stream) are named alike, without Reason, with the .afcap extension.
+
  Examples:
   aftee_20180424_153811_038_13_57_2_T_REMOVE.wav
   aftee_20180424_153811_218_13_57_2_T_REMOVE.wav
@@ -63,8 +65,23 @@ namespace android {
 
 static constexpr char DEFAULT_PREFIX[] = "aftee_";
 static constexpr char DEFAULT_DIRECTORY[] = "/data/misc/audioserver";
+static constexpr char CAPTURE_EXTENSION[] = ".afcap";
 static constexpr size_t DEFAULT_THREADPOOL_SIZE = 8;
 
+/** returns the current date as YYYYmmdd_HHMMSS_MSEC for generated filenames. */
+static std::string generateFileTime() {
+    char fileTime[sizeof("YYYYmmdd_HHMMSS_\0")];
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    struct tm tm;
+    localtime_r(&tv.tv_sec, &tm);
+    LOG_ALWAYS_FATAL_IF(strftime(fileTime, sizeof(fileTime), "%Y%m%d_%H%M%S_", &tm) == 0,
+        "incorrect fileTime buffer");
+    char msec[4];
+    (void)snprintf(msec, sizeof(msec), "%03d", (int)(tv.tv_usec / 1000));
+    return std::string(fileTime) + msec;
+}
+
 /** AudioFileHandler manages temporary audio wav files with a least recently created
     retention policy.
 
@@ -121,16 +138,7 @@ private:
     }
 
     std::string generateFilename(const std::string &suffix) const {
-        char fileTime[sizeof("YYYYmmdd_HHMMSS_\0")];
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        struct tm tm;
-        localtime_r(&tv.tv_sec, &tm);
-        LOG_ALWAYS_FATAL_IF(strftime(fileTime, sizeof(fileTime), "%Y%m%d_%H%M%S_", &tm) == 0,
-            "incorrect fileTime buffer");
-        char msec[4];
-        (void)snprintf(msec, sizeof(msec), "%03d", (int)(tv.tv_usec / 1000));
-        return mPrefix + fileTime + msec + suffix + ".wav";
+        return mPrefix + generateFileTime() + suffix + ".wav";
     }
 
     bool isManagedFilename(const char *name) {
@@ -222,6 +230,18 @@ void NBAIO_Tee::NBAIO_TeeImpl::dumpTee(
     }
 }
 
+void NBAIO_Tee::NBAIO_TeeImpl::startCapture_l()
+{
+    if (mCapture->isStarted()) return;
+
+    // Streamed captures are not managed by the AudioFileHandler retention policy,
+    // streaming is enabled explicitly and the files are expected to be pulled.
+    const std::string path = std::string(DEFAULT_DIRECTORY) + "/" + DEFAULT_PREFIX
+            + generateFileTime() + mId + CAPTURE_EXTENSION;
+    const status_t status = mCapture->start(path);
+    ALOGW_IF(status != NO_ERROR, "%s: cannot stream to %s: %d", __func__, path.c_str(), status);
+}
+
 /* static */
 NBAIO_Tee::NBAIO_TeeImpl::NBAIO_SinkSource NBAIO_Tee::NBAIO_TeeImpl::makeSinkSource(
         const NBAIO_Format &format, size_t frames, bool *enabled)
@@ -24,6 +24,7 @@
 #include <mutex>
 #include <set>
 
+#include <capture/AudioCaptureWriter.h>
 #include <cutils/properties.h>
 #include <media/nbaio/NBAIO.h>
 
@@ -58,6 +59,10 @@ namespace android {
  *    WAV integer PCM 32 bit for AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_24_BIT_PACKED
  *                               AUDIO_FORMAT_PCM_32_BIT.
  *    WAV float PCM 32 bit for AUDIO_FORMAT_PCM_FLOAT.
+ * 4) If the af.tee.stream property is also set, Tees do not keep the last DEFAULT_TEE_FRAMES
+ *    in memory, but stream all data written, with a timestamp and thread id per buffer,
+ *    to an audio capture file (.afcap) once the Tee id is set.
+ *    See capture/AudioCaptureFormat.h and the audiocapture_replay tool.
  *
  * Input_Thread:
  * 1) Capture buffer is teed when read from the HAL, before resampling for the AudioRecord
@@ -181,6 +186,8 @@ private:
         status_t set(const NBAIO_Format &format, TEE_FLAG flags, size_t frames) {
             static const int teeConfig = property_get_bool("ro.debuggable", false)
                    ? property_get_int32("af.tee", 0) : 0;
+            static const bool teeStream = teeConfig != 0
+                   && property_get_bool("af.tee.stream", false);
 
             // check the type of Tee
             const TEE_FLAG type = TEE_FLAG(
@@ -209,6 +216,25 @@ private:
                 return NO_ERROR;
             }
 
+            if (teeStream) {
+                if (!Format_isValid(format) || !audio_is_linear_pcm(format.mFormat)) {
+                    return BAD_VALUE;
+                }
+                auto capture = std::make_shared<audioflinger::AudioCaptureWriter>(
+                        Format_sampleRate(format), Format_channelCount(format), format.mFormat);
+                std::lock_guard<std::mutex> _l(mLock);
+                mFlags = flags;
+                mFormat = format;
+                mFrames = frames;
+                mSinkSource = {};
+                mCapture = std::move(capture);
+                if (!mId.empty()) {
+                    startCapture_l();
+                }
+                mEnabled.store(true);
+                return NO_ERROR;
+            }
+
             bool enabled = false;
             auto sinksource = makeSinkSource(format, frames, &enabled);
 
@@ -230,23 +256,41 @@ private:
         void setId(const std::string &id) {
             std::lock_guard<std::mutex> _l(mLock);
             mId = id;
+            if (mCapture != nullptr) {
+                startCapture_l();
+            }
         }
 
         void dump(int fd, const std::string &reason) {
             if (!mDataReady.exchange(false)) return;
             std::string suffix;
             NBAIO_SinkSource sinkSource;
+            std::shared_ptr<audioflinger::AudioCaptureWriter> capture;
             {
                 std::lock_guard<std::mutex> _l(mLock);
                 suffix = mId + reason;
                 sinkSource = mSinkSource;
+                capture = mCapture;
+                if (capture != nullptr && !capture->isStarted()) {
+                    startCapture_l(); // no id was set, start so that data is not dropped.
+                }
+            }
+            if (capture != nullptr) {
+                if (fd >= 0 && capture->isStarted()) {
+                    dprintf(fd, "tee streaming to %s\n", capture->path().c_str());
+                }
+                return;
             }
             dumpTee(fd, sinkSource, suffix);
         }
 
         void write(const void *buffer, size_t frameCount) {
             if (!mEnabled.load() || frameCount == 0) return;
-            (void)mSinkSource.first->write(buffer, frameCount);
+            if (mCapture != nullptr) {
+                (void)mCapture->write(buffer, frameCount);
+            } else {
+                (void)mSinkSource.first->write(buffer, frameCount);
+            }
             mDataReady.store(true);
         }
 
@@ -260,6 +304,9 @@ private:
         static NBAIO_SinkSource makeSinkSource(
                 const NBAIO_Format &format, size_t frames, bool *enabled);
 
+        // Starts streaming mCapture to a file named after mId, if not already started.
+        void startCapture_l(); // REQUIRES(mLock)
+
         // 0x200000 stereo 16-bit PCM frames = 47.5 seconds at 44.1 kHz, 8 megabytes
         static constexpr size_t DEFAULT_TEE_FRAMES = 0x200000;
 
@@ -274,6 +321,8 @@ private:
         NBAIO_Format mFormat = Format_Invalid;                   // GUARDED_BY(mLock)
         size_t mFrames = 0;                                      // GUARDED_BY(mLock)
         NBAIO_SinkSource mSinkSource;                            // GUARDED_BY(mLock)
+        // set if streaming, instead of mSinkSource
+        std::shared_ptr<audioflinger::AudioCaptureWriter> mCapture; // GUARDED_BY(mLock)
     };
 
     /** RunningTees tracks current running tees for dump purposes.
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace android::audioflinger {
+
+/**
+ * Layout of an audio capture file (".afcap"), as written by AudioCaptureWriter.
+ *
+ * The file starts with an AudioCaptureFileHeader, followed by the captured buffers in the order
+ * they were written. Each buffer is an AudioCaptureRecordHeader followed by
+ * frameCount * frameSize bytes of audio data, in the format of the file header.
+ *
+ * Fields are in the native byte order, little-endian on all Android ABIs.
+ */
+
+constexpr char kAudioCaptureMagic[8] = {'A', 'F', 'C', 'A', 'P', 'T', 'U', 'R'};
+constexpr uint32_t kAudioCaptureVersion = 1;
+
+struct AudioCaptureFileHeader {
+    char magic[8];          // kAudioCaptureMagic
+    uint32_t version;       // kAudioCaptureVersion
+    uint32_t headerSize;    // sizeof(AudioCaptureFileHeader), records start at this offset
+    uint32_t sampleRate;
+    uint32_t channelCount;
+    uint32_t format;        // audio_format_t
+    uint32_t frameSize;     // in bytes
+};
+
+static_assert(sizeof(AudioCaptureFileHeader) == 32);
+
+struct AudioCaptureRecordHeader {
+    int64_t timestampNs;    // CLOCK_MONOTONIC when the buffer was written
+    int32_t tid;            // thread writing the buffer
+    uint32_t frameCount;    // frames of data following this header
+    uint32_t droppedFrames; // frames dropped since the previous record, the ring was full
+    uint32_t reserved;
+};
+
+static_assert(sizeof(AudioCaptureRecordHeader) == 24);
+
+} // namespace android::audioflinger
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioCaptureReader"
+//#define LOG_NDEBUG 0
+
+#include "AudioCaptureReader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+namespace android::audioflinger {
+
+status_t AudioCaptureReader::open(const std::string &path)
+{
+    mFile.reset(fopen(path.c_str(), "rbe"));
+    if (mFile == nullptr) {
+        return -errno;
+    }
+    AudioCaptureFileHeader header;
+    if (fread(&header, sizeof(header), 1, mFile.get()) != 1
+            || memcmp(header.magic, kAudioCaptureMagic, sizeof(header.magic)) != 0) {
+        ALOGW("%s: %s is not an audio capture", __func__, path.c_str());
+        mFile.reset();
+        return BAD_VALUE;
+    }
+    if (header.version != kAudioCaptureVersion || header.headerSize < sizeof(header)
+            || header.frameSize == 0
+            || fseek(mFile.get(), header.headerSize, SEEK_SET) != 0) {
+        ALOGW("%s: %s: unsupported version %u", __func__, path.c_str(), header.version);
+        mFile.reset();
+        return BAD_VALUE;
+    }
+    if (header.sampleRate == 0 || header.channelCount == 0) {
+        ALOGW("%s: %s: invalid sample rate %u or channel count %u",
+                __func__, path.c_str(), header.sampleRate, header.channelCount);
+        mFile.reset();
+        return BAD_VALUE;
+    }
+    mHeader = header;
+    return NO_ERROR;
+}
+
+status_t AudioCaptureReader::read(AudioCaptureRecordHeader *record, std::vector<uint8_t> *data)
+{
+    if (mFile == nullptr) {
+        return NO_INIT;
+    }
+    const size_t read = fread(record, 1, sizeof(*record), mFile.get());
+    // A zero frame count is the padding of a capture which was not truncated to size.
+    if (read == 0 || (read == sizeof(*record) && record->frameCount == 0)) {
+        return NOT_ENOUGH_DATA;
+    }
+    if (read != sizeof(*record)) {
+        return BAD_VALUE;
+    }
+    data->resize(static_cast<size_t>(record->frameCount) * mHeader.frameSize);
+    if (fread(data->data(), 1, data->size(), mFile.get()) != data->size()) {
+        return BAD_VALUE;
+    }
+    return NO_ERROR;
+}
+
+} // namespace android::audioflinger
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <utils/Errors.h>
+
+#include "AudioCaptureFormat.h"
+
+namespace android::audioflinger {
+
+/**
+ * AudioCaptureReader reads back the records of an audio capture file written by
+ * AudioCaptureWriter, in order.
+ *
+ * This class is thread-compatible, but not thread-safe.
+ */
+class AudioCaptureReader {
+public:
+    /**
+     * \return
+     *         - NO_ERROR on success.
+     *         - BAD_VALUE if the file is not an audio capture, of an unsupported version, or
+     *           has a zero sample rate or channel count.
+     *         - the negative errno if the file cannot be opened.
+     */
+    status_t open(const std::string &path);
+
+    const AudioCaptureFileHeader &header() const { return mHeader; }
+
+    /**
+     * \brief Reads the next record.
+     *
+     * \param record  the record header.
+     * \param data    resized to the record audio data, record->frameCount * frameSize bytes.
+     * \return
+     *         - NO_ERROR on success.
+     *         - NOT_ENOUGH_DATA at the end of the capture.
+     *         - BAD_VALUE if the record is truncated, e.g. the capture was not stopped.
+     *         - NO_INIT if not opened.
+     */
+    status_t read(AudioCaptureRecordHeader *record, std::vector<uint8_t> *data);
+
+private:
+    std::unique_ptr<FILE, decltype(&fclose)> mFile{nullptr, fclose};
+    AudioCaptureFileHeader mHeader{};
+};
+
+} // namespace android::audioflinger
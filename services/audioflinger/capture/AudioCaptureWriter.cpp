@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioCaptureWriter"
+//#define LOG_NDEBUG 0
+
+#include "AudioCaptureWriter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/threads.h>
+#include <utils/Log.h>
+#include <utils/ThreadDefs.h>
+#include <utils/Timers.h>
+
+#ifdef __ANDROID__
+#include <utils/AndroidThreads.h>
+#endif
+
+namespace android::audioflinger {
+
+namespace {
+
+// O_DIRECT requires the buffers written to be aligned, use the largest page size in use.
+constexpr size_t kBlockAlignment = 4096;
+
+static_assert(AudioCaptureWriter::kBlockSize % kBlockAlignment == 0);
+
+size_t roundUpToPowerOf2(size_t size) {
+    size_t result = 1;
+    while (result < size) result <<= 1;
+    return result;
+}
+
+AudioCaptureFileHeader makeHeader(
+        uint32_t sampleRate, uint32_t channelCount, audio_format_t format) {
+    AudioCaptureFileHeader header{};
+    memcpy(header.magic, kAudioCaptureMagic, sizeof(header.magic));
+    header.version = kAudioCaptureVersion;
+    header.headerSize = sizeof(AudioCaptureFileHeader);
+    header.sampleRate = sampleRate;
+    header.channelCount = channelCount;
+    header.format = format;
+    // Formats without a frame size are captured byte by byte.
+    header.frameSize = audio_has_proportional_frames(format)
+            ? std::max<size_t>(audio_bytes_per_frame(channelCount, format), 1) : 1;
+    return header;
+}
+
+int openCaptureFile(const std::string &path) {
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    const int fd = open(path.c_str(), flags | O_DIRECT, 0644);
+    // Some file systems, e.g. tmpfs, don't support O_DIRECT.
+    if (fd >= 0 || errno != EINVAL) return fd;
+#endif
+    return open(path.c_str(), flags, 0644);
+}
+
+} // namespace
+
+AudioCaptureWriter::AudioCaptureWriter(uint32_t sampleRate, uint32_t channelCount,
+        audio_format_t format, size_t ringSize)
+    : mHeader(makeHeader(sampleRate, channelCount, format))
+    , mFrameSize(mHeader.frameSize)
+    , mRingSize(roundUpToPowerOf2(ringSize))
+    , mRing(new uint8_t[mRingSize])
+{
+}
+
+AudioCaptureWriter::~AudioCaptureWriter()
+{
+    (void)stop();
+}
+
+status_t AudioCaptureWriter::start(const std::string &path)
+{
+    std::lock_guard<std::mutex> _l(mLock);
+    if (mStarted.load() || mStopping) {
+        return INVALID_OPERATION;
+    }
+
+    void *block = nullptr;
+    if (posix_memalign(&block, kBlockAlignment, kBlockSize) != 0) {
+        return NO_MEMORY;
+    }
+    mBlock.reset(static_cast<uint8_t *>(block));
+
+    mFd = openCaptureFile(path);
+    if (mFd < 0) {
+        const status_t status = -errno;
+        ALOGW("%s: cannot create %s: %s", __func__, path.c_str(), strerror(errno));
+        mBlock.reset();
+        return status;
+    }
+
+    memcpy(mBlock.get(), &mHeader, sizeof(mHeader));
+    mBlockFill = sizeof(mHeader);
+    mFileSize = sizeof(mHeader);
+    mPath = path;
+    mThread = std::thread([this] { threadLoop(); });
+    mStarted.store(true);
+    ALOGV("%s: capturing to %s", __func__, path.c_str());
+    return NO_ERROR;
+}
+
+bool AudioCaptureWriter::write(const void *buffer, size_t frameCount)
+{
+    if (frameCount == 0) return true;
+
+    const size_t dataSize = frameCount * mFrameSize;
+    const size_t recordSize = sizeof(AudioCaptureRecordHeader) + dataSize;
+    const uint64_t rear = mRear.load(std::memory_order_relaxed);
+    const uint64_t front = mFront.load(std::memory_order_acquire);
+    if (frameCount > UINT32_MAX || recordSize > mRingSize - (rear - front)) {
+        mPendingDroppedFrames += frameCount;
+        mDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        return false;
+    }
+
+    const AudioCaptureRecordHeader header{
+        .timestampNs = systemTime(SYSTEM_TIME_MONOTONIC),
+        .tid = static_cast<int32_t>(base::GetThreadId()),
+        .frameCount = static_cast<uint32_t>(frameCount),
+        .droppedFrames = mPendingDroppedFrames,
+        .reserved = 0,
+    };
+    copyIn(rear, &header, sizeof(header));
+    copyIn(rear + sizeof(header), buffer, dataSize);
+    mPendingDroppedFrames = 0;
+    mRear.store(rear + recordSize, std::memory_order_release);
+    return true;
+}
+
+status_t AudioCaptureWriter::stop()
+{
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (mStopping) return mStatus;
+        mStopping = true;
+        thread = std::move(mThread);
+        mCondition.notify_all();
+    }
+    if (!thread.joinable()) {
+        return NO_ERROR; // never started
+    }
+    thread.join(); // the thread flushes the capture before exiting.
+
+    close(mFd);
+    mFd = -1;
+    mBlock.reset();
+    ALOGV("%s: %s: %llu bytes, %llu frames dropped", __func__, mPath.c_str(),
+            (unsigned long long)mFileSize, (unsigned long long)droppedFrames());
+    return mStatus;
+}
+
+std::string AudioCaptureWriter::path() const
+{
+    std::lock_guard<std::mutex> _l(mLock);
+    return mPath;
+}
+
+void AudioCaptureWriter::threadLoop()
+{
+#ifdef __ANDROID__
+    androidSetThreadPriority(0 /* tid */, ANDROID_PRIORITY_BACKGROUND);
+#endif
+    std::unique_lock<std::mutex> l(mLock);
+    while (!mStopping) {
+        mCondition.wait_for(l, kWritePeriod);
+        l.unlock();
+        drain(false /* flush */);
+        l.lock();
+    }
+    l.unlock();
+    drain(true /* flush */);
+}
+
+void AudioCaptureWriter::drain(bool flush)
+{
+    const uint64_t rear = mRear.load(std::memory_order_acquire);
+    uint64_t front = mFront.load(std::memory_order_relaxed);
+    while (front < rear) {
+        const size_t size = std::min<uint64_t>(rear - front, kBlockSize - mBlockFill);
+        copyOut(front, mBlock.get() + mBlockFill, size);
+        mBlockFill += size;
+        mFileSize += size;
+        front += size;
+        // Free the ring space as soon as possible.
+        mFront.store(front, std::memory_order_release);
+        if (mBlockFill == kBlockSize) {
+            writeBlock();
+        }
+    }
+
+    if (flush && mBlockFill > 0) {
+        // O_DIRECT only writes whole blocks, pad and cut the file to size.
+        memset(mBlock.get() + mBlockFill, 0, kBlockSize - mBlockFill);
+        writeBlock();
+        if (ftruncate(mFd, mFileSize) != 0 && mStatus == NO_ERROR) {
+            mStatus = -errno;
+            ALOGW("%s: cannot truncate %s: %s", __func__, mPath.c_str(), strerror(errno));
+        }
+    }
+}
+
+void AudioCaptureWriter::writeBlock()
+{
+    // After an error, keep draining the ring so that write() does not drop all buffers.
+    for (size_t written = 0; mStatus == NO_ERROR && written < kBlockSize;) {
+        const ssize_t result = ::write(mFd, mBlock.get() + written, kBlockSize - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            mStatus = -errno;
+            ALOGW("%s: cannot write %s: %s", __func__, mPath.c_str(), strerror(errno));
+            break;
+        }
+        written += result;
+    }
+    mBlockFill = 0;
+}
+
+void AudioCaptureWriter::copyIn(uint64_t position, const void *data, size_t size)
+{
+    const size_t offset = position & (mRingSize - 1);
+    const size_t firstPart = std::min(size, mRingSize - offset);
+    memcpy(mRing.get() + offset, data, firstPart);
+    memcpy(mRing.get(), static_cast<const uint8_t *>(data) + firstPart, size - firstPart);
+}
+
+void AudioCaptureWriter::copyOut(uint64_t position, void *data, size_t size) const
+{
+    const size_t offset = position & (mRingSize - 1);
+    const size_t firstPart = std::min(size, mRingSize - offset);
+    memcpy(data, mRing.get() + offset, firstPart);
+    memcpy(static_cast<uint8_t *>(data) + firstPart, mRing.get(), size - firstPart);
+}
+
+} // namespace android::audioflinger
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <system/audio.h>
+#include <utils/Errors.h>
+
+#include "AudioCaptureFormat.h"
+
+namespace android::audioflinger {
+
+/**
+ * AudioCaptureWriter streams audio buffers to an audio capture file (see AudioCaptureFormat.h)
+ * without blocking the thread producing them.
+ *
+ * write() copies the buffer, with its timestamp and thread id, into a lock-free ring and returns;
+ * it makes no system call and takes no lock, so it may be called from a fast thread. If the ring
+ * is full the buffer is dropped, and the count of dropped frames is recorded with the next buffer.
+ *
+ * A background priority thread wakes up periodically to move the ring content into blocks of
+ * kBlockSize bytes, written to the file with O_DIRECT where supported so that the capture does
+ * not fill the page cache.
+ *
+ * write() must not be called concurrently with itself. The other methods may be called from
+ * any thread.
+ */
+class AudioCaptureWriter {
+public:
+    static constexpr size_t kDefaultRingSize = 1 << 20; // bytes
+    static constexpr size_t kBlockSize = 1 << 16;       // bytes, a multiple of the page size
+    static constexpr std::chrono::milliseconds kWritePeriod{20};
+
+    /**
+     * \param ringSize in bytes, rounded up to a power of 2. It must hold the buffers written
+     *                 during kWritePeriod, plus the time for the writer thread to run.
+     */
+    AudioCaptureWriter(uint32_t sampleRate, uint32_t channelCount, audio_format_t format,
+            size_t ringSize = kDefaultRingSize);
+
+    /** Stops the writer if started, see stop(). */
+    ~AudioCaptureWriter();
+
+    /**
+     * \brief Creates the file at path and starts the writer thread.
+     *
+     * Buffers written before start() are kept in the ring and written to the file.
+     *
+     * \return
+     *         - NO_ERROR on success.
+     *         - INVALID_OPERATION if already started.
+     *         - the negative errno if the file cannot be created.
+     */
+    status_t start(const std::string &path);
+
+    /**
+     * \brief Writes buffer to the capture.
+     *
+     * \param buffer      frameCount frames in the format passed to the constructor.
+     * \param frameCount  number of frames.
+     * \return true if written, false if dropped.
+     */
+    bool write(const void *buffer, size_t frameCount);
+
+    /**
+     * \brief Writes out all buffers written, closes the file and stops the writer thread.
+     *
+     * The writer cannot be restarted.
+     *
+     * \return NO_ERROR, or the first error writing to the file.
+     */
+    status_t stop();
+
+    bool isStarted() const { return mStarted.load(); }
+
+    /** Returns the path passed to start(), or an empty string. */
+    std::string path() const;
+
+    /** Returns the total number of frames dropped as the ring was full. */
+    uint64_t droppedFrames() const { return mDroppedFrames.load(std::memory_order_relaxed); }
+
+    size_t frameSize() const { return mFrameSize; }
+
+private:
+    void threadLoop();
+
+    // Moves the ring content into mBlock, writing each block filled.
+    // With flush, also writes the last partial block and sets the final file size.
+    void drain(bool flush);
+
+    void writeBlock();
+
+    void copyIn(uint64_t position, const void *data, size_t size);
+    void copyOut(uint64_t position, void *data, size_t size) const;
+
+    const AudioCaptureFileHeader mHeader;
+    const size_t mFrameSize;
+    const size_t mRingSize;
+    const std::unique_ptr<uint8_t[]> mRing;
+
+    // Positions in bytes since the start of the capture, the ring holds [mFront, mRear).
+    std::atomic<uint64_t> mRear{0};  // advanced by write()
+    std::atomic<uint64_t> mFront{0}; // advanced by the writer thread
+    uint32_t mPendingDroppedFrames = 0; // accessed by write() only
+    std::atomic<uint64_t> mDroppedFrames{0};
+    std::atomic<bool> mStarted{false};
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    std::string mPath;      // GUARDED_BY(mLock)
+    bool mStopping = false; // GUARDED_BY(mLock)
+    std::thread mThread;    // GUARDED_BY(mLock)
+
+    // Accessed by the writer thread, or by start() and stop() when it does not run.
+    int mFd = -1;
+    std::unique_ptr<uint8_t, decltype(&free)> mBlock{nullptr, free};
+    size_t mBlockFill = 0;  // bytes of mBlock in use
+    uint64_t mFileSize = 0; // bytes of the capture handed over to mBlock
+    status_t mStatus = NO_ERROR;
+};
+
+} // namespace android::audioflinger
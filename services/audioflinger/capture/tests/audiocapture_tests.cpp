@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "audiocapture_tests"
+
+#include "../AudioCaptureReader.h"
+#include "../AudioCaptureWriter.h"
+
+#include <numeric>
+#include <thread>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+using namespace android;
+using namespace android::audioflinger;
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+constexpr uint32_t kChannelCount = 2;
+constexpr size_t kFrameCount = 240; // 5 ms
+
+std::vector<int16_t> makeBuffer(int16_t first) {
+    std::vector<int16_t> buffer(kFrameCount * kChannelCount);
+    std::iota(buffer.begin(), buffer.end(), first);
+    return buffer;
+}
+
+TEST(AudioCaptureTest, WriteAndReadBack) {
+    TemporaryFile file;
+    AudioCaptureWriter writer(kSampleRate, kChannelCount, AUDIO_FORMAT_PCM_16_BIT);
+    ASSERT_EQ(kChannelCount * sizeof(int16_t), writer.frameSize());
+
+    // Buffers written before start() are kept.
+    ASSERT_TRUE(writer.write(makeBuffer(0).data(), kFrameCount));
+    ASSERT_EQ(NO_ERROR, writer.start(file.path));
+    EXPECT_EQ(INVALID_OPERATION, writer.start(file.path));
+    EXPECT_EQ(file.path, writer.path());
+
+    // Spans several blocks, and wraps around the ring.
+    constexpr size_t kBufferCount = 400;
+    for (size_t i = 1; i < kBufferCount; ++i) {
+        ASSERT_TRUE(writer.write(makeBuffer(i).data(), kFrameCount));
+        if (i % 8 == 0) {
+            std::this_thread::sleep_for(AudioCaptureWriter::kWritePeriod);
+        }
+    }
+    ASSERT_EQ(NO_ERROR, writer.stop());
+    EXPECT_EQ(0u, writer.droppedFrames());
+
+    AudioCaptureReader reader;
+    ASSERT_EQ(NO_ERROR, reader.open(file.path));
+    EXPECT_EQ(kSampleRate, reader.header().sampleRate);
+    EXPECT_EQ(kChannelCount, reader.header().channelCount);
+    EXPECT_EQ(AUDIO_FORMAT_PCM_16_BIT, reader.header().format);
+
+    AudioCaptureRecordHeader record;
+    std::vector<uint8_t> data;
+    int64_t previousTimestampNs = 0;
+    for (size_t i = 0; i < kBufferCount; ++i) {
+        ASSERT_EQ(NO_ERROR, reader.read(&record, &data)) << i;
+        EXPECT_EQ(kFrameCount, record.frameCount);
+        EXPECT_EQ(0u, record.droppedFrames);
+        EXPECT_EQ(gettid(), record.tid);
+        EXPECT_LE(previousTimestampNs, record.timestampNs);
+        previousTimestampNs = record.timestampNs;
+        const std::vector<int16_t> expected = makeBuffer(i);
+        ASSERT_EQ(expected.size() * sizeof(int16_t), data.size());
+        ASSERT_EQ(0, memcmp(expected.data(), data.data(), data.size())) << i;
+    }
+    EXPECT_EQ(NOT_ENOUGH_DATA, reader.read(&record, &data));
+}
+
+TEST(AudioCaptureTest, RecordsDroppedFrames) {
+    TemporaryFile file;
+    const size_t recordSize =
+            sizeof(AudioCaptureRecordHeader) + kFrameCount * kChannelCount * sizeof(int16_t);
+    // The ring holds two buffers and the writer is not started, so the next ones are dropped.
+    AudioCaptureWriter writer(kSampleRate, kChannelCount, AUDIO_FORMAT_PCM_16_BIT,
+            2 * recordSize);
+    size_t written = 0;
+    while (writer.write(makeBuffer(written).data(), kFrameCount)) {
+        ++written;
+    }
+    ASSERT_GE(written, 2u);
+    ASSERT_FALSE(writer.write(makeBuffer(0).data(), kFrameCount));
+    EXPECT_EQ(2 * kFrameCount, writer.droppedFrames());
+
+    ASSERT_EQ(NO_ERROR, writer.start(file.path));
+    // Wait for the ring to be drained.
+    while (!writer.write(makeBuffer(written).data(), kFrameCount)) {
+        std::this_thread::sleep_for(AudioCaptureWriter::kWritePeriod);
+    }
+    ASSERT_EQ(NO_ERROR, writer.stop());
+
+    AudioCaptureReader reader;
+    ASSERT_EQ(NO_ERROR, reader.open(file.path));
+    AudioCaptureRecordHeader record;
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < written; ++i) {
+        ASSERT_EQ(NO_ERROR, reader.read(&record, &data));
+        EXPECT_EQ(0u, record.droppedFrames);
+    }
+    ASSERT_EQ(NO_ERROR, reader.read(&record, &data));
+    EXPECT_EQ(writer.droppedFrames(), record.droppedFrames);
+    EXPECT_EQ(NOT_ENOUGH_DATA, reader.read(&record, &data));
+}
+
+TEST(AudioCaptureTest, RejectsOtherFiles) {
+    TemporaryFile file;
+    ASSERT_TRUE(android::base::WriteStringToFile("RIFF\0\0\0\0WAVEfmt and more", file.path));
+    AudioCaptureReader reader;
+    EXPECT_EQ(BAD_VALUE, reader.open(file.path));
+
+    AudioCaptureRecordHeader record;
+    std::vector<uint8_t> data;
+    EXPECT_EQ(NO_INIT, reader.read(&record, &data));
+}
+
+TEST(AudioCaptureTest, RejectsZeroSampleRate) {
+    TemporaryFile file;
+    AudioCaptureFileHeader header = {};
+    memcpy(header.magic, kAudioCaptureMagic, sizeof(header.magic));
+    header.version = kAudioCaptureVersion;
+    header.headerSize = sizeof(header);
+    header.sampleRate = 0;
+    header.channelCount = kChannelCount;
+    header.format = AUDIO_FORMAT_PCM_16_BIT;
+    header.frameSize = kChannelCount * sizeof(int16_t);
+    ASSERT_TRUE(android::base::WriteStringToFile(
+            std::string(reinterpret_cast<const char *>(&header), sizeof(header)), file.path));
+    AudioCaptureReader reader;
+    EXPECT_EQ(BAD_VALUE, reader.open(file.path));
+}
+
+} // namespace
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays audio captures (.afcap), as streamed by the tee sink or BufLog, through AudioMixer.
+//
+// Each capture becomes a mixer track; dropped frames are replaced by silence so that the tracks
+// stay aligned. The mix is written to a WAV file, and the time spent in AudioMixer::process()
+// is reported, so that mixer changes can be evaluated on captured device traffic:
+//
+//   adb shell setprop af.tee 7 && adb shell setprop af.tee.stream 1
+//   ... play, then adb pull /data/misc/audioserver/aftee_<...>.afcap
+//   adb shell audiocapture_replay -o /data/local/tmp/mix.wav /data/local/tmp/*.afcap
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <audio_utils/sndfile.h>
+#include <media/AudioBufferProvider.h>
+#include <media/AudioMixer.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "../AudioCaptureReader.h"
+
+using namespace android;
+using namespace android::audioflinger;
+
+namespace {
+
+// An AudioBufferProvider over a capture loaded in memory.
+class CaptureProvider : public AudioBufferProvider {
+public:
+    status_t load(const char *path) {
+        AudioCaptureReader reader;
+        status_t status = reader.open(path);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        mHeader = reader.header();
+        AudioCaptureRecordHeader record;
+        std::vector<uint8_t> data;
+        int64_t previousTimestampNs = 0;
+        while ((status = reader.read(&record, &data)) == NO_ERROR) {
+            mData.insert(mData.end(), (size_t)record.droppedFrames * mHeader.frameSize, 0);
+            mData.insert(mData.end(), data.begin(), data.end());
+            if (mRecords > 0) {
+                mMaxGapNs = std::max(mMaxGapNs, record.timestampNs - previousTimestampNs);
+            }
+            previousTimestampNs = record.timestampNs;
+            mDroppedFrames += record.droppedFrames;
+            ++mRecords;
+        }
+        if (status == BAD_VALUE) {
+            fprintf(stderr, "%s: truncated record after %zu records, ignored\n", path, mRecords);
+        }
+        return NO_ERROR;
+    }
+
+    const AudioCaptureFileHeader &header() const { return mHeader; }
+    size_t frames() const { return mData.size() / mHeader.frameSize; }
+    size_t records() const { return mRecords; }
+    uint64_t droppedFrames() const { return mDroppedFrames; }
+    int64_t maxGapNs() const { return mMaxGapNs; }
+
+    // AudioBufferProvider
+    status_t getNextBuffer(Buffer *buffer) override {
+        const size_t frames = std::min(buffer->frameCount, this->frames() - mPosition);
+        buffer->frameCount = frames;
+        if (frames == 0) {
+            buffer->raw = nullptr;
+            return NOT_ENOUGH_DATA;
+        }
+        buffer->raw = mData.data() + mPosition * mHeader.frameSize;
+        return NO_ERROR;
+    }
+
+    void releaseBuffer(Buffer *buffer) override {
+        mPosition += buffer->frameCount;
+        buffer->raw = nullptr;
+        buffer->frameCount = 0;
+    }
+
+private:
+    AudioCaptureFileHeader mHeader{};
+    std::vector<uint8_t> mData;
+    size_t mPosition = 0; // in frames
+    size_t mRecords = 0;
+    uint64_t mDroppedFrames = 0;
+    int64_t mMaxGapNs = 0;
+};
+
+void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-c channels] [-s sample-rate] [-f frames] [-o <output-file>]"
+                    " <capture-file>+\n", name);
+    fprintf(stderr, "    -c    number of mixer output channels, default 2\n");
+    fprintf(stderr, "    -s    mixer sample-rate, default 48000\n");
+    fprintf(stderr, "    -f    frames per AudioMixer::process() call, default 960\n");
+    fprintf(stderr, "    -o    <output-file> WAV file, float\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const char * const progname = argv[0];
+    uint32_t outputSampleRate = 48000;
+    uint32_t outputChannels = 2;
+    size_t mixerFrameCount = 960;
+    const char *outputFilename = nullptr;
+
+    for (int ch; (ch = getopt(argc, argv, "c:s:f:o:")) != -1;) {
+        switch (ch) {
+        case 'c':
+            outputChannels = atoi(optarg);
+            break;
+        case 's':
+            outputSampleRate = atoi(optarg);
+            break;
+        case 'f':
+            mixerFrameCount = atoi(optarg);
+            break;
+        case 'o':
+            outputFilename = optarg;
+            break;
+        case '?':
+        default:
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc == 0 || outputChannels == 0 || outputSampleRate == 0 || mixerFrameCount == 0) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<CaptureProvider> providers(argc);
+    size_t outputFrames = 0; // of the longest capture
+    for (int i = 0; i < argc; ++i) {
+        const status_t status = providers[i].load(argv[i]);
+        if (status != NO_ERROR) {
+            fprintf(stderr, "%s: cannot load capture: %d\n", argv[i], status);
+            return EXIT_FAILURE;
+        }
+        const AudioCaptureFileHeader &header = providers[i].header();
+        printf("%s: format:%#x channels:%u samplerate:%u frames:%zu records:%zu"
+                " dropped frames:%" PRIu64 " max record gap:%.3f ms\n",
+                argv[i], header.format, header.channelCount, header.sampleRate,
+                providers[i].frames(), providers[i].records(), providers[i].droppedFrames(),
+                providers[i].maxGapNs() * 1e-6);
+        outputFrames = std::max(outputFrames, (size_t)((int64_t)providers[i].frames()
+                * outputSampleRate / header.sampleRate));
+    }
+    outputFrames = (outputFrames + mixerFrameCount - 1) / mixerFrameCount * mixerFrameCount;
+
+    const size_t outputFrameSize = outputChannels * sizeof(float);
+    std::vector<float> output(outputFrames * outputChannels);
+    const audio_channel_mask_t outputChannelMask =
+            audio_channel_out_mask_from_count(outputChannels);
+
+    AudioMixer mixer(mixerFrameCount, outputSampleRate);
+    float volume = AudioMixer::UNITY_GAIN_FLOAT;
+    for (size_t i = 0; i < providers.size(); ++i) {
+        const AudioCaptureFileHeader &header = providers[i].header();
+        const audio_format_t format = static_cast<audio_format_t>(header.format);
+        const audio_channel_mask_t channelMask =
+                audio_channel_out_mask_from_count(header.channelCount);
+        const int name = i;
+        const status_t status = mixer.create(name, channelMask, format, AUDIO_SESSION_OUTPUT_MIX);
+        if (status != OK) {
+            fprintf(stderr, "%s: cannot mix format %#x with %u channels\n",
+                    argv[i], header.format, header.channelCount);
+            return EXIT_FAILURE;
+        }
+        mixer.setBufferProvider(name, &providers[i]);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER, output.data());
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
+                (void *)(uintptr_t)AUDIO_FORMAT_PCM_FLOAT);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::FORMAT,
+                (void *)(uintptr_t)format);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MIXER_CHANNEL_MASK,
+                (void *)(uintptr_t)outputChannelMask);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
+                (void *)(uintptr_t)channelMask);
+        mixer.setParameter(name, AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                (void *)(uintptr_t)header.sampleRate);
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &volume);
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &volume);
+        mixer.enable(name);
+    }
+
+    // Pump the mixer, timing each call as the mixer thread would see it.
+    nsecs_t totalNs = 0;
+    nsecs_t maxNs = 0;
+    size_t calls = 0;
+    for (size_t i = 0; i < outputFrames; i += mixerFrameCount) {
+        for (size_t j = 0; j < providers.size(); ++j) {
+            mixer.setParameter(j, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                    (char *)output.data() + i * outputFrameSize);
+        }
+        const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        mixer.process();
+        const nsecs_t durationNs = systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+        totalNs += durationNs;
+        maxNs = std::max(maxNs, durationNs);
+        ++calls;
+    }
+    const double periodNs = 1e9 * mixerFrameCount / outputSampleRate;
+    printf("process: calls:%zu frames:%zu mean:%.3f us max:%.3f us (%.2f%% of the period)\n",
+            calls, mixerFrameCount, calls == 0 ? 0. : totalNs * 1e-3 / calls, maxNs * 1e-3,
+            maxNs * 100. / periodNs);
+
+    if (outputFilename != nullptr) {
+        SF_INFO info{};
+        info.samplerate = outputSampleRate;
+        info.channels = outputChannels;
+        info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        SNDFILE *sf = sf_open(outputFilename, SFM_WRITE, &info);
+        if (sf == nullptr) {
+            perror(outputFilename);
+            return EXIT_FAILURE;
+        }
+        (void)sf_writef_float(sf, output.data(), outputFrames);
+        sf_close(sf);
+        printf("saving file:%s channels:%u samplerate:%u frames:%zu\n",
+                outputFilename, outputChannels, outputSampleRate, outputFrames);
+    }
+    return EXIT_SUCCESS;
+}
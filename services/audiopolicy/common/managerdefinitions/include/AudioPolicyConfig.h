@@ -51,6 +51,8 @@ public:
     static sp<const AudioPolicyConfig> createDefault();
     // Attempts to load the configuration from the XML file, falls back to default on failure.
     // If the XML file path is not provided, uses `audio_get_audio_policy_config_file` function.
+    // The parsed configuration is saved in a binary snapshot which is loaded instead of
+    // the XML file on the next call, as long as the XML file and its XIncludes are unchanged.
     static sp<const AudioPolicyConfig> loadFromApmXmlConfigWithFallback(
             const std::string& xmlFilePath = "");
     // The factory method to use in APM tests which craft the configuration manually.
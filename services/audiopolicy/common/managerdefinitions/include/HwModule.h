@@ -72,6 +72,9 @@ public:
 
     void setProfiles(const IOProfileCollection &profiles);
 
+    // Mix ports and declared devices, in the order they were added to the module
+    const PolicyAudioPortVector &getPorts() const { return mPorts; }
+
     void setHalVersion(uint32_t major, uint32_t minor) {
         mHalVersion = (major << 8) | (minor & 0xff);
     }
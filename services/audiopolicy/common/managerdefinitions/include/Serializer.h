@@ -26,4 +26,14 @@ status_t deserializeAudioPolicyFile(const char *fileName, AudioPolicyConfig *con
 // of system libraries.
 status_t deserializeAudioPolicyFileForVts(const char *fileName, AudioPolicyConfig *config);
 
+// Precompiled snapshots of a deserialized configuration. A snapshot is keyed by the hash
+// of the XML file, of the files it pulls in through XIncludes, of the build fingerprint and
+// of the parser version, so that a stale snapshot is detected and rejected with
+// NOT_ENOUGH_DATA instead of being loaded.
+status_t hashAudioPolicyFile(const char *fileName, uint64_t *hash);
+status_t writeAudioPolicySnapshot(const char *snapshotFileName, uint64_t sourceHash,
+        const AudioPolicyConfig &config);
+status_t readAudioPolicySnapshot(const char *snapshotFileName, uint64_t sourceHash,
+        AudioPolicyConfig *config);
+
 } // namespace android
@@ -16,16 +16,29 @@
 
 #define LOG_TAG "APM_Config"
 
+#include <inttypes.h>
+
 #include <AudioPolicyConfig.h>
 #include <IOProfile.h>
 #include <Serializer.h>
+#include <cutils/properties.h>
 #include <media/AudioProfile.h>
 #include <system/audio.h>
 #include <system/audio_config.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 namespace android {
 
+namespace {
+
+// Where the parsed configuration is kept between audioserver starts, see
+// AudioPolicyConfig::loadFromApmXmlConfigWithFallback.
+constexpr const char* kSnapshotFile = "/data/misc/audioserver/audio_policy_configuration.snapshot";
+constexpr const char* kSnapshotEnabledProperty = "audio.policy.config_snapshot.enabled";
+
+}  // namespace
+
 // static
 sp<const AudioPolicyConfig> AudioPolicyConfig::createDefault() {
     auto config = sp<AudioPolicyConfig>::make();
@@ -38,8 +51,26 @@ sp<const AudioPolicyConfig> AudioPolicyConfig::loadFromApmXmlConfigWithFallback(
         const std::string& xmlFilePath) {
     const std::string filePath =
             xmlFilePath.empty() ? audio_get_audio_policy_config_file() : xmlFilePath;
+    const nsecs_t startNs = systemTime();
+    uint64_t sourceHash = 0;
+    const bool useSnapshot = property_get_bool(kSnapshotEnabledProperty, true /*default*/) &&
+            hashAudioPolicyFile(filePath.c_str(), &sourceHash) == NO_ERROR;
+    if (useSnapshot) {
+        auto config = sp<AudioPolicyConfig>::make();
+        if (readAudioPolicySnapshot(kSnapshotFile, sourceHash, config.get()) == NO_ERROR) {
+            ALOGI("%s: loaded \"%s\" from its snapshot in %" PRId64 " us", __func__,
+                    filePath.c_str(), ns2us(systemTime() - startNs));
+            return config;
+        }
+    }
+    // A snapshot which failed to load may have partially filled its config, start afresh.
     auto config = sp<AudioPolicyConfig>::make();
     if (status_t status = config->loadFromXml(filePath, false /*forVts*/); status == NO_ERROR) {
+        ALOGI("%s: parsed \"%s\" in %" PRId64 " us", __func__, filePath.c_str(),
+                ns2us(systemTime() - startNs));
+        if (useSnapshot) {
+            writeAudioPolicySnapshot(kSnapshotFile, sourceHash, *config);
+        }
         return config;
     }
     return createDefault();
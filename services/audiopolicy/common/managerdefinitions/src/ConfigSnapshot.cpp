@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "APM::ConfigSnapshot"
+//#define LOG_NDEBUG 0
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/unique_fd.h>
+#include <utils/Errors.h>
+#include <utils/Log.h>
+#include "AudioRoute.h"
+#include "IOProfile.h"
+#include "Serializer.h"
+
+namespace android {
+
+namespace {
+
+// Bump the version whenever the layout of the payload changes.
+constexpr uint32_t kSnapshotMagic = 0x53504141;  // "AAPS"
+constexpr uint32_t kSnapshotVersion = 1;
+// Bump the parser version whenever the Serializer interprets the same XML differently.
+constexpr uint32_t kParserVersion = 1;
+// Bounds the recursion through nested XIncludes.
+constexpr int kMaxIncludeDepth = 8;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+// 64-bit FNV-1a, good enough to detect a modified configuration file.
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Hashes the file contents and, recursively, the contents of the files referenced by
+// its <xi:include href="..."/> elements. Relative references are resolved against the
+// directory of the including file, as libxml does.
+status_t hashFileWithIncludes(const std::string &fileName, int depth, uint64_t *hash) {
+    if (depth > kMaxIncludeDepth) {
+        ALOGE("%s: XIncludes nested too deeply in %s", __func__, fileName.c_str());
+        return BAD_VALUE;
+    }
+    std::string content;
+    if (!base::ReadFileToString(fileName, &content)) {
+        ALOGE("%s: Could not read %s", __func__, fileName.c_str());
+        return NAME_NOT_FOUND;
+    }
+    *hash = fnv1a(fileName.data(), fileName.size(), *hash);
+    *hash = fnv1a(content.data(), content.size(), *hash);
+
+    static const std::string includeTag = "<xi:include";
+    static const std::string hrefAttribute = "href=\"";
+    const std::string directory = base::Dirname(fileName);
+    for (size_t pos = content.find(includeTag); pos != std::string::npos;
+            pos = content.find(includeTag, pos + includeTag.size())) {
+        const size_t tagEnd = content.find('>', pos);
+        const size_t hrefStart = content.find(hrefAttribute, pos);
+        if (tagEnd == std::string::npos || hrefStart == std::string::npos || hrefStart > tagEnd) {
+            continue;
+        }
+        const size_t valueStart = hrefStart + hrefAttribute.size();
+        const size_t valueEnd = content.find('"', valueStart);
+        if (valueEnd == std::string::npos || valueEnd > tagEnd) {
+            continue;
+        }
+        std::string href = content.substr(valueStart, valueEnd - valueStart);
+        if (href.empty()) {
+            continue;
+        }
+        if (href[0] != '/') {
+            href = directory + '/' + href;
+        }
+        if (status_t status = hashFileWithIncludes(href, depth + 1, hash); status != NO_ERROR) {
+            return status;
+        }
+    }
+    return NO_ERROR;
+}
+
+class SnapshotWriter {
+public:
+    template<typename T>
+    void write(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        mData.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    void writeString(const std::string &value) {
+        write<uint32_t>(value.size());
+        mData.append(value);
+    }
+    void writeProfiles(const AudioProfileVector &profiles);
+    void writeGains(const AudioGains &gains);
+
+    const std::string &data() const { return mData; }
+
+private:
+    std::string mData;
+};
+
+void SnapshotWriter::writeProfiles(const AudioProfileVector &profiles) {
+    write<uint32_t>(profiles.size());
+    for (const auto &profile : profiles) {
+        write<uint32_t>(profile->getFormat());
+        write<uint32_t>(profile->getChannels().size());
+        for (const auto channelMask : profile->getChannels()) {
+            write<uint32_t>(channelMask);
+        }
+        write<uint32_t>(profile->getSampleRates().size());
+        for (const auto sampleRate : profile->getSampleRates()) {
+            write<uint32_t>(sampleRate);
+        }
+        write<uint8_t>(profile->isDynamicFormat());
+        write<uint8_t>(profile->isDynamicChannels());
+        write<uint8_t>(profile->isDynamicRate());
+    }
+}
+
+void SnapshotWriter::writeGains(const AudioGains &gains) {
+    write<uint32_t>(gains.size());
+    for (const auto &gain : gains) {
+        write<uint32_t>(gain->getMode());
+        write<uint32_t>(gain->getChannelMask());
+        write<int32_t>(gain->getMinValueInMb());
+        write<int32_t>(gain->getMaxValueInMb());
+        write<int32_t>(gain->getDefaultValueInMb());
+        write<uint32_t>(gain->getStepValueInMb());
+        write<uint32_t>(gain->getMinRampInMs());
+        write<uint32_t>(gain->getMaxRampInMs());
+        write<uint8_t>(gain->canUseForVolume());
+    }
+}
+
+// Reads from a mapped snapshot. Any out of bounds access latches the reader into a failed
+// state, so that callers may check once at the end of a section instead of after each field.
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t *data, size_t size) : mCurrent(data), mEnd(data + size) {}
+
+    template<typename T>
+    bool read(T *value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (mFailed || static_cast<size_t>(mEnd - mCurrent) < sizeof(T)) {
+            mFailed = true;
+            return false;
+        }
+        memcpy(value, mCurrent, sizeof(T));
+        mCurrent += sizeof(T);
+        return true;
+    }
+    bool readString(std::string *value) {
+        uint32_t size;
+        if (!read(&size) || static_cast<size_t>(mEnd - mCurrent) < size) {
+            mFailed = true;
+            return false;
+        }
+        value->assign(reinterpret_cast<const char *>(mCurrent), size);
+        mCurrent += size;
+        return true;
+    }
+    // Element counts can not exceed the remaining bytes, this rejects corrupted
+    // counts before anything gets allocated for them.
+    bool readCount(uint32_t *count) {
+        if (!read(count) || *count > static_cast<size_t>(mEnd - mCurrent)) {
+            mFailed = true;
+            return false;
+        }
+        return true;
+    }
+    bool readProfiles(AudioProfileVector *profiles);
+    bool readGains(AudioGains *gains, int *gainIndex);
+
+    bool failed() const { return mFailed; }
+    bool atEnd() const { return mCurrent == mEnd; }
+
+private:
+    const uint8_t *mCurrent;
+    const uint8_t *const mEnd;
+    bool mFailed = false;
+};
+
+bool SnapshotReader::readProfiles(AudioProfileVector *profiles) {
+    uint32_t profileCount = 0;
+    readCount(&profileCount);
+    for (uint32_t i = 0; i < profileCount && !mFailed; i++) {
+        uint32_t format = 0, channelCount = 0, rateCount = 0;
+        read(&format);
+        ChannelMaskSet channelMasks;
+        readCount(&channelCount);
+        for (uint32_t j = 0; j < channelCount && !mFailed; j++) {
+            uint32_t channelMask = 0;
+            read(&channelMask);
+            channelMasks.insert(static_cast<audio_channel_mask_t>(channelMask));
+        }
+        SampleRateSet sampleRates;
+        readCount(&rateCount);
+        for (uint32_t j = 0; j < rateCount && !mFailed; j++) {
+            uint32_t sampleRate = 0;
+            read(&sampleRate);
+            sampleRates.insert(sampleRate);
+        }
+        uint8_t dynamicFormat = 0, dynamicChannels = 0, dynamicRate = 0;
+        read(&dynamicFormat);
+        read(&dynamicChannels);
+        read(&dynamicRate);
+        sp<AudioProfile> profile = new AudioProfile(
+                static_cast<audio_format_t>(format), channelMasks, sampleRates);
+        profile->setDynamicFormat(dynamicFormat != 0);
+        profile->setDynamicChannels(dynamicChannels != 0);
+        profile->setDynamicRate(dynamicRate != 0);
+        // Profiles were sorted when the XML file was parsed, keep that order.
+        profiles->push_back(profile);
+    }
+    return !mFailed;
+}
+
+bool SnapshotReader::readGains(AudioGains *gains, int *gainIndex) {
+    uint32_t gainCount = 0;
+    readCount(&gainCount);
+    for (uint32_t i = 0; i < gainCount && !mFailed; i++) {
+        uint32_t mode = 0, channelMask = 0, stepValue = 0, minRamp = 0, maxRamp = 0;
+        int32_t minValue = 0, maxValue = 0, defaultValue = 0;
+        uint8_t useForVolume = 0;
+        read(&mode);
+        read(&channelMask);
+        read(&minValue);
+        read(&maxValue);
+        read(&defaultValue);
+        read(&stepValue);
+        read(&minRamp);
+        read(&maxRamp);
+        read(&useForVolume);
+        // Gain indexes are handed out in parsing order, as the XML deserializer does.
+        sp<AudioGain> gain = new AudioGain((*gainIndex)++, true);
+        gain->setMode(static_cast<audio_gain_mode_t>(mode));
+        gain->setChannelMask(static_cast<audio_channel_mask_t>(channelMask));
+        gain->setMinValueInMb(minValue);
+        gain->setMaxValueInMb(maxValue);
+        gain->setDefaultValueInMb(defaultValue);
+        gain->setStepValueInMb(stepValue);
+        gain->setMinRampInMs(minRamp);
+        gain->setMaxRampInMs(maxRamp);
+        gain->setUseForVolume(useForVolume != 0);
+        gains->add(gain);
+    }
+    return !mFailed;
+}
+
+void writeMixPorts(const IOProfileCollection &mixPorts, SnapshotWriter *writer) {
+    for (const auto &mixPort : mixPorts) {
+        writer->writeString(mixPort->getName());
+        writer->write<uint32_t>(mixPort->getRole());
+        writer->write<uint32_t>(mixPort->getFlags());
+        writer->write<uint32_t>(mixPort->maxOpenCount);
+        writer->write<uint32_t>(mixPort->maxActiveCount);
+        writer->write<uint32_t>(mixPort->recommendedMuteDurationMs);
+        writer->writeProfiles(mixPort->getAudioProfiles());
+        writer->writeGains(mixPort->getGains());
+    }
+}
+
+status_t writeModule(const sp<HwModule> &module, const AudioPolicyConfig &config,
+        SnapshotWriter *writer) {
+    writer->writeString(module->getName());
+    writer->write<uint32_t>(module->getHalVersionMajor());
+    writer->write<uint32_t>(module->getHalVersionMinor());
+
+    // Mix ports in document order, which is the order the gain indexes are handed out in
+    // when the snapshot is read, as when the XML is parsed.
+    IOProfileCollection mixPorts;
+    for (const auto &port : module->getPorts()) {
+        for (const IOProfileCollection *profiles :
+                {&module->getOutputProfiles(), &module->getInputProfiles()}) {
+            for (const auto &profile : *profiles) {
+                if (static_cast<PolicyAudioPort *>(profile.get()) == port.get()) {
+                    mixPorts.add(profile);
+                }
+            }
+        }
+    }
+    writer->write<uint32_t>(mixPorts.size());
+    writeMixPorts(mixPorts, writer);
+
+    const DeviceVector &declaredDevices = module->getDeclaredDevices();
+    writer->write<uint32_t>(declaredDevices.size());
+    for (const auto &device : declaredDevices) {
+        writer->write<uint32_t>(device->type());
+        writer->writeString(device->getTagName());
+        writer->writeString(device->address());
+        writer->write<uint32_t>(device->encodedFormats().size());
+        for (const auto format : device->encodedFormats()) {
+            writer->write<uint32_t>(format);
+        }
+        writer->writeProfiles(device->getAudioProfiles());
+        writer->writeGains(device->getGains());
+    }
+
+    const AudioRouteVector &routes = module->getRoutes();
+    writer->write<uint32_t>(routes.size());
+    for (const auto &route : routes) {
+        if (route->getSink() == nullptr) {
+            ALOGE("%s: route without sink in module %s", __func__, module->getName());
+            return BAD_VALUE;
+        }
+        writer->write<uint32_t>(route->getType());
+        writer->writeString(route->getSink()->getTagName());
+        writer->write<uint32_t>(route->getSources().size());
+        for (const auto &source : route->getSources()) {
+            writer->writeString(source->getTagName());
+        }
+    }
+
+    // Attached devices are referenced through the tag name of the declared device.
+    std::vector<std::string> attachedDevices;
+    for (const DeviceVector *devices : {&config.getOutputDevices(), &config.getInputDevices()}) {
+        for (const auto &device : *devices) {
+            if (declaredDevices.contains(device)) {
+                attachedDevices.push_back(device->getTagName());
+            }
+        }
+    }
+    writer->write<uint32_t>(attachedDevices.size());
+    for (const auto &tagName : attachedDevices) {
+        writer->writeString(tagName);
+    }
+    return NO_ERROR;
+}
+
+status_t readModule(SnapshotReader *reader, AudioPolicyConfig *config, int *gainIndex,
+        sp<HwModule> *result) {
+    std::string name;
+    uint32_t versionMajor = 0, versionMinor = 0;
+    reader->readString(&name);
+    reader->read(&versionMajor);
+    reader->read(&versionMinor);
+    if (reader->failed()) return BAD_VALUE;
+    sp<HwModule> module = new HwModule(name.c_str(), versionMajor, versionMinor);
+
+    uint32_t mixPortCount = 0;
+    reader->readCount(&mixPortCount);
+    IOProfileCollection mixPorts;
+    for (uint32_t i = 0; i < mixPortCount && !reader->failed(); i++) {
+        std::string mixPortName;
+        uint32_t role = 0, flags = 0;
+        reader->readString(&mixPortName);
+        reader->read(&role);
+        reader->read(&flags);
+        if (role != AUDIO_PORT_ROLE_SOURCE && role != AUDIO_PORT_ROLE_SINK) return BAD_VALUE;
+        sp<IOProfile> mixPort = new IOProfile(mixPortName, static_cast<audio_port_role_t>(role));
+        // Flags first, they reset the max active count of some inputs.
+        mixPort->setFlags(flags);
+        reader->read(&mixPort->maxOpenCount);
+        reader->read(&mixPort->maxActiveCount);
+        reader->read(&mixPort->recommendedMuteDurationMs);
+        AudioProfileVector profiles;
+        reader->readProfiles(&profiles);
+        mixPort->setAudioProfiles(profiles);
+        AudioGains gains;
+        reader->readGains(&gains, gainIndex);
+        mixPort->setGains(gains);
+        mixPorts.add(mixPort);
+    }
+    if (reader->failed()) return BAD_VALUE;
+    module->setProfiles(mixPorts);
+
+    uint32_t deviceCount = 0;
+    reader->readCount(&deviceCount);
+    DeviceVector declaredDevices;
+    for (uint32_t i = 0; i < deviceCount && !reader->failed(); i++) {
+        uint32_t type = 0, formatCount = 0;
+        std::string tagName, address;
+        reader->read(&type);
+        reader->readString(&tagName);
+        reader->readString(&address);
+        FormatVector encodedFormats;
+        reader->readCount(&formatCount);
+        for (uint32_t j = 0; j < formatCount && !reader->failed(); j++) {
+            uint32_t format = 0;
+            reader->read(&format);
+            encodedFormats.push_back(static_cast<audio_format_t>(format));
+        }
+        sp<DeviceDescriptor> device = new DeviceDescriptor(
+                static_cast<audio_devices_t>(type), tagName, address, encodedFormats);
+        AudioProfileVector profiles;
+        reader->readProfiles(&profiles);
+        device->setAudioProfiles(profiles);
+        AudioGains gains;
+        reader->readGains(&gains, gainIndex);
+        device->setGains(gains);
+        declaredDevices.add(device);
+    }
+    if (reader->failed()) return BAD_VALUE;
+    module->setDeclaredDevices(declaredDevices);
+
+    uint32_t routeCount = 0;
+    reader->readCount(&routeCount);
+    AudioRouteVector routes;
+    for (uint32_t i = 0; i < routeCount && !reader->failed(); i++) {
+        uint32_t type = 0, sourceCount = 0;
+        std::string sinkName;
+        reader->read(&type);
+        reader->readString(&sinkName);
+        sp<PolicyAudioPort> sink = module->findPortByTagName(sinkName);
+        if (reader->failed() || sink == nullptr) {
+            ALOGE("%s: no sink found with name=%s", __func__, sinkName.c_str());
+            return BAD_VALUE;
+        }
+        sp<AudioRoute> route = new AudioRoute(static_cast<audio_route_type_t>(type));
+        route->setSink(sink);
+        PolicyAudioPortVector sources;
+        reader->readCount(&sourceCount);
+        for (uint32_t j = 0; j < sourceCount && !reader->failed(); j++) {
+            std::string sourceName;
+            reader->readString(&sourceName);
+            sp<PolicyAudioPort> source = module->findPortByTagName(sourceName);
+            if (source == nullptr) {
+                ALOGE("%s: no source found with name=%s", __func__, sourceName.c_str());
+                return BAD_VALUE;
+            }
+            sources.add(source);
+        }
+        sink->addRoute(route);
+        for (const auto &source : sources) {
+            source->addRoute(route);
+        }
+        route->setSources(sources);
+        routes.add(route);
+    }
+    if (reader->failed()) return BAD_VALUE;
+    module->setRoutes(routes);
+
+    uint32_t attachedCount = 0;
+    reader->readCount(&attachedCount);
+    for (uint32_t i = 0; i < attachedCount && !reader->failed(); i++) {
+        std::string tagName;
+        reader->readString(&tagName);
+        sp<DeviceDescriptor> device = module->getDeclaredDevices().getDeviceFromTagName(tagName);
+        if (device == nullptr) {
+            ALOGE("%s: no attached device found with name=%s", __func__, tagName.c_str());
+            return BAD_VALUE;
+        }
+        config->addDevice(device);
+    }
+    if (reader->failed()) return BAD_VALUE;
+    *result = module;
+    return NO_ERROR;
+}
+
+status_t readPayload(SnapshotReader *reader, AudioPolicyConfig *config) {
+    std::string source, engineLibraryNameSuffix;
+    uint8_t callScreenModeSupported = 0;
+    reader->readString(&source);
+    reader->readString(&engineLibraryNameSuffix);
+    reader->read(&callScreenModeSupported);
+
+    uint32_t moduleCount = 0;
+    reader->readCount(&moduleCount);
+    HwModuleCollection modules;
+    int gainIndex = 0;
+    for (uint32_t i = 0; i < moduleCount && !reader->failed(); i++) {
+        sp<HwModule> module;
+        if (status_t status = readModule(reader, config, &gainIndex, &module);
+                status != NO_ERROR) {
+            return status;
+        }
+        modules.add(module);
+    }
+
+    uint8_t hasDefaultOutputDevice = 0;
+    reader->read(&hasDefaultOutputDevice);
+    if (hasDefaultOutputDevice != 0) {
+        uint32_t moduleIndex = 0;
+        std::string tagName;
+        reader->read(&moduleIndex);
+        reader->readString(&tagName);
+        if (reader->failed() || moduleIndex >= modules.size()) return BAD_VALUE;
+        sp<DeviceDescriptor> device =
+                modules[moduleIndex]->getDeclaredDevices().getDeviceFromTagName(tagName);
+        if (device == nullptr) return BAD_VALUE;
+        config->setDefaultOutputDevice(device);
+    }
+
+    uint32_t surroundFormatCount = 0;
+    reader->readCount(&surroundFormatCount);
+    AudioPolicyConfig::SurroundFormats surroundFormats;
+    for (uint32_t i = 0; i < surroundFormatCount && !reader->failed(); i++) {
+        uint32_t format = 0, subformatCount = 0;
+        reader->read(&format);
+        auto &subformats = surroundFormats[static_cast<audio_format_t>(format)];
+        reader->readCount(&subformatCount);
+        for (uint32_t j = 0; j < subformatCount && !reader->failed(); j++) {
+            uint32_t subformat = 0;
+            reader->read(&subformat);
+            subformats.insert(static_cast<audio_format_t>(subformat));
+        }
+    }
+    if (reader->failed() || !reader->atEnd()) return BAD_VALUE;
+
+    config->setSource(source);
+    config->setEngineLibraryNameSuffix(engineLibraryNameSuffix);
+    config->setCallScreenModeSupported(callScreenModeSupported != 0);
+    config->setHwModules(modules);
+    config->setSurroundFormats(surroundFormats);
+    return NO_ERROR;
+}
+
+}  // namespace
+
+status_t hashAudioPolicyFile(const char *fileName, uint64_t *hash)
+{
+    *hash = fnv1a(&kSnapshotVersion, sizeof(kSnapshotVersion));
+    *hash = fnv1a(&kParserVersion, sizeof(kParserVersion), *hash);
+    // The parser comes with the system image, a snapshot does not survive an update of it.
+    const std::string fingerprint = base::GetProperty("ro.build.fingerprint", "");
+    *hash = fnv1a(fingerprint.data(), fingerprint.size(), *hash);
+    return hashFileWithIncludes(fileName, 0 /*depth*/, hash);
+}
+
+status_t writeAudioPolicySnapshot(const char *snapshotFileName, uint64_t sourceHash,
+        const AudioPolicyConfig &config)
+{
+    SnapshotWriter writer;
+    writer.writeString(config.getSource());
+    writer.writeString(config.getEngineLibraryNameSuffix());
+    writer.write<uint8_t>(config.isCallScreenModeSupported());
+
+    const HwModuleCollection &modules = config.getHwModules();
+    writer.write<uint32_t>(modules.size());
+    for (const auto &module : modules) {
+        if (status_t status = writeModule(module, config, &writer); status != NO_ERROR) {
+            return status;
+        }
+    }
+
+    const sp<DeviceDescriptor> &defaultOutputDevice = config.getDefaultOutputDevice();
+    ssize_t defaultModuleIndex = -1;
+    for (size_t i = 0; defaultOutputDevice != nullptr && i < modules.size(); i++) {
+        if (modules[i]->getDeclaredDevices().contains(defaultOutputDevice)) {
+            defaultModuleIndex = i;
+            break;
+        }
+    }
+    writer.write<uint8_t>(defaultModuleIndex >= 0);
+    if (defaultModuleIndex >= 0) {
+        writer.write<uint32_t>(defaultModuleIndex);
+        writer.writeString(defaultOutputDevice->getTagName());
+    }
+
+    const AudioPolicyConfig::SurroundFormats &surroundFormats = config.getSurroundFormats();
+    writer.write<uint32_t>(surroundFormats.size());
+    for (const auto &[format, subformats] : surroundFormats) {
+        writer.write<uint32_t>(format);
+        writer.write<uint32_t>(subformats.size());
+        for (const auto subformat : subformats) {
+            writer.write<uint32_t>(subformat);
+        }
+    }
+
+    const std::string &payload = writer.data();
+    const SnapshotHeader header = {
+        .magic = kSnapshotMagic,
+        .version = kSnapshotVersion,
+        .sourceHash = sourceHash,
+        .payloadSize = payload.size(),
+        .payloadHash = fnv1a(payload.data(), payload.size()),
+    };
+    std::string content(reinterpret_cast<const char *>(&header), sizeof(header));
+    content.append(payload);
+
+    // Write aside and rename, so that a reader never maps a partially written snapshot.
+    const std::string tmpFileName = std::string(snapshotFileName) + ".tmp";
+    if (!base::WriteStringToFile(content, tmpFileName, S_IRUSR | S_IWUSR, getuid(), getgid())) {
+        ALOGE("%s: Could not write %s: %s", __func__, tmpFileName.c_str(), strerror(errno));
+        unlink(tmpFileName.c_str());
+        return INVALID_OPERATION;
+    }
+    if (rename(tmpFileName.c_str(), snapshotFileName) != 0) {
+        ALOGE("%s: Could not rename %s: %s", __func__, tmpFileName.c_str(), strerror(errno));
+        unlink(tmpFileName.c_str());
+        return INVALID_OPERATION;
+    }
+    return NO_ERROR;
+}
+
+status_t readAudioPolicySnapshot(const char *snapshotFileName, uint64_t sourceHash,
+        AudioPolicyConfig *config)
+{
+    base::unique_fd fd(open(snapshotFileName, O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        ALOGV("%s: No snapshot %s: %s", __func__, snapshotFileName, strerror(errno));
+        return NAME_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ALOGW("%s: Truncated snapshot %s", __func__, snapshotFileName);
+        return BAD_VALUE;
+    }
+    const size_t size = st.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ALOGE("%s: Could not map %s: %s", __func__, snapshotFileName, strerror(errno));
+        return NO_MEMORY;
+    }
+    const uint8_t *data = static_cast<const uint8_t *>(mapped);
+
+    status_t status = NO_ERROR;
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion) {
+        ALOGI("%s: Snapshot %s has an unsupported version %u", __func__, snapshotFileName,
+                header.version);
+        status = NOT_ENOUGH_DATA;
+    } else if (header.sourceHash != sourceHash) {
+        ALOGI("%s: Snapshot %s is stale", __func__, snapshotFileName);
+        status = NOT_ENOUGH_DATA;
+    } else if (header.payloadSize != size - sizeof(header) ||
+            header.payloadHash != fnv1a(data + sizeof(header), header.payloadSize)) {
+        ALOGW("%s: Snapshot %s is corrupted", __func__, snapshotFileName);
+        status = BAD_VALUE;
+    } else {
+        SnapshotReader reader(data + sizeof(header), header.payloadSize);
+        status = readPayload(&reader, config);
+        ALOGE_IF(status != NO_ERROR, "%s: Could not decode snapshot %s", __func__,
+                snapshotFileName);
+    }
+    munmap(mapped, size);
+    return status;
+}
+
+} // namespace android
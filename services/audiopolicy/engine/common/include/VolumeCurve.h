@@ -28,6 +28,7 @@
 #include <string>
 #include <map>
 #include <utility>
+#include <vector>
 
 namespace android {
 
@@ -53,7 +54,15 @@ class VolumeCurve : public RefBase
 public:
     VolumeCurve(device_category device) : mDeviceCategory(device) {}
 
-    void add(const CurvePoint &point) { mCurvePoints.add(point); }
+    void add(const CurvePoint &point)
+    {
+        mCurvePoints.add(point);
+        mLookupTable.clear();
+    }
+
+    // Tabulates the attenuation of every UI index from 0 to volIndexMax, so that conversions
+    // for this index range no longer interpolate between curve points.
+    void buildLookupTable(int volIndexMin, int volIndexMax);
 
     float volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
 
@@ -62,8 +71,16 @@ public:
     device_category getDeviceCategory() const { return mDeviceCategory; }
 
 private:
+    // Larger index ranges are not tabulated and always interpolated.
+    static constexpr int kMaxLookupTableSize = 1024;
+
+    float interpolateVolIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
+
     const device_category mDeviceCategory;
     SortedVector<CurvePoint> mCurvePoints;
+    std::vector<float> mLookupTable; /**< decibels indexed by UI index, see buildLookupTable(). */
+    int mLookupIndexMin = -1;
+    int mLookupIndexMax = -1;
 };
 
 // Volume Curves for a given use case indexed by device category
@@ -80,6 +97,9 @@ public:
     {
         mIndexMin = indexMin;
         mIndexMax = indexMax;
+        for (size_t i = 0; i < mOriginVolumeCurves.size(); i++) {
+            mOriginVolumeCurves.valueAt(i)->buildLookupTable(mIndexMin, mIndexMax);
+        }
         return NO_ERROR;
     }
 
@@ -151,6 +171,7 @@ public:
         device_category deviceCategory = volumeCurve->getDeviceCategory();
         ssize_t index = indexOfKey(deviceCategory);
         if (index < 0) {
+            volumeCurve->buildLookupTable(mIndexMin, mIndexMax);
             // Keep track of original Volume Curves per device category in order to switch curves.
             mOriginVolumeCurves.add(deviceCategory, volumeCurve);
             return KeyedVector::add(deviceCategory, volumeCurve);
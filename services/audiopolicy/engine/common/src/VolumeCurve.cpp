@@ -23,7 +23,31 @@
 
 namespace android {
 
+void VolumeCurve::buildLookupTable(int volIndexMin, int volIndexMax)
+{
+    mLookupTable.clear();
+    mLookupIndexMin = volIndexMin;
+    mLookupIndexMax = volIndexMax;
+    if (mCurvePoints.isEmpty() || volIndexMin < 0 || volIndexMin > volIndexMax ||
+            volIndexMax >= kMaxLookupTableSize) {
+        return;
+    }
+    mLookupTable.reserve(volIndexMax + 1);
+    for (int indexInUi = 0; indexInUi <= volIndexMax; indexInUi++) {
+        mLookupTable.push_back(interpolateVolIndexToDb(indexInUi, volIndexMin, volIndexMax));
+    }
+}
+
 float VolumeCurve::volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const
+{
+    if (volIndexMin == mLookupIndexMin && volIndexMax == mLookupIndexMax &&
+            indexInUi >= 0 && indexInUi < static_cast<int>(mLookupTable.size())) {
+        return mLookupTable[indexInUi];
+    }
+    return interpolateVolIndexToDb(indexInUi, volIndexMin, volIndexMax);
+}
+
+float VolumeCurve::interpolateVolIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const
 {
     ALOG_ASSERT(!mCurvePoints.isEmpty(), "Invalid volume curve");
     if (volIndexMin < 0 || volIndexMax < 0) {
@@ -39,6 +39,7 @@
 #include <vector>
 
 #include <Serializer.h>
+#include <android-base/scopeguard.h>
 #include <android/media/audio/common/AudioPort.h>
 #include <cutils/bitops.h>
 #include <cutils/properties.h>
@@ -175,6 +176,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(audio_devices_t deviceT
 status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescriptor> &device,
                                                          audio_policy_dev_state_t state)
 {
+    invalidateOutputRoutingCache();
     // handle output devices
     if (audio_is_output_device(device->type())) {
         SortedVector <audio_io_handle_t> outputs;
@@ -821,6 +823,7 @@ void AudioPolicyManager::connectTelephonyTxAudioSource(
 
 void AudioPolicyManager::setPhoneState(audio_mode_t state)
 {
+    invalidateOutputRoutingCache();
     ALOGV("setPhoneState() state %d", state);
     // store previous phone state for management of sonification strategy below
     int oldState = mEngine->getPhoneState();
@@ -932,6 +935,7 @@ audio_mode_t AudioPolicyManager::getPhoneState() {
 void AudioPolicyManager::setForceUse(audio_policy_force_use_t usage,
                                      audio_policy_forced_cfg_t config)
 {
+    invalidateOutputRoutingCache();
     ALOGV("setForceUse() usage %d, config %d, mPhoneState %d", usage, config, mEngine->getPhoneState());
     if (config == mEngine->getForceUse(usage)) {
         return;
@@ -1160,11 +1164,9 @@ status_t AudioPolicyManager::getOutputForAttrInt(
         bool *isSpatialized,
         bool *isBitPerfect)
 {
+    const nsecs_t lookupStartNs = systemTime();
     DeviceVector outputDevices;
     const audio_port_handle_t requestedPortId = *selectedDeviceId;
-    DeviceVector msdDevices = getMsdAudioOutDevices();
-    const sp<DeviceDescriptor> requestedDevice =
-        mAvailableOutputDevices.getDeviceFromId(requestedPortId);
 
     *outputType = API_OUTPUT_INVALID;
     *isSpatialized = false;
@@ -1181,6 +1183,45 @@ status_t AudioPolicyManager::getOutputForAttrInt(
     ALOGV("%s() attributes=%s stream=%s session %d selectedDeviceId %d", __func__,
           toString(*resultAttr).c_str(), toString(*stream).c_str(), session, requestedPortId);
 
+    // Reuse the previous decision for an identical request if nothing it depends on changed.
+    const bool routingCacheable = isOutputRoutingCacheable(*resultAttr, *flags, *config);
+    const OutputRoutingKey routingKey = {
+        .usage = resultAttr->usage,
+        .contentType = resultAttr->content_type,
+        .source = resultAttr->source,
+        .attrFlags = resultAttr->flags,
+        .tags = resultAttr->tags,
+        .session = session,
+        .uid = uid,
+        .requestedPortId = requestedPortId,
+        .flags = *flags,
+        .sampleRate = config->sample_rate,
+        .channelMask = config->channel_mask,
+        .format = config->format,
+    };
+    if (routingCacheable) {
+        auto it = mOutputRoutingCache.find(routingKey);
+        if (it != mOutputRoutingCache.end() &&
+                it->second.generation == mOutputRoutingGeneration) {
+            *output = it->second.output;
+            *flags = it->second.flags;
+            *selectedDeviceId = it->second.selectedDeviceId;
+            *outputType = API_OUTPUT_LEGACY;
+            *isBitPerfect = false;
+            recordOutputRoutingLookup(true /*hit*/, lookupStartNs);
+            ALOGV("%s returns cached output %d selectedDeviceId %d", __func__, *output,
+                  *selectedDeviceId);
+            return NO_ERROR;
+        }
+    }
+    // Any other outcome, failed, uncacheable or not stored, is a miss.
+    auto recordMiss = base::make_scope_guard(
+            [&] { recordOutputRoutingLookup(false /*hit*/, lookupStartNs); });
+
+    DeviceVector msdDevices = getMsdAudioOutDevices();
+    const sp<DeviceDescriptor> requestedDevice =
+        mAvailableOutputDevices.getDeviceFromId(requestedPortId);
+
     bool usePrimaryOutputFromPolicyMixes = false;
 
     // The primary output is the explicit routing (eg. setPreferredDevice) if specified,
@@ -1279,6 +1320,7 @@ status_t AudioPolicyManager::getOutputForAttrInt(
           config->channel_mask, *flags, toString(*stream).c_str());
 
     *output = AUDIO_IO_HANDLE_NONE;
+    sp<PreferredMixerAttributesInfo> info = nullptr;
     if (!msdDevices.isEmpty()) {
         *output = getOutputForDevices(msdDevices, session, resultAttr, config, flags, isSpatialized);
         if (*output != AUDIO_IO_HANDLE_NONE && setMsdOutputPatches(&outputDevices) == NO_ERROR) {
@@ -1289,7 +1331,6 @@ status_t AudioPolicyManager::getOutputForAttrInt(
         }
     }
     if (*output == AUDIO_IO_HANDLE_NONE) {
-        sp<PreferredMixerAttributesInfo> info = nullptr;
         if (outputDevices.size() == 1) {
             info = getPreferredMixerAttributesInfo(
                     outputDevices.itemAt(0)->getId(),
@@ -1342,11 +1383,62 @@ status_t AudioPolicyManager::getOutputForAttrInt(
         *outputType = API_OUTPUT_LEGACY;
     }
 
+    // Only memoize plain engine routing to a mixed output: MSD, preferred mixer, spatializer,
+    // direct and secondary mix decisions depend on state not covered by the generation.
+    if (routingCacheable && *outputType == API_OUTPUT_LEGACY && msdDevices.isEmpty()
+            && info == nullptr && !*isSpatialized && !*isRequestedDeviceForExclusiveUse
+            && (secondaryMixes == nullptr || secondaryMixes->empty())
+            && (mOutputs.valueFor(*output)->mFlags & AUDIO_OUTPUT_FLAG_DIRECT) == 0
+            && systemTime() - mLastSourceStopTime >
+                    milliseconds(SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY)) {
+        if (mOutputRoutingCache.size() >= kMaxOutputRoutingCacheSize) {
+            mOutputRoutingCache.clear();
+        }
+        mOutputRoutingCache[routingKey] = {
+            .generation = mOutputRoutingGeneration,
+            .output = *output,
+            .flags = *flags,
+            .selectedDeviceId = *selectedDeviceId,
+        };
+    }
+
     ALOGV("%s returns output %d selectedDeviceId %d", __func__, *output, *selectedDeviceId);
 
     return NO_ERROR;
 }
 
+bool AudioPolicyManager::isOutputRoutingCacheable(const audio_attributes_t &attr,
+                                                  audio_output_flags_t flags,
+                                                  const audio_config_t &config) const
+{
+    // Direct, offloaded and tuner requests open or reuse session specific outputs.
+    static const audio_output_flags_t kUncachedFlags = (audio_output_flags_t)
+        (AUDIO_OUTPUT_FLAG_DIRECT | AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD |
+            AUDIO_OUTPUT_FLAG_HW_AV_SYNC | AUDIO_OUTPUT_FLAG_MMAP_NOIRQ);
+    return (flags & kUncachedFlags) == 0
+            && (attr.flags & AUDIO_FLAG_HW_AV_SYNC) == 0
+            && attr.usage != AUDIO_USAGE_VIRTUAL_SOURCE
+            && audio_is_linear_pcm(config.format)
+            && config.offload_info.content_id == 0 && config.offload_info.sync_id == 0;
+}
+
+void AudioPolicyManager::invalidateOutputRoutingCache()
+{
+    mOutputRoutingGeneration++;
+}
+
+void AudioPolicyManager::recordOutputRoutingLookup(bool hit, nsecs_t startNs)
+{
+    const nsecs_t durationNs = systemTime() - startNs;
+    if (hit) {
+        mOutputRoutingCacheHits++;
+        mOutputRoutingHitTimeNs += durationNs;
+    } else {
+        mOutputRoutingCacheMisses++;
+        mOutputRoutingMissTimeNs += durationNs;
+    }
+}
+
 status_t AudioPolicyManager::getOutputForAttr(const audio_attributes_t *attr,
                                               audio_io_handle_t *output,
                                               audio_session_t session,
@@ -2234,6 +2326,11 @@ status_t AudioPolicyManager::startSource(const sp<SwAudioOutputDescriptor>& outp
     // NOTE that the usage count is the same for duplicated output and hardware output which is
     // necessary for a correct control of hardware output routing by startOutput() and stopOutput()
     outputDesc->setClientActive(client, true);
+    // the engine routing depends on which volume sources are active and on active clients with
+    // a preferred device
+    if (outputDesc->getActivityCount(clientVolSrc) == 1 || client->hasPreferredDevice()) {
+        invalidateOutputRoutingCache();
+    }
 
     if (client->hasPreferredDevice(true)) {
         if (outputDesc->sameExclusivePreferredDevicesCount() > 0) {
@@ -2476,6 +2573,10 @@ status_t AudioPolicyManager::stopSource(const sp<SwAudioOutputDescriptor>& outpu
 
         // decrement usage count of this stream on the output
         outputDesc->setClientActive(client, false);
+        if (outputDesc->getActivityCount(clientVolSrc) == 0 || client->hasPreferredDevice()) {
+            invalidateOutputRoutingCache();
+            mLastSourceStopTime = systemTime();
+        }
 
         // store time at which the stream was stopped - see isStreamActive()
         if (outputDesc->getActivityCount(clientVolSrc) == 0 || forceDeviceUpdate) {
@@ -3461,6 +3562,7 @@ status_t AudioPolicyManager::registerEffect(const effect_descriptor_t *desc,
                                 int session,
                                 int id)
 {
+    invalidateOutputRoutingCache();
     if (session != AUDIO_SESSION_DEVICE) {
         ssize_t index = mOutputs.indexOfKey(io);
         if (index < 0) {
@@ -3479,6 +3581,7 @@ status_t AudioPolicyManager::registerEffect(const effect_descriptor_t *desc,
 
 status_t AudioPolicyManager::unregisterEffect(int id)
 {
+    invalidateOutputRoutingCache();
     if (mEffects.getEffect(id) == nullptr) {
         return INVALID_OPERATION;
     }
@@ -3506,6 +3609,7 @@ status_t AudioPolicyManager::setEffectEnabled(int id, bool enabled)
 
 status_t AudioPolicyManager::moveEffectsToIo(const std::vector<int>& ids, audio_io_handle_t io)
 {
+   invalidateOutputRoutingCache();
    mEffects.moveEffects(ids, io);
    return NO_ERROR;
 }
@@ -3558,6 +3662,7 @@ bool AudioPolicyManager::isSourceActive(audio_source_t source) const
 
 status_t AudioPolicyManager::registerPolicyMixes(const Vector<AudioMix>& mixes)
 {
+    invalidateOutputRoutingCache();
     ALOGV("registerPolicyMixes() %zu mix(es)", mixes.size());
     status_t res = NO_ERROR;
     bool checkOutputs = false;
@@ -3695,6 +3800,7 @@ status_t AudioPolicyManager::registerPolicyMixes(const Vector<AudioMix>& mixes)
 
 status_t AudioPolicyManager::unregisterPolicyMixes(Vector<AudioMix> mixes)
 {
+    invalidateOutputRoutingCache();
     ALOGV("unregisterPolicyMixes() num mixes %zu", mixes.size());
     status_t res = NO_ERROR;
     bool checkOutputs = false;
@@ -3784,6 +3890,7 @@ bool  AudioPolicyManager::areAllDevicesSupported(
 
 status_t AudioPolicyManager::setUidDeviceAffinities(uid_t uid,
         const AudioDeviceTypeAddrVector& devices) {
+    invalidateOutputRoutingCache();
     ALOGV("%s() uid=%d num devices %zu", __FUNCTION__, uid, devices.size());
     if (!areAllDevicesSupported(devices, audio_is_output_device, __func__)) {
         return BAD_VALUE;
@@ -3801,6 +3908,7 @@ status_t AudioPolicyManager::setUidDeviceAffinities(uid_t uid,
 }
 
 status_t AudioPolicyManager::removeUidDeviceAffinities(uid_t uid) {
+    invalidateOutputRoutingCache();
     ALOGV("%s() uid=%d", __FUNCTION__, uid);
     status_t res = mPolicyMixes.removeUidDeviceAffinities(uid);
     if (res != NO_ERROR) {
@@ -3819,6 +3927,7 @@ status_t AudioPolicyManager::removeUidDeviceAffinities(uid_t uid) {
 status_t AudioPolicyManager::setDevicesRoleForStrategy(product_strategy_t strategy,
                                                        device_role_t role,
                                                        const AudioDeviceTypeAddrVector &devices) {
+    invalidateOutputRoutingCache();
     ALOGV("%s() strategy=%d role=%d %s", __func__, strategy, role,
             dumpAudioDeviceTypeAddrVector(devices).c_str());
 
@@ -3941,6 +4050,7 @@ AudioPolicyManager::removeDevicesRoleForStrategy(product_strategy_t strategy,
 status_t AudioPolicyManager::clearDevicesRoleForStrategy(product_strategy_t strategy,
                                                          device_role_t role)
 {
+    invalidateOutputRoutingCache();
     ALOGV("%s() strategy=%d role=%d", __func__, strategy, role);
 
     status_t status = mEngine->clearDevicesRoleForStrategy(strategy, role);
@@ -4047,6 +4157,7 @@ status_t AudioPolicyManager::getDevicesForRoleAndCapturePreset(
 
 status_t AudioPolicyManager::setUserIdDeviceAffinities(int userId,
         const AudioDeviceTypeAddrVector& devices) {
+    invalidateOutputRoutingCache();
     ALOGV("%s() userId=%d num devices %zu", __func__, userId, devices.size());
     if (!areAllDevicesSupported(devices, audio_is_output_device, __func__)) {
         return BAD_VALUE;
@@ -4066,6 +4177,7 @@ status_t AudioPolicyManager::setUserIdDeviceAffinities(int userId,
 }
 
 status_t AudioPolicyManager::removeUserIdDeviceAffinities(int userId) {
+    invalidateOutputRoutingCache();
     ALOGV("%s() userId=%d", __FUNCTION__, userId);
     status_t status = mPolicyMixes.removeUserIdDeviceAffinities(userId);
     if (status != NO_ERROR) {
@@ -4121,6 +4233,19 @@ void AudioPolicyManager::dump(String8 *dst) const
     mPolicyMixes.dump(dst);
     mAudioSources.dump(dst);
 
+    const uint64_t routingLookups = mOutputRoutingCacheHits + mOutputRoutingCacheMisses;
+    dst->appendFormat(" Output routing cache: generation %u, %zu entries, %" PRIu64 " hits,"
+            " %" PRIu64 " misses (hit rate %.1f%%)\n", mOutputRoutingGeneration,
+            mOutputRoutingCache.size(), mOutputRoutingCacheHits, mOutputRoutingCacheMisses,
+            routingLookups > 0 ? 100.0 * mOutputRoutingCacheHits / routingLookups : 0.0);
+    if (routingLookups > 0) {
+        dst->appendFormat("   average lookup: hit %.1f us, miss %.1f us\n",
+                mOutputRoutingCacheHits > 0 ?
+                        mOutputRoutingHitTimeNs / 1000.0 / mOutputRoutingCacheHits : 0.0,
+                mOutputRoutingCacheMisses > 0 ?
+                        mOutputRoutingMissTimeNs / 1000.0 / mOutputRoutingCacheMisses : 0.0);
+    }
+
     dst->appendFormat(" AllowedCapturePolicies:\n");
     for (auto& policy : mAllowedCapturePolicies) {
         dst->appendFormat("   - uid=%d flag_mask=%#x\n", policy.first, policy.second);
@@ -4393,6 +4518,7 @@ status_t AudioPolicyManager::setPreferredMixerAttributes(
         audio_port_handle_t portId,
         uid_t uid,
         const audio_mixer_attributes_t *mixerAttributes) {
+    invalidateOutputRoutingCache();
     ALOGV("%s, attr=%s, mixerAttributes={format=%#x, channelMask=%#x, samplingRate=%u, "
           "mixerBehavior=%d}, uid=%d, portId=%u",
           __func__, toString(*attr).c_str(), mixerAttributes->config.format,
@@ -4513,6 +4639,7 @@ status_t AudioPolicyManager::getPreferredMixerAttributes(
 status_t AudioPolicyManager::clearPreferredMixerAttributes(const audio_attributes_t *attr,
                                                            audio_port_handle_t portId,
                                                            uid_t uid) {
+    invalidateOutputRoutingCache();
     const product_strategy_t strategy = mEngine->getProductStrategyForAttributes(*attr);
     const auto preferredMixerAttrInfo = getPreferredMixerAttributesInfo(portId, strategy);
     if (preferredMixerAttrInfo == nullptr) {
@@ -5932,6 +6059,7 @@ status_t AudioPolicyManager::getSpatializerOutput(const audio_config_base_t *mix
             ALOGV("%s adding opened spatializer Output %d", __func__, desc->mIoHandle);
         }
     }
+    invalidateOutputRoutingCache();
     mSpatializerOutput.clear();
     bool outputsChanged = false;
     for (const auto& desc : spatializerOutputs) {
@@ -6249,6 +6377,7 @@ void AudioPolicyManager::onNewAudioModulesAvailableInt(DeviceVector *newDevices)
 void AudioPolicyManager::addOutput(audio_io_handle_t output,
                                    const sp<SwAudioOutputDescriptor>& outputDesc)
 {
+    invalidateOutputRoutingCache();
     mOutputs.add(output, outputDesc);
     applyStreamVolumes(outputDesc, DeviceTypeSet(), 0 /* delayMs */, true /* force */);
     updateMono(output); // update mono status when adding to output list
@@ -6258,6 +6387,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output,
 
 void AudioPolicyManager::removeOutput(audio_io_handle_t output)
 {
+    invalidateOutputRoutingCache();
     if (mPrimaryOutput != 0 && mPrimaryOutput == mOutputs.valueFor(output)) {
         ALOGV("%s: removing primary output", __func__);
         mPrimaryOutput = nullptr;
@@ -6751,47 +6881,109 @@ void AudioPolicyManager::clearAudioSourcesForOutput(audio_io_handle_t output)
     }
 }
 
-void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr)
+AudioPolicyManager::OutputChanges AudioPolicyManager::getOutputChanges() const
+{
+    OutputChanges changes;
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        if (mPreviousOutputs.valueFor(mOutputs.keyAt(i)) != mOutputs.valueAt(i)) {
+            changes.openedOrClosedOutputs.push_back(mOutputs.valueAt(i));
+        }
+    }
+    for (size_t i = 0; i < mPreviousOutputs.size(); i++) {
+        const sp<SwAudioOutputDescriptor>& desc = mPreviousOutputs.valueAt(i);
+        if (mOutputs.valueFor(mPreviousOutputs.keyAt(i)) != desc) {
+            changes.openedOrClosedOutputs.push_back(desc);
+        }
+        if (desc->isDuplicated()) {
+            continue;
+        }
+        for (const sp<TrackClientDescriptor>& client : desc->getClientIterable()) {
+            changes.previousClientsByStrategy[
+                    mEngine->getProductStrategyForAttributes(client->attributes())]
+                    .emplace_back(desc, client);
+        }
+    }
+    return changes;
+}
+
+bool AudioPolicyManager::OutputChanges::affects(const DeviceVector &devices) const
+{
+    for (const auto &desc : openedOrClosedOutputs) {
+        if (desc->supportsAllDevices(devices)
+                && desc->devicesSupportEncodedFormats(devices.types())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr,
+                                                  const OutputChanges *changes)
 {
     auto psId = mEngine->getProductStrategyForAttributes(attr);
 
     DeviceVector oldDevices = mEngine->getOutputDevicesForAttributes(attr, 0, true /*fromCache*/);
     DeviceVector newDevices = mEngine->getOutputDevicesForAttributes(attr, 0, false /*fromCache*/);
 
-    SortedVector<audio_io_handle_t> srcOutputs = getOutputsForDevices(oldDevices, mPreviousOutputs);
-    SortedVector<audio_io_handle_t> dstOutputs = getOutputsForDevices(newDevices, mOutputs);
+    // When the strategy keeps its devices and no opened or closed output can reach them, the
+    // outputs reaching its devices are necessarily the same before and after the change.
+    const bool outputsUnchanged = changes != nullptr && oldDevices == newDevices
+            && !changes->affects(newDevices);
+    SortedVector<audio_io_handle_t> srcOutputs;
+    SortedVector<audio_io_handle_t> dstOutputs;
+    if (!outputsUnchanged) {
+        srcOutputs = getOutputsForDevices(oldDevices, mPreviousOutputs);
+        dstOutputs = getOutputsForDevices(newDevices, mOutputs);
+    }
 
     uint32_t maxLatency = 0;
     bool unneededUsePrimaryOutputFromPolicyMixes = false;
     std::vector<sp<SwAudioOutputDescriptor>> invalidatedOutputs;
     // take into account dynamic audio policies related changes: if a client is now associated
     // to a different policy mix than at creation time, invalidate corresponding stream
-    for (size_t i = 0; i < mPreviousOutputs.size(); i++) {
-        const sp<SwAudioOutputDescriptor>& desc = mPreviousOutputs.valueAt(i);
-        if (desc->isDuplicated()) {
-            continue;
+    auto checkClientPolicyMix = [&](const sp<SwAudioOutputDescriptor>& desc,
+                                    const sp<TrackClientDescriptor>& client) {
+        sp<AudioPolicyMix> primaryMix;
+        status_t status = mPolicyMixes.getOutputForAttr(client->attributes(), client->config(),
+                client->uid(), client->session(), client->flags(), mAvailableOutputDevices,
+                nullptr /* requestedDevice */, primaryMix, nullptr /* secondaryMixes */,
+                unneededUsePrimaryOutputFromPolicyMixes);
+        if (status != OK) {
+            return;
         }
-        for (const sp<TrackClientDescriptor>& client : desc->getClientIterable()) {
-            if (mEngine->getProductStrategyForAttributes(client->attributes()) != psId) {
-                continue;
+        if (client->getPrimaryMix() != primaryMix || client->hasLostPrimaryMix()) {
+            if (desc->isStrategyActive(psId) && maxLatency < desc->latency()) {
+                maxLatency = desc->latency();
             }
-            sp<AudioPolicyMix> primaryMix;
-            status_t status = mPolicyMixes.getOutputForAttr(client->attributes(), client->config(),
-                    client->uid(), client->session(), client->flags(), mAvailableOutputDevices,
-                    nullptr /* requestedDevice */, primaryMix, nullptr /* secondaryMixes */,
-                    unneededUsePrimaryOutputFromPolicyMixes);
-            if (status != OK) {
+            invalidatedOutputs.push_back(desc);
+        }
+    };
+    if (changes != nullptr) {
+        if (auto it = changes->previousClientsByStrategy.find(psId);
+                it != changes->previousClientsByStrategy.end()) {
+            for (const auto& [desc, client] : it->second) {
+                checkClientPolicyMix(desc, client);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < mPreviousOutputs.size(); i++) {
+            const sp<SwAudioOutputDescriptor>& desc = mPreviousOutputs.valueAt(i);
+            if (desc->isDuplicated()) {
                 continue;
             }
-            if (client->getPrimaryMix() != primaryMix || client->hasLostPrimaryMix()) {
-                if (desc->isStrategyActive(psId) && maxLatency < desc->latency()) {
-                    maxLatency = desc->latency();
+            for (const sp<TrackClientDescriptor>& client : desc->getClientIterable()) {
+                if (mEngine->getProductStrategyForAttributes(client->attributes()) == psId) {
+                    checkClientPolicyMix(desc, client);
                 }
-                invalidatedOutputs.push_back(desc);
             }
         }
     }
 
+    if (outputsUnchanged && !invalidatedOutputs.empty()) {
+        srcOutputs = getOutputsForDevices(oldDevices, mPreviousOutputs);
+        dstOutputs = srcOutputs;
+    }
+
     if (srcOutputs != dstOutputs || !invalidatedOutputs.empty()) {
         // get maximum latency of all source outputs to determine the minimum mute time guaranteeing
         // audio from invalidated tracks will be rendered when unmuting
@@ -6867,10 +7059,17 @@ void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr
 
 void AudioPolicyManager::checkOutputForAllStrategies()
 {
+    OutputChanges changes = getOutputChanges();
+    uint32_t portGeneration = curAudioPortGeneration();
     for (const auto &strategy : mEngine->getOrderedProductStrategies()) {
         auto attributes = mEngine->getAllAttributesForProductStrategy(strategy).front();
-        checkOutputForAttributes(attributes);
+        checkOutputForAttributes(attributes, &changes);
         checkAudioSourceForAttributes(attributes);
+        // reconnecting audio sources may open or close outputs
+        if (curAudioPortGeneration() != portGeneration) {
+            changes = getOutputChanges();
+            portGeneration = curAudioPortGeneration();
+        }
     }
 }
 
@@ -7215,6 +7414,7 @@ uint32_t AudioPolicyManager::setBeaconMute(bool mute) {
 
 void AudioPolicyManager::updateDevicesAndOutputs()
 {
+    invalidateOutputRoutingCache();
     mEngine->updateDeviceSelectionCache();
     mPreviousOutputs = mOutputs;
 }
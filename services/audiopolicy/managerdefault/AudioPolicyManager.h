@@ -18,7 +18,9 @@
 
 #include <atomic>
 #include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <unordered_set>
 
 #include <stdint.h>
@@ -684,8 +686,12 @@ protected:
          * attributes changes: connected device, phone state, force use...
          * Must be called before updateDevicesAndOutputs()
          * @param attr to be considered
+         * @param changes if not null, the output changes shared by all strategies being checked,
+         *        used to skip the output re-evaluation when nothing the strategy depends on changed
          */
-        void checkOutputForAttributes(const audio_attributes_t &attr);
+        struct OutputChanges;
+        void checkOutputForAttributes(const audio_attributes_t &attr,
+                                      const OutputChanges *changes = nullptr);
 
         /**
          * @brief checkAudioSourceForAttributes checks if any AudioSource following the same routing
@@ -700,6 +706,22 @@ protected:
         bool followsSameRouting(const audio_attributes_t &lAttr,
                                 const audio_attributes_t &rAttr) const;
 
+        /**
+         * @brief OutputChanges summarizes what changed between mPreviousOutputs and mOutputs so
+         * that each strategy is only re-evaluated against the outputs that can affect it.
+         */
+        struct OutputChanges {
+            // outputs opened or closed since mPreviousOutputs was captured
+            std::vector<sp<SwAudioOutputDescriptor>> openedOrClosedOutputs;
+            // clients of the non duplicated outputs in mPreviousOutputs, by product strategy
+            std::map<product_strategy_t, std::vector<std::pair<sp<SwAudioOutputDescriptor>,
+                    sp<TrackClientDescriptor>>>> previousClientsByStrategy;
+
+            // true if an opened or closed output can reach all the given devices
+            bool affects(const DeviceVector &devices) const;
+        };
+        OutputChanges getOutputChanges() const;
+
         /**
          * @brief checkOutputForAllStrategies Same as @see checkOutputForAttributes()
          *      but for a all product strategies in order of priority
@@ -982,6 +1004,47 @@ protected:
 
         std::unordered_map<uid_t, audio_flags_mask_t> mAllowedCapturePolicies;
 
+        // Routing decisions of getOutputForAttrInt() for tracks the engine routes to a mixed
+        // output. An entry is only valid for the generation it was computed in.
+        struct OutputRoutingKey {
+            audio_usage_t usage;
+            audio_content_type_t contentType;
+            audio_source_t source;
+            audio_flags_mask_t attrFlags;
+            std::string tags;
+            audio_session_t session;
+            uid_t uid;
+            audio_port_handle_t requestedPortId;
+            audio_output_flags_t flags;
+            uint32_t sampleRate;
+            audio_channel_mask_t channelMask;
+            audio_format_t format;
+
+            bool operator<(const OutputRoutingKey &other) const {
+                return std::tie(usage, contentType, source, attrFlags, tags, session, uid,
+                                requestedPortId, flags, sampleRate, channelMask, format) <
+                        std::tie(other.usage, other.contentType, other.source, other.attrFlags,
+                                other.tags, other.session, other.uid, other.requestedPortId,
+                                other.flags, other.sampleRate, other.channelMask, other.format);
+            }
+        };
+        struct OutputRoutingDecision {
+            uint32_t generation;
+            audio_io_handle_t output;
+            audio_output_flags_t flags;
+            audio_port_handle_t selectedDeviceId;
+        };
+        static constexpr size_t kMaxOutputRoutingCacheSize = 64;
+        std::map<OutputRoutingKey, OutputRoutingDecision> mOutputRoutingCache;
+        uint32_t mOutputRoutingGeneration = 0;
+        // the engine treats music stopped less than SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY
+        // ago as active, so decisions taken in that window are not memoized.
+        nsecs_t mLastSourceStopTime = 0;
+        uint64_t mOutputRoutingCacheHits = 0;
+        uint64_t mOutputRoutingCacheMisses = 0;
+        nsecs_t mOutputRoutingHitTimeNs = 0;
+        nsecs_t mOutputRoutingMissTimeNs = 0;
+
         // The map of device descriptor and formats reported by the device.
         std::map<wp<DeviceDescriptor>, FormatVector> mReportedFormatsMap;
 
@@ -1079,6 +1142,14 @@ private:
                 output_type_t *outputType,
                 bool *isSpatialized,
                 bool *isBitPerfect);
+        // internal methods managing the memoized getOutputForAttrInt() decisions.
+        // invalidateOutputRoutingCache() must be called whenever state consulted by the engine,
+        // the policy mixes or output selection changes.
+        void invalidateOutputRoutingCache();
+        bool isOutputRoutingCacheable(const audio_attributes_t &attr,
+                audio_output_flags_t flags,
+                const audio_config_t &config) const;
+        void recordOutputRoutingLookup(bool hit, nsecs_t startNs);
         // internal method to return the output handle for the given device and format
         audio_io_handle_t getOutputForDevices(
                 const DeviceVector &devices,
@@ -130,6 +130,8 @@ SpatializerPoseController::SpatializerPoseController(Listener* listener,
           while (true) {
               Pose3f headToStage;
               std::optional<HeadTrackingMode> modeIfChanged;
+              std::optional<int64_t> headPoseTimestamp;
+              int64_t calculateNs = 0;
               {
                   std::unique_lock lock(mMutex);
                   if (maxUpdatePeriod.has_value()) {
@@ -143,12 +145,26 @@ SpatializerPoseController::SpatializerPoseController(Listener* listener,
                       return;
                   }
 
+                  // Measure the latency once for each new head pose.
+                  if (mHeadPoseTimestamp != mCalculatedHeadPoseTimestamp) {
+                      headPoseTimestamp = mCalculatedHeadPoseTimestamp = mHeadPoseTimestamp;
+                      calculateNs = elapsedRealtimeNano();
+                  }
+
                   // Calculate.
                   std::tie(headToStage, modeIfChanged) = calculate_l();
               }
 
               // Invoke the callbacks outside the lock.
               mListener->onHeadToStagePose(headToStage);
+              if (headPoseTimestamp) {
+                  constexpr float NANOS_TO_MILLIS = 1e-6;
+                  const std::vector<float> latencyMs{
+                          (calculateNs - headPoseTimestamp.value()) * NANOS_TO_MILLIS,
+                          (elapsedRealtimeNano() - headPoseTimestamp.value()) * NANOS_TO_MILLIS};
+                  mHeadLatencyRecorder.record(latencyMs);
+                  mHeadLatencyDurableRecorder.record(latencyMs);
+              }
               if (modeIfChanged) {
                   mListener->onActualModeChange(modeIfChanged.value());
               }
@@ -305,53 +321,72 @@ void SpatializerPoseController::recenter() {
 
 void SpatializerPoseController::onPose(int64_t timestamp, int32_t sensor, const Pose3f& pose,
                                        const std::optional<Twist3f>& twist, bool isNewReference) {
+    media::PoseBatch poses;
+    poses.push_back(timestamp, pose, twist.value_or(Twist3f()));
+    onPoses(sensor, poses, twist.has_value(), isNewReference);
+}
+
+void SpatializerPoseController::onPoses(int32_t sensor, const media::PoseBatch& poses,
+                                        bool hasTwist, bool isNewReference) {
+    if (poses.empty()) return;
     std::lock_guard lock(mMutex);
     constexpr float NANOS_TO_MILLIS = 1e-6;
     constexpr float RAD_TO_DEGREE = 180.f / M_PI;
 
-    const float delayMs = (elapsedRealtimeNano() - timestamp) * NANOS_TO_MILLIS; // CLOCK_BOOTTIME
+    const int64_t nowNs = elapsedRealtimeNano(); // CLOCK_BOOTTIME
 
     if (sensor == mHeadSensor) {
-        std::vector<float> pryprydt(8);  // pitch, roll, yaw, d_pitch, d_roll, d_yaw,
-                                         // discontinuity, timestamp_delay
-        media::quaternionToAngles(pose.rotation(), &pryprydt[0], &pryprydt[1], &pryprydt[2]);
-        if (twist) {
-            const auto rotationalVelocity = twist->rotationalVelocity();
-            // The rotational velocity is an intrinsic transform (i.e. based on the head
-            // coordinate system, not the world coordinate system).  It is a 3 element vector:
-            // axis (d theta / dt).
-            //
-            // We leave rotational velocity relative to the head coordinate system,
-            // as the initial head tracking sensor's world frame is arbitrary.
-            media::quaternionToAngles(media::rotationVectorToQuaternion(rotationalVelocity),
-                    &pryprydt[3], &pryprydt[4], &pryprydt[5]);
-        }
-        pryprydt[6] = isNewReference;
-        pryprydt[7] = delayMs;
-        for (size_t i = 0; i < 6; ++i) {
-            // pitch, roll, yaw in degrees, referenced in degrees on the world frame.
-            // d_pitch, d_roll, d_yaw rotational velocity in degrees/s, based on the world frame.
-            pryprydt[i] *= RAD_TO_DEGREE;
+        for (size_t i = 0; i < poses.size(); ++i) {
+            std::vector<float> pryprydt(8);  // pitch, roll, yaw, d_pitch, d_roll, d_yaw,
+                                             // discontinuity, timestamp_delay
+            media::quaternionToAngles(poses.pose(i).rotation(),
+                    &pryprydt[0], &pryprydt[1], &pryprydt[2]);
+            if (hasTwist) {
+                const auto rotationalVelocity = poses.twist(i).rotationalVelocity();
+                // The rotational velocity is an intrinsic transform (i.e. based on the head
+                // coordinate system, not the world coordinate system).  It is a 3 element vector:
+                // axis (d theta / dt).
+                //
+                // We leave rotational velocity relative to the head coordinate system,
+                // as the initial head tracking sensor's world frame is arbitrary.
+                media::quaternionToAngles(media::rotationVectorToQuaternion(rotationalVelocity),
+                        &pryprydt[3], &pryprydt[4], &pryprydt[5]);
+            }
+            pryprydt[6] = isNewReference && i == poses.size() - 1;
+            pryprydt[7] = (nowNs - poses.timestamp(i)) * NANOS_TO_MILLIS;
+            for (size_t j = 0; j < 6; ++j) {
+                // pitch, roll, yaw in degrees, referenced in degrees on the world frame.
+                // d_pitch, d_roll, d_yaw rotational velocity in degrees/s, based on the world
+                // frame.
+                pryprydt[j] *= RAD_TO_DEGREE;
+            }
+            mHeadSensorRecorder.record(pryprydt);
+            mHeadSensorDurableRecorder.record(pryprydt);
         }
-        mHeadSensorRecorder.record(pryprydt);
-        mHeadSensorDurableRecorder.record(pryprydt);
 
-        mProcessor->setWorldToHeadPose(timestamp, pose,
-                                       twist.value_or(Twist3f()) / kTicksPerSecond);
+        mHeadPoses = poses;
+        mHeadPoses.scaleTwists(1.f / kTicksPerSecond);
+        mProcessor->setWorldToHeadPoses(mHeadPoses);
+        mHeadPoseTimestamp = poses.timestamp(poses.size() - 1);
         if (isNewReference) {
             mProcessor->recenter(true, false, __func__);
         }
     }
     if (sensor == mScreenSensor) {
-        std::vector<float> pryt{ 0.f, 0.f, 0.f, delayMs}; // pitch, roll, yaw, timestamp_delay
-        media::quaternionToAngles(pose.rotation(), &pryt[0], &pryt[1], &pryt[2]);
-        for (size_t i = 0; i < 3; ++i) {
-            pryt[i] *= RAD_TO_DEGREE;
-        }
-        mScreenSensorRecorder.record(pryt);
-        mScreenSensorDurableRecorder.record(pryt);
+        for (size_t i = 0; i < poses.size(); ++i) {
+            // pitch, roll, yaw, timestamp_delay
+            std::vector<float> pryt{ 0.f, 0.f, 0.f,
+                    (nowNs - poses.timestamp(i)) * NANOS_TO_MILLIS};
+            const Pose3f pose = poses.pose(i);
+            media::quaternionToAngles(pose.rotation(), &pryt[0], &pryt[1], &pryt[2]);
+            for (size_t j = 0; j < 3; ++j) {
+                pryt[j] *= RAD_TO_DEGREE;
+            }
+            mScreenSensorRecorder.record(pryt);
+            mScreenSensorDurableRecorder.record(pryt);
 
-        mProcessor->setWorldToScreenPose(timestamp, pose);
+            mProcessor->setWorldToScreenPose(poses.timestamp(i), pose);
+        }
         if (isNewReference) {
             mProcessor->recenter(false, true, __func__);
         }
@@ -387,6 +422,15 @@ std::string SpatializerPoseController::toString(unsigned level) const {
             .append(mHeadSensorRecorder.toString(level + 3));
     }
 
+    ss += prefixSpace;
+    ss += "HeadPoseLatency [ calculation : update ] (ms)\n";
+    ss.append(prefixSpace)
+        .append(" PerMinuteHistory:\n")
+        .append(mHeadLatencyDurableRecorder.toString(level + 3))
+        .append(prefixSpace)
+        .append(" PerSecondHistory:\n")
+        .append(mHeadLatencyRecorder.toString(level + 3));
+
     ss += prefixSpace;
     if (mScreenSensor == INVALID_SENSOR) {
         ss += "ScreenSensor: INVALID\n";
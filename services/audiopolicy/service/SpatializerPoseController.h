@@ -23,6 +23,7 @@
 #include <thread>
 
 #include <media/HeadTrackingProcessor.h>
+#include <media/PoseBatch.h>
 #include <media/SensorPoseProvider.h>
 #include <media/VectorRecorder.h>
 
@@ -144,6 +145,21 @@ class SpatializerPoseController : private media::SensorPoseProvider::Listener {
         4 /* vectorSize */, std::chrono::minutes(1), 10 /* maxLogLine */,
         { 3 } /* delimiterIdx */};
 
+    // Latency from the timestamp of the latest head pose to the start of the calculation and to
+    // the return of the pose callback, which updates the spatializer.
+    media::VectorRecorder mHeadLatencyRecorder{
+        2 /* vectorSize */, std::chrono::seconds(1), 10 /* maxLogLine */,
+        { 1 } /* delimiterIdx */};
+    media::VectorRecorder mHeadLatencyDurableRecorder{
+        2 /* vectorSize */, std::chrono::minutes(1), 10 /* maxLogLine */,
+        { 1 } /* delimiterIdx */};
+    // Timestamp of the latest head pose, and of the one the latency was last recorded for.
+    std::optional<int64_t> mHeadPoseTimestamp;
+    std::optional<int64_t> mCalculatedHeadPoseTimestamp;
+
+    // Head poses handed to mProcessor, with twists per tick.
+    media::PoseBatch mHeadPoses;
+
     // Next to last variable as releasing this stops the callbacks
     std::unique_ptr<media::SensorPoseProvider> mPoseProvider;
 
@@ -154,6 +170,9 @@ class SpatializerPoseController : private media::SensorPoseProvider::Listener {
     void onPose(int64_t timestamp, int32_t sensor, const media::Pose3f& pose,
                 const std::optional<media::Twist3f>& twist, bool isNewReference) override;
 
+    void onPoses(int32_t sensor, const media::PoseBatch& poses, bool hasTwist,
+                 bool isNewReference) override;
+
     /**
      * Calculates the new outputs and updates internal state. Must be called with the lock held.
      * Returns values that should be passed to the respective callbacks.
@@ -42,7 +42,10 @@ class AudioPolicyTestManager : public AudioPolicyManager {
     using AudioPolicyManager::setDeviceConnectionState;
     using AudioPolicyManager::deviceToAudioPort;
     using AudioPolicyManager::handleDeviceConfigChange;
+    using AudioPolicyManager::applyStreamVolumes;
     uint32_t getAudioPortGeneration() const { return mAudioPortGeneration; }
+    uint64_t getOutputRoutingCacheHits() const { return mOutputRoutingCacheHits; }
+    uint64_t getOutputRoutingCacheMisses() const { return mOutputRoutingCacheMisses; }
 };
 
 }  // namespace android
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <media/AudioProfile.h>
+
+#include "AudioPolicyManagerTestClient.h"
+#include "AudioPolicyTestManager.h"
+
+using namespace android;
+
+namespace {
+
+constexpr uint32_t k48000SamplingRate = 48000;
+
+// Default configuration extended with 'busCount' attached bus devices, each served by its own
+// output, and a USB device that can be connected on demand.
+sp<AudioPolicyConfig> createSyntheticConfig(size_t busCount) {
+    sp<AudioPolicyConfig> config = AudioPolicyConfig::createWritableForTests();
+    config->setDefault();
+    sp<HwModule> primaryModule =
+            config->getHwModules().getModuleFromName(AUDIO_HARDWARE_MODULE_ID_PRIMARY);
+    sp<AudioProfile> pcmProfile = new AudioProfile(
+            AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO, k48000SamplingRate);
+
+    for (size_t i = 0; i < busCount; ++i) {
+        const std::string name = "bus" + std::to_string(i);
+        sp<DeviceDescriptor> busDevice = new DeviceDescriptor(AUDIO_DEVICE_OUT_BUS, name, name);
+        busDevice->addAudioProfile(pcmProfile);
+        config->addDevice(busDevice);
+        sp<OutputProfile> busOutputProfile = new OutputProfile(name);
+        busOutputProfile->addAudioProfile(pcmProfile);
+        busOutputProfile->addSupportedDevice(busDevice);
+        primaryModule->addOutputProfile(busOutputProfile);
+    }
+
+    sp<DeviceDescriptor> usbDevice = new DeviceDescriptor(AUDIO_DEVICE_OUT_USB_DEVICE);
+    usbDevice->addAudioProfile(pcmProfile);
+    sp<OutputProfile> usbOutputProfile = new OutputProfile("usb");
+    usbOutputProfile->addAudioProfile(pcmProfile);
+    usbOutputProfile->addSupportedDevice(usbDevice);
+    primaryModule->addOutputProfile(usbOutputProfile);
+    DeviceVector declaredDevices = primaryModule->getDeclaredDevices();
+    declaredDevices.add(usbDevice);
+    primaryModule->setDeclaredDevices(declaredDevices);
+    return config;
+}
+
+// Times a USB output device connection followed by its disconnection.
+void BM_UsbConnectDisconnect(benchmark::State& state) {
+    const size_t busCount = state.range(0);
+    AudioPolicyManagerTestClient client;
+    client.addSupportedFormat(AUDIO_FORMAT_PCM_16_BIT);
+    client.addSupportedChannelMask(AUDIO_CHANNEL_OUT_STEREO);
+    auto manager = std::make_unique<AudioPolicyTestManager>(
+            createSyntheticConfig(busCount), &client);
+    if (manager->initialize() != NO_ERROR) {
+        state.SkipWithError("Failed to initialize the audio policy manager");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (manager->setDeviceConnectionState(AUDIO_DEVICE_OUT_USB_DEVICE,
+                AUDIO_POLICY_DEVICE_STATE_AVAILABLE, "", "", AUDIO_FORMAT_DEFAULT) != NO_ERROR
+                || manager->setDeviceConnectionState(AUDIO_DEVICE_OUT_USB_DEVICE,
+                AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE, "", "", AUDIO_FORMAT_DEFAULT)
+                        != NO_ERROR) {
+            state.SkipWithError("Failed to toggle the USB device");
+            return;
+        }
+    }
+    state.counters["outputs"] = manager->getOutputs().size();
+}
+
+// Times re-applying the volume of every stream to every output, as done when the devices of
+// an output change, with each stream swept through its volume index range.
+void BM_ApplyStreamVolumes(benchmark::State& state) {
+    const size_t busCount = state.range(0);
+    constexpr int kIndexMax = 15;
+    AudioPolicyManagerTestClient client;
+    client.addSupportedFormat(AUDIO_FORMAT_PCM_16_BIT);
+    client.addSupportedChannelMask(AUDIO_CHANNEL_OUT_STEREO);
+    auto manager = std::make_unique<AudioPolicyTestManager>(
+            createSyntheticConfig(busCount), &client);
+    if (manager->initialize() != NO_ERROR) {
+        state.SkipWithError("Failed to initialize the audio policy manager");
+        return;
+    }
+    for (int stream = 0; stream < AUDIO_STREAM_PUBLIC_CNT; ++stream) {
+        manager->initStreamVolume(static_cast<audio_stream_type_t>(stream), 0, kIndexMax);
+    }
+
+    int index = 0;
+    size_t volumeUpdates = 0;
+    for (auto _ : state) {
+        for (int stream = 0; stream < AUDIO_STREAM_PUBLIC_CNT; ++stream) {
+            manager->setStreamVolumeIndex(static_cast<audio_stream_type_t>(stream), index,
+                    AUDIO_DEVICE_OUT_SPEAKER);
+        }
+        index = (index + 1) % (kIndexMax + 1);
+        const SwAudioOutputCollection& outputs = manager->getOutputs();
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            manager->applyStreamVolumes(outputs.valueAt(i), outputs.valueAt(i)->devices().types(),
+                    0 /*delayMs*/, true /*force*/);
+            ++volumeUpdates;
+        }
+    }
+    state.counters["outputs"] = manager->getOutputs().size();
+    state.counters["applyStreamVolumes"] =
+            benchmark::Counter(volumeUpdates, benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(BM_UsbConnectDisconnect)->Arg(0)->Arg(8)->Arg(32)->Arg(64);
+BENCHMARK(BM_ApplyStreamVolumes)->Arg(0)->Arg(8)->Arg(32);
+
+BENCHMARK_MAIN();
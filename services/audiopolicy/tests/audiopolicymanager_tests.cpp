@@ -38,6 +38,7 @@
 #include "AudioPolicyManagerTestClient.h"
 #include "AudioPolicyTestClient.h"
 #include "AudioPolicyTestManager.h"
+#include "VolumeCurve.h"
 
 using namespace android;
 using testing::UnorderedElementsAre;
@@ -124,6 +125,104 @@ TEST(AudioPolicyConfigTest, LoadForTests) {
     }
 }
 
+TEST(AudioPolicyConfigTest, SnapshotRoundTrip) {
+    const std::string source =
+            base::GetExecutableDirectory() + "/test_audio_policy_configuration.xml";
+    auto result = AudioPolicyConfig::loadFromCustomXmlConfigForTests(source);
+    ASSERT_TRUE(result.ok());
+    sp<AudioPolicyConfig> parsed = result.value();
+
+    TemporaryDir tempDir;
+    const std::string snapshot = std::string(tempDir.path) + "/config.snapshot";
+    uint64_t sourceHash = 0;
+    ASSERT_EQ(NO_ERROR, hashAudioPolicyFile(source.c_str(), &sourceHash));
+    ASSERT_EQ(NO_ERROR, writeAudioPolicySnapshot(snapshot.c_str(), sourceHash, *parsed));
+
+    auto stale = AudioPolicyConfig::createWritableForTests();
+    EXPECT_EQ(NOT_ENOUGH_DATA,
+            readAudioPolicySnapshot(snapshot.c_str(), sourceHash + 1, stale.get()));
+
+    auto loaded = AudioPolicyConfig::createWritableForTests();
+    ASSERT_EQ(NO_ERROR, readAudioPolicySnapshot(snapshot.c_str(), sourceHash, loaded.get()));
+    EXPECT_EQ(parsed->getSource(), loaded->getSource());
+    EXPECT_EQ(parsed->getEngineLibraryNameSuffix(), loaded->getEngineLibraryNameSuffix());
+    EXPECT_EQ(parsed->isCallScreenModeSupported(), loaded->isCallScreenModeSupported());
+    EXPECT_EQ(parsed->getSurroundFormats(), loaded->getSurroundFormats());
+    ASSERT_EQ(parsed->getOutputDevices().size(), loaded->getOutputDevices().size());
+    ASSERT_EQ(parsed->getInputDevices().size(), loaded->getInputDevices().size());
+    ASSERT_NE(nullptr, loaded->getDefaultOutputDevice());
+    EXPECT_EQ(parsed->getDefaultOutputDevice()->getTagName(),
+            loaded->getDefaultOutputDevice()->getTagName());
+
+    const HwModuleCollection& parsedModules = parsed->getHwModules();
+    const HwModuleCollection& loadedModules = loaded->getHwModules();
+    ASSERT_EQ(parsedModules.size(), loadedModules.size());
+    for (size_t i = 0; i < parsedModules.size(); ++i) {
+        const sp<HwModule>& parsedModule = parsedModules[i];
+        const sp<HwModule>& loadedModule = loadedModules[i];
+        EXPECT_STREQ(parsedModule->getName(), loadedModule->getName());
+        EXPECT_EQ(parsedModule->getHalVersionMajor(), loadedModule->getHalVersionMajor());
+        EXPECT_EQ(parsedModule->getRoutes().size(), loadedModule->getRoutes().size());
+        ASSERT_EQ(parsedModule->getOutputProfiles().size(),
+                loadedModule->getOutputProfiles().size());
+        for (size_t j = 0; j < parsedModule->getOutputProfiles().size(); ++j) {
+            const sp<IOProfile>& parsedProfile = parsedModule->getOutputProfiles()[j];
+            const sp<IOProfile>& loadedProfile = loadedModule->getOutputProfiles()[j];
+            EXPECT_EQ(parsedProfile->getName(), loadedProfile->getName());
+            EXPECT_EQ(parsedProfile->getFlags(), loadedProfile->getFlags());
+            EXPECT_EQ(parsedProfile->maxOpenCount, loadedProfile->maxOpenCount);
+            EXPECT_EQ(parsedProfile->getAudioProfiles().size(),
+                    loadedProfile->getAudioProfiles().size());
+            EXPECT_EQ(parsedProfile->getSupportedDevices().size(),
+                    loadedProfile->getSupportedDevices().size());
+        }
+        EXPECT_EQ(parsedModule->getInputProfiles().size(),
+                loadedModule->getInputProfiles().size());
+        // Ports keep the document order, in which their gains are numbered.
+        ASSERT_EQ(parsedModule->getPorts().size(), loadedModule->getPorts().size());
+        for (size_t j = 0; j < parsedModule->getPorts().size(); ++j) {
+            EXPECT_EQ(parsedModule->getPorts()[j]->getTagName(),
+                    loadedModule->getPorts()[j]->getTagName());
+        }
+        for (const auto& device : parsedModule->getDeclaredDevices()) {
+            sp<DeviceDescriptor> loadedDevice =
+                    loadedModule->getDeclaredDevices().getDeviceFromTagName(device->getTagName());
+            ASSERT_NE(nullptr, loadedDevice) << device->getTagName();
+            EXPECT_EQ(device->type(), loadedDevice->type());
+            EXPECT_EQ(device->address(), loadedDevice->address());
+            EXPECT_EQ(device->encodedFormats(), loadedDevice->encodedFormats());
+        }
+    }
+}
+
+TEST(VolumeCurveTest, LookupTableMatchesInterpolation) {
+    // Points of the default media curve and of a steep curve with a flat start.
+    const std::vector<std::vector<CurvePoint>> curvesPoints = {
+        {{1, -5800}, {20, -4000}, {60, -1700}, {100, 0}},
+        {{0, -9600}, {33, -9600}, {66, -2400}, {100, -600}},
+    };
+    const std::vector<std::pair<int, int>> indexRanges = {{0, 100}, {1, 15}, {0, 7}, {5, 30}};
+    for (const auto& points : curvesPoints) {
+        // Not added to a group, so it always interpolates.
+        sp<VolumeCurve> reference = new VolumeCurve(DEVICE_CATEGORY_SPEAKER);
+        sp<VolumeCurve> tabulated = new VolumeCurve(DEVICE_CATEGORY_SPEAKER);
+        for (const auto& point : points) {
+            reference->add(point);
+            tabulated->add(point);
+        }
+        VolumeCurves curves;
+        curves.add(tabulated);
+        for (const auto& [indexMin, indexMax] : indexRanges) {
+            SCOPED_TRACE(testing::Message() << "range " << indexMin << "-" << indexMax);
+            ASSERT_EQ(NO_ERROR, curves.initVolume(indexMin, indexMax));
+            for (int index = 0; index <= indexMax; ++index) {
+                EXPECT_EQ(reference->volIndexToDb(index, indexMin, indexMax),
+                        curves.volIndexToDb(DEVICE_CATEGORY_SPEAKER, index)) << index;
+            }
+        }
+    }
+}
+
 TEST(AudioPolicyManagerTestInit, EngineFailure) {
     AudioPolicyTestClient client;
     auto config = AudioPolicyConfig::createWritableForTests();
@@ -1137,6 +1236,71 @@ TEST_F(AudioPolicyManagerTestWithConfigurationFile, RoutingChangedWithPreferredM
                                                            "", "", AUDIO_FORMAT_LDAC));
 }
 
+TEST_F(AudioPolicyManagerTestWithConfigurationFile, RepeatedOutputRoutingFollowsDeviceChanges) {
+    mClient->addSupportedFormat(AUDIO_FORMAT_PCM_16_BIT);
+    mClient->addSupportedChannelMask(AUDIO_CHANNEL_OUT_STEREO);
+    const audio_attributes_t sonificationAttr = {
+            .content_type = AUDIO_CONTENT_TYPE_SONIFICATION,
+            .usage = AUDIO_USAGE_GAME,
+    };
+    const audio_session_t session = static_cast<audio_session_t>(10);
+    const uid_t uid = 1234;
+
+    audio_port_handle_t firstDeviceId = AUDIO_PORT_HANDLE_NONE;
+    audio_io_handle_t firstOutput = AUDIO_IO_HANDLE_NONE;
+    getOutputForAttr(&firstDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+            k48000SamplingRate, AUDIO_OUTPUT_FLAG_NONE, &firstOutput, nullptr /*portId*/,
+            sonificationAttr, session, uid);
+
+    uint64_t hits = mManager->getOutputRoutingCacheHits();
+    uint64_t misses = mManager->getOutputRoutingCacheMisses();
+    EXPECT_LT(0u, misses);
+
+    // An identical request is answered with the same routing decision, from the cache.
+    for (int i = 0; i < 3; ++i) {
+        audio_port_handle_t deviceId = AUDIO_PORT_HANDLE_NONE;
+        audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
+        getOutputForAttr(&deviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                k48000SamplingRate, AUDIO_OUTPUT_FLAG_NONE, &output, nullptr /*portId*/,
+                sonificationAttr, session, uid);
+        EXPECT_EQ(firstDeviceId, deviceId);
+        EXPECT_EQ(firstOutput, output);
+        EXPECT_EQ(++hits, mManager->getOutputRoutingCacheHits());
+        EXPECT_EQ(misses, mManager->getOutputRoutingCacheMisses());
+    }
+
+    // Connecting a device must not leave the previous decision in place.
+    ASSERT_EQ(NO_ERROR, mManager->setDeviceConnectionState(AUDIO_DEVICE_OUT_USB_DEVICE,
+                                                           AUDIO_POLICY_DEVICE_STATE_AVAILABLE,
+                                                           "", "", AUDIO_FORMAT_DEFAULT));
+    audio_port_handle_t usbPortId = AUDIO_PORT_HANDLE_NONE;
+    for (auto device : mManager->getAvailableOutputDevices()) {
+        if (device->type() == AUDIO_DEVICE_OUT_USB_DEVICE) {
+            usbPortId = device->getId();
+            break;
+        }
+    }
+    ASSERT_NE(AUDIO_PORT_HANDLE_NONE, usbPortId);
+    audio_port_handle_t deviceId = AUDIO_PORT_HANDLE_NONE;
+    getOutputForAttr(&deviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+            k48000SamplingRate, AUDIO_OUTPUT_FLAG_NONE, nullptr /*output*/, nullptr /*portId*/,
+            sonificationAttr, session, uid);
+    EXPECT_EQ(usbPortId, deviceId);
+    EXPECT_EQ(hits, mManager->getOutputRoutingCacheHits());
+    EXPECT_EQ(++misses, mManager->getOutputRoutingCacheMisses());
+
+    ASSERT_EQ(NO_ERROR, mManager->setDeviceConnectionState(AUDIO_DEVICE_OUT_USB_DEVICE,
+                                                           AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE,
+                                                           "", "", AUDIO_FORMAT_DEFAULT));
+    deviceId = AUDIO_PORT_HANDLE_NONE;
+    getOutputForAttr(&deviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+            k48000SamplingRate, AUDIO_OUTPUT_FLAG_NONE, nullptr /*output*/, nullptr /*portId*/,
+            sonificationAttr, session, uid);
+    EXPECT_EQ(firstDeviceId, deviceId);
+    EXPECT_EQ(hits, mManager->getOutputRoutingCacheHits());
+    EXPECT_EQ(++misses, mManager->getOutputRoutingCacheMisses());
+}
+
 TEST_F(AudioPolicyManagerTestWithConfigurationFile, BitPerfectPlayback) {
     const audio_format_t bitPerfectFormat = AUDIO_FORMAT_PCM_16_BIT;
     const audio_channel_mask_t bitPerfectChannelMask = AUDIO_CHANNEL_OUT_QUAD;
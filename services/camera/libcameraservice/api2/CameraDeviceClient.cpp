@@ -490,8 +490,7 @@ binder::Status CameraDeviceClient::submitRequestList(
                 if (!mSupportedPhysicalRequestKeys.empty()) {
                     // Filter out any unsupported physical request keys.
                     CameraMetadata filteredParams(mSupportedPhysicalRequestKeys.size());
-                    camera_metadata_t *meta = const_cast<camera_metadata_t *>(
-                            filteredParams.getAndLock());
+                    camera_metadata_t *meta = filteredParams.getAndLockForWrite();
                     set_camera_metadata_vendor_id(meta, mDevice->getVendorTagId());
                     filteredParams.unlock(meta);
 
@@ -1965,6 +1964,9 @@ status_t CameraDeviceClient::dumpClient(int fd, const Vector<String16>& args) {
     } else {
         dprintf(fd, "      No output streams configured.\n");
     }
+    for (size_t i = 0; i < mCompositeStreamMap.size(); i++) {
+        mCompositeStreamMap.valueAt(i)->dump(fd);
+    }
     // TODO: print dynamic/request section from most recent requests
     mFrameProcessor->dump(fd, args);
 
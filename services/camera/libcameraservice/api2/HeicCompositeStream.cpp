@@ -68,7 +68,6 @@ HeicCompositeStream::HeicCompositeStream(sp<CameraDeviceBase> device,
         mYuvBufferAcquired(false),
         mProducerListener(new ProducerListener()),
         mDequeuedOutputBufferCnt(0),
-        mCodecOutputCounter(0),
         mQuality(-1),
         mGridTimestampUs(0),
         mStatusId(StatusTracker::NO_STATUS_ID) {
@@ -80,7 +79,6 @@ HeicCompositeStream::~HeicCompositeStream() {
     deinitCodec();
 
     mInputAppSegmentBuffers.clear();
-    mCodecOutputBuffers.clear();
 
     mAppSegmentStreamId = -1;
     mAppSegmentSurfaceId = -1;
@@ -164,7 +162,7 @@ status_t HeicCompositeStream::createInternalStreams(const std::vector<sp<Surface
     }
 
     if (!mUseGrid) {
-        res = mCodec->createInputSurface(&producer);
+        res = mCodecs[0].codec->createInputSurface(&producer);
         if (res != OK) {
             ALOGE("%s: Failed to create input surface for Heic codec: %s (%d)",
                     __FUNCTION__, strerror(-res), res);
@@ -178,11 +176,24 @@ status_t HeicCompositeStream::createInternalStreams(const std::vector<sp<Surface
     }
     mMainImageSurface = new Surface(producer);
 
-    res = mCodec->start();
-    if (res != OK) {
-        ALOGE("%s: Failed to start codec: %s (%d)", __FUNCTION__,
-                strerror(-res), res);
-        return res;
+    for (size_t i = 0; i < mCodecs.size(); i++) {
+        res = mCodecs[i].codec->start();
+        if (res != OK) {
+            if (i == 0) {
+                ALOGE("%s: Failed to start codec %zu: %s (%d)", __FUNCTION__, i,
+                        strerror(-res), res);
+                return res;
+            }
+            // Additional instances are best effort only. Tiles are assigned to instances by
+            // index, so drop this instance and the ones after it, which are not started yet.
+            ALOGW("%s: Failed to start codec %zu: %s (%d), using %zu codec instance(s)",
+                    __FUNCTION__, i, strerror(-res), res, i);
+            for (size_t j = i; j < mCodecs.size(); j++) {
+                releaseTileCodec(mCodecs[j]);
+            }
+            mCodecs.resize(i);
+            break;
+        }
     }
 
     std::vector<int> sourceSurfaceId;
@@ -275,7 +286,16 @@ void HeicCompositeStream::onBufferReleased(const BufferInfo& bufferInfo) {
 
     if (bufferInfo.mStreamId == mMainImageStreamId) {
         mMainImageFrameNumbers.push(bufferInfo.mFrameNumber);
-        mCodecOutputBufferFrameNumbers.push(bufferInfo.mFrameNumber);
+        for (auto& tileCodec : mCodecs) {
+            tileCodec.outputBufferFrameNumbers.push(bufferInfo.mFrameNumber);
+        }
+        if (!mUseGrid) {
+            // In surface mode the main image goes straight to the encoder.
+            auto inputFrame = mPendingInputFrames.find(bufferInfo.mFrameNumber);
+            if (inputFrame != mPendingInputFrames.end()) {
+                inputFrame->second.encodeStartTime = systemTime();
+            }
+        }
         ALOGV("%s: [%" PRId64 "]: Adding main image frame number (%zu frame numbers in total)",
                 __FUNCTION__, bufferInfo.mFrameNumber, mMainImageFrameNumbers.size());
     } else if (bufferInfo.mStreamId == mAppSegmentStreamId) {
@@ -399,42 +419,55 @@ bool HeicCompositeStream::isInMemoryTempFileSupported() {
     return true;
 }
 
-void HeicCompositeStream::onHeicOutputFrameAvailable(
+void HeicCompositeStream::onHeicOutputFrameAvailable(size_t codecIndex,
         const CodecOutputBufferInfo& outputBufferInfo) {
     Mutex::Autolock l(mMutex);
 
-    ALOGV("%s: index %d, offset %d, size %d, time %" PRId64 ", flags 0x%x",
-            __FUNCTION__, outputBufferInfo.index, outputBufferInfo.offset,
+    ALOGV("%s: codec %zu, index %d, offset %d, size %d, time %" PRId64 ", flags 0x%x",
+            __FUNCTION__, codecIndex, outputBufferInfo.index, outputBufferInfo.offset,
             outputBufferInfo.size, outputBufferInfo.timeUs, outputBufferInfo.flags);
 
+    if (codecIndex >= mCodecs.size()) {
+        ALOGE("%s: Invalid codec index %zu", __FUNCTION__, codecIndex);
+        return;
+    }
+    TileCodec& tileCodec = mCodecs[codecIndex];
+
     if (!mErrorState) {
         if ((outputBufferInfo.size > 0) &&
                 ((outputBufferInfo.flags & MediaCodec::BUFFER_FLAG_CODECCONFIG) == 0)) {
-            mCodecOutputBuffers.push_back(outputBufferInfo);
+            CodecOutputBufferInfo bufferInfo = outputBufferInfo;
+            bufferInfo.codecIndex = codecIndex;
+            bufferInfo.receivedTime = systemTime();
+            tileCodec.outputBuffers.push_back(bufferInfo);
             mInputReadyCondition.signal();
         } else {
             ALOGV("%s: Releasing output buffer: size %d flags: 0x%x ", __FUNCTION__,
                 outputBufferInfo.size, outputBufferInfo.flags);
-            mCodec->releaseOutputBuffer(outputBufferInfo.index);
+            tileCodec.codec->releaseOutputBuffer(outputBufferInfo.index);
         }
     } else {
-        mCodec->releaseOutputBuffer(outputBufferInfo.index);
+        tileCodec.codec->releaseOutputBuffer(outputBufferInfo.index);
     }
 }
 
-void HeicCompositeStream::onHeicInputFrameAvailable(int32_t index) {
+void HeicCompositeStream::onHeicInputFrameAvailable(size_t codecIndex, int32_t index) {
     Mutex::Autolock l(mMutex);
 
     if (!mUseGrid) {
         ALOGE("%s: Codec YUV input mode must only be used for Hevc tiling mode", __FUNCTION__);
         return;
     }
+    if (codecIndex >= mCodecs.size()) {
+        ALOGE("%s: Invalid codec index %zu", __FUNCTION__, codecIndex);
+        return;
+    }
 
-    mCodecInputBuffers.push_back(index);
+    mCodecs[codecIndex].inputBuffers.push_back(index);
     mInputReadyCondition.signal();
 }
 
-void HeicCompositeStream::onHeicFormatChanged(sp<AMessage>& newFormat) {
+void HeicCompositeStream::onHeicFormatChanged(size_t codecIndex, sp<AMessage>& newFormat) {
     if (newFormat == nullptr) {
         ALOGE("%s: newFormat must not be null!", __FUNCTION__);
         return;
@@ -442,6 +475,20 @@ void HeicCompositeStream::onHeicFormatChanged(sp<AMessage>& newFormat) {
 
     Mutex::Autolock l(mMutex);
 
+    if (codecIndex >= mCodecs.size()) {
+        ALOGE("%s: Invalid codec index %zu", __FUNCTION__, codecIndex);
+        return;
+    }
+    if (codecIndex != 0) {
+        // Only the primary codec's output format is passed to the muxer. Validate the
+        // secondary format now if the primary one is known, otherwise once it arrives.
+        mCodecs[codecIndex].outputFormat = newFormat;
+        if (mFormat != nullptr) {
+            validateTileCodecFormatLocked(codecIndex);
+        }
+        return;
+    }
+
     AString mime;
     AString mimeHeic(MIMETYPE_IMAGE_ANDROID_HEIC);
     newFormat->findString(KEY_MIME, &mime);
@@ -473,11 +520,29 @@ void HeicCompositeStream::onHeicFormatChanged(sp<AMessage>& newFormat) {
     }
 
     mFormat = newFormat;
+    for (size_t i = 1; i < mCodecs.size(); i++) {
+        if (mCodecs[i].outputFormat != nullptr) {
+            validateTileCodecFormatLocked(i);
+        }
+    }
 
     ALOGV("%s: mNumOutputTiles is %zu", __FUNCTION__, mNumOutputTiles);
     mInputReadyCondition.signal();
 }
 
+void HeicCompositeStream::validateTileCodecFormatLocked(size_t codecIndex) {
+    // Tiles from a secondary codec instance are muxed with the primary codec's parameter
+    // sets, so they are only decodable if both instances produce identical ones.
+    sp<ABuffer> csd, primaryCsd;
+    if (!mCodecs[codecIndex].outputFormat->findBuffer("csd-0", &csd) ||
+            !mFormat->findBuffer("csd-0", &primaryCsd) || csd->size() != primaryCsd->size() ||
+            memcmp(csd->data(), primaryCsd->data(), csd->size()) != 0) {
+        ALOGE("%s: Codec %zu codec specific data doesn't match the primary codec",
+                __FUNCTION__, codecIndex);
+        mErrorState = true;
+    }
+}
+
 void HeicCompositeStream::onHeicCodecError() {
     Mutex::Autolock l(mMutex);
     mErrorState = true;
@@ -699,34 +764,46 @@ void HeicCompositeStream::compilePendingInputLocked() {
             mMainImageConsumer->unlockBuffer(imgBuffer);
         } else {
             mPendingInputFrames[frameNumber].yuvBuffer = imgBuffer;
+            mPendingInputFrames[frameNumber].encodeStartTime = systemTime();
             mYuvBufferAcquired = true;
         }
         mInputYuvBuffers.erase(it);
         mMainImageFrameNumbers.pop();
     }
 
-    while (!mCodecOutputBuffers.empty()) {
-        auto it = mCodecOutputBuffers.begin();
-        // Assume encoder input to output is FIFO, use a queue to look up
-        // frameNumber when handling codec outputs.
-        int64_t bufferFrameNumber = -1;
-        if (mCodecOutputBufferFrameNumbers.empty()) {
-            ALOGV("%s: Failed to find buffer frameNumber for codec output buffer!", __FUNCTION__);
-            break;
-        } else {
-            // Direct mapping between camera frame number and codec timestamp (in us).
-            bufferFrameNumber = mCodecOutputBufferFrameNumbers.front();
-            mCodecOutputCounter++;
-            if (mCodecOutputCounter == mNumOutputTiles) {
-                mCodecOutputBufferFrameNumbers.pop();
-                mCodecOutputCounter = 0;
-            }
+    for (size_t codecIndex = 0; codecIndex < mCodecs.size(); codecIndex++) {
+        TileCodec& tileCodec = mCodecs[codecIndex];
+        size_t outputTileCount = getOutputTileCount(codecIndex);
+        while (!tileCodec.outputBuffers.empty()) {
+            auto it = tileCodec.outputBuffers.begin();
+            // Assume encoder input to output is FIFO, use a queue to look up
+            // frameNumber when handling codec outputs.
+            int64_t bufferFrameNumber = -1;
+            if (tileCodec.outputBufferFrameNumbers.empty()) {
+                ALOGV("%s: Failed to find buffer frameNumber for codec output buffer!",
+                        __FUNCTION__);
+                break;
+            } else {
+                // Direct mapping between camera frame number and codec timestamp (in us).
+                // The n-th output of this codec for a frame is tile
+                // codecIndex + n * mCodecs.size().
+                bufferFrameNumber = tileCodec.outputBufferFrameNumbers.front();
+                size_t tileIndex = codecIndex + tileCodec.outputCounter * mCodecs.size();
+                tileCodec.outputCounter++;
+                if (tileCodec.outputCounter >= outputTileCount) {
+                    tileCodec.outputBufferFrameNumbers.pop();
+                    tileCodec.outputCounter = 0;
+                }
 
-            mPendingInputFrames[bufferFrameNumber].codecOutputBuffers.push_back(*it);
-            ALOGV("%s: [%" PRId64 "]: Pushing codecOutputBuffers (frameNumber %" PRId64 ")",
-                    __FUNCTION__, bufferFrameNumber, it->timeUs);
+                InputFrame& inputFrame = mPendingInputFrames[bufferFrameNumber];
+                inputFrame.codecOutputBuffers[tileIndex] = *it;
+                inputFrame.lastTileEncodedTime =
+                        std::max(inputFrame.lastTileEncodedTime, it->receivedTime);
+                ALOGV("%s: [%" PRId64 "]: Pushing codecOutputBuffers tile %zu (timeUs %" PRId64
+                        ")", __FUNCTION__, bufferFrameNumber, tileIndex, it->timeUs);
+            }
+            tileCodec.outputBuffers.erase(it);
         }
-        mCodecOutputBuffers.erase(it);
     }
 
     while (!mCaptureResults.empty()) {
@@ -772,21 +849,24 @@ void HeicCompositeStream::compilePendingInputLocked() {
         it = mExifErrorFrameNumbers.erase(it);
     }
 
-    // Distribute codec input buffers to be filled out from YUV output
-    for (auto it = mPendingInputFrames.begin();
-            it != mPendingInputFrames.end() && mCodecInputBuffers.size() > 0; it++) {
+    // Distribute codec input buffers to be filled out from YUV output. Tiles are handed
+    // out in order, each to the codec instance that owns it, until that codec runs out of
+    // input buffers.
+    for (auto it = mPendingInputFrames.begin(); it != mPendingInputFrames.end(); it++) {
         InputFrame& inputFrame(it->second);
         if (inputFrame.codecInputCounter < mGridRows * mGridCols) {
-            // Available input tiles that are required for the current input
-            // image.
-            size_t newInputTiles = std::min(mCodecInputBuffers.size(),
-                    mGridRows * mGridCols - inputFrame.codecInputCounter);
-            for (size_t i = 0; i < newInputTiles; i++) {
-                CodecInputBufferInfo inputInfo =
-                        { mCodecInputBuffers[0], mGridTimestampUs++, inputFrame.codecInputCounter };
+            while (inputFrame.codecInputCounter < mGridRows * mGridCols) {
+                size_t codecIndex = inputFrame.codecInputCounter % mCodecs.size();
+                auto& inputBuffers = mCodecs[codecIndex].inputBuffers;
+                if (inputBuffers.empty()) {
+                    break;
+                }
+
+                CodecInputBufferInfo inputInfo = { inputBuffers[0], mGridTimestampUs++,
+                        inputFrame.codecInputCounter, codecIndex };
                 inputFrame.codecInputBuffers.push_back(inputInfo);
 
-                mCodecInputBuffers.erase(mCodecInputBuffers.begin());
+                inputBuffers.erase(inputBuffers.begin());
                 inputFrame.codecInputCounter++;
             }
             break;
@@ -812,7 +892,7 @@ bool HeicCompositeStream::getNextReadyInputLocked(int64_t *frameNumber /*out*/)
                 (it.second.appSegmentBuffer.data != nullptr || it.second.exifError) &&
                 !it.second.appSegmentWritten && it.second.result != nullptr &&
                 it.second.muxer != nullptr;
-        bool codecOutputReady = !it.second.codecOutputBuffers.empty();
+        bool codecOutputReady = it.second.isCodecOutputReady();
         bool codecInputReady = (it.second.yuvBuffer.data != nullptr) &&
                 (!it.second.codecInputBuffers.empty());
         bool hasOutputBuffer = it.second.muxer != nullptr ||
@@ -853,7 +933,7 @@ status_t HeicCompositeStream::processInputFrame(int64_t frameNumber,
             (inputFrame.appSegmentBuffer.data != nullptr || inputFrame.exifError) &&
             !inputFrame.appSegmentWritten && inputFrame.result != nullptr &&
             inputFrame.muxer != nullptr;
-    bool codecOutputReady = inputFrame.codecOutputBuffers.size() > 0;
+    bool codecOutputReady = inputFrame.isCodecOutputReady();
     bool codecInputReady = inputFrame.yuvBuffer.data != nullptr &&
             !inputFrame.codecInputBuffers.empty();
     bool hasOutputBuffer = inputFrame.muxer != nullptr ||
@@ -900,8 +980,8 @@ status_t HeicCompositeStream::processInputFrame(int64_t frameNumber,
         }
     }
 
-    // Write media codec bitstream buffers to muxer.
-    while (!inputFrame.codecOutputBuffers.empty()) {
+    // Write media codec bitstream buffers to muxer in tile order.
+    while (inputFrame.isCodecOutputReady()) {
         res = processOneCodecOutputFrame(frameNumber, inputFrame);
         if (res != OK) {
             ALOGE("%s: Failed to process codec output frame: %s (%d)", __FUNCTION__,
@@ -1061,8 +1141,9 @@ status_t HeicCompositeStream::processAppSegment(int64_t frameNumber, InputFrame
 
 status_t HeicCompositeStream::processCodecInputFrame(InputFrame &inputFrame) {
     for (auto& inputBuffer : inputFrame.codecInputBuffers) {
+        sp<MediaCodec> codec = mCodecs[inputBuffer.codecIndex].codec;
         sp<MediaCodecBuffer> buffer;
-        auto res = mCodec->getInputBuffer(inputBuffer.index, &buffer);
+        auto res = codec->getInputBuffer(inputBuffer.index, &buffer);
         if (res != OK) {
             ALOGE("%s: Error getting codec input buffer: %s (%d)", __FUNCTION__,
                     strerror(-res), res);
@@ -1082,14 +1163,16 @@ status_t HeicCompositeStream::processCodecInputFrame(InputFrame &inputFrame) {
                 " timeUs %" PRId64, __FUNCTION__, tileX, tileY, top, left, width, height,
                 inputBuffer.timeUs);
 
+        nsecs_t copyStart = systemTime();
         res = copyOneYuvTile(buffer, inputFrame.yuvBuffer, top, left, width, height);
         if (res != OK) {
             ALOGE("%s: Failed to copy YUV tile %s (%d)", __FUNCTION__,
                     strerror(-res), res);
             return res;
         }
+        inputFrame.tileCopyDuration += systemTime() - copyStart;
 
-        res = mCodec->queueInputBuffer(inputBuffer.index, 0, buffer->capacity(),
+        res = codec->queueInputBuffer(inputBuffer.index, 0, buffer->capacity(),
                 inputBuffer.timeUs, 0, nullptr /*errorDetailMsg*/);
         if (res != OK) {
             ALOGE("%s: Failed to queueInputBuffer to Codec: %s (%d)",
@@ -1105,45 +1188,51 @@ status_t HeicCompositeStream::processCodecInputFrame(InputFrame &inputFrame) {
 status_t HeicCompositeStream::processOneCodecOutputFrame(int64_t frameNumber,
         InputFrame &inputFrame) {
     auto it = inputFrame.codecOutputBuffers.begin();
+    const CodecOutputBufferInfo& bufferInfo = it->second;
+    sp<MediaCodec> codec = mCodecs[bufferInfo.codecIndex].codec;
     sp<MediaCodecBuffer> buffer;
-    status_t res = mCodec->getOutputBuffer(it->index, &buffer);
+    status_t res = codec->getOutputBuffer(bufferInfo.index, &buffer);
     if (res != OK) {
         ALOGE("%s: Error getting Heic codec output buffer at index %d: %s (%d)",
-                __FUNCTION__, it->index, strerror(-res), res);
+                __FUNCTION__, bufferInfo.index, strerror(-res), res);
         return res;
     }
     if (buffer == nullptr) {
         ALOGE("%s: Invalid Heic codec output buffer at index %d",
-                __FUNCTION__, it->index);
+                __FUNCTION__, bufferInfo.index);
         return BAD_VALUE;
     }
 
+    nsecs_t muxStart = systemTime();
     sp<ABuffer> aBuffer = new ABuffer(buffer->data(), buffer->size());
     res = inputFrame.muxer->writeSampleData(
             aBuffer, inputFrame.trackIndex, inputFrame.timestamp, 0 /*flags*/);
     if (res != OK) {
         ALOGE("%s: Failed to write buffer index %d to muxer: %s (%d)",
-                __FUNCTION__, it->index, strerror(-res), res);
+                __FUNCTION__, bufferInfo.index, strerror(-res), res);
         return res;
     }
+    inputFrame.muxDuration += systemTime() - muxStart;
 
-    mCodec->releaseOutputBuffer(it->index);
+    codec->releaseOutputBuffer(bufferInfo.index);
     if (inputFrame.pendingOutputTiles == 0) {
         ALOGW("%s: Codec generated more tiles than expected!", __FUNCTION__);
     } else {
         inputFrame.pendingOutputTiles--;
     }
 
-    inputFrame.codecOutputBuffers.erase(inputFrame.codecOutputBuffers.begin());
+    ALOGV("%s: [%" PRId64 "]: Output buffer index %d, tile %zu",
+        __FUNCTION__, frameNumber, bufferInfo.index, it->first);
 
-    ALOGV("%s: [%" PRId64 "]: Output buffer index %d",
-        __FUNCTION__, frameNumber, it->index);
+    inputFrame.codecOutputBuffers.erase(it);
+    inputFrame.nextMuxedTile++;
     return OK;
 }
 
 status_t HeicCompositeStream::processCompletedInputFrame(int64_t frameNumber,
         InputFrame &inputFrame) {
     sp<ANativeWindow> outputANW = mOutputSurface;
+    nsecs_t muxStart = systemTime();
     inputFrame.muxer->stop();
 
     // Copy the content of the file to memory.
@@ -1173,6 +1262,7 @@ status_t HeicCompositeStream::processCompletedInputFrame(int64_t frameNumber,
 
     close(inputFrame.fileFd);
     inputFrame.fileFd = -1;
+    inputFrame.muxDuration += systemTime() - muxStart;
 
     // Fill in HEIC header
     // Must be in sync with CAMERA3_HEIC_BLOB_ID in android_media_Utils.cpp
@@ -1198,6 +1288,7 @@ status_t HeicCompositeStream::processCompletedInputFrame(int64_t frameNumber,
     }
     inputFrame.anb = nullptr;
     mDequeuedOutputBufferCnt--;
+    inputFrame.completedTime = systemTime();
 
     ALOGV("%s: [%" PRId64 "]", __FUNCTION__, frameNumber);
     ATRACE_ASYNC_END("HEIC capture", frameNumber);
@@ -1218,8 +1309,8 @@ void HeicCompositeStream::releaseInputFrameLocked(int64_t frameNumber,
 
     while (!inputFrame->codecOutputBuffers.empty()) {
         auto it = inputFrame->codecOutputBuffers.begin();
-        ALOGV("%s: releaseOutputBuffer index %d", __FUNCTION__, it->index);
-        mCodec->releaseOutputBuffer(it->index);
+        ALOGV("%s: releaseOutputBuffer index %d", __FUNCTION__, it->second.index);
+        mCodecs[it->second.codecIndex].codec->releaseOutputBuffer(it->second.index);
         inputFrame->codecOutputBuffers.erase(it);
     }
 
@@ -1260,6 +1351,9 @@ void HeicCompositeStream::releaseInputFramesLocked() {
         auto& inputFrame = it->second;
         if (inputFrame.error ||
                 (inputFrame.appSegmentWritten && inputFrame.pendingOutputTiles == 0)) {
+            if (!inputFrame.error && inputFrame.completedTime > 0) {
+                recordCaptureTimingLocked(it->first, inputFrame);
+            }
             releaseInputFrameLocked(it->first, &inputFrame);
             it = mPendingInputFrames.erase(it);
             inputFrameDone = true;
@@ -1297,30 +1391,7 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
         return BAD_VALUE;
     }
 
-    // Create Looper for MediaCodec.
     auto desiredMime = mUseHeic ? MIMETYPE_IMAGE_ANDROID_HEIC : MIMETYPE_VIDEO_HEVC;
-    mCodecLooper = new ALooper;
-    mCodecLooper->setName("Camera3-HeicComposite-MediaCodecLooper");
-    status_t res = mCodecLooper->start(
-            false,   // runOnCallingThread
-            false,    // canCallJava
-            PRIORITY_AUDIO);
-    if (res != OK) {
-        ALOGE("%s: Failed to start codec looper: %s (%d)",
-                __FUNCTION__, strerror(-res), res);
-        return NO_INIT;
-    }
-
-    // Create HEIC/HEVC codec.
-    if (mUseHeic) {
-        mCodec = MediaCodec::CreateByType(mCodecLooper, desiredMime, true /*encoder*/);
-    } else {
-        mCodec = MediaCodec::CreateByComponentName(mCodecLooper, hevcName);
-    }
-    if (mCodec == nullptr) {
-        ALOGE("%s: Failed to create codec for %s", __FUNCTION__, desiredMime);
-        return NO_INIT;
-    }
 
     // Create Looper and handler for Codec callback.
     mCodecCallbackHandler = new CodecCallbackHandler(this);
@@ -1330,7 +1401,7 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
     }
     mCallbackLooper = new ALooper;
     mCallbackLooper->setName("Camera3-HeicComposite-MediaCodecCallbackLooper");
-    res = mCallbackLooper->start(
+    status_t res = mCallbackLooper->start(
             false,   // runOnCallingThread
             false,    // canCallJava
             PRIORITY_AUDIO);
@@ -1341,14 +1412,6 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
     }
     mCallbackLooper->registerHandler(mCodecCallbackHandler);
 
-    mAsyncNotify = new AMessage(kWhatCallbackNotify, mCodecCallbackHandler);
-    res = mCodec->setCallback(mAsyncNotify);
-    if (res != OK) {
-        ALOGE("%s: Failed to set MediaCodec callback: %s (%d)", __FUNCTION__,
-                strerror(-res), res);
-        return res;
-    }
-
     // Create output format and configure the Codec.
     sp<AMessage> outputFormat = new AMessage();
     outputFormat->setString(KEY_MIME, desiredMime);
@@ -1363,6 +1426,7 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
         gridHeight = HeicEncoderInfoManager::kGridHeight;
         gridRows = (height + gridHeight - 1)/gridHeight;
         gridCols = (width + gridWidth - 1)/gridWidth;
+        mNumOutputTiles = gridRows * gridCols;
 
         if (mUseHeic) {
             outputFormat->setInt32(KEY_TILE_WIDTH, gridWidth);
@@ -1387,13 +1451,30 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
     // This only serves as a hint to encoder when encoding is not real-time.
     outputFormat->setInt32(KEY_OPERATING_RATE, useGrid ? kGridOpRate : kNoGridOpRate);
 
-    res = mCodec->configure(outputFormat, nullptr /*nativeWindow*/,
-            nullptr /*crypto*/, CONFIGURE_FLAG_ENCODE);
-    if (res != OK) {
-        ALOGE("%s: Failed to configure codec: %s (%d)", __FUNCTION__,
-                strerror(-res), res);
-        return res;
+    // With framework tiling, grid tiles may be sharded across several HEVC encoder
+    // instances that then run in parallel.
+    size_t codecCount = 1;
+    if (useGrid) {
+        codecCount = std::min(HeicEncoderInfoManager::getInstance().getMaxTileEncoders(),
+                static_cast<size_t>(gridRows * gridCols));
+    }
+    mCodecs.resize(codecCount);
+    for (size_t i = 0; i < codecCount; i++) {
+        res = createTileCodec(i, desiredMime, hevcName, outputFormat);
+        if (res != OK) {
+            // createTileCodec() released the failed instance.
+            if (i == 0) {
+                mCodecs.clear();
+                return res;
+            }
+            // Additional instances are best effort only.
+            ALOGW("%s: Failed to create tile codec %zu, using %zu codec instance(s)",
+                    __FUNCTION__, i, i);
+            mCodecs.resize(i);
+            break;
+        }
     }
+    ALOGV("%s: Using %zu codec instance(s)", __FUNCTION__, mCodecs.size());
 
     mGridWidth = gridWidth;
     mGridHeight = gridHeight;
@@ -1410,28 +1491,99 @@ status_t HeicCompositeStream::initializeCodec(uint32_t width, uint32_t height,
     return OK;
 }
 
-void HeicCompositeStream::deinitCodec() {
-    ALOGV("%s", __FUNCTION__);
-    if (mCodec != nullptr) {
-        mCodec->stop();
-        mCodec->release();
-        mCodec.clear();
+status_t HeicCompositeStream::createTileCodec(size_t codecIndex, const char* mime,
+        const AString& hevcName, const sp<AMessage>& outputFormat) {
+    TileCodec& tileCodec = mCodecs[codecIndex];
+    status_t res = configureTileCodec(tileCodec, codecIndex, mime, hevcName, outputFormat);
+    if (res != OK) {
+        // ~MediaCodec() requires the codec to be released, and the looper must not outlive
+        // the discarded slot.
+        releaseTileCodec(tileCodec);
+    }
+    return res;
+}
+
+status_t HeicCompositeStream::configureTileCodec(TileCodec& tileCodec, size_t codecIndex,
+        const char* mime, const AString& hevcName, const sp<AMessage>& outputFormat) {
+
+    // Create Looper for MediaCodec.
+    tileCodec.looper = new ALooper;
+    tileCodec.looper->setName(AStringPrintf(
+            "Camera3-HeicComposite-MediaCodecLooper-%zu", codecIndex).c_str());
+    status_t res = tileCodec.looper->start(
+            false,   // runOnCallingThread
+            false,    // canCallJava
+            PRIORITY_AUDIO);
+    if (res != OK) {
+        ALOGE("%s: Failed to start codec looper: %s (%d)",
+                __FUNCTION__, strerror(-res), res);
+        return NO_INIT;
     }
 
-    if (mCodecLooper != nullptr) {
-        mCodecLooper->stop();
-        mCodecLooper.clear();
+    // Create HEIC/HEVC codec.
+    if (mUseHeic) {
+        tileCodec.codec = MediaCodec::CreateByType(tileCodec.looper, mime, true /*encoder*/);
+    } else {
+        tileCodec.codec = MediaCodec::CreateByComponentName(tileCodec.looper, hevcName);
+    }
+    if (tileCodec.codec == nullptr) {
+        ALOGE("%s: Failed to create codec for %s", __FUNCTION__, mime);
+        return NO_INIT;
+    }
+
+    tileCodec.asyncNotify = new AMessage(kWhatCallbackNotify, mCodecCallbackHandler);
+    tileCodec.asyncNotify->setSize("codecIndex", codecIndex);
+    res = tileCodec.codec->setCallback(tileCodec.asyncNotify);
+    if (res != OK) {
+        ALOGE("%s: Failed to set MediaCodec callback: %s (%d)", __FUNCTION__,
+                strerror(-res), res);
+        return res;
     }
 
+    res = tileCodec.codec->configure(outputFormat, nullptr /*nativeWindow*/,
+            nullptr /*crypto*/, CONFIGURE_FLAG_ENCODE);
+    if (res != OK) {
+        ALOGE("%s: Failed to configure codec: %s (%d)", __FUNCTION__,
+                strerror(-res), res);
+        return res;
+    }
+
+    return OK;
+}
+
+void HeicCompositeStream::releaseTileCodec(TileCodec& tileCodec) {
+    if (tileCodec.codec != nullptr) {
+        tileCodec.codec->stop();
+        tileCodec.codec->release();
+        tileCodec.codec.clear();
+    }
+
+    if (tileCodec.looper != nullptr) {
+        tileCodec.looper->stop();
+        tileCodec.looper.clear();
+    }
+}
+
+void HeicCompositeStream::deinitCodec() {
+    ALOGV("%s", __FUNCTION__);
+    for (auto& tileCodec : mCodecs) {
+        releaseTileCodec(tileCodec);
+    }
+    mCodecs.clear();
+
     if (mCallbackLooper != nullptr) {
         mCallbackLooper->stop();
         mCallbackLooper.clear();
     }
 
-    mAsyncNotify.clear();
     mFormat.clear();
 }
 
+size_t HeicCompositeStream::getOutputTileCount(size_t codecIndex) const {
+    size_t codecCount = mCodecs.size();
+    return mNumOutputTiles / codecCount + ((codecIndex < mNumOutputTiles % codecCount) ? 1 : 0);
+}
+
 // Return the size of the complete list of app segment, 0 indicates failure
 size_t HeicCompositeStream::findAppSegmentsSize(const uint8_t* appSegmentBuffer,
         size_t maxSize, size_t *app1SegmentSize) {
@@ -1661,11 +1813,16 @@ void HeicCompositeStream::updateCodecQualityLocked(int32_t quality) {
     if (quality != mQuality) {
         sp<AMessage> qualityParams = new AMessage;
         qualityParams->setInt32(PARAMETER_KEY_VIDEO_BITRATE, quality);
-        status_t res = mCodec->setParameters(qualityParams);
-        if (res != OK) {
-            ALOGE("%s: Failed to set codec quality: %s (%d)",
-                    __FUNCTION__, strerror(-res), res);
-        } else {
+        status_t res = OK;
+        for (auto& tileCodec : mCodecs) {
+            res = tileCodec.codec->setParameters(qualityParams);
+            if (res != OK) {
+                ALOGE("%s: Failed to set codec quality: %s (%d)",
+                        __FUNCTION__, strerror(-res), res);
+                break;
+            }
+        }
+        if (res == OK) {
             mQuality = quality;
         }
     }
@@ -1807,6 +1964,45 @@ void HeicCompositeStream::onRequestError(const CaptureResultExtras& resultExtras
     }
 }
 
+void HeicCompositeStream::recordCaptureTimingLocked(int64_t frameNumber,
+        const InputFrame& inputFrame) {
+    CaptureTiming timing = {};
+    timing.frameNumber = frameNumber;
+    timing.tileCount = mUseGrid ? mGridRows * mGridCols : mNumOutputTiles;
+    timing.codecCount = mCodecs.size();
+    timing.tileCopyDuration = inputFrame.tileCopyDuration;
+    timing.muxDuration = inputFrame.muxDuration;
+    if (inputFrame.encodeStartTime > 0) {
+        if (inputFrame.lastTileEncodedTime > inputFrame.encodeStartTime) {
+            timing.encodeDuration = inputFrame.lastTileEncodedTime - inputFrame.encodeStartTime;
+        }
+        timing.totalDuration = inputFrame.completedTime - inputFrame.encodeStartTime;
+    }
+
+    if (mCaptureTimings.size() >= kMaxCaptureTimings) {
+        mCaptureTimings.pop_front();
+    }
+    mCaptureTimings.push_back(timing);
+}
+
+void HeicCompositeStream::dump(int fd) const {
+    Mutex::Autolock l(mMutex);
+    dprintf(fd, "      HEIC composite stream %d: %s, %zu codec instance(s), %zu tile(s)\n",
+            mMainImageStreamId, mUseHeic ? "HEIC" : (mUseGrid ? "HEVC grid" : "HEVC"),
+            mCodecs.size(), mUseGrid ? mGridRows * mGridCols : mNumOutputTiles);
+    dprintf(fd, "        Pending input frames: %zu\n", mPendingInputFrames.size());
+    if (mCaptureTimings.empty()) {
+        dprintf(fd, "        No completed captures\n");
+        return;
+    }
+    dprintf(fd, "        Recent captures (ms): frame, tile copy, encode, mux, total\n");
+    for (const auto& timing : mCaptureTimings) {
+        dprintf(fd, "          %" PRId64 ": %.2f, %.2f, %.2f, %.2f\n", timing.frameNumber,
+                timing.tileCopyDuration / 1e6, timing.encodeDuration / 1e6,
+                timing.muxDuration / 1e6, timing.totalDuration / 1e6);
+    }
+}
+
 void HeicCompositeStream::markTrackerIdle() {
     sp<StatusTracker> statusTracker = mStatusTracker.promote();
     if (statusTracker != nullptr) {
@@ -1827,7 +2023,10 @@ void HeicCompositeStream::CodecCallbackHandler::onMessageReceived(const sp<AMess
                  break;
              }
 
-             ALOGV("kWhatCallbackNotify: cbID = %d", cbID);
+             size_t codecIndex = 0;
+             msg->findSize("codecIndex", &codecIndex);
+
+             ALOGV("kWhatCallbackNotify: cbID = %d, codecIndex = %zu", cbID, codecIndex);
 
              switch (cbID) {
                  case MediaCodec::CB_INPUT_AVAILABLE: {
@@ -1836,7 +2035,7 @@ void HeicCompositeStream::CodecCallbackHandler::onMessageReceived(const sp<AMess
                          ALOGE("CB_INPUT_AVAILABLE: index is expected.");
                          break;
                      }
-                     parent->onHeicInputFrameAvailable(index);
+                     parent->onHeicInputFrameAvailable(codecIndex, index);
                      break;
                  }
 
@@ -1873,9 +2072,11 @@ void HeicCompositeStream::CodecCallbackHandler::onMessageReceived(const sp<AMess
                          (int32_t)offset,
                          (int32_t)size,
                          timeUs,
-                         (uint32_t)flags};
+                         (uint32_t)flags,
+                         codecIndex,
+                         0 /*receivedTime*/};
 
-                     parent->onHeicOutputFrameAvailable(bufferInfo);
+                     parent->onHeicOutputFrameAvailable(codecIndex, bufferInfo);
                      break;
                  }
 
@@ -1891,7 +2092,7 @@ void HeicCompositeStream::CodecCallbackHandler::onMessageReceived(const sp<AMess
                      if (format != nullptr) {
                          formatCopy = format->dup();
                      }
-                     parent->onHeicFormatChanged(formatCopy);
+                     parent->onHeicFormatChanged(codecIndex, formatCopy);
                      break;
                  }
 
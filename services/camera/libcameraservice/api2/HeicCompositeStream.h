@@ -17,6 +17,7 @@
 #ifndef ANDROID_SERVERS_CAMERA_CAMERA3_HEIC_COMPOSITE_STREAM_H
 #define ANDROID_SERVERS_CAMERA_CAMERA3_HEIC_COMPOSITE_STREAM_H
 
+#include <deque>
 #include <queue>
 
 #include <gui/IProducerListener.h>
@@ -78,6 +79,8 @@ public:
     // Get composite stream stats
     void getStreamStats(hardware::CameraStreamStats*) override {};
 
+    void dump(int fd) const override;
+
     static bool isSizeSupportedByHeifEncoder(int32_t width, int32_t height,
             bool* useHeic, bool* useGrid, int64_t* stall, AString* hevcName = nullptr);
     static bool isInMemoryTempFileSupported();
@@ -98,12 +101,35 @@ private:
         int32_t size;
         int64_t timeUs;
         uint32_t flags;
+        size_t codecIndex;
+        nsecs_t receivedTime;
     };
 
     struct CodecInputBufferInfo {
         int32_t index;
         int64_t timeUs;
         size_t tileIndex;
+        size_t codecIndex;
+    };
+
+    // One encoder instance together with the buffers it has handed back to us. With
+    // framework tiling, tile i of every capture is encoded by mCodecs[i % mCodecs.size()],
+    // so each instance sees its share of the tiles in order and its outputs can be mapped
+    // back to tile indices. Without framework tiling there is exactly one instance.
+    struct TileCodec {
+        sp<MediaCodec>      codec;
+        sp<ALooper>         looper;
+        sp<AMessage>        asyncNotify;
+        sp<AMessage>        outputFormat; // Only tracked for secondary instances
+
+        // Codec input buffers ready to be filled out (for HEVC YUV tiling only)
+        std::vector<int32_t> inputBuffers;
+        // Codec output buffers not yet assigned to a pending input frame
+        std::vector<CodecOutputBufferInfo> outputBuffers;
+        std::queue<int64_t> outputBufferFrameNumbers;
+        size_t              outputCounter;
+
+        TileCodec() : outputCounter(0) {}
     };
 
     class CodecCallbackHandler : public AHandler {
@@ -121,10 +147,9 @@ private:
     };
 
     bool              mUseHeic;
-    sp<MediaCodec>    mCodec;
-    sp<ALooper>       mCodecLooper, mCallbackLooper;
+    std::vector<TileCodec> mCodecs;
+    sp<ALooper>       mCallbackLooper;
     sp<CodecCallbackHandler> mCodecCallbackHandler;
-    sp<AMessage>      mAsyncNotify;
     sp<AMessage>      mFormat;
     size_t            mNumOutputTiles;
 
@@ -138,14 +163,25 @@ private:
     static const int32_t kNoGridOpRate = 30;
     static const int32_t kGridOpRate = 120;
 
-    void onHeicOutputFrameAvailable(const CodecOutputBufferInfo& bufferInfo);
-    void onHeicInputFrameAvailable(int32_t index);  // Only called for YUV input mode.
-    void onHeicFormatChanged(sp<AMessage>& newFormat);
+    void onHeicOutputFrameAvailable(size_t codecIndex, const CodecOutputBufferInfo& bufferInfo);
+    // Only called for YUV input mode.
+    void onHeicInputFrameAvailable(size_t codecIndex, int32_t index);
+    void onHeicFormatChanged(size_t codecIndex, sp<AMessage>& newFormat);
+    void validateTileCodecFormatLocked(size_t codecIndex);
     void onHeicCodecError();
 
     status_t initializeCodec(uint32_t width, uint32_t height,
             const sp<CameraDeviceBase>& cameraDevice);
+    // Creates and configures the codec at codecIndex, releasing it on failure.
+    status_t createTileCodec(size_t codecIndex, const char* mime, const AString& hevcName,
+            const sp<AMessage>& outputFormat);
+    status_t configureTileCodec(TileCodec& tileCodec, size_t codecIndex, const char* mime,
+            const AString& hevcName, const sp<AMessage>& outputFormat);
+    // Stops and releases the codec and its looper, as required before destruction.
+    void releaseTileCodec(TileCodec& tileCodec);
     void deinitCodec();
+    // Number of output tiles of one capture produced by the codec at codecIndex.
+    size_t getOutputTileCount(size_t codecIndex) const;
 
     //
     // Composite stream related structures, utility functions and callbacks.
@@ -155,7 +191,9 @@ private:
         int32_t                   quality;
 
         CpuConsumer::LockedBuffer          appSegmentBuffer;
-        std::vector<CodecOutputBufferInfo> codecOutputBuffers;
+        // Codec output buffers keyed by tile index. Tiles are written to the muxer in
+        // order, starting with tile nextMuxedTile.
+        std::map<size_t, CodecOutputBufferInfo> codecOutputBuffers;
         std::unique_ptr<CameraMetadata>    result;
 
         // Fields that are only applicable to HEVC tiling.
@@ -177,12 +215,39 @@ private:
         bool                      appSegmentWritten;
         size_t                    pendingOutputTiles;
         size_t                    codecInputCounter;
+        size_t                    nextMuxedTile;
+
+        // Timing breakdown of this capture, reported in dump().
+        nsecs_t                   encodeStartTime; // Main image handed to the encode path
+        nsecs_t                   lastTileEncodedTime;
+        nsecs_t                   completedTime;
+        nsecs_t                   tileCopyDuration;
+        nsecs_t                   muxDuration;
 
         InputFrame() : orientation(0), quality(kDefaultJpegQuality), error(false),
                        exifError(false), timestamp(-1), requestId(-1), fenceFd(-1),
                        fileFd(-1), trackIndex(-1), anb(nullptr), appSegmentWritten(false),
-                       pendingOutputTiles(0), codecInputCounter(0) { }
+                       pendingOutputTiles(0), codecInputCounter(0), nextMuxedTile(0),
+                       encodeStartTime(0), lastTileEncodedTime(0), completedTime(0),
+                       tileCopyDuration(0), muxDuration(0) { }
+
+        bool isCodecOutputReady() const {
+            return !codecOutputBuffers.empty() &&
+                    codecOutputBuffers.begin()->first == nextMuxedTile;
+        }
+    };
+
+    // Timing breakdown of a completed capture.
+    struct CaptureTiming {
+        int64_t frameNumber;
+        size_t  tileCount;
+        size_t  codecCount;
+        nsecs_t tileCopyDuration;
+        nsecs_t encodeDuration;
+        nsecs_t muxDuration;
+        nsecs_t totalDuration;
     };
+    void recordCaptureTimingLocked(int64_t frameNumber, const InputFrame& inputFrame);
 
     void compilePendingInputLocked();
     // Find first complete and valid frame with smallest frame number
@@ -259,16 +324,10 @@ private:
     // Keep all incoming APP segment Blob buffer pending further processing.
     std::vector<int64_t> mInputAppSegmentBuffers;
 
-    // Keep all incoming HEIC blob buffer pending further processing.
-    std::vector<CodecOutputBufferInfo> mCodecOutputBuffers;
-    std::queue<int64_t> mCodecOutputBufferFrameNumbers;
-    size_t mCodecOutputCounter;
     int32_t mQuality;
 
     // Keep all incoming Yuv buffer pending tiling and encoding (for HEVC YUV tiling only)
     std::vector<int64_t> mInputYuvBuffers;
-    // Keep all codec input buffers ready to be filled out (for HEVC YUV tiling only)
-    std::vector<int32_t> mCodecInputBuffers;
 
     // Artificial strictly incremental YUV grid timestamp to make encoder happy.
     int64_t mGridTimestampUs;
@@ -286,6 +345,10 @@ private:
     // The status id for tracking the active/idle status of this composite stream
     int mStatusId;
     void markTrackerIdle();
+
+    // Timing breakdowns of the most recently completed captures.
+    static const size_t kMaxCaptureTimings = 16;
+    std::deque<CaptureTiming> mCaptureTimings;
 };
 
 }; // namespace camera3
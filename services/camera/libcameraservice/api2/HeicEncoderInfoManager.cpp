@@ -17,6 +17,7 @@
 #define LOG_TAG "HeicEncoderInfoManager"
 //#define LOG_NDEBUG 0
 
+#include <algorithm>
 #include <cstdint>
 #include <regex>
 
@@ -39,6 +40,7 @@ HeicEncoderInfoManager::HeicEncoderInfoManager() :
         mMaxSizeHeic(INT32_MAX, INT32_MAX),
         mHasHEVC(false),
         mHasHEIC(false),
+        mHevcMaxInstances(1),
         mDisableGrid(false) {
     if (initialize() == OK) {
         mIsInited = true;
@@ -109,6 +111,14 @@ bool HeicEncoderInfoManager::isSizeSupported(int32_t width, int32_t height, bool
     return true;
 }
 
+size_t HeicEncoderInfoManager::getMaxTileEncoders() const {
+    if (!mIsInited || !mHasHEVC) return 1;
+
+    int32_t maxTileEncoders = property_get_int32("camera.heic.max_tile_encoders", 1);
+    maxTileEncoders = std::min(maxTileEncoders, mHevcMaxInstances);
+    return maxTileEncoders > 1 ? static_cast<size_t>(maxTileEncoders) : 1;
+}
+
 status_t HeicEncoderInfoManager::initialize() {
     mDisableGrid = property_get_bool("camera.heic.disable_grid", false);
     sp<IMediaCodecList> codecsList = MediaCodecList::getInstance();
@@ -332,8 +342,17 @@ bool HeicEncoderInfoManager::getHevcCodecDetails(
             continue; // move on to next encoder
         }
 
-        // Found: save name, size, frame rate
+        // The concurrent instance limit is optional; absent means only one instance
+        // is guaranteed.
+        AString maxInstances;
+        int32_t hevcMaxInstances = 1;
+        if (details->findString("max-concurrent-instances", &maxInstances)) {
+            hevcMaxInstances = std::max(1, atoi(maxInstances.c_str()));
+        }
+
+        // Found: save name, size, frame rate, concurrent instances
         mHevcName = info->getCodecName();
+        mHevcMaxInstances = hevcMaxInstances;
         mMinSizeHevc = minSizeHevc;
         mMaxSizeHevc = maxSizeHevc;
         mHevcFrameRateMaps = hevcFrameRateMaps;
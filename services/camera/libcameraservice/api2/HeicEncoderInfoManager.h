@@ -38,6 +38,11 @@ public:
     bool isSizeSupported(int32_t width, int32_t height,
             bool* useHeic, bool* useGrid, int64_t* stall, AString* hevcName) const;
 
+    // Number of HEVC encoder instances that framework grid tiles may be sharded across.
+    // Bounded by the "camera.heic.max_tile_encoders" property (default 1) and by the
+    // number of concurrent instances advertised by the chosen HEVC encoder.
+    size_t getMaxTileEncoders() const;
+
     // kGridWidth and kGridHeight should be 2^n
     static const auto kGridWidth = 512;
     static const auto kGridHeight = 512;
@@ -69,6 +74,7 @@ private:
     std::pair<int32_t, int32_t> mMinSizeHevc, mMaxSizeHevc;
     bool mHasHEVC, mHasHEIC;
     AString mHevcName;
+    int32_t mHevcMaxInstances;
     FrameRateMaps mHeicFrameRateMaps, mHevcFrameRateMaps;
     bool mDisableGrid;
 
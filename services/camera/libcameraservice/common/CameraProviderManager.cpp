@@ -1557,7 +1557,7 @@ status_t CameraProviderManager::ProviderInfo::DeviceInfo3::fixupMonochromeTags()
                 }
 
                 // ANDROID_SENSOR_BLACK_LEVEL_PATTERN
-                camera_metadata_entry blEntry = c.find(ANDROID_SENSOR_BLACK_LEVEL_PATTERN);
+                camera_metadata_entry blEntry = c.findForWrite(ANDROID_SENSOR_BLACK_LEVEL_PATTERN);
                 for (size_t j = 1; j < blEntry.count; j++) {
                     blEntry.data.i32[j] = blEntry.data.i32[0];
                 }
@@ -589,13 +589,21 @@ status_t Camera3Device::dump(int fd, [[maybe_unused]] const Vector<String16> &ar
             lines.append("      None\n");
         } else {
             for (size_t i = 0; i < mInFlightMap.size(); i++) {
-                InFlightRequest r = mInFlightMap.valueAt(i);
+                const InFlightRequest &r = mInFlightMap.valueAt(i);
                 lines.appendFormat("      Frame %d |  Timestamp: %" PRId64 ", metadata"
                         " arrived: %s, buffers left: %d\n", mInFlightMap.keyAt(i),
                         r.shutterTimestamp, r.haveResultMetadata ? "true" : "false",
                         r.numBuffersLeft);
             }
+            if (mInFlightMap.overflowCount() > 0) {
+                lines.appendFormat("      %zu requests outside of in-flight ring\n",
+                        mInFlightMap.overflowCount());
+            }
         }
+        write(fd, lines.string(), lines.size());
+        lines.clear();
+        mRequestToResultLatency.dump(fd, "    Request to result latency histogram:");
+        dumpMetadataAllocationStatsLocked(fd);
         mInFlightLock.unlock();
     } else {
         lines.append("      Failed to acquire In-flight lock!\n");
@@ -1369,8 +1377,7 @@ status_t Camera3Device::filterParamsAndConfigureLocked(const CameraMetadata& ses
     camera_metadata_entry_t availableSessionKeys = mDeviceInfo.find(
             ANDROID_REQUEST_AVAILABLE_SESSION_KEYS);
     CameraMetadata filteredParams(availableSessionKeys.count);
-    camera_metadata_t *meta = const_cast<camera_metadata_t *>(
-            filteredParams.getAndLock());
+    camera_metadata_t *meta = filteredParams.getAndLockForWrite();
     set_camera_metadata_vendor_id(meta, mVendorTagId);
     filteredParams.unlock(meta);
     if (availableSessionKeys.count > 0) {
@@ -2849,6 +2856,32 @@ void Camera3Device::onInflightEntryRemovedLocked(nsecs_t duration) {
     mExpectedInflightDuration -= duration;
 }
 
+void Camera3Device::dumpMetadataAllocationStatsLocked(int fd) {
+    // Allocation totals are process-wide; the per-frame figures cover the interval since the
+    // previous dump of this device.
+    CameraMetadata::AllocationStats stats = CameraMetadata::getAllocationStats();
+    uint64_t frames = mCompletedRequestCount - mDumpedRequestCount;
+    String8 lines = String8::format("    CameraMetadata allocations: %" PRIu64 ", bytes copied:"
+            " %" PRIu64 ", shared copies: %" PRIu64 "\n", stats.allocations, stats.bytesCopied,
+            stats.sharedCopies);
+    if (frames > 0) {
+        lines.appendFormat("      Since last dump (%" PRIu64 " frames): %.2f allocations,"
+                " %.0f bytes copied, %.2f shared copies per frame\n", frames,
+                static_cast<double>(stats.allocations - mDumpedMetadataStats.allocations) / frames,
+                static_cast<double>(stats.bytesCopied - mDumpedMetadataStats.bytesCopied) / frames,
+                static_cast<double>(stats.sharedCopies - mDumpedMetadataStats.sharedCopies) /
+                        frames);
+    }
+    write(fd, lines.string(), lines.size());
+    mDumpedRequestCount = mCompletedRequestCount;
+    mDumpedMetadataStats = stats;
+}
+
+void Camera3Device::onInflightRequestCompletedLocked(nsecs_t requestTimeNs) {
+    mRequestToResultLatency.add(requestTimeNs, systemTime());
+    mCompletedRequestCount++;
+}
+
 void Camera3Device::checkInflightMapLengthLocked() {
     // Validation check - if we have too many in-flight frames with long total inflight duration,
     // something has likely gone wrong. This might still be legit only if application send in
@@ -3444,14 +3477,15 @@ void Camera3Device::RequestThread::updateNextRequest(NextRequest& nextRequest) {
     if (halRequest.settings != NULL) { // Don't update if they were unchanged
         Mutex::Autolock al(mLatestRequestMutex);
 
-        camera_metadata_t* cloned = clone_camera_metadata(halRequest.settings);
-        mLatestRequest.acquire(cloned);
+        // The HAL settings are the locked buffers of the capture request's settings
+        // list, so share those instead of cloning them.
+        auto settingsIt = nextRequest.captureRequest->mSettingsList.begin();
+        mLatestRequest = settingsIt->metadata;
 
         mLatestPhysicalRequest.clear();
-        for (uint32_t i = 0; i < halRequest.num_physcam_settings; i++) {
-            cloned = clone_camera_metadata(halRequest.physcam_settings[i]);
-            mLatestPhysicalRequest.emplace(halRequest.physcam_id[i],
-                    CameraMetadata(cloned));
+        settingsIt++;
+        for (uint32_t i = 0; i < halRequest.num_physcam_settings; i++, settingsIt++) {
+            mLatestPhysicalRequest.emplace(halRequest.physcam_id[i], settingsIt->metadata);
         }
 
         sp<Camera3Device> parent = mParent.promote();
@@ -4827,7 +4861,7 @@ bool Camera3Device::overrideAutoRotateAndCrop(const sp<CaptureRequest> &request,
     if (request->mRotateAndCropAuto) {
         CameraMetadata &metadata = request->mSettingsList.begin()->metadata;
 
-        auto rotateAndCropEntry = metadata.find(ANDROID_SCALER_ROTATE_AND_CROP);
+        auto rotateAndCropEntry = metadata.findForWrite(ANDROID_SCALER_ROTATE_AND_CROP);
         if (rotateAndCropEntry.count > 0) {
             if (rotateAndCropEntry.data.u8[0] == rotateAndCropOverride) {
                 return false;
@@ -4848,7 +4882,7 @@ bool Camera3Device::overrideAutoRotateAndCrop(const sp<CaptureRequest> &request,
 bool Camera3Device::overrideAutoframing(const sp<CaptureRequest> &request /*out*/,
         camera_metadata_enum_android_control_autoframing_t autoframingOverride) {
     CameraMetadata &metadata = request->mSettingsList.begin()->metadata;
-    auto autoframingEntry = metadata.find(ANDROID_CONTROL_AUTOFRAMING);
+    auto autoframingEntry = metadata.findForWrite(ANDROID_CONTROL_AUTOFRAMING);
     if (autoframingEntry.count > 0) {
         if (autoframingEntry.data.u8[0] == autoframingOverride) {
             return false;
@@ -4907,7 +4941,7 @@ bool Camera3Device::RequestThread::overrideTestPattern(
             testPatternData[3] = 0;
         }
 
-        auto testPatternEntry = metadata.find(ANDROID_SENSOR_TEST_PATTERN_MODE);
+        auto testPatternEntry = metadata.findForWrite(ANDROID_SENSOR_TEST_PATTERN_MODE);
         bool supportTestPatternModeKey = settings.mHasTestPatternModeTag;
         if (testPatternEntry.count > 0) {
             if (testPatternEntry.data.i32[0] != testPatternMode) {
@@ -4920,7 +4954,7 @@ bool Camera3Device::RequestThread::overrideTestPattern(
             changed = true;
         }
 
-        auto testPatternColor = metadata.find(ANDROID_SENSOR_TEST_PATTERN_DATA);
+        auto testPatternColor = metadata.findForWrite(ANDROID_SENSOR_TEST_PATTERN_DATA);
         bool supportTestPatternDataKey = settings.mHasTestPatternDataTag;
         if (testPatternColor.count >= 4) {
             for (size_t i = 0; i < 4; i++) {
@@ -824,11 +824,15 @@ class Camera3Device :
     // Implements InflightRequestUpdateInterface
 
     void onInflightEntryRemovedLocked(nsecs_t duration) override;
+    void onInflightRequestCompletedLocked(nsecs_t requestTimeNs) override;
     void checkInflightMapLengthLocked() override;
     void onInflightMapFlushedLocked() override;
 
     /////////////////////////////////////////////////////////////////////
 
+    // Dump CameraMetadata allocation totals and per-frame rates; requires mInFlightLock
+    void dumpMetadataAllocationStatsLocked(int fd);
+
     /**
      * Debugging trylock/spin method
      * Try to acquire a lock a few times with sleeps between before giving up.
@@ -1195,6 +1199,9 @@ class Camera3Device :
 
     /**
      * In-flight queue for tracking completion of capture requests.
+     *
+     * Capture results, notifications and the request thread all serialize on mInFlightLock;
+     * InFlightRequestMap keeps the time spent under it short but is not lock-free.
      */
     std::mutex                    mInFlightLock;
     camera3::InFlightRequestMap   mInFlightMap;
@@ -1202,6 +1209,14 @@ class Camera3Device :
     int64_t                       mLastCompletedRegularFrameNumber = -1;
     int64_t                       mLastCompletedReprocessFrameNumber = -1;
     int64_t                       mLastCompletedZslFrameNumber = -1;
+    // Time from request submission to the completion of its in-flight entry
+    static const int32_t          kRequestToResultLatencyBinSize = 20; // in ms
+    CameraLatencyHistogram        mRequestToResultLatency{kRequestToResultLatencyBinSize};
+    // Completed requests and CameraMetadata allocation totals as of the last dump, used to
+    // report metadata allocations per frame
+    uint64_t                      mCompletedRequestCount = 0;
+    uint64_t                      mDumpedRequestCount = 0;
+    CameraMetadata::AllocationStats mDumpedMetadataStats = {};
     // End of mInFlightLock protection scope
 
     int mInFlightStatusId; // const after initialize
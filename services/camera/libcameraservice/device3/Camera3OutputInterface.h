@@ -76,6 +76,11 @@ namespace camera3 {
         // duration: the maxExpectedDuration of the removed entry
         virtual void onInflightEntryRemovedLocked(nsecs_t duration) = 0;
 
+        // Caller must hold the lock proctecting InflightRequestMap
+        // requestTimeNs: the submission time of a request whose buffers, result metadata
+        // and shutter have all arrived
+        virtual void onInflightRequestCompletedLocked(nsecs_t /*requestTimeNs*/) {}
+
         virtual void checkInflightMapLengthLocked() = 0;
 
         virtual void onInflightMapFlushedLocked() = 0;
@@ -81,7 +81,7 @@ status_t fixupMonochromeTags(
     }
 
     // ANDROID_SENSOR_DYNAMIC_BLACK_LEVEL
-    camera_metadata_entry blEntry = resultMetadata.find(ANDROID_SENSOR_DYNAMIC_BLACK_LEVEL);
+    camera_metadata_entry blEntry = resultMetadata.findForWrite(ANDROID_SENSOR_DYNAMIC_BLACK_LEVEL);
     for (size_t i = 1; i < blEntry.count; i++) {
         blEntry.data.f[i] = blEntry.data.f[0];
     }
@@ -100,7 +100,7 @@ status_t fixupMonochromeTags(
 
     // ANDROID_STATISTICS_LENS_SHADING_MAP
     camera_metadata_ro_entry lsSizeEntry = deviceInfo.find(ANDROID_LENS_INFO_SHADING_MAP_SIZE);
-    camera_metadata_entry lsEntry = resultMetadata.find(ANDROID_STATISTICS_LENS_SHADING_MAP);
+    camera_metadata_entry lsEntry = resultMetadata.findForWrite(ANDROID_STATISTICS_LENS_SHADING_MAP);
     if (lsSizeEntry.count == 2 && lsEntry.count > 0
             && (int32_t)lsEntry.count == 4 * lsSizeEntry.data.i32[0] * lsSizeEntry.data.i32[1]) {
         for (int32_t i = 0; i < lsSizeEntry.data.i32[0] * lsSizeEntry.data.i32[1]; i++) {
@@ -113,8 +113,8 @@ status_t fixupMonochromeTags(
     // ANDROID_TONEMAP_CURVE_BLUE
     // ANDROID_TONEMAP_CURVE_GREEN
     // ANDROID_TONEMAP_CURVE_RED
-    camera_metadata_entry tcbEntry = resultMetadata.find(ANDROID_TONEMAP_CURVE_BLUE);
-    camera_metadata_entry tcgEntry = resultMetadata.find(ANDROID_TONEMAP_CURVE_GREEN);
+    camera_metadata_entry tcbEntry = resultMetadata.findForWrite(ANDROID_TONEMAP_CURVE_BLUE);
+    camera_metadata_entry tcgEntry = resultMetadata.findForWrite(ANDROID_TONEMAP_CURVE_GREEN);
     camera_metadata_entry tcrEntry = resultMetadata.find(ANDROID_TONEMAP_CURVE_RED);
     if (tcbEntry.count > 0
             && tcbEntry.count == tcgEntry.count
@@ -189,8 +189,7 @@ void correctMeteringRegions(camera_metadata_t *meta) {
 void insertResultLocked(CaptureOutputStates& states, CaptureResult *result, uint32_t frameNumber) {
     if (result == nullptr) return;
 
-    camera_metadata_t *meta = const_cast<camera_metadata_t *>(
-            result->mMetadata.getAndLock());
+    camera_metadata_t *meta = result->mMetadata.getAndLockForWrite();
     set_camera_metadata_vendor_id(meta, states.vendorTagId);
     correctMeteringRegions(meta);
     result->mMetadata.unlock(meta);
@@ -208,8 +207,8 @@ void insertResultLocked(CaptureOutputStates& states, CaptureResult *result, uint
 
     // Update vendor tag id for physical metadata
     for (auto& physicalMetadata : result->mPhysicalMetadatas) {
-        camera_metadata_t *pmeta = const_cast<camera_metadata_t *>(
-                physicalMetadata.mPhysicalCameraMetadata.getAndLock());
+        camera_metadata_t *pmeta =
+                physicalMetadata.mPhysicalCameraMetadata.getAndLockForWrite();
         set_camera_metadata_vendor_id(pmeta, states.vendorTagId);
         correctMeteringRegions(pmeta);
         physicalMetadata.mPhysicalCameraMetadata.unlock(pmeta);
@@ -440,14 +439,16 @@ void sendCaptureResult(
         }
     }
 
-    std::unordered_map<std::string, CameraMetadata> monitoredPhysicalMetadata;
-    for (auto& m : physicalMetadatas) {
-        monitoredPhysicalMetadata.emplace(String8(m.mPhysicalCameraId).string(),
-                CameraMetadata(m.mPhysicalCameraMetadata));
+    if (states.tagMonitor.isMonitoringEnabled()) {
+        std::unordered_map<std::string, CameraMetadata> monitoredPhysicalMetadata;
+        for (auto& m : physicalMetadatas) {
+            monitoredPhysicalMetadata.emplace(String8(m.mPhysicalCameraId).string(),
+                    m.mPhysicalCameraMetadata);
+        }
+        states.tagMonitor.monitorMetadata(TagMonitor::RESULT,
+                frameNumber, sensorTimestamp, captureResult.mMetadata,
+                monitoredPhysicalMetadata);
     }
-    states.tagMonitor.monitorMetadata(TagMonitor::RESULT,
-            frameNumber, sensorTimestamp, captureResult.mMetadata,
-            monitoredPhysicalMetadata);
 
     insertResultLocked(states, &captureResult, frameNumber);
 }
@@ -519,6 +520,10 @@ void removeInFlightRequestIfReadyLocked(CaptureOutputStates& states, int idx) {
 
         sessionStatsBuilder.incResultCounter(request.skipResultMetadata);
 
+        if (request.requestTimeNs != 0) {
+            states.inflightIntf.onInflightRequestCompletedLocked(request.requestTimeNs);
+        }
+
         removeInFlightMapEntryLocked(states, idx);
         ALOGVV("%s: removed frame %d from InFlightMap", __FUNCTION__, frameNumber);
     }
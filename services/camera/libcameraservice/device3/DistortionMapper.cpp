@@ -278,7 +278,7 @@ status_t DistortionMapper::mapRawToCorrected(int32_t *coordPairs, int coordCount
     }
 
     for (int i = 0; i < coordCount * 2; i += 2) {
-        const GridQuad *quad = findEnclosingQuad(coordPairs + i, mapperInfo->mDistortedGrid);
+        const GridQuad *quad = findEnclosingQuad(coordPairs + i, *mapperInfo);
         if (quad == nullptr) {
             ALOGE("Raw to corrected mapping failure: No quad found for (%d, %d)",
                     *(coordPairs + i), *(coordPairs + i + 1));
@@ -383,29 +383,55 @@ status_t DistortionMapper::mapCorrectedToRawImpl(T *coordPairs, int coordCount,
 
     if (simple) return mapCorrectedToRawImplSimple(coordPairs, coordCount, mapperInfo, clamp);
 
-    float activeCx = mapperInfo->mCx - mapperInfo->mArrayDiffX;
-    float activeCy = mapperInfo->mCy - mapperInfo->mArrayDiffY;
-    for (int i = 0; i < coordCount * 2; i += 2) {
+    float xs[kBatchSize];
+    float ys[kBatchSize];
+    for (int start = 0; start < coordCount; start += kBatchSize) {
+        int count = std::min(kBatchSize, coordCount - start);
+        T *pairs = coordPairs + start * 2;
+        for (int i = 0; i < count; i++) {
+            xs[i] = pairs[i * 2];
+            ys[i] = pairs[i * 2 + 1];
+        }
+        status_t res = mapCorrectedToRawBatch(xs, ys, count, mapperInfo, clamp);
+        if (res != OK) return res;
+        for (int i = 0; i < count; i++) {
+            pairs[i * 2] = static_cast<T>(std::round(xs[i]));
+            pairs[i * 2 + 1] = static_cast<T>(std::round(ys[i]));
+        }
+    }
+    return OK;
+}
+
+status_t DistortionMapper::mapCorrectedToRawBatch(float *xs, float *ys, int coordCount,
+        const DistortionMapperInfo *mapperInfo, bool clamp) const {
+    if (!mapperInfo->mValidMapping) return INVALID_OPERATION;
+
+    // Hoist everything out of the loop so that it only touches xs and ys
+    const float activeCx = mapperInfo->mCx - mapperInfo->mArrayDiffX;
+    const float activeCy = mapperInfo->mCy - mapperInfo->mArrayDiffY;
+    const float fx = mapperInfo->mFx, fy = mapperInfo->mFy;
+    const float cx = mapperInfo->mCx, cy = mapperInfo->mCy;
+    const float s = mapperInfo->mS;
+    const float invFx = mapperInfo->mInvFx, invFy = mapperInfo->mInvFy;
+    const float k0 = mapperInfo->mK[0], k1 = mapperInfo->mK[1], k2 = mapperInfo->mK[2];
+    const float k3 = mapperInfo->mK[3], k4 = mapperInfo->mK[4];
+    const float maxX = clamp ? mapperInfo->mArrayWidth - 1 : INFINITY;
+    const float maxY = clamp ? mapperInfo->mArrayHeight - 1 : INFINITY;
+    const float minXY = clamp ? 0.f : -INFINITY;
+
+    for (int i = 0; i < coordCount; i++) {
         // Move to normalized space from active array space
-        float ywi = (coordPairs[i + 1] - activeCy) * mapperInfo->mInvFy;
-        float xwi = (coordPairs[i] - activeCx - mapperInfo->mS * ywi) * mapperInfo->mInvFx;
+        float ywi = (ys[i] - activeCy) * invFy;
+        float xwi = (xs[i] - activeCx - s * ywi) * invFx;
         // Apply distortion model to calculate raw image coordinates
-        const std::array<float, 5> &kK = mapperInfo->mK;
         float rSq = xwi * xwi + ywi * ywi;
-        float Fr = 1.f + (kK[0] * rSq) + (kK[1] * rSq * rSq) + (kK[2] * rSq * rSq * rSq);
-        float xc = xwi * Fr + (kK[3] * 2 * xwi * ywi) + kK[4] * (rSq + 2 * xwi * xwi);
-        float yc = ywi * Fr + (kK[4] * 2 * xwi * ywi) + kK[3] * (rSq + 2 * ywi * ywi);
-        // Move back to image space
-        float xr = mapperInfo->mFx * xc + mapperInfo->mS * yc + mapperInfo->mCx;
-        float yr = mapperInfo->mFy * yc + mapperInfo->mCy;
-        // Clamp to within pre-correction active array
-        if (clamp) {
-            xr = std::min(mapperInfo->mArrayWidth - 1, std::max(0.f, xr));
-            yr = std::min(mapperInfo->mArrayHeight - 1, std::max(0.f, yr));
-        }
-
-        coordPairs[i] = static_cast<T>(std::round(xr));
-        coordPairs[i + 1] = static_cast<T>(std::round(yr));
+        float Fr = 1.f + (k0 * rSq) + (k1 * rSq * rSq) + (k2 * rSq * rSq * rSq);
+        float xc = xwi * Fr + (k3 * 2 * xwi * ywi) + k4 * (rSq + 2 * xwi * xwi);
+        float yc = ywi * Fr + (k4 * 2 * xwi * ywi) + k3 * (rSq + 2 * ywi * ywi);
+        // Move back to image space, clamping to within pre-correction active array
+        // if requested
+        xs[i] = std::min(maxX, std::max(minXY, fx * xc + s * yc + cx));
+        ys[i] = std::min(maxY, std::max(minXY, fy * yc + cy));
     }
     return OK;
 }
@@ -480,55 +506,173 @@ status_t DistortionMapper::buildGrids(DistortionMapperInfo *mapperInfo) {
                 x + gridSpacingX, y + gridSpacingY,
                 x, y + gridSpacingY
             };
-            mapperInfo->mDistortedGrid[index].src = &(mapperInfo->mCorrectedGrid[index]);
-            mapperInfo->mDistortedGrid[index].coords = mapperInfo->mCorrectedGrid[index].coords;
-            status_t res = mapCorrectedToRawImpl(mapperInfo->mDistortedGrid[index].coords.data(), 4,
-                    mapperInfo, /*clamp*/false, /*simple*/false);
-            if (res != OK) return res;
         }
     }
 
+    // Map all grid corners in one batch
+    constexpr size_t kCornerCount = kGridSize * kGridSize * 4;
+    std::vector<float> xs(kCornerCount);
+    std::vector<float> ys(kCornerCount);
+    for (size_t q = 0; q < kGridSize * kGridSize; q++) {
+        const std::array<float, 8> &coords = mapperInfo->mCorrectedGrid[q].coords;
+        for (size_t c = 0; c < 4; c++) {
+            xs[q * 4 + c] = coords[c * 2];
+            ys[q * 4 + c] = coords[c * 2 + 1];
+        }
+    }
+    status_t res = mapCorrectedToRawBatch(xs.data(), ys.data(), kCornerCount, mapperInfo,
+            /*clamp*/false);
+    if (res != OK) return res;
+    for (size_t q = 0; q < kGridSize * kGridSize; q++) {
+        GridQuad &quad = mapperInfo->mDistortedGrid[q];
+        quad.src = &(mapperInfo->mCorrectedGrid[q]);
+        for (size_t c = 0; c < 4; c++) {
+            quad.coords[c * 2] = std::round(xs[q * 4 + c]);
+            quad.coords[c * 2 + 1] = std::round(ys[q * 4 + c]);
+        }
+    }
+
+    buildQuadIndex(mapperInfo);
+
     mapperInfo->mValidGrids = true;
     return OK;
 }
 
+void DistortionMapper::buildQuadIndex(DistortionMapperInfo *mapperInfo) {
+    const std::vector<GridQuad> &grid = mapperInfo->mDistortedGrid;
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (const GridQuad &quad : grid) {
+        for (size_t c = 0; c < 8; c += 2) {
+            minX = std::min(minX, quad.coords[c]);
+            maxX = std::max(maxX, quad.coords[c]);
+            minY = std::min(minY, quad.coords[c + 1]);
+            maxY = std::max(maxY, quad.coords[c + 1]);
+        }
+    }
+    mapperInfo->mIndexMinX = minX;
+    mapperInfo->mIndexMinY = minY;
+    mapperInfo->mIndexMaxX = maxX;
+    mapperInfo->mIndexMaxY = maxY;
+    mapperInfo->mIndexInvBucketW = maxX > minX ? kIndexSize / (maxX - minX) : 0.f;
+    mapperInfo->mIndexInvBucketH = maxY > minY ? kIndexSize / (maxY - minY) : 0.f;
+
+    // Same bucket computation as findEnclosingQuad, so that a point inside a quad's bounding
+    // box always lands in one of the buckets the quad is listed in.
+    auto bucketX = [mapperInfo](float v) {
+        int b = static_cast<int>((v - mapperInfo->mIndexMinX) * mapperInfo->mIndexInvBucketW);
+        return std::clamp(b, 0, static_cast<int>(kIndexSize) - 1);
+    };
+    auto bucketY = [mapperInfo](float v) {
+        int b = static_cast<int>((v - mapperInfo->mIndexMinY) * mapperInfo->mIndexInvBucketH);
+        return std::clamp(b, 0, static_cast<int>(kIndexSize) - 1);
+    };
+
+    struct BucketRange { int x0, x1, y0, y1; };
+    std::vector<BucketRange> ranges(grid.size());
+    std::vector<uint32_t> counts(kIndexSize * kIndexSize, 0);
+    for (size_t q = 0; q < grid.size(); q++) {
+        const std::array<float, 8> &c = grid[q].coords;
+        BucketRange &r = ranges[q];
+        r.x0 = bucketX(std::min({c[0], c[2], c[4], c[6]}));
+        r.x1 = bucketX(std::max({c[0], c[2], c[4], c[6]}));
+        r.y0 = bucketY(std::min({c[1], c[3], c[5], c[7]}));
+        r.y1 = bucketY(std::max({c[1], c[3], c[5], c[7]}));
+        for (int by = r.y0; by <= r.y1; by++) {
+            for (int bx = r.x0; bx <= r.x1; bx++) {
+                counts[by * kIndexSize + bx]++;
+            }
+        }
+    }
+
+    mapperInfo->mQuadIndexStart.resize(kIndexSize * kIndexSize + 1);
+    uint32_t total = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        mapperInfo->mQuadIndexStart[b] = total;
+        total += counts[b];
+    }
+    mapperInfo->mQuadIndexStart[counts.size()] = total;
+
+    // Fill in grid order, so that lookups return the same quad as a linear scan would
+    mapperInfo->mQuadIndex.resize(total);
+    std::vector<uint32_t> next(mapperInfo->mQuadIndexStart.begin(),
+            mapperInfo->mQuadIndexStart.end() - 1);
+    for (size_t q = 0; q < grid.size(); q++) {
+        const BucketRange &r = ranges[q];
+        for (int by = r.y0; by <= r.y1; by++) {
+            for (int bx = r.x0; bx <= r.x1; bx++) {
+                mapperInfo->mQuadIndex[next[by * kIndexSize + bx]++] = static_cast<uint16_t>(q);
+            }
+        }
+    }
+}
+
+const DistortionMapper::GridQuad* DistortionMapper::findEnclosingQuad(
+        const int32_t pt[2], const DistortionMapperInfo& mapperInfo) {
+    const float x = pt[0];
+    const float y = pt[1];
+
+    // No quad can enclose a point outside of the bounding box of the whole grid
+    if (x < mapperInfo.mIndexMinX || x > mapperInfo.mIndexMaxX ||
+            y < mapperInfo.mIndexMinY || y > mapperInfo.mIndexMaxY) {
+        return nullptr;
+    }
+
+    int bx = std::clamp(static_cast<int>((x - mapperInfo.mIndexMinX) *
+            mapperInfo.mIndexInvBucketW), 0, static_cast<int>(kIndexSize) - 1);
+    int by = std::clamp(static_cast<int>((y - mapperInfo.mIndexMinY) *
+            mapperInfo.mIndexInvBucketH), 0, static_cast<int>(kIndexSize) - 1);
+    size_t bucket = by * kIndexSize + bx;
+
+    for (uint32_t i = mapperInfo.mQuadIndexStart[bucket];
+            i < mapperInfo.mQuadIndexStart[bucket + 1]; i++) {
+        const GridQuad &quad = mapperInfo.mDistortedGrid[mapperInfo.mQuadIndex[i]];
+        if (quadContains(quad, x, y)) return &quad;
+    }
+    return nullptr;
+}
+
 const DistortionMapper::GridQuad* DistortionMapper::findEnclosingQuad(
         const int32_t pt[2], const std::vector<GridQuad>& grid) {
     const float x = pt[0];
     const float y = pt[1];
 
     for (const GridQuad& quad : grid) {
-        const float &x1 = quad.coords[0];
-        const float &y1 = quad.coords[1];
-        const float &x2 = quad.coords[2];
-        const float &y2 = quad.coords[3];
-        const float &x3 = quad.coords[4];
-        const float &y3 = quad.coords[5];
-        const float &x4 = quad.coords[6];
-        const float &y4 = quad.coords[7];
-
-        // Point-in-quad test:
-
-        // Quad has corners P1-P4; if P is within the quad, then it is on the same side of all the
-        // edges (or on top of one of the edges or corners), traversed in a consistent direction.
-        // This means that the cross product of edge En = Pn->P(n+1 mod 4) and line Ep = Pn->P must
-        // have the same sign (or be zero) for all edges.
-        // For clockwise traversal, the sign should be negative or zero for Ep x En, indicating that
-        // En is to the left of Ep, or overlapping.
-        float s1 = (x - x1) * (y2 - y1) - (y - y1) * (x2 - x1);
-        if (s1 > 0) continue;
-        float s2 = (x - x2) * (y3 - y2) - (y - y2) * (x3 - x2);
-        if (s2 > 0) continue;
-        float s3 = (x - x3) * (y4 - y3) - (y - y3) * (x4 - x3);
-        if (s3 > 0) continue;
-        float s4 = (x - x4) * (y1 - y4) - (y - y4) * (x1 - x4);
-        if (s4 > 0) continue;
-
-        return &quad;
+        if (quadContains(quad, x, y)) return &quad;
     }
     return nullptr;
 }
 
+bool DistortionMapper::quadContains(const GridQuad& quad, float x, float y) {
+    const float &x1 = quad.coords[0];
+    const float &y1 = quad.coords[1];
+    const float &x2 = quad.coords[2];
+    const float &y2 = quad.coords[3];
+    const float &x3 = quad.coords[4];
+    const float &y3 = quad.coords[5];
+    const float &x4 = quad.coords[6];
+    const float &y4 = quad.coords[7];
+
+    // Point-in-quad test:
+
+    // Quad has corners P1-P4; if P is within the quad, then it is on the same side of all the
+    // edges (or on top of one of the edges or corners), traversed in a consistent direction.
+    // This means that the cross product of edge En = Pn->P(n+1 mod 4) and line Ep = Pn->P must
+    // have the same sign (or be zero) for all edges.
+    // For clockwise traversal, the sign should be negative or zero for Ep x En, indicating that
+    // En is to the left of Ep, or overlapping.
+    float s1 = (x - x1) * (y2 - y1) - (y - y1) * (x2 - x1);
+    if (s1 > 0) return false;
+    float s2 = (x - x2) * (y3 - y2) - (y - y2) * (x3 - x2);
+    if (s2 > 0) return false;
+    float s3 = (x - x3) * (y4 - y3) - (y - y3) * (x4 - x3);
+    if (s3 > 0) return false;
+    float s4 = (x - x4) * (y1 - y4) - (y - y4) * (x1 - x4);
+    if (s4 > 0) return false;
+
+    return true;
+}
+
 float DistortionMapper::calculateUorV(const int32_t pt[2], const GridQuad& quad, bool calculateU) {
     const float x = pt[0];
     const float y = pt[1];
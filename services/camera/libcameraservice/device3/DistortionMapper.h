@@ -127,6 +127,21 @@ class DistortionMapper : public CoordinateMapper {
     status_t mapCorrectedRectToRaw(int32_t *rects, int rectCount,
            const DistortionMapperInfo *mapperInfo, bool clamp, bool simple = true) const;
 
+    /**
+     * Transform from corrected (warped) to distorted (original) coordinates, using the full
+     * distortion model. Coordinates are stored as separate x and y arrays and are transformed
+     * in-place without rounding.
+     *
+     * The loop body has no data-dependent branches, so this is the preferred entry point for
+     * mapping many points at once; the compiler can vectorize it.
+     *
+     *   xs, ys: Pointers to arrays of coordCount x and y coordinates
+     *   coordCount: Number of (x,y) pairs to transform
+     *   clamp: Whether to clamp the result to the bounds of the precorrection active array
+     */
+    status_t mapCorrectedToRawBatch(float *xs, float *ys, int coordCount,
+            const DistortionMapperInfo *mapperInfo, bool clamp) const;
+
     struct GridQuad {
         // Source grid quad, or null
         const GridQuad *src;
@@ -155,12 +170,28 @@ class DistortionMapper : public CoordinateMapper {
 
         std::vector<GridQuad> mCorrectedGrid;
         std::vector<GridQuad> mDistortedGrid;
+
+        // Uniform bucket grid over the bounding box of mDistortedGrid, used to find the quads
+        // that may enclose a point without scanning the whole grid. The quads overlapping
+        // bucket b are mQuadIndex[mQuadIndexStart[b]] to mQuadIndex[mQuadIndexStart[b + 1] - 1].
+        float mIndexMinX, mIndexMinY, mIndexMaxX, mIndexMaxY;
+        float mIndexInvBucketW, mIndexInvBucketH;
+        std::vector<uint32_t> mQuadIndexStart;
+        std::vector<uint16_t> mQuadIndex;
     };
 
     // Find which grid quad encloses the point; returns null if none do
     static const GridQuad* findEnclosingQuad(
             const int32_t pt[2], const std::vector<GridQuad>& grid);
 
+    // Find which distorted grid quad encloses the point using the bucket index; returns null
+    // if none do. Requires valid grids.
+    static const GridQuad* findEnclosingQuad(
+            const int32_t pt[2], const DistortionMapperInfo& mapperInfo);
+
+    // Whether the point is within the quad, or on one of its edges
+    static bool quadContains(const GridQuad& quad, float x, float y);
+
     // Calculate 'horizontal' interpolation coordinate for the point and the quad
     // Assumes the point P is within the quad Q.
     // Given quad with points P1-P4, and edges E12-E41, and considering the edge segments as
@@ -188,6 +219,10 @@ class DistortionMapper : public CoordinateMapper {
     constexpr static float kGridMargin = 0.05f;
     // Fuzziness for float inequality tests
     constexpr static float kFloatFuzz = 1e-4;
+    // Number of buckets in each dimension of the quad lookup index
+    constexpr static size_t kIndexSize = 32;
+    // Number of points transformed at a time when batching integer coordinates
+    constexpr static int kBatchSize = 64;
 
     bool mMaxResolution = false;
 
@@ -209,6 +244,9 @@ class DistortionMapper : public CoordinateMapper {
     // Utility to create reverse mapping grids
     status_t buildGrids(DistortionMapperInfo *mapperInfo);
 
+    // Utility to create the quad lookup index for the distorted grid
+    static void buildQuadIndex(DistortionMapperInfo *mapperInfo);
+
     DistortionMapperInfo mDistortionMapperInfo;
     DistortionMapperInfo mDistortionMapperInfoMaximumResolution;
 
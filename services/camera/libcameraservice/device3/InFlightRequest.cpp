@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Camera3-InFlightRequest"
+//#define LOG_NDEBUG 0
+
+#include <algorithm>
+
+#include <utils/Log.h>
+
+#include "device3/InFlightRequest.h"
+
+namespace android {
+
+namespace camera3 {
+
+static size_t roundUpToPowerOf2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+InFlightRequestMap::InFlightRequestMap(size_t capacity) :
+        mMask(roundUpToPowerOf2(std::max<size_t>(capacity, 1)) - 1),
+        mSlots(mMask + 1) {
+}
+
+InFlightRequestMap::InFlightRequestMap(const InFlightRequestMap& other) :
+        InFlightRequestMap(other.mSlots.size()) {
+    *this = other;
+}
+
+InFlightRequestMap& InFlightRequestMap::operator=(const InFlightRequestMap& other) {
+    if (this == &other) {
+        return *this;
+    }
+    clear();
+    for (size_t i = 0; i < other.size(); i++) {
+        add(other.keyAt(i), other.valueAt(i));
+    }
+    return *this;
+}
+
+const InFlightRequest& InFlightRequestMap::valueAt(size_t index) const {
+    return get(mFrameNumbers[index]);
+}
+
+InFlightRequest& InFlightRequestMap::editValueAt(size_t index) {
+    return get(mFrameNumbers[index]);
+}
+
+ssize_t InFlightRequestMap::indexOfKey(uint32_t frameNumber) const {
+    // Most lookups are for the oldest frames, and new frames are appended at the end
+    if (mFrameNumbers.empty() || frameNumber < mFrameNumbers.front() ||
+            frameNumber > mFrameNumbers.back()) {
+        return NAME_NOT_FOUND;
+    }
+    auto it = std::lower_bound(mFrameNumbers.begin(), mFrameNumbers.end(), frameNumber);
+    if (it == mFrameNumbers.end() || *it != frameNumber) {
+        return NAME_NOT_FOUND;
+    }
+    return it - mFrameNumbers.begin();
+}
+
+const InFlightRequest& InFlightRequestMap::valueFor(uint32_t frameNumber) const {
+    return get(frameNumber);
+}
+
+ssize_t InFlightRequestMap::add(uint32_t frameNumber, const InFlightRequest& request) {
+    auto it = std::lower_bound(mFrameNumbers.begin(), mFrameNumbers.end(), frameNumber);
+    if (it != mFrameNumbers.end() && *it == frameNumber) {
+        ALOGE("%s: Frame number %u already in flight", __FUNCTION__, frameNumber);
+        return BAD_VALUE;
+    }
+
+    Slot& slot = mSlots[frameNumber & mMask];
+    if (!slot.request.has_value()) {
+        slot.frameNumber = frameNumber;
+        slot.request.emplace(request);
+    } else {
+        ALOGV("%s: Ring slot for frame %u held by frame %u, using overflow map", __FUNCTION__,
+                frameNumber, slot.frameNumber);
+        mOverflow.emplace(frameNumber, request);
+    }
+
+    return mFrameNumbers.insert(it, frameNumber) - mFrameNumbers.begin();
+}
+
+ssize_t InFlightRequestMap::removeItemsAt(size_t index, size_t count) {
+    if (index + count > mFrameNumbers.size()) {
+        return BAD_INDEX;
+    }
+    for (size_t i = index; i < index + count; i++) {
+        erase(mFrameNumbers[i]);
+    }
+    mFrameNumbers.erase(mFrameNumbers.begin() + index, mFrameNumbers.begin() + index + count);
+    return index;
+}
+
+void InFlightRequestMap::clear() {
+    for (uint32_t frameNumber : mFrameNumbers) {
+        mSlots[frameNumber & mMask].request.reset();
+    }
+    mOverflow.clear();
+    mFrameNumbers.clear();
+}
+
+const InFlightRequest& InFlightRequestMap::get(uint32_t frameNumber) const {
+    const Slot& slot = mSlots[frameNumber & mMask];
+    if (slot.request.has_value() && slot.frameNumber == frameNumber) {
+        return *slot.request;
+    }
+    return mOverflow.at(frameNumber);
+}
+
+InFlightRequest& InFlightRequestMap::get(uint32_t frameNumber) {
+    Slot& slot = mSlots[frameNumber & mMask];
+    if (slot.request.has_value() && slot.frameNumber == frameNumber) {
+        return *slot.request;
+    }
+    return mOverflow.at(frameNumber);
+}
+
+void InFlightRequestMap::erase(uint32_t frameNumber) {
+    Slot& slot = mSlots[frameNumber & mMask];
+    if (slot.request.has_value() && slot.frameNumber == frameNumber) {
+        slot.request.reset();
+        return;
+    }
+    mOverflow.erase(frameNumber);
+}
+
+} // namespace camera3
+
+} // namespace android
@@ -17,7 +17,10 @@
 #ifndef ANDROID_SERVERS_CAMERA3_INFLIGHT_REQUEST_H
 #define ANDROID_SERVERS_CAMERA3_INFLIGHT_REQUEST_H
 
+#include <map>
+#include <optional>
 #include <set>
+#include <vector>
 
 #include <camera/CaptureResult.h>
 #include <camera/CameraMetadata.h>
@@ -253,8 +256,66 @@ struct InFlightRequest {
     }
 };
 
-// Map from frame number to the in-flight request state
-typedef KeyedVector<uint32_t, InFlightRequest> InFlightRequestMap;
+/**
+ * Map from frame number to the in-flight request state.
+ *
+ * Provides the subset of the KeyedVector interface used for in-flight tracking, with indices
+ * referring to entries in increasing frame number order. Requests are stored in a fixed-capacity
+ * ring indexed by frame number, so adding and removing entries never copies InFlightRequest
+ * objects; only the sorted frame number list is shifted. Requests whose ring slot is still
+ * occupied by an older, unfinished frame go to an overflow map.
+ *
+ * Not thread-safe; callers must hold the lock protecting the map. Slots have no per-entry
+ * atomic state: result and notify handling update several fields of a request together,
+ * check shutter order against the last completed frame numbers and walk other in-flight
+ * entries (output transforms, flush), so a lookup that skips the lock would race with those
+ * updates.
+ */
+class InFlightRequestMap {
+  public:
+    // Covers batch size 32 * pipe depth 8 for constrained high speed sessions
+    static const size_t kDefaultCapacity = 256;
+
+    explicit InFlightRequestMap(size_t capacity = kDefaultCapacity);
+    InFlightRequestMap(const InFlightRequestMap& other);
+    InFlightRequestMap& operator=(const InFlightRequestMap& other);
+
+    size_t size() const { return mFrameNumbers.size(); }
+    bool isEmpty() const { return mFrameNumbers.empty(); }
+
+    uint32_t keyAt(size_t index) const { return mFrameNumbers[index]; }
+    const InFlightRequest& valueAt(size_t index) const;
+    InFlightRequest& editValueAt(size_t index);
+
+    // Returns the index of the frame number, or NAME_NOT_FOUND
+    ssize_t indexOfKey(uint32_t frameNumber) const;
+    const InFlightRequest& valueFor(uint32_t frameNumber) const;
+
+    // Returns the index of the new entry, or BAD_VALUE if the frame number is already present
+    ssize_t add(uint32_t frameNumber, const InFlightRequest& request);
+    // Returns the index of the first removed entry, or BAD_INDEX
+    ssize_t removeItemsAt(size_t index, size_t count = 1);
+    void clear();
+
+    // Number of requests that did not fit in the ring, for dumps
+    size_t overflowCount() const { return mOverflow.size(); }
+
+  private:
+    struct Slot {
+        uint32_t frameNumber = 0;
+        std::optional<InFlightRequest> request;
+    };
+
+    const InFlightRequest& get(uint32_t frameNumber) const;
+    InFlightRequest& get(uint32_t frameNumber);
+    void erase(uint32_t frameNumber);
+
+    size_t mMask;
+    std::vector<Slot> mSlots;
+    std::map<uint32_t, InFlightRequest> mOverflow;
+    // Sorted frame numbers of all entries
+    std::vector<uint32_t> mFrameNumbers;
+};
 
 } // namespace camera3
 
@@ -126,7 +126,7 @@ void UHRCropAndMeteringRegionMapper::fixCropRegionsIfNeeded(CameraMetadata *requ
         ALOGV("%s: crop region set by client, doesn't need to be fixed", __FUNCTION__);
         return;
     }
-    camera_metadata_entry_t cropRegionEntry = request->find(ANDROID_SCALER_CROP_REGION);
+    camera_metadata_entry_t cropRegionEntry = request->findForWrite(ANDROID_SCALER_CROP_REGION);
     if (cropRegionEntry.count == 4) {
         cropRegionEntry.data.i32[0] = 0;
         cropRegionEntry.data.i32[1] = 0;
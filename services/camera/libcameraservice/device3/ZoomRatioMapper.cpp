@@ -234,7 +234,7 @@ status_t ZoomRatioMapper::updateCaptureRequest(CameraMetadata* request) {
         zoomRatioIs1 = false;
 
         // If cropRegion is windowboxing, override it with activeArray
-        camera_metadata_entry_t cropRegionEntry = request->find(ANDROID_SCALER_CROP_REGION);
+        camera_metadata_entry_t cropRegionEntry = request->findForWrite(ANDROID_SCALER_CROP_REGION);
         if (cropRegionEntry.count == 4) {
             int cropWidth = cropRegionEntry.data.i32[2];
             int cropHeight = cropRegionEntry.data.i32[3];
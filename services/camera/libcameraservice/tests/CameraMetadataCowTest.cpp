@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "CameraMetadataCowTest"
+
+#include <gtest/gtest.h>
+
+#include <camera/CameraMetadata.h>
+
+using namespace android;
+
+static CameraMetadata makeMetadata(uint8_t aeMode) {
+    CameraMetadata metadata(/*entryCapacity*/4, /*dataCapacity*/16);
+    metadata.update(ANDROID_CONTROL_AE_MODE, &aeMode, 1);
+    int32_t sensitivity = 100;
+    metadata.update(ANDROID_SENSOR_SENSITIVITY, &sensitivity, 1);
+    return metadata;
+}
+
+TEST(CameraMetadataCowTest, CopySharesBuffer) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata::AllocationStats before = CameraMetadata::getAllocationStats();
+
+    CameraMetadata copy(original);
+    CameraMetadata assigned;
+    assigned = original;
+
+    CameraMetadata::AllocationStats after = CameraMetadata::getAllocationStats();
+    EXPECT_EQ(before.allocations, after.allocations);
+    EXPECT_EQ(before.sharedCopies + 2, after.sharedCopies);
+
+    const camera_metadata_t *originalBuffer = original.getAndLock();
+    const camera_metadata_t *copyBuffer = copy.getAndLock();
+    EXPECT_EQ(originalBuffer, copyBuffer);
+    copy.unlock(copyBuffer);
+    original.unlock(originalBuffer);
+}
+
+TEST(CameraMetadataCowTest, WriteDetachesCopy) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata copy(original);
+
+    int32_t sensitivity = 800;
+    ASSERT_EQ(OK, copy.update(ANDROID_SENSOR_SENSITIVITY, &sensitivity, 1));
+    ASSERT_EQ(OK, copy.erase(ANDROID_CONTROL_AE_MODE));
+
+    camera_metadata_entry_t entry = original.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(100, entry.data.i32[0]);
+    EXPECT_TRUE(original.exists(ANDROID_CONTROL_AE_MODE));
+
+    entry = copy.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(800, entry.data.i32[0]);
+    EXPECT_FALSE(copy.exists(ANDROID_CONTROL_AE_MODE));
+
+    // Erasing a missing tag must not force a private copy
+    CameraMetadata second(original);
+    CameraMetadata::AllocationStats before = CameraMetadata::getAllocationStats();
+    EXPECT_EQ(OK, second.erase(ANDROID_FLASH_MODE));
+    EXPECT_EQ(before.allocations, CameraMetadata::getAllocationStats().allocations);
+}
+
+TEST(CameraMetadataCowTest, WriteLockDetachesCopy) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata copy(original);
+
+    const camera_metadata_t *originalBuffer = original.getAndLock();
+    camera_metadata_t *writable = copy.getAndLockForWrite();
+    EXPECT_NE(originalBuffer, writable);
+    copy.unlock(writable);
+    original.unlock(originalBuffer);
+}
+
+TEST(CameraMetadataCowTest, FindKeepsBufferShared) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata copy(original);
+    CameraMetadata::AllocationStats before = CameraMetadata::getAllocationStats();
+
+    camera_metadata_entry_t entry = copy.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(100, entry.data.i32[0]);
+    EXPECT_EQ(before.allocations, CameraMetadata::getAllocationStats().allocations);
+
+    const camera_metadata_t *originalBuffer = original.getAndLock();
+    const camera_metadata_t *copyBuffer = copy.getAndLock();
+    EXPECT_EQ(originalBuffer, copyBuffer);
+    copy.unlock(copyBuffer);
+    original.unlock(originalBuffer);
+}
+
+TEST(CameraMetadataCowTest, FindForWriteDetachesCopy) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata copy(original);
+
+    camera_metadata_entry_t entry = copy.findForWrite(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    entry.data.i32[0] = 400;
+
+    entry = original.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(100, entry.data.i32[0]);
+
+    entry = copy.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(400, entry.data.i32[0]);
+}
+
+TEST(CameraMetadataCowTest, ReleaseSharedBuffer) {
+    CameraMetadata original = makeMetadata(1);
+    CameraMetadata copy(original);
+
+    camera_metadata_t *released = copy.release();
+    ASSERT_NE(nullptr, released);
+    EXPECT_TRUE(copy.isEmpty());
+
+    // The released buffer belongs to the caller; the original is unaffected
+    const camera_metadata_t *originalBuffer = original.getAndLock();
+    EXPECT_NE(originalBuffer, released);
+    original.unlock(originalBuffer);
+    free_camera_metadata(released);
+
+    camera_metadata_entry_t entry = original.find(ANDROID_SENSOR_SENSITIVITY);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(100, entry.data.i32[0]);
+}
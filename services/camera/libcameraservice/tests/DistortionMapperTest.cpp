@@ -379,3 +379,112 @@ TEST(DistortionMapperTest, CompareToOpenCV) {
                 << expCoords[i] << ", " << expCoords[i + 1] << ")";
     }
 }
+
+TEST(DistortionMapperTest, QuadIndexMatchesLinearScan) {
+    float bigDistortion[] = {0.1, -0.003, 0.004, 0.02, 0.01};
+
+    DistortionMapper m;
+    setupTestMapper(&m, bigDistortion, testICal,
+            /*activeArray*/testActiveArray,
+            /*preCorrectionActiveArray*/testPreCorrActiveArray);
+
+    // Force grid and index construction
+    DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+    auto coords = basicCoords;
+    ASSERT_EQ(m.mapRawToCorrected(coords.data(), 1, mapperInfo, /*clamp*/false,
+            /*simple*/false), OK);
+    ASSERT_TRUE(mapperInfo->mValidGrids);
+
+    std::default_random_engine gen(1234);
+    // Include points outside of the grid as well
+    std::uniform_int_distribution<int> x_dist(-200, testPreCorrActiveArray[2] + 200);
+    std::uniform_int_distribution<int> y_dist(-200, testPreCorrActiveArray[3] + 200);
+    for (size_t i = 0; i < 1e5; i++) {
+        int32_t pt[2] = { x_dist(gen), y_dist(gen) };
+        EXPECT_EQ(DistortionMapper::findEnclosingQuad(pt, mapperInfo->mDistortedGrid),
+                DistortionMapper::findEnclosingQuad(pt, *mapperInfo))
+                << "(" << pt[0] << ", " << pt[1] << ")";
+    }
+}
+
+TEST(DistortionMapperTest, BatchMatchesCoordPairs) {
+    float bigDistortion[] = {0.1, -0.003, 0.004, 0.02, 0.01};
+
+    DistortionMapper m;
+    setupTestMapper(&m, bigDistortion, testICal,
+            /*activeArray*/testActiveArray,
+            /*preCorrectionActiveArray*/testPreCorrActiveArray);
+    DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+
+    std::default_random_engine gen(1234);
+    std::uniform_int_distribution<int> x_dist(0, testActiveArray[2] - 1);
+    std::uniform_int_distribution<int> y_dist(0, testActiveArray[3] - 1);
+
+    // Odd size so the last batch is partial
+    const int coordCount = 1001;
+    std::vector<int32_t> pairs(coordCount * 2);
+    std::vector<float> xs(coordCount), ys(coordCount);
+    for (int i = 0; i < coordCount; i++) {
+        pairs[i * 2] = xs[i] = x_dist(gen);
+        pairs[i * 2 + 1] = ys[i] = y_dist(gen);
+    }
+
+    for (bool clamp : {false, true}) {
+        auto mappedPairs = pairs;
+        auto mappedXs = xs;
+        auto mappedYs = ys;
+        ASSERT_EQ(m.mapCorrectedToRaw(mappedPairs.data(), coordCount, mapperInfo, clamp,
+                /*simple*/false), OK);
+        ASSERT_EQ(m.mapCorrectedToRawBatch(mappedXs.data(), mappedYs.data(), coordCount,
+                mapperInfo, clamp), OK);
+        for (int i = 0; i < coordCount; i++) {
+            EXPECT_EQ(mappedPairs[i * 2], static_cast<int32_t>(std::round(mappedXs[i])));
+            EXPECT_EQ(mappedPairs[i * 2 + 1], static_cast<int32_t>(std::round(mappedYs[i])));
+        }
+    }
+}
+
+// Measure the cost of correcting a typical capture result, which carries a handful of
+// metering regions, using the OpenCV comparison data as the coordinate source.
+TEST(DistortionMapperTest, OpenCvPerResultCost) {
+    float bigDistortion[] = {0.1, -0.003, 0.004, 0.02, 0.01};
+    // 3 metering regions (AE/AF/AWB), each mapped as 2 corners
+    constexpr size_t kCoordsPerResult = 3 * 2;
+
+    DistortionMapper m;
+    setupTestMapper(&m, bigDistortion, testICal,
+            /*activeArray*/testActiveArray,
+            /*preCorrectionActiveArray*/testActiveArray);
+    DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+
+    // Build grids outside of the timed section, as this only happens on calibration changes
+    base::Timer buildTimer;
+    auto coords = openCvData::rawCoords;
+    ASSERT_EQ(m.mapRawToCorrected(coords.data(), 1, mapperInfo, /*clamp*/false,
+            /*simple*/false), OK);
+    auto buildDuration = buildTimer.duration();
+
+    const size_t resultCount = coords.size() / 2 / kCoordsPerResult;
+    coords = openCvData::rawCoords;
+    base::Timer rawToCorrectedTimer;
+    for (size_t r = 0; r < resultCount; r++) {
+        EXPECT_EQ(m.mapRawToCorrected(coords.data() + r * kCoordsPerResult * 2,
+                kCoordsPerResult, mapperInfo, /*clamp*/false, /*simple*/false), OK);
+    }
+    auto rawToCorrectedDuration = rawToCorrectedTimer.duration();
+
+    base::Timer correctedToRawTimer;
+    for (size_t r = 0; r < resultCount; r++) {
+        EXPECT_EQ(m.mapCorrectedToRaw(coords.data() + r * kCoordsPerResult * 2,
+                kCoordsPerResult, mapperInfo, /*clamp*/false, /*simple*/false), OK);
+    }
+    auto correctedToRawDuration = correctedToRawTimer.duration();
+
+    using UsDouble = std::chrono::duration<double, std::micro>;
+    RecordProperty("GridBuildDurationUs", base::StringPrintf("%f",
+            std::chrono::duration_cast<UsDouble>(buildDuration).count()));
+    RecordProperty("RawToCorrectedDurationPerResultUs", base::StringPrintf("%f",
+            (std::chrono::duration_cast<UsDouble>(rawToCorrectedDuration) / resultCount).count()));
+    RecordProperty("CorrectedToRawDurationPerResultUs", base::StringPrintf("%f",
+            (std::chrono::duration_cast<UsDouble>(correctedToRawDuration) / resultCount).count()));
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "InFlightRequestMapTest"
+
+#include <gtest/gtest.h>
+
+#include "../device3/InFlightRequest.h"
+
+using namespace android;
+using namespace android::camera3;
+
+static InFlightRequest makeRequest(int numBuffers) {
+    InFlightRequest r;
+    r.numBuffersLeft = numBuffers;
+    return r;
+}
+
+TEST(InFlightRequestMapTest, AddFindRemove) {
+    InFlightRequestMap map(/*capacity*/8);
+    EXPECT_TRUE(map.isEmpty());
+
+    for (uint32_t f = 0; f < 5; f++) {
+        EXPECT_EQ(static_cast<ssize_t>(f), map.add(f, makeRequest(f)));
+    }
+    EXPECT_EQ(BAD_VALUE, map.add(3, makeRequest(0)));
+    ASSERT_EQ(5u, map.size());
+
+    for (uint32_t f = 0; f < 5; f++) {
+        ssize_t idx = map.indexOfKey(f);
+        ASSERT_EQ(static_cast<ssize_t>(f), idx);
+        EXPECT_EQ(f, map.keyAt(idx));
+        EXPECT_EQ(static_cast<int>(f), map.valueAt(idx).numBuffersLeft);
+        EXPECT_EQ(static_cast<int>(f), map.valueFor(f).numBuffersLeft);
+    }
+    EXPECT_EQ(NAME_NOT_FOUND, map.indexOfKey(5));
+
+    map.editValueAt(map.indexOfKey(2)).numBuffersLeft = 42;
+    EXPECT_EQ(42, map.valueFor(2).numBuffersLeft);
+
+    EXPECT_EQ(1, map.removeItemsAt(1, 2));
+    ASSERT_EQ(3u, map.size());
+    EXPECT_EQ(0u, map.keyAt(0));
+    EXPECT_EQ(3u, map.keyAt(1));
+    EXPECT_EQ(4u, map.keyAt(2));
+    EXPECT_EQ(NAME_NOT_FOUND, map.indexOfKey(2));
+    EXPECT_EQ(BAD_INDEX, map.removeItemsAt(2, 2));
+
+    map.clear();
+    EXPECT_TRUE(map.isEmpty());
+    EXPECT_EQ(NAME_NOT_FOUND, map.indexOfKey(0));
+}
+
+TEST(InFlightRequestMapTest, RingWraparoundAndOverflow) {
+    InFlightRequestMap map(/*capacity*/4);
+
+    // Frame 0 stays in flight while later frames wrap around the ring
+    ASSERT_EQ(0, map.add(0, makeRequest(100)));
+    bool overflowed = false;
+    for (uint32_t f = 1; f < 20; f++) {
+        ASSERT_GE(map.add(f, makeRequest(f)), 0);
+        overflowed |= map.overflowCount() > 0;
+        if (f >= 3) {
+            // Complete frames in order, except for frame 0
+            ssize_t idx = map.indexOfKey(f - 2);
+            ASSERT_GE(idx, 0);
+            map.removeItemsAt(idx);
+        }
+    }
+    EXPECT_TRUE(overflowed);
+    EXPECT_EQ(0u, map.overflowCount());
+
+    ASSERT_EQ(3u, map.size());
+    EXPECT_EQ(0u, map.keyAt(0));
+    EXPECT_EQ(100, map.valueAt(0).numBuffersLeft);
+    EXPECT_EQ(18u, map.keyAt(1));
+    EXPECT_EQ(18, map.valueAt(1).numBuffersLeft);
+    EXPECT_EQ(19u, map.keyAt(2));
+    EXPECT_EQ(19, map.valueAt(2).numBuffersLeft);
+
+    // Copies are independent
+    InFlightRequestMap copy(map);
+    map.clear();
+    ASSERT_EQ(3u, copy.size());
+    EXPECT_EQ(19, copy.valueFor(19).numBuffersLeft);
+    EXPECT_EQ(100, copy.valueFor(0).numBuffersLeft);
+}
+
+TEST(InFlightRequestMapTest, OutOfOrderAdd) {
+    InFlightRequestMap map;
+
+    for (uint32_t f : {10u, 3u, 7u, 1000u, 5u}) {
+        ASSERT_GE(map.add(f, makeRequest(f)), 0);
+    }
+    const uint32_t expected[] = {3, 5, 7, 10, 1000};
+    ASSERT_EQ(std::size(expected), map.size());
+    for (size_t i = 0; i < map.size(); i++) {
+        EXPECT_EQ(expected[i], map.keyAt(i));
+        EXPECT_EQ(static_cast<int>(expected[i]), map.valueAt(i).numBuffersLeft);
+    }
+}
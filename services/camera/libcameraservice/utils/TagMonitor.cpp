@@ -41,6 +41,8 @@ TagMonitor::TagMonitor(const TagMonitor& other):
         mLastMonitoredResultValues(other.mLastMonitoredResultValues),
         mLastMonitoredPhysicalRequestKeys(other.mLastMonitoredPhysicalRequestKeys),
         mLastMonitoredPhysicalResultKeys(other.mLastMonitoredPhysicalResultKeys),
+        mMonitoredMetadataCount(other.mMonitoredMetadataCount),
+        mChangedValueCount(other.mChangedValueCount),
         mMonitoringEvents(other.mMonitoringEvents),
         mVendorTagId(other.mVendorTagId) {}
 
@@ -136,6 +138,7 @@ void TagMonitor::monitorMetadata(eventSource source, int64_t frameNumber, nsecs_
         outputStreamIds.emplace(streamId);
     }
     std::string emptyId;
+    mMonitoredMetadataCount += 1 + physicalMetadata.size();
     for (auto tag : mMonitoredTagList) {
         monitorSingleMetadata(source, frameNumber, timestamp, emptyId, tag, metadata,
                 outputStreamIds, inputStreamId);
@@ -151,23 +154,14 @@ void TagMonitor::monitorSingleMetadata(eventSource source, int64_t frameNumber,
         const std::string& cameraId, uint32_t tag, const CameraMetadata& metadata,
         const std::unordered_set<int32_t> &outputStreamIds, int32_t inputStreamId) {
 
-    CameraMetadata &lastValues = (source == REQUEST) ?
+    LastValues &lastValues = (source == REQUEST) ?
             (cameraId.empty() ? mLastMonitoredRequestValues :
                     mLastMonitoredPhysicalRequestKeys[cameraId]) :
             (cameraId.empty() ? mLastMonitoredResultValues :
                     mLastMonitoredPhysicalResultKeys[cameraId]);
 
     camera_metadata_ro_entry entry = metadata.find(tag);
-    if (lastValues.isEmpty()) {
-        lastValues = CameraMetadata(mMonitoredTagList.size());
-        const camera_metadata_t *metaBuffer =
-                lastValues.getAndLock();
-        set_camera_metadata_vendor_id(
-                const_cast<camera_metadata_t *> (metaBuffer), mVendorTagId);
-        lastValues.unlock(metaBuffer);
-    }
-
-    camera_metadata_entry lastEntry = lastValues.find(tag);
+    LastValue &lastValue = lastValues[tag];
 
     // Monitor when the stream ids change, this helps visually see what
     // monitored metadata values are for capture requests with different
@@ -187,14 +181,13 @@ void TagMonitor::monitorSingleMetadata(eventSource source, int64_t frameNumber,
     }
     if (entry.count > 0) {
         bool isDifferent = false;
-        if (lastEntry.count > 0) {
+        size_t entryBytes = camera_metadata_type_size[entry.type] * entry.count;
+        if (lastValue.present) {
             // Have a last value, compare to see if changed
-            if (lastEntry.type == entry.type &&
-                    lastEntry.count == entry.count) {
+            if (lastValue.type == entry.type &&
+                    lastValue.data.size() == entryBytes) {
                 // Same type and count, compare values
-                size_t bytesPerValue = camera_metadata_type_size[lastEntry.type];
-                size_t entryBytes = bytesPerValue * lastEntry.count;
-                int cmp = memcmp(entry.data.u8, lastEntry.data.u8, entryBytes);
+                int cmp = memcmp(entry.data.u8, lastValue.data.data(), entryBytes);
                 if (cmp != 0) {
                     isDifferent = true;
                 }
@@ -211,16 +204,22 @@ void TagMonitor::monitorSingleMetadata(eventSource source, int64_t frameNumber,
             ALOGV("%s: Tag %s changed", __FUNCTION__,
                   get_local_camera_metadata_tag_name_vendor_id(
                           tag, mVendorTagId));
-            lastValues.update(entry);
+            // assign() reuses the existing capacity for same-sized updates.
+            lastValue.present = true;
+            lastValue.type = entry.type;
+            lastValue.data.assign(entry.data.u8, entry.data.u8 + entryBytes);
+            mChangedValueCount++;
             mMonitoringEvents.emplace(source, frameNumber, timestamp, entry, cameraId,
                                       std::unordered_set<int>(), -1);
         }
-    } else if (lastEntry.count > 0) {
+    } else if (lastValue.present) {
         // Value has been removed
         ALOGV("%s: Tag %s removed", __FUNCTION__,
               get_local_camera_metadata_tag_name_vendor_id(
                       tag, mVendorTagId));
-        lastValues.erase(tag);
+        lastValue.present = false;
+        lastValue.data.clear();
+        mChangedValueCount++;
         entry.tag = tag;
         entry.type = get_local_camera_metadata_tag_type_vendor_id(tag,
                 mVendorTagId);
@@ -247,6 +246,11 @@ void TagMonitor::dumpMonitoredMetadata(int fd) {
     } else {
         dprintf(fd, "     Tag monitoring disabled (enable with -m <name1,..,nameN>)\n");
     }
+    if (mMonitoredMetadataCount > 0) {
+        dprintf(fd, "     Monitored %" PRIu64 " metadata buffers, %.2f changed values per"
+                " buffer\n", mMonitoredMetadataCount,
+                static_cast<double>(mChangedValueCount) / mMonitoredMetadataCount);
+    }
 
     if (mMonitoringEvents.size() == 0) { return; }
 
@@ -64,6 +64,8 @@ class TagMonitor {
     // Disable monitoring; does not clear the event log
     void disableMonitoring();
 
+    bool isMonitoringEnabled() const { return mMonitoringEnabled; }
+
     // Scan through the metadata and update the monitoring information
     void monitorMetadata(eventSource source, int64_t frameNumber,
             nsecs_t timestamp, const CameraMetadata& metadata,
@@ -88,6 +90,18 @@ class TagMonitor {
     static String8 getEventDataString(const uint8_t* data_ptr, uint32_t tag, int type, int count,
                                       int indentation);
 
+    /**
+     * Latest-seen value of one tracked tag. Together these form the previous
+     * frame's state that each new frame is diffed against; only the differences
+     * are recorded as events.
+     */
+    struct LastValue {
+        bool present = false;
+        uint8_t type = 0;
+        std::vector<uint8_t> data;
+    };
+    typedef std::unordered_map<uint32_t, LastValue> LastValues;
+
     void monitorSingleMetadata(TagMonitor::eventSource source, int64_t frameNumber,
             nsecs_t timestamp, const std::string& cameraId, uint32_t tag,
             const CameraMetadata& metadata, const std::unordered_set<int32_t> &outputStreamIds,
@@ -100,11 +114,15 @@ class TagMonitor {
     std::vector<uint32_t> mMonitoredTagList;
 
     // Latest-seen values of tracked tags
-    CameraMetadata mLastMonitoredRequestValues;
-    CameraMetadata mLastMonitoredResultValues;
+    LastValues mLastMonitoredRequestValues;
+    LastValues mLastMonitoredResultValues;
+
+    std::unordered_map<std::string, LastValues> mLastMonitoredPhysicalRequestKeys;
+    std::unordered_map<std::string, LastValues> mLastMonitoredPhysicalResultKeys;
 
-    std::unordered_map<std::string, CameraMetadata> mLastMonitoredPhysicalRequestKeys;
-    std::unordered_map<std::string, CameraMetadata> mLastMonitoredPhysicalResultKeys;
+    // Number of monitored metadata buffers, and how many tag values changed in them
+    uint64_t mMonitoredMetadataCount = 0;
+    uint64_t mChangedValueCount = 0;
 
     int32_t mLastInputStreamId = -1;
     std::unordered_set<int32_t> mLastStreamIds;
@@ -23,6 +23,7 @@
 #include "iface_statsd.h"
 
 #include <pwd.h> //getpwuid
+#include <string.h> // memcpy
 
 #include <android-base/stringprintf.h>
 #include <android/content/pm/IPackageManagerNative.h>  // package info
@@ -35,6 +36,7 @@
 #include <private/android_filesystem_config.h> // UID
 #include <stats_media_metrics.h>
 
+#include <algorithm>
 #include <set>
 
 namespace android {
@@ -111,16 +113,47 @@ MediaMetricsService::MediaMetricsService()
           mMaxRecordsExpiredAtOnce(kMaxExpiredAtOnce)
 {
     ALOGD("%s", __func__);
+    mConsolidateThread = std::thread([this] { consolidateThreadLoop(); });
 }
 
 MediaMetricsService::~MediaMetricsService()
 {
     ALOGD("%s", __func__);
+    {
+        std::lock_guard l(mConsolidateLock);
+        mConsolidateExit = true;
+    }
+    mConsolidateCv.notify_one();
+    mConsolidateThread.join();
+
     // the class destructor clears anyhow, but we enforce clearing items first.
+    std::lock_guard _l(mLock);
+    consolidate();
     mItemsDiscarded += (int64_t)mItems.size();
     mItems.clear();
 }
 
+status_t MediaMetricsService::submitBuffer(const char *buffer, size_t length)
+{
+    status_t status = NO_ERROR;
+    while (length > 0) {
+        // Each item starts with its total size.
+        uint32_t size;
+        if (length < sizeof(size)) return BAD_VALUE;
+        memcpy(&size, buffer, sizeof(size));
+        if (size < sizeof(size) || size > length) return BAD_VALUE;
+
+        auto item = std::make_unique<mediametrics::Item>();
+        const status_t itemStatus = item->readFromByteString(buffer, size);
+        if (itemStatus != NO_ERROR) return itemStatus;
+        const status_t submitStatus = submitInternal(item.release(), true /* release */);
+        if (status == NO_ERROR) status = submitStatus;
+        buffer += size;
+        length -= size;
+    }
+    return status;
+}
+
 status_t MediaMetricsService::submitInternal(mediametrics::Item *item, bool release)
 {
     // calling PID is 0 for one-way calls.
@@ -302,6 +335,7 @@ status_t MediaMetricsService::dump(int fd, const Vector<String16>& args)
     std::stringstream result;
     {
         std::lock_guard _l(mLock);
+        consolidate();
 
         if (clear) {
             mItemsDiscarded += (int64_t)mItems.size();
@@ -488,21 +522,60 @@ void MediaMetricsService::processExpirations()
 
 void MediaMetricsService::saveItem(const std::shared_ptr<const mediametrics::Item>& item)
 {
-    std::lock_guard _l(mLock);
-    // we assume the items are roughly in time order.
-    mItems.emplace_back(item);
-    if (isPullable(item->getKey())) {
-        registerStatsdCallbacksIfNeeded();
-        mPullableItems[item->getKey()].emplace_back(item);
-    }
-    ++mItemsFinalized;
-    if (expirations(item)
+    mPendingItems.push(item);
+    // Only the first submitter after a consolidation needs to wake the thread.
+    if (!mConsolidatePending.exchange(true)) {
+        std::lock_guard l(mConsolidateLock);
+        mConsolidateCv.notify_one();
+    }
+}
+
+void MediaMetricsService::consolidate()
+{
+    std::vector<std::shared_ptr<const mediametrics::Item>> items;
+    if (mPendingItems.drain(&items) == 0) return;
+
+    // Shards are only ordered internally, merge them back into submission time order.
+    std::stable_sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+        return a->getTimestamp() < b->getTimestamp();
+    });
+    for (const auto& item : items) {
+        // we assume the items are roughly in time order.
+        mItems.emplace_back(item);
+        if (isPullable(item->getKey())) {
+            registerStatsdCallbacksIfNeeded();
+            mPullableItems[item->getKey()].emplace_back(item);
+        }
+    }
+    mItemsFinalized += (int64_t)items.size();
+    // The new items are never expired, as the oldest of them stops the search.
+    if (expirations(items.front())
             && (!mExpireFuture.valid()
                || mExpireFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
         mExpireFuture = std::async(std::launch::async, [this] { processExpirations(); });
     }
 }
 
+void MediaMetricsService::consolidateThreadLoop()
+{
+    pthread_setname_np(pthread_self(), "mediametrics.q");
+    std::unique_lock ul(mConsolidateLock);
+    while (true) {
+        mConsolidateCv.wait(ul, [this] {
+            return mConsolidateExit || mConsolidatePending.load();
+        });
+        if (mConsolidateExit) break;
+        ul.unlock();
+        // Clear before draining, so that a later submission wakes us up again.
+        mConsolidatePending = false;
+        {
+            std::lock_guard _l(mLock);
+            consolidate();
+        }
+        ul.lock();
+    }
+}
+
 /* static */
 bool MediaMetricsService::isContentValid(const mediametrics::Item *item, bool isTrusted)
 {
@@ -590,6 +663,7 @@ AStatsManager_PullAtomCallbackReturn MediaMetricsService::pullItems(
         return AStatsManager_PULL_SKIP;
     }
     std::lock_guard _l(mLock);
+    consolidate();
     bool dumped = false;
     for (auto &item : mPullableItems[key]) {
         if (const auto sitem = item.lock()) {
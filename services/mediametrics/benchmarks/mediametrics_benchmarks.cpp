@@ -14,7 +14,14 @@
  * limitations under the License.
  */
 
+#include <malloc.h>
+
+#include <string>
+#include <vector>
+
 #include <media/MediaMetricsItem.h>
+#include <mediametricsservice/MediaMetricsService.h>
+#include <mediametricsservice/TimeMachine.h>
 #include <benchmark/benchmark.h>
 
 class MyItem : public android::mediametrics::BaseItem {
@@ -44,4 +51,127 @@ static void BM_SubmitBuffer(benchmark::State& state)
 
 BENCHMARK(BM_SubmitBuffer)->Iterations(4000);   // Adjust magic number until test runs
 
+// Submits a typical audio track item through the client library, with batching
+// disabled (0) or enabled (1).
+static void BM_ItemSelfrecord(benchmark::State& state)
+{
+    android::mediametrics::BaseItem::setBatchingEnabled(state.range(0) != 0);
+    android::mediametrics::Item item("audiotrack");
+    item.setInt32("channelMask", 3)
+        .setInt32("sampleRate", 48000)
+        .setCString("encoding", "AUDIO_FORMAT_PCM_16_BIT")
+        .setDouble("volume.left", 1.)
+        .setDouble("volume.right", 1.)
+        .setInt64("frames", 0);
+
+    (void)item.selfrecord(); // warm up the reused buffers.
+    for (auto _ : state) {
+        item.setInt64("frames", (int64_t)state.iterations());
+        if (!item.selfrecord()) {
+            state.SkipWithError("failed"); // see BM_SubmitBuffer about one-way failures.
+            break;
+        }
+    }
+    (void)android::mediametrics::BaseItem::flush();
+    android::mediametrics::BaseItem::setBatchingEnabled(false);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ItemSelfrecord)->Arg(0)->Iterations(4000);
+BENCHMARK(BM_ItemSelfrecord)->Arg(1);
+
+// Measures in-process submission throughput to the service, without binder,
+// from several concurrent submitters as seen when many codecs come and go.
+static void BM_ServiceSubmit(benchmark::State& state)
+{
+    // Shared by all the threads of a run, created before any of them starts submitting.
+    static android::sp<android::MediaMetricsService> service;
+    if (state.thread_index() == 0) {
+        service = new android::MediaMetricsService();
+    }
+    android::mediametrics::Item item("audiotrack");
+    item.setInt32("thread", state.thread_index());
+    for (auto _ : state) {
+        item.setInt64("iteration", (int64_t)state.iterations());
+        if (service->submit(&item) != android::NO_ERROR) {
+            state.SkipWithError("submit failed");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ServiceSubmit)->ThreadRange(1, 16)->UseRealTime();
+
+// TimeMachine shape: keys with a handful of properties each, like audio tracks.
+static constexpr size_t kTimeMachineKeys = 200;
+static constexpr size_t kTimeMachineProperties = 8;
+
+static std::string timeMachineKey(size_t i) {
+    return "audio.track." + std::to_string(i);
+}
+
+static std::string timeMachineProperty(size_t i) {
+    return "property" + std::to_string(i);
+}
+
+// Fills the TimeMachine with samples, every sample changing the property value.
+static void fillTimeMachine(android::mediametrics::TimeMachine& timeMachine, size_t samples) {
+    for (size_t key = 0; key < kTimeMachineKeys; ++key) {
+        auto item = std::make_shared<android::mediametrics::Item>(timeMachineKey(key).c_str());
+        item->setTimestamp(1);
+        (void)timeMachine.put(item, true /* isTrusted */);
+    }
+    for (size_t i = 0; i < samples; ++i) {
+        const size_t key = i % kTimeMachineKeys;
+        const size_t property = (i / kTimeMachineKeys) % kTimeMachineProperties;
+        (void)timeMachine.put(
+                timeMachineKey(key) + "." + timeMachineProperty(property),
+                (int64_t)i, (int64_t)i + 2 /* time */);
+    }
+}
+
+// Reports the heap held by a TimeMachine per million samples put in.
+static void BM_TimeMachinePut(benchmark::State& state)
+{
+    const size_t samples = state.range(0);
+    size_t heapBytes = 0;
+    for (auto _ : state) {
+        const size_t before = mallinfo().uordblks;
+        android::mediametrics::TimeMachine timeMachine;
+        fillTimeMachine(timeMachine, samples);
+        heapBytes = mallinfo().uordblks - before;
+        benchmark::DoNotOptimize(timeMachine.size());
+    }
+    state.SetItemsProcessed(state.iterations() * samples);
+    state.counters["bytes_per_million_samples"] = (double)heapBytes * 1e6 / samples;
+}
+
+BENCHMARK(BM_TimeMachinePut)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Query latency at random points in time of a full TimeMachine.
+static void BM_TimeMachineGet(benchmark::State& state)
+{
+    constexpr size_t kSamples = 1000000;
+    android::mediametrics::TimeMachine timeMachine;
+    fillTimeMachine(timeMachine, kSamples);
+    std::vector<std::string> urls;
+    for (size_t key = 0; key < kTimeMachineKeys; ++key) {
+        for (size_t property = 0; property < kTimeMachineProperties; ++property) {
+            urls.push_back(timeMachineKey(key) + "." + timeMachineProperty(property));
+        }
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        int64_t value;
+        const int64_t time = kSamples - (int64_t)(i * 7919 % 20000);
+        benchmark::DoNotOptimize(
+                timeMachine.get(urls[i % urls.size()], &value, -1 /* uidCheck */, time));
+        ++i;
+    }
+}
+
+BENCHMARK(BM_TimeMachineGet);
+
 BENCHMARK_MAIN();
@@ -17,9 +17,11 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <future>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 // IMediaMetricsService must include Vector, String16, Errors
@@ -30,6 +32,7 @@
 #include <utils/String8.h>
 
 #include "AudioAnalytics.h"
+#include "ShardedAppendLog.h"
 
 namespace android {
 
@@ -56,11 +59,12 @@ public:
         return submitInternal(item, false /* release */);
     }
 
-    status_t submitBuffer(const char *buffer, size_t length) {
-        mediametrics::Item *item = new mediametrics::Item();
-        return item->readFromByteString(buffer, length)
-                ?: submitInternal(item, true /* release */);
-    }
+    /**
+     * Submits the items encoded back to back in buffer, as batched by clients.
+     *
+     * \return the first failure, items following a malformed item are dropped.
+     */
+    status_t submitBuffer(const char *buffer, size_t length);
 
     status_t dump(int fd, const Vector<String16>& args) override;
 
@@ -97,6 +101,10 @@ private:
     bool isRateLimited(mediametrics::Item *) const;
     void saveItem(const std::shared_ptr<const mediametrics::Item>& item);
 
+    // Moves the items pending in mPendingItems to mItems.
+    void consolidate() REQUIRES(mLock);
+    void consolidateThreadLoop() NO_THREAD_SAFETY_ANALYSIS; // doesn't cover unique_lock
+
     bool expirations(const std::shared_ptr<const mediametrics::Item>& item) REQUIRES(mLock);
 
     // support for generating output
@@ -133,6 +141,16 @@ private:
     // mAudioAnalytics is locked internally.
     mediametrics::AudioAnalytics mAudioAnalytics{mStatsdLog};
 
+    // Submitted items are appended here by the binder threads without taking mLock,
+    // then moved into mItems by the consolidate thread, or by any reader of mItems.
+    mediametrics::ShardedAppendLog<std::shared_ptr<const mediametrics::Item>> mPendingItems;
+    std::atomic<bool> mConsolidatePending{false};
+
+    std::mutex mConsolidateLock;
+    std::condition_variable mConsolidateCv;
+    bool mConsolidateExit GUARDED_BY(mConsolidateLock) = false;
+    std::thread mConsolidateThread; // initialized last in the constructor.
+
     std::mutex mLock;
     // statistics about our analytics
     int64_t mItemsFinalized GUARDED_BY(mLock) = 0;
@@ -144,7 +162,6 @@ private:
     std::future<void> mExpireFuture GUARDED_BY(mLock);
 
     // Our item queue, generally (oldest at front)
-    // TODO: Make separate class, use segmented queue, write lock only end.
     // Note: Another analytics module might have ownership of an item longer than the log.
     std::deque<std::shared_ptr<const mediametrics::Item>> mItems GUARDED_BY(mLock);
 
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sched.h>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace android::mediametrics {
+
+/**
+ * ShardedAppendLog is an unbounded multiple producer append log.
+ *
+ * Producers push() without taking any lock onto one of several shards,
+ * chosen by the CPU they run on, so that concurrent producers seldom
+ * contend on the same cache line.
+ *
+ * drain() detaches the contents of all the shards at once. Elements of
+ * a shard come out in the order they were pushed, but there is no order
+ * between elements of different shards; callers needing one must sort.
+ *
+ * All methods are thread-safe.
+ */
+template <typename T, size_t Shards = 8>
+class ShardedAppendLog {
+    struct Node {
+        T value;
+        Node *next;
+    };
+
+    // Each shard on its own cache line to avoid false sharing.
+    struct alignas(64) Shard {
+        std::atomic<Node *> head{nullptr};
+    };
+
+    Shard mShards[Shards];
+
+public:
+    ShardedAppendLog() = default;
+    ShardedAppendLog(const ShardedAppendLog&) = delete;
+    ShardedAppendLog& operator=(const ShardedAppendLog&) = delete;
+
+    ~ShardedAppendLog() {
+        std::vector<T> discarded;
+        drain(&discarded);
+    }
+
+    /** Appends value to the shard of the current CPU. */
+    void push(T value) {
+        Node *node = new Node{std::move(value), nullptr};
+        Shard &shard = mShards[shardIndex()];
+        node->next = shard.head.load();
+        while (!shard.head.compare_exchange_weak(node->next, node)) {}
+    }
+
+    /**
+     * Moves all the pushed elements to the back of the output vector.
+     *
+     * \return the number of elements moved.
+     */
+    size_t drain(std::vector<T> *out) {
+        size_t count = 0;
+        for (auto &shard : mShards) {
+            // The shard is a stack, reverse it to restore the push order.
+            Node *reversed = nullptr;
+            for (Node *node = shard.head.exchange(nullptr); node != nullptr; ) {
+                Node *next = node->next;
+                node->next = reversed;
+                reversed = node;
+                node = next;
+            }
+            while (reversed != nullptr) {
+                Node *next = reversed->next;
+                out->push_back(std::move(reversed->value));
+                delete reversed;
+                reversed = next;
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    /** Returns true if nothing is pending; may be stale by the time it returns. */
+    bool empty() const {
+        for (const auto &shard : mShards) {
+            if (shard.head.load() != nullptr) return false;
+        }
+        return true;
+    }
+
+private:
+    static size_t shardIndex() {
+        const int cpu = sched_getcpu();
+        return cpu >= 0 ? (size_t)cpu % Shards : 0;
+    }
+};
+
+} // namespace android::mediametrics
@@ -16,11 +16,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <any>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -66,7 +69,114 @@ std::ostream & operator<< (std::ostream& s,
 class TimeMachine final { // made final as we have copy constructor instead of dup() override.
 public:
     using Elem = Item::Prop::Elem;  // use the Item property element.
-    using PropertyHistory = std::multimap<int64_t /* time */, Elem>;
+
+    static inline constexpr size_t kTimeSequenceMaxElements = 50;
+    static inline constexpr size_t kMaxInternedNames = 4096;
+
+    /**
+     * The time sequence of a single property.
+     *
+     * Stored as two parallel ring buffers (columns), one of timestamps and one of
+     * values, holding at most kTimeSequenceMaxElements samples. Timestamps are
+     * kept in ascending order so that lookups by time are binary searches.
+     *
+     * The property name is interned, shared by all the keys having this property.
+     */
+    class PropertyHistory {
+    public:
+        explicit PropertyHistory(const std::string &name) : mName(internName(name)) {}
+
+        const std::string &getName() const { return *mName; }
+        size_t size() const { return mTimes.size(); }
+        bool empty() const { return mTimes.empty(); }
+
+        // Accessors by logical index, 0 being the oldest sample.
+        int64_t timeAt(size_t i) const { return mTimes[physical(i)]; }
+        const Elem &valueAt(size_t i) const { return mValues[physical(i)]; }
+
+        // Returns the logical index of the first sample later than time.
+        size_t upperBound(int64_t time) const {
+            return partitionPoint([time](int64_t t) { return t <= time; });
+        }
+
+        // Returns the logical index of the first sample not earlier than time.
+        size_t lowerBound(int64_t time) const {
+            return partitionPoint([time](int64_t t) { return t < time; });
+        }
+
+        // Adds a sample, discarding the oldest if full.
+        void add(int64_t time, Elem &&el) {
+            if (!mTimes.empty() && time < timeAt(mTimes.size() - 1)) {
+                insertOutOfOrder(time, std::move(el)); // uncommon.
+                return;
+            }
+            if (mTimes.size() < kTimeSequenceMaxElements) {
+                mTimes.push_back(time);
+                mValues.push_back(std::move(el));
+                return;
+            }
+            ALOGV("%s: restricting maximum elements (discarding oldest) for %s",
+                    __func__, mName->c_str());
+            mTimes[mHead] = time;
+            mValues[mHead] = std::move(el);
+            mHead = (mHead + 1) % mTimes.size();
+        }
+
+    private:
+        size_t physical(size_t i) const {
+            const size_t p = mHead + i;
+            return p < mTimes.size() ? p : p - mTimes.size();
+        }
+
+        template <typename Predicate>
+        size_t partitionPoint(Predicate pred) const {
+            size_t low = 0;
+            size_t high = mTimes.size();
+            while (low < high) {
+                const size_t mid = low + (high - low) / 2;
+                if (pred(timeAt(mid))) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        void insertOutOfOrder(int64_t time, Elem &&el) {
+            // Unroll the ring so the columns are in time order, then insert after any
+            // sample with the same time, as a multimap would.
+            std::rotate(mTimes.begin(), mTimes.begin() + mHead, mTimes.end());
+            std::rotate(mValues.begin(), mValues.begin() + mHead, mValues.end());
+            mHead = 0;
+            const size_t position = upperBound(time);
+            mTimes.insert(mTimes.begin() + position, time);
+            mValues.insert(mValues.begin() + position, std::move(el));
+            if (mTimes.size() > kTimeSequenceMaxElements) {
+                mTimes.erase(mTimes.begin());
+                mValues.erase(mValues.begin());
+            }
+        }
+
+        // Returns the shared copy of name. The pool is bounded, names past
+        // kMaxInternedNames get a private copy.
+        static std::shared_ptr<const std::string> internName(const std::string &name) {
+            static std::mutex lock;
+            static std::map<std::string_view, std::shared_ptr<const std::string>> pool;
+            std::lock_guard l(lock);
+            if (auto it = pool.find(name); it != pool.end()) return it->second;
+            auto interned = std::make_shared<const std::string>(name);
+            if (pool.size() < kMaxInternedNames) {
+                pool.emplace(*interned, interned);  // the key views the pooled string.
+            }
+            return interned;
+        }
+
+        std::shared_ptr<const std::string> mName;
+        size_t mHead = 0;              // physical index of the oldest sample once full.
+        std::vector<int64_t> mTimes;   // ascending from mHead, wrapping around.
+        std::vector<Elem> mValues;     // parallel to mTimes.
+    };
 
 private:
 
@@ -108,14 +218,11 @@ private:
         status_t getValue(const std::string &property, T* value, int64_t time = 0) const
                 REQUIRES(mPseudoKeyHistoryLock) {
             if (time == 0) time = systemTime(SYSTEM_TIME_REALTIME);
-            const auto tsptr = mPropertyMap.find(property);
-            if (tsptr == mPropertyMap.end()) return BAD_VALUE;
-            const auto& timeSequence = tsptr->second;
-            auto eptr = timeSequence.upper_bound(time);
-            if (eptr == timeSequence.begin()) return BAD_VALUE;
-            --eptr;
-            if (eptr == timeSequence.end()) return BAD_VALUE;
-            const T* vptr = std::get_if<T>(&eptr->second);
+            const PropertyHistory *timeSequence = findProperty(property);
+            if (timeSequence == nullptr) return BAD_VALUE;
+            const size_t index = timeSequence->upperBound(time);
+            if (index == 0) return BAD_VALUE;
+            const T* vptr = std::get_if<T>(&timeSequence->valueAt(index - 1));
             if (vptr == nullptr) return BAD_VALUE;
             *value = *vptr;
             return NO_ERROR;
@@ -140,24 +247,21 @@ private:
                 REQUIRES(mPseudoKeyHistoryLock) {
             if (time == 0) time = systemTime(SYSTEM_TIME_REALTIME);
             mLastModificationTime = time;
-            if (mPropertyMap.size() >= kKeyMaxProperties &&
-                    !mPropertyMap.count(property)) {
-                ALOGV("%s: too many properties, rejecting %s", __func__, property.c_str());
-                mRejectedPropertiesCount++;
-                return;
+            auto it = lowerBoundProperty(property);
+            if (it == mProperties.end() || it->getName() != property) {
+                if (mProperties.size() >= kKeyMaxProperties) {
+                    ALOGV("%s: too many properties, rejecting %s", __func__, property.c_str());
+                    mRejectedPropertiesCount++;
+                    return;
+                }
+                it = mProperties.emplace(it, property);
             }
-            auto& timeSequence = mPropertyMap[property];
+            PropertyHistory& timeSequence = *it;
             Elem el{std::forward<T>(e)};
             if (timeSequence.empty()           // no elements
                     || property.back() == AMEDIAMETRICS_PROP_SUFFIX_CHAR_DUPLICATES_ALLOWED
-                    || timeSequence.rbegin()->second != el) { // value changed
-                timeSequence.emplace_hint(timeSequence.end(), time, std::move(el));
-
-                if (timeSequence.size() > kTimeSequenceMaxElements) {
-                    ALOGV("%s: restricting maximum elements (discarding oldest) for %s",
-                            __func__, property.c_str());
-                    timeSequence.erase(timeSequence.begin());
-                }
+                    || timeSequence.valueAt(timeSequence.size() - 1) != el) { // value changed
+                timeSequence.add(time, std::move(el));
             }
         }
 
@@ -165,9 +269,9 @@ private:
                 REQUIRES(mPseudoKeyHistoryLock) {
             std::stringstream ss;
             int32_t ll = lines;
-            for (auto& tsPair : mPropertyMap) {
+            for (const auto& timeSequence : mProperties) {
                 if (ll <= 0) break;
-                std::string s = dump(mKey, tsPair, time);
+                std::string s = dump(mKey, timeSequence, time);
                 if (s.size() > 0) {
                     --ll;
                     ss << s;
@@ -185,28 +289,42 @@ private:
         }
 
     private:
+        // mProperties is sorted by name.
+        std::vector<PropertyHistory>::iterator lowerBoundProperty(const std::string &property) {
+            return std::lower_bound(mProperties.begin(), mProperties.end(), property,
+                    [](const PropertyHistory &history, const std::string &name) {
+                        return history.getName() < name;
+                    });
+        }
+
+        const PropertyHistory *findProperty(const std::string &property) const {
+            const auto it = std::lower_bound(mProperties.begin(), mProperties.end(), property,
+                    [](const PropertyHistory &history, const std::string &name) {
+                        return history.getName() < name;
+                    });
+            return it != mProperties.end() && it->getName() == property ? &*it : nullptr;
+        }
+
         static std::string dump(
-                const std::string &key,
-                const std::pair<std::string /* prop */, PropertyHistory>& tsPair,
-                int64_t time) {
-            const auto timeSequence = tsPair.second;
-            auto eptr = timeSequence.lower_bound(time);
-            if (eptr == timeSequence.end()) {
-                return {}; // don't dump anything. tsPair.first + "={};\n";
+                const std::string &key, const PropertyHistory& timeSequence, int64_t time) {
+            size_t index = timeSequence.lowerBound(time);
+            if (index == timeSequence.size()) {
+                return {}; // don't dump anything. name + "={};\n";
             }
             std::stringstream ss;
-            ss << key << "." << tsPair.first << "={";
+            ss << key << "." << timeSequence.getName() << "={";
 
             time_string_t last_timestring{}; // last timestring used.
             while (true) {
-                const time_string_t timestring = mediametrics::timeStringFromNs(eptr->first);
+                const time_string_t timestring =
+                        mediametrics::timeStringFromNs(timeSequence.timeAt(index));
                 // find common prefix offset.
                 const size_t offset = commonTimePrefixPosition(timestring.time,
                         last_timestring.time);
                 last_timestring = timestring;
                 ss << "(" << (offset == 0 ? "" : "~") << &timestring.time[offset]
-                    << ") " << eptr->second;
-                if (++eptr == timeSequence.end()) {
+                    << ") " << timeSequence.valueAt(index);
+                if (++index == timeSequence.size()) {
                     break;
                 }
                 ss << ", ";
@@ -221,12 +339,11 @@ private:
 
         unsigned int mRejectedPropertiesCount = 0;
         int64_t mLastModificationTime;
-        std::map<std::string /* property */, PropertyHistory> mPropertyMap;
+        std::vector<PropertyHistory> mProperties; // sorted by property name.
     };
 
     using History = std::map<std::string /* key */, std::shared_ptr<KeyHistory>>;
 
-    static inline constexpr size_t kTimeSequenceMaxElements = 50;
     static inline constexpr size_t kKeyMaxProperties = 128;
     static inline constexpr size_t kKeyLowWaterMark = 400;
     static inline constexpr size_t kKeyHighWaterMark = 500;
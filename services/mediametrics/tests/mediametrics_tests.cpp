@@ -18,6 +18,8 @@
 #include <utils/Log.h>
 
 #include <stdio.h>
+#include <algorithm>
+#include <future>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -26,6 +28,7 @@
 #include <media/MediaMetricsItem.h>
 #include <mediametricsservice/AudioTypes.h>
 #include <mediametricsservice/MediaMetricsService.h>
+#include <mediametricsservice/ShardedAppendLog.h>
 #include <mediametricsservice/StringUtils.h>
 #include <mediametricsservice/ValidateId.h>
 #include <system/audio.h>
@@ -268,6 +271,38 @@ TEST(mediametrics_tests, instantiate) {
   mediaMetrics->dump(fileno(stdout), {} /* args */);
 }
 
+TEST(mediametrics_tests, submit_batched_buffer) {
+  sp mediaMetrics = new MediaMetricsService();
+
+  mediametrics::Item item1("audiotrack");
+  item1.setInt32("foo", 1);
+  mediametrics::Item item2("audiotrack");
+  item2.setInt32("foo", 2)
+       .setCString("bar", "abc");
+
+  std::vector<char> batch;
+  std::vector<char> buffer;
+  ASSERT_EQ(NO_ERROR, item1.writeToByteString(&buffer));
+  batch.insert(batch.end(), buffer.begin(), buffer.end());
+  ASSERT_EQ(NO_ERROR, item2.writeToByteString(&buffer));
+  batch.insert(batch.end(), buffer.begin(), buffer.end());
+
+  // both items are accepted.
+  ASSERT_EQ(NO_ERROR, mediaMetrics->submitBuffer(batch.data(), batch.size()));
+
+  // a truncated item is rejected.
+  ASSERT_EQ(BAD_VALUE, mediaMetrics->submitBuffer(batch.data(), batch.size() - 1));
+  ASSERT_EQ(BAD_VALUE, mediaMetrics->submitBuffer(batch.data(), 2));
+
+  // the vector encoding matches the allocated one.
+  char *data;
+  size_t length;
+  ASSERT_EQ(NO_ERROR, item2.writeToByteString(&data, &length));
+  ASSERT_EQ(buffer.size(), length);
+  ASSERT_EQ(0, memcmp(buffer.data(), data, length));
+  free(data);
+}
+
 TEST(mediametrics_tests, package_installer_check) {
   ASSERT_EQ(false, MediaMetricsService::useUidForPackage(
       "abcd", "installer"));  // ok, package name has no dot.
@@ -741,6 +776,38 @@ TEST(mediametrics_tests, time_machine_gc) {
   printf("After\n%s\n", timeMachine.dump().first.c_str());
 }
 
+TEST(mediametrics_tests, time_machine_history) {
+  auto item = std::make_shared<mediametrics::Item>("Key");
+  (*item).set("value", (int32_t)0)
+         .setTimestamp(10);
+
+  android::mediametrics::TimeMachine timeMachine;
+  ASSERT_EQ(NO_ERROR, timeMachine.put(item, true));
+
+  // Overflow the history, only the most recent samples are kept.
+  constexpr size_t kMax = android::mediametrics::TimeMachine::kTimeSequenceMaxElements;
+  for (int32_t i = 1; i <= (int32_t)kMax; ++i) {
+    ASSERT_EQ(NO_ERROR, timeMachine.put("Key.value", (int32_t)i, 10 + i * 10));
+  }
+  int32_t i32;
+  ASSERT_EQ(BAD_VALUE, timeMachine.get("Key.value", &i32, -1, 15));  // discarded.
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1, 25));
+  ASSERT_EQ(1, i32);
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1, 39));
+  ASSERT_EQ(2, i32);
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1));
+  ASSERT_EQ((int32_t)kMax, i32);
+
+  // A sample older than the latest one is placed by its time.
+  ASSERT_EQ(NO_ERROR, timeMachine.put("Key.value", (int32_t)-1, 35));
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1, 39));
+  ASSERT_EQ(-1, i32);
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1, 40));
+  ASSERT_EQ(3, i32);
+  ASSERT_EQ(NO_ERROR, timeMachine.get("Key.value", &i32, -1));
+  ASSERT_EQ((int32_t)kMax, i32);
+}
+
 TEST(mediametrics_tests, transaction_log_gc) {
   auto item = std::make_shared<mediametrics::Item>("Key1");
   (*item).set("one", (int32_t)1)
@@ -1215,6 +1282,39 @@ TEST(mediametrics_tests, LruSet0) {
     ASSERT_EQ(0u, lruSet.size());
 }
 
+TEST(mediametrics_tests, ShardedAppendLog) {
+    mediametrics::ShardedAppendLog<std::pair<size_t, size_t>> log;
+    std::vector<std::pair<size_t, size_t>> drained;
+    ASSERT_TRUE(log.empty());
+    ASSERT_EQ(0u, log.drain(&drained));
+
+    constexpr size_t THREADS = 16;
+    constexpr size_t ITERATIONS = 1000;
+    std::vector<std::future<void>> threads;
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.push_back(std::async(std::launch::async, [&log, i] {
+            for (size_t j = 0; j < ITERATIONS; ++j) {
+                log.push({i, j});
+            }
+        }));
+    }
+    // Drain concurrently with the producers.
+    while (drained.size() < THREADS * ITERATIONS / 2) {
+        log.drain(&drained);
+    }
+    threads.clear();
+    log.drain(&drained);
+    ASSERT_TRUE(log.empty());
+    ASSERT_EQ(THREADS * ITERATIONS, drained.size());
+
+    // Every element comes out exactly once. Producers may migrate between
+    // shards, so there is no ordering guarantee to check here.
+    std::sort(drained.begin(), drained.end());
+    for (size_t i = 0; i < drained.size(); ++i) {
+        ASSERT_EQ(std::make_pair(i / ITERATIONS, i % ITERATIONS), drained[i]);
+    }
+}
+
 // Returns a 16 Base64Url string representing the decimal representation of value
 // (with leading 0s) e.g. 0000000000000000, 0000000000000001, 0000000000000002, ...
 static std::string generateId(size_t value)
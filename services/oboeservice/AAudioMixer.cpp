@@ -20,6 +20,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_AUDIO
 
+#include <algorithm>
 #include <cstring>
 #include <utils/Trace.h>
 
@@ -29,10 +30,82 @@
 #define AAUDIO_MIXER_ATRACE_ENABLED    1
 #endif
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#define USE_NEON (false)
+#endif
+
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
 using android::WrappingBuffer;
 using android::FifoBuffer;
 using android::fifo_frames_t;
 
+namespace {
+
+/**
+ * Add the sources to the destination, sample by sample.
+ * The number of sources is a template parameter so that the inner loop is fully unrolled
+ * and the destination is only loaded and stored once per pass.
+ */
+template <int32_t NumSources>
+void accumulate(float *destination, const float * const *sources, int32_t numSamples) {
+    int32_t sampleIndex = 0;
+#if USE_NEON
+    for (; sampleIndex + 4 <= numSamples; sampleIndex += 4) {
+        float32x4_t sum = vld1q_f32(destination + sampleIndex);
+        for (int32_t i = 0; i < NumSources; i++) {
+            sum = vaddq_f32(sum, vld1q_f32(sources[i] + sampleIndex));
+        }
+        vst1q_f32(destination + sampleIndex, sum);
+    }
+#else
+    // Fixed size blocks that the compiler can keep in vector registers.
+    constexpr int32_t kBlockSamples = 8;
+    for (; sampleIndex + kBlockSamples <= numSamples; sampleIndex += kBlockSamples) {
+        float sum[kBlockSamples];
+        for (int32_t j = 0; j < kBlockSamples; j++) {
+            sum[j] = destination[sampleIndex + j];
+        }
+        for (int32_t i = 0; i < NumSources; i++) {
+            for (int32_t j = 0; j < kBlockSamples; j++) {
+                sum[j] += sources[i][sampleIndex + j];
+            }
+        }
+        for (int32_t j = 0; j < kBlockSamples; j++) {
+            destination[sampleIndex + j] = sum[j];
+        }
+    }
+#endif // USE_NEON
+    for (; sampleIndex < numSamples; sampleIndex++) {
+        float sum = destination[sampleIndex];
+        for (int32_t i = 0; i < NumSources; i++) {
+            sum += sources[i][sampleIndex];
+        }
+        destination[sampleIndex] = sum;
+    }
+}
+
+void accumulate(float *destination, const float * const *sources, int32_t numSources,
+                int32_t numSamples) {
+    static_assert(AAudioMixer::kMaxSourcesPerPass == 4);
+    switch (numSources) {
+        case 0: accumulate<0>(destination, sources, numSamples); break;
+        case 1: accumulate<1>(destination, sources, numSamples); break;
+        case 2: accumulate<2>(destination, sources, numSamples); break;
+        case 3: accumulate<3>(destination, sources, numSamples); break;
+        case 4: accumulate<4>(destination, sources, numSamples); break;
+        default: LOG_ALWAYS_FATAL("%s() %d sources", __func__, numSources);
+    }
+}
+
+} // namespace
+
 void AAudioMixer::allocate(int32_t samplesPerFrame, int32_t framesPerBurst) {
     mSamplesPerFrame = samplesPerFrame;
     mFramesPerBurst = framesPerBurst;
@@ -43,16 +116,12 @@ void AAudioMixer::allocate(int32_t samplesPerFrame, int32_t framesPerBurst) {
 
 void AAudioMixer::clear() {
     memset(mOutputBuffer.get(), 0, mBufferSizeInBytes);
+    mNumSources = 0;
 }
 
-int32_t AAudioMixer::mix(
+int32_t AAudioMixer::addSource(
         int streamIndex, const std::shared_ptr<FifoBuffer>& fifo, bool allowUnderflow) {
     WrappingBuffer wrappingBuffer;
-    float *destination = mOutputBuffer.get();
-
-#if AAUDIO_MIXER_ATRACE_ENABLED
-    ATRACE_BEGIN("aaMix");
-#endif /* AAUDIO_MIXER_ATRACE_ENABLED */
 
     // Gather the data from the client. May be in two parts.
     fifo_frames_t fullFrames = fifo->getFullDataAvailable(&wrappingBuffer);
@@ -64,7 +133,7 @@ int32_t AAudioMixer::mix(
         ATRACE_INT(rdyText, fullFrames);
     }
 #else /* MIXER_ATRACE_ENABLED */
-    (void) trackIndex;
+    (void) streamIndex;
 #endif /* AAUDIO_MIXER_ATRACE_ENABLED */
 
     // If allowUnderflow then always advance by one burst even if we do not have the data.
@@ -78,39 +147,86 @@ int32_t AAudioMixer::mix(
         framesDesired = fullFrames; // just use what is available then stop
     }
 
-    // Mix data in one or two parts.
-    int partIndex = 0;
+    // The vector only grows when more streams are mixed than ever before.
+    if (mNumSources == static_cast<int32_t>(mSources.size())) {
+        mSources.emplace_back();
+    }
+    Source &source = mSources[mNumSources];
+    source.fifo = fifo;
+    source.framesDesired = framesDesired;
+
+    // Take data from one or two parts.
     int32_t framesLeft = framesDesired;
-    while (framesLeft > 0 && partIndex < WrappingBuffer::SIZE) {
-        fifo_frames_t framesToMixFromPart = framesLeft;
-        fifo_frames_t framesAvailableFromPart = wrappingBuffer.numFrames[partIndex];
-        if (framesAvailableFromPart > 0) {
-            if (framesToMixFromPart > framesAvailableFromPart) {
-                framesToMixFromPart = framesAvailableFromPart;
-            }
-            mixPart(destination, (float *)wrappingBuffer.data[partIndex],
-                    framesToMixFromPart);
+    for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+        fifo_frames_t framesToMixFromPart = std::min(framesLeft,
+                std::max(wrappingBuffer.numFrames[partIndex], 0));
+        source.data[partIndex] = static_cast<const float *>(wrappingBuffer.data[partIndex]);
+        source.numSamples[partIndex] = framesToMixFromPart * mSamplesPerFrame;
+        framesLeft -= framesToMixFromPart;
+    }
+    source.framesRead = framesDesired - framesLeft;
+    return mNumSources++;
+}
 
-            destination += framesToMixFromPart * mSamplesPerFrame;
-            framesLeft -= framesToMixFromPart;
-        }
-        partIndex++;
+void AAudioMixer::mix() {
+#if AAUDIO_MIXER_ATRACE_ENABLED
+    ATRACE_BEGIN("aaMix");
+#endif /* AAUDIO_MIXER_ATRACE_ENABLED */
+
+    // Each pass accumulates several sources so the output buffer is read and written
+    // fewer times.
+    for (int32_t first = 0; first < mNumSources; first += kMaxSourcesPerPass) {
+        int32_t numSources = std::min(mNumSources - first, kMaxSourcesPerPass);
+        mixSources(&mSources[first], numSources);
+    }
+
+    // The clients may overwrite the data as soon as the read index moves.
+    for (int32_t i = 0; i < mNumSources; i++) {
+        mSources[i].fifo->advanceReadIndex(mSources[i].framesDesired);
+        mSources[i].fifo.reset();
     }
-    fifo->advanceReadIndex(framesDesired);
 
 #if AAUDIO_MIXER_ATRACE_ENABLED
     ATRACE_END();
 #endif /* AAUDIO_MIXER_ATRACE_ENABLED */
-
-    return (framesDesired - framesLeft); // framesRead
 }
 
-void AAudioMixer::mixPart(float *destination, float *source, int32_t numFrames) {
-    int32_t numSamples = numFrames * mSamplesPerFrame;
-    // TODO maybe optimize using SIMD
-    for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
-        *destination++ += *source++;
+void AAudioMixer::mixSources(const Source *sources, int32_t numSources) {
+    // Cut the burst into spans where every source is contiguous or exhausted.
+    constexpr int32_t kMaxBoundaries = kMaxSourcesPerPass * WrappingBuffer::SIZE + 2;
+    int32_t boundaries[kMaxBoundaries];
+    int32_t numBoundaries = 0;
+    const int32_t samplesPerBurst = mFramesPerBurst * mSamplesPerFrame;
+    boundaries[numBoundaries++] = 0;
+    boundaries[numBoundaries++] = samplesPerBurst;
+    for (int32_t i = 0; i < numSources; i++) {
+        boundaries[numBoundaries++] = sources[i].numSamples[0];
+        boundaries[numBoundaries++] = sources[i].numSamples[0] + sources[i].numSamples[1];
     }
+    std::sort(boundaries, boundaries + numBoundaries);
+    numBoundaries = std::unique(boundaries, boundaries + numBoundaries) - boundaries;
+
+    float *destination = mOutputBuffer.get();
+    for (int32_t b = 0; b + 1 < numBoundaries && boundaries[b] < samplesPerBurst; b++) {
+        const int32_t start = boundaries[b];
+        const int32_t numSamples = boundaries[b + 1] - start;
+        const float *spanSources[kMaxSourcesPerPass];
+        int32_t numSpanSources = 0;
+        for (int32_t i = 0; i < numSources; i++) {
+            const Source &source = sources[i];
+            if (start < source.numSamples[0]) {
+                spanSources[numSpanSources++] = source.data[0] + start;
+            } else if (start < source.numSamples[0] + source.numSamples[1]) {
+                spanSources[numSpanSources++] =
+                        source.data[1] + (start - source.numSamples[0]);
+            } // else this source underflowed, it adds silence
+        }
+        accumulate(destination + start, spanSources, numSpanSources, numSamples);
+    }
+}
+
+int32_t AAudioMixer::getFramesMixed(int32_t sourceIndex) const {
+    return mSources[sourceIndex].framesRead;
 }
 
 float *AAudioMixer::getOutputBuffer() {
@@ -19,6 +19,9 @@
 
 #include <stdint.h>
 
+#include <memory>
+#include <vector>
+
 #include <aaudio/AAudio.h>
 #include <fifo/FifoBuffer.h>
 
@@ -28,27 +31,59 @@ public:
 
     void allocate(int32_t samplesPerFrame, int32_t framesPerBurst);
 
+    /**
+     * Silence the output buffer and forget the sources of the previous mix.
+     */
     void clear();
 
     /**
-     * Mix from this FIFO
+     * Add the data available in this FIFO to the next mix().
+     * The FIFO is not read until mix() is called so the caller must keep it
+     * alive until then.
      * @param streamIndex for marking stream variables in systrace
      * @param fifo to read from
      * @param allowUnderflow if true then allow mixer to advance read index past the write index
-     * @return frames read from this stream
+     * @return index of the source, to pass to getFramesMixed()
+     */
+    int32_t addSource(int streamIndex,
+                      const std::shared_ptr<android::FifoBuffer>& fifo,
+                      bool allowUnderflow);
+
+    /**
+     * Mix all the sources added since clear() in one pass over the output buffer,
+     * then advance the read index of every source FIFO.
+     * The sum is not clamped, the client flowgraph limits it after any mono blend.
      */
-    int32_t mix(int streamIndex,
-                const std::shared_ptr<android::FifoBuffer>& fifo,
-                bool allowUnderflow);
+    void mix();
+
+    /**
+     * @param sourceIndex as returned by addSource()
+     * @return frames read from this source by the last mix()
+     */
+    int32_t getFramesMixed(int32_t sourceIndex) const;
 
     float *getOutputBuffer();
 
     int32_t getFramesPerBurst() const { return mFramesPerBurst; }
 
+    // Sources accumulated per pass over the output buffer.
+    static constexpr int32_t kMaxSourcesPerPass = 4;
+
 private:
-    void mixPart(float *destination, float *source, int32_t numFrames);
+    struct Source {
+        std::shared_ptr<android::FifoBuffer> fifo;
+        // Data from the client. May be in two parts.
+        const float *data[android::WrappingBuffer::SIZE];
+        int32_t numSamples[android::WrappingBuffer::SIZE];
+        int32_t framesDesired;
+        int32_t framesRead;
+    };
+
+    void mixSources(const Source *sources, int32_t numSources);
 
     std::unique_ptr<float[]> mOutputBuffer;
+    std::vector<Source> mSources;
+    int32_t  mNumSources = 0;
     int32_t  mSamplesPerFrame = 0;
     int32_t  mFramesPerBurst = 0;
     int32_t  mBufferSizeInBytes = 0;
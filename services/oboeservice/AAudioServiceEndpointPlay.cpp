@@ -80,7 +80,6 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
 
             std::lock_guard <std::mutex> lock(mLockStreams);
             for (const auto& clientStream : mRegisteredStreams) {
-                int64_t clientFramesRead = 0;
                 bool allowUnderflow = true;
 
                 if (clientStream->isSuspended()) {
@@ -107,29 +106,41 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
 
                         // Determine offset between framePosition in client's stream
                         // vs the underlying MMAP stream.
-                        clientFramesRead = fifo->getReadCounter();
+                        int64_t clientFramesRead = fifo->getReadCounter();
                         // These two indices refer to the same frame.
                         int64_t positionOffset = mmapFramesWritten - clientFramesRead;
                         streamShared->setTimestampPositionOffset(positionOffset);
 
-                        int32_t framesMixed = mMixer.mix(index, fifo, allowUnderflow);
-
-                        if (streamShared->isFlowing()) {
-                            // Consider it an underflow if we got less than a burst
-                            // after the data started flowing.
-                            bool underflowed = allowUnderflow
-                                               && framesMixed < mMixer.getFramesPerBurst();
-                            if (underflowed) {
-                                streamShared->incrementXRunCount();
-                            }
-                        } else if (framesMixed > 0) {
-                            // Mark beginning of data flow after a start.
-                            streamShared->setFlowing(true);
-                        }
-                        clientFramesRead = fifo->getReadCounter();
+                        int32_t sourceIndex = mMixer.addSource(index, fifo, allowUnderflow);
+                        mMixedStreams.push_back({streamShared, std::move(audioDataQueue),
+                                                 sourceIndex, allowUnderflow});
                     }
                 }
 
+                index++; // just used for labelling tracks in systrace
+            }
+
+            // Mix all the streams at once. This advances their read indices.
+            mMixer.mix();
+
+            for (const auto& mixed : mMixedStreams) {
+                const sp<AAudioServiceStreamShared>& streamShared = mixed.stream;
+                int32_t framesMixed = mMixer.getFramesMixed(mixed.sourceIndex);
+                if (streamShared->isFlowing()) {
+                    // Consider it an underflow if we got less than a burst
+                    // after the data started flowing.
+                    bool underflowed = mixed.allowUnderflow
+                                       && framesMixed < mMixer.getFramesPerBurst();
+                    if (underflowed) {
+                        streamShared->incrementXRunCount();
+                    }
+                } else if (framesMixed > 0) {
+                    // Mark beginning of data flow after a start.
+                    streamShared->setFlowing(true);
+                }
+
+                int64_t clientFramesRead = mixed.audioDataQueue->getFifoBuffer()
+                        ->getReadCounter();
                 if (clientFramesRead > 0) {
                     // This timestamp represents the completion of data being read out of the
                     // client buffer. It is sent to the client and used in the timing model
@@ -137,9 +148,8 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
                     Timestamp timestamp(clientFramesRead, AudioClock::getNanoseconds());
                     streamShared->markTransferTime(timestamp);
                 }
-
-                index++; // just used for labelling tracks in systrace
             }
+            mMixedStreams.clear();
         }
 
         // Write mixer output to stream using a blocking write.
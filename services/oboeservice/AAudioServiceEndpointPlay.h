@@ -45,8 +45,18 @@ public:
     void *callbackLoop() override;
 
 private:
+    // A stream whose data was added to the mixer during this burst.
+    struct MixedStream {
+        android::sp<AAudioServiceStreamShared> stream;
+        // Keeps the shared memory mapped until the mixer has read it.
+        std::shared_ptr<SharedRingBuffer>      audioDataQueue;
+        int32_t                                sourceIndex;
+        bool                                   allowUnderflow;
+    };
+
     bool                     mLatencyTuningEnabled = false; // TODO implement tuning
     AAudioMixer              mMixer;    //
+    std::vector<MixedStream> mMixedStreams; // only used by the callback thread
 };
 
 } /* namespace aaudio */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "AAudioMixer.h"
+
+using android::FifoBuffer;
+using android::FifoBufferAllocated;
+
+namespace {
+
+constexpr int32_t kChannelCount = 2;
+// Not a multiple of any burst size so that reads regularly wrap around the end.
+constexpr int32_t kFifoCapacityInFrames = 1000;
+
+// Times one burst of the shared endpoint mixer: gathering each stream's FIFO,
+// the fused mix, and advancing the read indices.
+// range(0) is the number of streams, range(1) the burst size in frames.
+// The reported time is the time per burst.
+void BM_MixBurst(benchmark::State& state) {
+    const int32_t numStreams = state.range(0);
+    const int32_t framesPerBurst = state.range(1);
+
+    AAudioMixer mixer;
+    mixer.allocate(kChannelCount, framesPerBurst);
+
+    std::vector<std::shared_ptr<FifoBuffer>> fifos;
+    std::vector<float> samples(kFifoCapacityInFrames * kChannelCount);
+    for (int32_t i = 0; i < numStreams; i++) {
+        auto fifo = std::make_shared<FifoBufferAllocated>(
+                kChannelCount * sizeof(float), kFifoCapacityInFrames);
+        for (size_t s = 0; s < samples.size(); s++) {
+            samples[s] = ((s + i * 7) % 64) / 64.0f - 0.5f;
+        }
+        fifo->write(samples.data(), kFifoCapacityInFrames);
+        fifos.push_back(std::move(fifo));
+    }
+
+    for (auto _ : state) {
+        mixer.clear();
+        for (int32_t i = 0; i < numStreams; i++) {
+            mixer.addSource(i, fifos[i], true /* allowUnderflow */);
+        }
+        mixer.mix();
+        benchmark::DoNotOptimize(mixer.getOutputBuffer());
+        benchmark::ClobberMemory();
+        // Hand the frames back to the writer, as a client would, without copying them.
+        for (const auto& fifo : fifos) {
+            fifo->advanceWriteIndex(framesPerBurst);
+        }
+    }
+    state.counters["samples_per_second"] = benchmark::Counter(
+            state.iterations() * numStreams * framesPerBurst * kChannelCount,
+            benchmark::Counter::kIsRate);
+}
+
+// 1 to 32 streams with the burst sizes of 1, 2 and 4 ms at 48 kHz.
+void MixBurstArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t framesPerBurst : {48, 96, 192}) {
+        for (int64_t numStreams : {1, 2, 4, 8, 16, 32}) {
+            b->Args({numStreams, framesPerBurst});
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_MixBurst)->Apply(MixBurstArgs)->Unit(benchmark::kNanosecond);
+
+BENCHMARK_MAIN();
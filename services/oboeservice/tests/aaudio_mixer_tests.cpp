@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AAudioMixer.h"
+
+using android::FifoBuffer;
+using android::FifoBufferAllocated;
+using android::WrappingBuffer;
+using android::fifo_frames_t;
+
+namespace {
+
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kFramesPerBurst = 96;
+// Not a multiple of the burst size so that reads regularly wrap around the end.
+constexpr int32_t kFifoCapacityInFrames = 250;
+
+// The mixer before streams were fused: each stream is added to the output, in turn,
+// in its own pass.
+int32_t mixPerStream(float *destination, const std::shared_ptr<FifoBuffer>& fifo,
+                     bool allowUnderflow) {
+    WrappingBuffer wrappingBuffer;
+    fifo_frames_t fullFrames = fifo->getFullDataAvailable(&wrappingBuffer);
+    fifo_frames_t framesDesired = kFramesPerBurst;
+    if (!allowUnderflow && fullFrames < framesDesired) {
+        framesDesired = fullFrames;
+    }
+    int32_t framesLeft = framesDesired;
+    for (int partIndex = 0; framesLeft > 0 && partIndex < WrappingBuffer::SIZE; partIndex++) {
+        fifo_frames_t framesToMixFromPart =
+                std::min(framesLeft, wrappingBuffer.numFrames[partIndex]);
+        if (framesToMixFromPart > 0) {
+            const float *source = static_cast<const float *>(wrappingBuffer.data[partIndex]);
+            for (int32_t i = 0; i < framesToMixFromPart * kChannelCount; i++) {
+                *destination++ += *source++;
+            }
+            framesLeft -= framesToMixFromPart;
+        }
+    }
+    fifo->advanceReadIndex(framesDesired);
+    return framesDesired - framesLeft;
+}
+
+std::shared_ptr<FifoBuffer> makeFifo() {
+    return std::make_shared<FifoBufferAllocated>(kChannelCount * sizeof(float),
+                                                 kFifoCapacityInFrames);
+}
+
+// Writes frames whose sum over many streams goes well beyond full scale, as the mix is
+// not limited until it reaches the client flowgraph.
+void writeFrames(const std::shared_ptr<FifoBuffer>& fifo, int32_t stream, int32_t burst,
+                 int32_t numFrames) {
+    std::vector<float> samples(numFrames * kChannelCount);
+    for (size_t s = 0; s < samples.size(); s++) {
+        samples[s] = (((s + stream * 7 + burst * 13) % 64) / 64.0f - 0.25f) * 1.5f;
+    }
+    fifo->write(samples.data(), numFrames);
+}
+
+class AAudioMixerTest : public ::testing::TestWithParam<int32_t> {};
+
+TEST_P(AAudioMixerTest, FusedMixMatchesPerStreamMix) {
+    const int32_t numStreams = GetParam();
+    AAudioMixer mixer;
+    mixer.allocate(kChannelCount, kFramesPerBurst);
+    std::vector<float> expected(kFramesPerBurst * kChannelCount);
+
+    // Each stream is written to two FIFOs, one for each mixer.
+    std::vector<std::shared_ptr<FifoBuffer>> fifos;
+    std::vector<std::shared_ptr<FifoBuffer>> referenceFifos;
+    for (int32_t i = 0; i < numStreams; i++) {
+        fifos.push_back(makeFifo());
+        referenceFifos.push_back(makeFifo());
+    }
+
+    for (int32_t burst = 0; burst < 20; burst++) {
+        // Some streams fall short of a burst, so that they underflow or drain.
+        for (int32_t i = 0; i < numStreams; i++) {
+            const int32_t numFrames = (burst + i) % 5 == 0 ? kFramesPerBurst / 3 : kFramesPerBurst;
+            writeFrames(fifos[i], i, burst, numFrames);
+            writeFrames(referenceFifos[i], i, burst, numFrames);
+        }
+        // Streams that are stopping drain their FIFO rather than underflow.
+        auto allowUnderflow = [burst](int32_t i) { return (burst + i) % 3 != 0; };
+
+        std::fill(expected.begin(), expected.end(), 0.0f);
+        std::vector<int32_t> expectedFramesRead;
+        for (int32_t i = 0; i < numStreams; i++) {
+            expectedFramesRead.push_back(
+                    mixPerStream(expected.data(), referenceFifos[i], allowUnderflow(i)));
+        }
+
+        mixer.clear();
+        std::vector<int32_t> sourceIndices;
+        for (int32_t i = 0; i < numStreams; i++) {
+            sourceIndices.push_back(mixer.addSource(i, fifos[i], allowUnderflow(i)));
+        }
+        mixer.mix();
+
+        // The sources are added in the same order, so the sums are identical, not just close.
+        const float *output = mixer.getOutputBuffer();
+        for (size_t s = 0; s < expected.size(); s++) {
+            ASSERT_EQ(expected[s], output[s]) << "burst " << burst << " sample " << s;
+        }
+        for (int32_t i = 0; i < numStreams; i++) {
+            EXPECT_EQ(expectedFramesRead[i], mixer.getFramesMixed(sourceIndices[i]))
+                    << "burst " << burst << " stream " << i;
+            EXPECT_EQ(referenceFifos[i]->getReadCounter(), fifos[i]->getReadCounter())
+                    << "burst " << burst << " stream " << i;
+        }
+    }
+}
+
+// Around multiples of the sources fused per pass.
+INSTANTIATE_TEST_SUITE_P(AAudioMixer, AAudioMixerTest,
+                         ::testing::Values(1, 2, 3, 4, 5, 8, 9, 16));
+
+}  // namespace